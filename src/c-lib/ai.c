@@ -886,8 +886,10 @@ const struct aiEntry* gs1_lookupAIentry(gs1_encoder *ctx, const char *p, size_t
 /*
  *  Validate string between start and end pointers according to rules for an AI
  *
+ *  If fault is given then it receives the class of any failure.
+ *
  */
-static size_t validate_ai_val(gs1_encoder *ctx, const struct aiEntry *entry, const char *start, const char *end) {
+static size_t validate_ai_val(gs1_encoder *ctx, const struct aiEntry *entry, const char *start, const char *end, uint8_t *fault) {
 
 	const struct aiComponent *part;
 	size_t i, j;
@@ -902,13 +904,15 @@ static size_t validate_ai_val(gs1_encoder *ctx, const struct aiEntry *entry, con
 	assert(end);
 	assert(end >= start);
 
-	DEBUG_PRINT("  Considering AI (%s): %s (first %d characters)\n", entry->ai, start, (int)(end-start));
+	DEBUG_PRINT("  Considering AI (%s): %.*s\n", entry->ai, (int)(end-start), start);
 
 	p = start;
 	r = end;
 	if (p == r) {
 		sprintf(ctx->errMsg, "AI (%s) data is empty", entry->ai);
 		ctx->errFlag = true;
+		if (fault)
+			*fault = gs1_encoder_colEMPTY;
 		return 0;
 	}
 
@@ -929,20 +933,28 @@ static size_t validate_ai_val(gs1_encoder *ctx, const struct aiEntry *entry, con
 		if (complen < part->min) {
 			sprintf(ctx->errMsg, "AI (%s) data is too short", entry->ai);
 			ctx->errFlag = true;
+			if (fault)
+				*fault = gs1_encoder_colLENGTH;
 			return 0;
 		}
 
 		// Run the cset linter
 		linter = part->cset == cset_N ? lint_csetNumeric : lint_cset82;
-		if (!linter(ctx, entry, compval))
+		if (!linter(ctx, entry, compval)) {
+			if (fault)
+				*fault = gs1_encoder_colCHARSET;
 			return 0;
+		}
 
 		// Run each additional linter on the component
 		for (j = 0; j < SIZEOF_ARRAY(ai_table[0].parts[0].linters); j++) {
 			if (!part->linters[j])
 				break;
-			if (!part->linters[j](ctx, entry, compval))
+			if (!part->linters[j](ctx, entry, compval)) {
+				if (fault)
+					*fault = part->linters[j] == lint_csum ? gs1_encoder_colCHECKDIGIT : gs1_encoder_colCONTENT;
 				return 0;
+			}
 		}
 	}
 
@@ -1150,7 +1162,7 @@ bool gs1_processAIdata(gs1_encoder *ctx, const char *dataStr, const bool extract
 			r = p + strlen(p);
 
 		// Validate and return how much was consumed
-		if ((vallen = validate_ai_val(ctx, entry, p, r)) == 0)
+		if ((vallen = validate_ai_val(ctx, entry, p, r, NULL)) == 0)
 			return false;
 
 		// Add to the aiData
@@ -1230,6 +1242,300 @@ bool gs1_allDigits(const uint8_t *str, size_t len) {
 
 
 
+/*
+ *  Write the extracted AIs as a compact JSON object keyed by AI, in the order
+ *  of the input data, directly from the AI data without forming HRI text, e.g.
+ *
+ *    {"01":"12312312312333","10":"ABC123"}
+ *
+ *  A repeated AI is written once, at its first position, with an array of
+ *  its values in input order so that no value is lost to duplicate keys:
+ *
+ *    {"01":"12312312312333","21":["S1","S2"]}
+ *
+ *  Values are CSET 82 so only quote needs escaping; backslash is escaped
+ *  regardless.
+ *
+ */
+bool gs1_aiDataToJSON(const gs1_encoder *ctx, char *out, const size_t max) {
+
+	const struct aiValue *ai, *rep;
+	char *p = out, *end = out + max - 1;	// Room for NUL
+	int i, j, k, count;
+
+	assert(ctx);
+	assert(out);
+	assert(max > 0);
+
+#define PUT(c) do {					\
+	if (p == end)					\
+		goto fail;				\
+	*p++ = (c);					\
+} while (0)
+
+#define SAME_AI(a, b) ((a)->aiEntry && (a)->ailen == (b)->ailen && memcmp((a)->ai, (b)->ai, (b)->ailen) == 0)
+
+	PUT('{');
+	for (i = 0; i < ctx->numAIs; i++) {
+		ai = &ctx->aiData[i];
+		if (!ai->aiEntry)
+			continue;
+
+		// Repeats were written with the first occurrence
+		for (k = 0; k < i && !SAME_AI(&ctx->aiData[k], ai); k++)
+			;
+		if (k < i)
+			continue;
+		for (count = 0, k = i; k < ctx->numAIs; k++)
+			if (SAME_AI(&ctx->aiData[k], ai))
+				count++;
+
+		if (p != out + 1)
+			PUT(',');
+		PUT('"');
+		for (j = 0; j < ai->ailen; j++)
+			PUT(ai->ai[j]);
+		PUT('"');
+		PUT(':');
+		if (count > 1)
+			PUT('[');
+		for (k = i; k < ctx->numAIs; k++) {
+			rep = &ctx->aiData[k];
+			if (!SAME_AI(rep, ai))
+				continue;
+			if (k != i)
+				PUT(',');
+			PUT('"');
+			for (j = 0; j < rep->vallen; j++) {
+				if (rep->value[j] == '"' || rep->value[j] == '\\')
+					PUT('\\');
+				PUT(rep->value[j]);
+			}
+			PUT('"');
+		}
+		if (count > 1)
+			PUT(']');
+	}
+	PUT('}');
+	*p = '\0';
+
+#undef SAME_AI
+#undef PUT
+
+	return true;
+
+fail:
+
+	*out = '\0';
+	return false;
+
+}
+
+
+/*
+ *  Populate a record with references to the extracted AI values, with fixed
+ *  slots for the commonest AIs and the remainder in input order
+ *
+ */
+int gs1_aiDataToRecord(const gs1_encoder *ctx, gs1_encoder_aiRecord *record) {
+
+	const struct aiValue *ai;
+	gs1_encoder_aiField *field;
+	int i, num = 0;
+
+	assert(ctx);
+	assert(record);
+
+	memset(record, 0, sizeof(*record));
+
+	for (i = 0; i < ctx->numAIs; i++) {
+		ai = &ctx->aiData[i];
+		if (!ai->aiEntry)
+			continue;
+
+		field = NULL;
+		if (ai->ailen == 2 && ai->ai[0] == '0' && ai->ai[1] == '1')
+			field = &record->gtin;
+		else if (ai->ailen == 2 && ai->ai[0] == '1' && ai->ai[1] == '0')
+			field = &record->batch;
+		else if (ai->ailen == 2 && ai->ai[0] == '1' && ai->ai[1] == '7')
+			field = &record->expiry;
+		else if (ai->ailen == 2 && ai->ai[0] == '2' && ai->ai[1] == '1')
+			field = &record->serial;
+		if (!field || field->ai) {	// Repeats overflow too
+			assert(record->numOther < (int)SIZEOF_ARRAY(record->other));
+			field = &record->other[record->numOther++];
+		}
+
+		field->ai = ai->ai;
+		field->aiLen = ai->ailen;
+		field->value = ai->value;
+		field->valueLen = ai->vallen;
+		num++;
+	}
+
+	return num;
+
+}
+
+
+/*
+ *  Helpers for the column validation fast path, working on eight digits at a
+ *  time within a 64-bit word
+ *
+ */
+#define ONES64	UINT64_C(0x0101010101010101)
+
+static uint64_t load64(const uint8_t *p) {
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap64(v);	// First character in the low byte
+#endif
+	return v;
+}
+
+
+// Every byte is an ASCII digit, with no carry between bytes when adding 6
+static bool allDigits64(const uint64_t v) {
+	return (v & ONES64 * 0xF0) == ONES64 * 0x30 &&
+	       ((v + ONES64 * 0x06) & ONES64 * 0xF0) == ONES64 * 0x30;
+}
+
+
+/*
+ *  Check the digits and check digit of a fixed-length numeric value
+ *
+ *  The value is right-aligned in a field of zeros so that, with the check
+ *  digit last, every digit in an even position has weight 3 and every digit
+ *  in an odd position has weight 1. The weighted sum of a valid value,
+ *  including its check digit, is then a multiple of 10.
+ *
+ */
+static uint8_t numericCsumFault(const uint8_t *val, const size_t len) {
+
+	uint8_t field[24];
+	uint64_t v, acc = 0;
+	size_t i;
+
+	assert(len <= sizeof(field));
+
+	memset(field, '0', sizeof(field));
+	memcpy(&field[sizeof(field) - len], val, len);
+
+	for (i = 0; i < sizeof(field); i += 8) {
+		v = load64(&field[i]);
+		if (!allDigits64(v))
+			return gs1_encoder_colCHARSET;
+		v -= ONES64 * '0';
+		acc += 3 * (v & UINT64_C(0x00FF00FF00FF00FF)) + ((v >> 8) & UINT64_C(0x00FF00FF00FF00FF));
+	}
+
+	// Sum the four 16-bit lanes into the top lane
+	if (((acc * UINT64_C(0x0001000100010001)) >> 48) % 10 != 0)
+		return gs1_encoder_colCHECKDIGIT;
+
+	return gs1_encoder_colOK;
+
+}
+
+
+/*
+ *  Validate a column of values for a single AI held in an Arrow-style string
+ *  arena, where value i is data[offsets[i]] up to data[offsets[i+1]]
+ *
+ *  Fixed-length numeric AIs whose only rule is a check digit, such as GTIN and
+ *  SSCC, take a fast path. Values of other AIs are validated component by
+ *  component, exactly as in AI element strings.
+ *
+ */
+long gs1_validateAIcolumn(gs1_encoder *ctx, const char *ai, const char *data, const int32_t *offsets, const size_t count, uint8_t *validity, uint8_t *faults) {
+
+	const struct aiEntry *entry;
+	const struct aiComponent *part;
+	size_t i, len, minlen = 0, maxlen = 0, invalid = 0, first = 0;
+	const char *val;
+	uint8_t fault = gs1_encoder_colOK;
+	bool fast;
+	char msg[sizeof(ctx->errMsg)];
+
+	assert(ctx);
+	assert(ai);
+	assert(offsets);
+	assert(validity);
+
+	len = strlen(ai);
+	if (len < 2 || len > 4 || !gs1_allDigits((const uint8_t*)ai, len) ||
+	    (entry = gs1_lookupAIentry(ctx, ai, len)) == NULL) {
+		sprintf(ctx->errMsg, "Unrecognised AI: %.4s", ai);
+		ctx->errFlag = true;
+		return -1;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (offsets[i] < 0 || offsets[i+1] < offsets[i]) {
+			sprintf(ctx->errMsg, "Invalid offsets for value %d", (int)i);
+			ctx->errFlag = true;
+			return -1;
+		}
+	}
+
+	for (i = 0; i < SIZEOF_ARRAY(entry->parts); i++) {
+		minlen += entry->parts[i].min;
+		maxlen += entry->parts[i].max;
+	}
+
+	part = &entry->parts[0];
+	fast = part->cset == cset_N && part->min == part->max && part->max <= 24 &&
+	       part->linters[0] == lint_csum && entry->parts[1].cset == cset_none;
+
+	memset(validity, 0, (count + 7) / 8);
+
+	for (i = 0; i < count; i++) {
+		val = data + offsets[i];
+		len = (size_t)(offsets[i+1] - offsets[i]);
+
+		if (len == 0)
+			fault = gs1_encoder_colEMPTY;
+		else if (len < minlen || len > maxlen)
+			fault = gs1_encoder_colLENGTH;
+		else if (fast)
+			fault = numericCsumFault((const uint8_t*)val, len);
+		else if (validate_ai_val(ctx, entry, val, val + len, &fault) != 0)
+			fault = gs1_encoder_colOK;
+
+		if (fault == gs1_encoder_colOK)
+			validity[i / 8] |= (uint8_t)(1 << (i % 8));
+		else if (invalid++ == 0)
+			first = i;
+		if (faults)
+			faults[i] = fault;
+	}
+
+	ctx->errFlag = false;
+	ctx->errMsg[0] = '\0';
+
+	if (invalid == 0)
+		return 0;
+
+	// Describe the first failure as though it were an element string
+	val = data + offsets[first];
+	len = (size_t)(offsets[first+1] - offsets[first]);
+	if (len == 0) {
+		sprintf(msg, "AI (%s) data is empty", entry->ai);
+	} else {
+		if (gs1_aiValLengthContentCheck(ctx, entry, val, len))
+			validate_ai_val(ctx, entry, val, val + len, NULL);
+		strcpy(msg, ctx->errMsg);
+	}
+	sprintf(ctx->errMsg, "%d of %d values are invalid, first is value %d: %.400s", (int)invalid, (int)count, (int)first, msg);
+	ctx->errFlag = true;
+
+	return (long)invalid;
+
+}
+
+
 #ifdef UNIT_TESTS
 
 #define TEST_NO_MAIN
@@ -1519,5 +1825,141 @@ void test_ai_lint_csumalpha(void) {
 }
 
 
+void test_ai_aiDataToJSON(void) {
+
+	gs1_encoder* ctx;
+	gs1_encoder_aiRecord rec;
+	char out[64];
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+
+	TEST_ASSERT(gs1_encoder_setDataStr(ctx, "^10\"Q\"^21S1^21S2"));
+	TEST_CHECK(gs1_aiDataToJSON(ctx, out, sizeof(out)));
+	TEST_CHECK(strcmp(out, "{\"10\":\"\\\"Q\\\"\",\"21\":[\"S1\",\"S2\"]}") == 0);
+	TEST_MSG("Got: %s", out);
+
+	// Repeats are gathered at the first occurrence, whatever lies between
+	TEST_ASSERT(gs1_encoder_setDataStr(ctx, "^21S1^10A^21S2^21S3"));
+	TEST_CHECK(gs1_aiDataToJSON(ctx, out, sizeof(out)));
+	TEST_CHECK(strcmp(out, "{\"21\":[\"S1\",\"S2\",\"S3\"],\"10\":\"A\"}") == 0);
+	TEST_MSG("Got: %s", out);
+
+	// Exactly fits, including NUL
+	TEST_ASSERT(gs1_encoder_setDataStr(ctx, "^10\"Q\"^21S1^21S2"));
+	TEST_CHECK(gs1_aiDataToJSON(ctx, out, sizeof(out)));
+	TEST_CHECK(gs1_aiDataToJSON(ctx, out, strlen(out) + 1));
+	TEST_CHECK(!gs1_aiDataToJSON(ctx, out, strlen(out)));
+	TEST_CHECK(out[0] == '\0');
+	TEST_CHECK(!gs1_aiDataToJSON(ctx, out, 1));
+
+	// Repeated AIs overflow the fixed fields
+	TEST_CHECK(gs1_aiDataToRecord(ctx, &rec) == 3);
+	TEST_CHECK(rec.batch.valueLen == 3);
+	TEST_CHECK(rec.serial.valueLen == 2 && strncmp(rec.serial.value, "S1", 2) == 0);
+	TEST_CHECK(rec.numOther == 1);
+	TEST_CHECK(strncmp(rec.other[0].ai, "21", 2) == 0 && strncmp(rec.other[0].value, "S2", 2) == 0);
+
+	gs1_encoder_free(ctx);
+
+}
+
+
+void test_ai_validateAIcolumn(void) {
+
+	gs1_encoder* ctx;
+	char arena[1000 * 18], val[19];
+	int32_t offsets[1001];
+	uint8_t validity[125], faults[1000];
+	uint32_t rnd = 1;
+	size_t i, j;
+	bool ok;
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+
+	TEST_CHECK(gs1_validateAIcolumn(ctx, "0", "", offsets, 0, validity, NULL) == -1);
+	TEST_CHECK(strcmp(ctx->errMsg, "Unrecognised AI: 0") == 0);
+	TEST_CHECK(gs1_validateAIcolumn(ctx, "0A", "", offsets, 0, validity, NULL) == -1);
+	TEST_CHECK(gs1_validateAIcolumn(ctx, "89", "", offsets, 0, validity, NULL) == -1);
+
+	// SSCCs, some of which have a disturbed check digit or character
+	offsets[0] = 0;
+	for (i = 0; i < 1000; i++) {
+		for (j = 0; j < 18; j++) {
+			rnd = rnd * 1103515245 + 12345;
+			val[j] = (char)('0' + (rnd >> 16) % 10);
+		}
+		val[18] = '\0';
+		gs1_validateParity((uint8_t*)val);
+		if (i % 7 == 3)
+			val[17] = (char)('0' + (val[17] - '0' + 1) % 10);
+		if (i % 11 == 5)
+			val[i % 18] = 'A';
+		memcpy(&arena[i * 18], val, 18);
+		offsets[i + 1] = (int32_t)(i + 1) * 18;
+	}
+
+	TEST_CHECK(gs1_validateAIcolumn(ctx, "00", arena, offsets, 1000, validity, faults) == 221);
+	TEST_CHECK(ctx->errFlag);
+	TEST_CHECK(strcmp(ctx->errMsg, "221 of 1000 values are invalid, first is value 3: AI (00): Incorrect check digit") == 0);
+	TEST_MSG("Got: %s", ctx->errMsg);
+
+	// Matches the linters applied to element strings
+	for (i = 0; i < 1000; i++) {
+		sprintf(ctx->dataStr, "^00%.18s", &arena[i * 18]);
+		ok = gs1_processAIdata(ctx, ctx->dataStr, false);
+		TEST_CHECK(ok == ((validity[i / 8] >> (i % 8)) & 1));
+		TEST_CHECK(faults[i] == (ok ? gs1_encoder_colOK : i % 11 == 5 ? gs1_encoder_colCHARSET : gs1_encoder_colCHECKDIGIT));
+		TEST_MSG("Value %d", (int)i);
+	}
+
+	// Lengths and components of an AI that is validated generally
+	strcpy(arena, "1231231231232" "1231231231233ABC" "123123123123" "1231231231232AB C" "1231231231232" "123123123123A");
+	offsets[0] = 0;
+	offsets[1] = 13;
+	offsets[2] = 29;
+	offsets[3] = 41;
+	offsets[4] = 58;
+	offsets[5] = 58;
+	offsets[6] = 71;
+	offsets[7] = 84;
+	TEST_CHECK(gs1_validateAIcolumn(ctx, "253", arena, offsets, 7, validity, faults) == 5);
+	TEST_CHECK(validity[0] == 0x21);
+	TEST_CHECK(faults[0] == gs1_encoder_colOK);
+	TEST_CHECK(faults[1] == gs1_encoder_colCHECKDIGIT);
+	TEST_CHECK(faults[2] == gs1_encoder_colLENGTH);
+	TEST_CHECK(faults[3] == gs1_encoder_colCHARSET);
+	TEST_CHECK(faults[4] == gs1_encoder_colEMPTY);
+	TEST_CHECK(faults[5] == gs1_encoder_colOK);
+	TEST_CHECK(faults[6] == gs1_encoder_colCHARSET);
+	TEST_CHECK(strcmp(ctx->errMsg, "5 of 7 values are invalid, first is value 1: AI (253): Incorrect check digit") == 0);
+	TEST_MSG("Got: %s", ctx->errMsg);
+
+	// Rules other than character set and check digit
+	strcpy(arena, "1987654Ad4X4bL5ttr2310c2K" "12345678901234567890123456");
+	offsets[1] = 25;
+	offsets[2] = 51;
+	TEST_CHECK(gs1_validateAIcolumn(ctx, "8013", arena, offsets, 2, validity, faults) == 1);
+	TEST_CHECK(faults[0] == gs1_encoder_colOK);
+	TEST_CHECK(faults[1] == gs1_encoder_colLENGTH);
+	TEST_CHECK(strcmp(ctx->errMsg, "1 of 2 values are invalid, first is value 1: AI (8013) value is too long") == 0);
+	TEST_MSG("Got: %s", ctx->errMsg);
+	offsets[2] = 50;
+	TEST_CHECK(gs1_validateAIcolumn(ctx, "8013", arena, offsets, 2, validity, faults) == 1);
+	TEST_CHECK(faults[1] == gs1_encoder_colCONTENT);
+
+	TEST_CHECK(gs1_validateAIcolumn(ctx, "8013", arena, offsets, 1, validity, NULL) == 0);
+	TEST_CHECK(!ctx->errFlag);
+	TEST_CHECK(gs1_validateAIcolumn(ctx, "01", arena, offsets, 0, validity, NULL) == 0);
+
+	// Offsets must be ascending
+	offsets[2] = 20;
+	TEST_CHECK(gs1_validateAIcolumn(ctx, "8013", arena, offsets, 2, validity, NULL) == -1);
+	TEST_CHECK(strcmp(ctx->errMsg, "Invalid offsets for value 1") == 0);
+
+	gs1_encoder_free(ctx);
+
+}
+
+
 #endif  /* UNIT_TESTS */
 
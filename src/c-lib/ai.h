@@ -26,7 +26,7 @@
 #include <string.h>
 
 
-#define MAX_AIS		64
+#define MAX_AIS		64	// Also the capacity of gs1_encoder_aiRecord.other
 #define MAX_AI_LEN	90
 
 
@@ -92,6 +92,9 @@ bool gs1_parseAIdata(gs1_encoder *ctx, const char *aiData, char *dataStr);
 bool gs1_processAIdata(gs1_encoder *ctx, const char *dataStr, bool extractAIs);
 bool gs1_validateParity(uint8_t *str);
 bool gs1_allDigits(const uint8_t *str, size_t len);
+bool gs1_aiDataToJSON(const gs1_encoder *ctx, char *out, size_t max);
+int gs1_aiDataToRecord(const gs1_encoder *ctx, gs1_encoder_aiRecord *record);
+long gs1_validateAIcolumn(gs1_encoder *ctx, const char *ai, const char *data, const int32_t *offsets, size_t count, uint8_t *validity, uint8_t *faults);
 
 
 #ifdef UNIT_TESTS
@@ -102,6 +105,8 @@ void test_ai_parseAIdata(void);
 void test_ai_processAIdata(void);
 void test_ai_validateParity(void);
 void test_ai_lint_csumalpha(void);
+void test_ai_aiDataToJSON(void);
+void test_ai_validateAIcolumn(void);
 
 #endif
 
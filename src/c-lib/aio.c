@@ -0,0 +1,918 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE	// fallocate()
+#endif
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define AIO_URING
+#endif
+
+#include "enc-private.h"
+#include "aio.h"
+
+
+#ifndef NOMALLOC
+
+/*
+ *  Asynchronous file output: each symbol is emitted into a slot buffer, then
+ *  the open, write and close of its file are handed to io_uring or, where
+ *  that is unavailable, to a pool of writer threads, so that the encoding
+ *  thread only waits when every slot is in flight
+ *
+ */
+
+enum { SLOT_FREE, SLOT_FILLING, SLOT_QUEUED, SLOT_OPENING, SLOT_WRITING };
+enum { OP_OPEN = 1, OP_FALLOCATE, OP_WRITE, OP_CLOSE };
+
+struct aioSlot {
+	int state;
+	uint8_t *data;			// Preallocated buffer, or its replacement on the heap
+	size_t len;
+	size_t cap;
+	int fd;
+	int pending;			// Completions outstanding for the write chain
+	bool failed;
+	char path[MAX_FNAME+1];
+	struct aioSlot *next;		// Writer thread queue
+};
+
+struct aioState {
+	int backend;
+	int depth;
+	struct aioSlot *slots;
+	uint8_t *fixed;			// Preallocated buffers of all slots
+	int failures;
+	char failMsg[MAX_FNAME+32];
+#ifdef AIO_URING
+	int ringFd;
+	bool registered;		// Preallocated buffers are registered with the ring
+	void *sqMap;
+	size_t sqMapLen;
+	void *cqMap;
+	size_t cqMapLen;
+	struct io_uring_sqe *sqes;
+	size_t sqesLen;
+	unsigned sqEntries;
+	unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+	unsigned *cqHead, *cqTail, *cqMask;
+	struct io_uring_cqe *cqes;
+	unsigned toSubmit;
+#endif
+#ifndef _WIN32
+	pthread_t threads[AIO_THREADS];
+	int numThreads;
+	pthread_mutex_t lock;
+	pthread_cond_t work;
+	pthread_cond_t done;
+	struct aioSlot *queueHead;
+	struct aioSlot *queueTail;
+	bool stop;
+#endif
+};
+
+
+static uint8_t* fixedBuffer(const struct aioState *a, const struct aioSlot *s) {
+	return &a->fixed[(size_t)(s - a->slots) * AIO_SLOT_SIZE];
+}
+
+
+static void fail(struct aioState *a, const struct aioSlot *s) {
+	if (a->failures++ == 0)
+		sprintf(a->failMsg, "Failed writing to file: %.*s", MAX_FNAME, s->path);
+}
+
+
+static void release(struct aioState *a, struct aioSlot *s) {
+	if (s->data != fixedBuffer(a, s))
+		free(s->data);
+	s->data = fixedBuffer(a, s);
+	s->cap = AIO_SLOT_SIZE;
+	s->state = SLOT_FREE;
+}
+
+
+static struct aioSlot* freeSlot(struct aioState *a) {
+
+	int i;
+
+	for (i = 0; i < a->depth; i++)
+		if (a->slots[i].state == SLOT_FREE)
+			return &a->slots[i];
+	return NULL;
+
+}
+
+
+// Synchronous write of a whole file, for the writer threads and fallback
+static bool writeFile(const struct aioSlot *s) {
+
+#ifndef _WIN32
+
+	const uint8_t *p = s->data;
+	size_t n = s->len;
+	ssize_t w;
+	int fd;
+	bool ok = true;
+
+	if ((fd = open(s->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666)) < 0)
+		return false;
+#ifdef __linux__
+	if (n > 0)
+		(void)fallocate(fd, 0, 0, (off_t)n);	// Best effort
+#endif
+	while (n > 0) {
+		if ((w = write(fd, p, n)) < 0) {
+			if (errno == EINTR)
+				continue;
+			ok = false;
+			break;
+		}
+		p += w;
+		n -= (size_t)w;
+	}
+	return close(fd) == 0 && ok;
+
+#else
+
+	FILE *fp;
+	bool ok;
+
+	if ((fp = fopen(s->path, "wb")) == NULL)
+		return false;
+	ok = s->len == 0 || fwrite(s->data, s->len, 1, fp) == 1;
+	return fclose(fp) == 0 && ok;
+
+#endif
+
+}
+
+
+#ifdef AIO_URING
+
+static int uringEnter(const struct aioState *a, const unsigned toSubmit, const unsigned minComplete, const unsigned flags) {
+
+	long ret;
+
+	do {
+		ret = syscall(__NR_io_uring_enter, a->ringFd, toSubmit, minComplete, flags, NULL, 0);
+	} while (ret < 0 && errno == EINTR);
+
+	return (int)ret;
+
+}
+
+
+static void uringTeardown(struct aioState *a) {
+
+	if (a->sqes)
+		munmap(a->sqes, a->sqesLen);
+	if (a->cqMap && a->cqMap != a->sqMap)
+		munmap(a->cqMap, a->cqMapLen);
+	if (a->sqMap)
+		munmap(a->sqMap, a->sqMapLen);
+	if (a->ringFd >= 0)
+		close(a->ringFd);	// Also unregisters the buffers
+	a->sqes = NULL;
+	a->sqMap = a->cqMap = NULL;
+	a->ringFd = -1;
+
+}
+
+
+static bool uringSetup(struct aioState *a) {
+
+	static const int ops[] = { IORING_OP_OPENAT, IORING_OP_FALLOCATE, IORING_OP_WRITE, IORING_OP_WRITE_FIXED, IORING_OP_CLOSE };
+	struct io_uring_params p;
+	struct io_uring_probe *probe;
+	struct iovec *iov;
+	char *sq, *cq;
+	size_t i;
+	bool ok;
+
+	memset(&p, 0, sizeof(p));
+	if ((a->ringFd = (int)syscall(__NR_io_uring_setup, (unsigned)(4 * a->depth), &p)) < 0)
+		return false;
+
+	// Every operation of the write chain must be supported by the kernel
+	if ((probe = calloc(1, sizeof(*probe) + 256 * sizeof(struct io_uring_probe_op))) == NULL)
+		goto fail;
+	ok = syscall(__NR_io_uring_register, a->ringFd, IORING_REGISTER_PROBE, probe, 256) == 0;
+	for (i = 0; ok && i < SIZEOF_ARRAY(ops); i++)
+		ok = ops[i] < probe->ops_len && (probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED);
+	free(probe);
+	if (!ok)
+		goto fail;
+
+	a->sqMapLen = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	a->cqMapLen = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (a->cqMapLen > a->sqMapLen)
+			a->sqMapLen = a->cqMapLen;
+		a->cqMapLen = a->sqMapLen;
+	}
+	a->sqMap = mmap(NULL, a->sqMapLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, a->ringFd, IORING_OFF_SQ_RING);
+	if (a->sqMap == MAP_FAILED) {
+		a->sqMap = NULL;
+		goto fail;
+	}
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		a->cqMap = a->sqMap;
+	} else {
+		a->cqMap = mmap(NULL, a->cqMapLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, a->ringFd, IORING_OFF_CQ_RING);
+		if (a->cqMap == MAP_FAILED) {
+			a->cqMap = NULL;
+			goto fail;
+		}
+	}
+	a->sqesLen = p.sq_entries * sizeof(struct io_uring_sqe);
+	a->sqes = mmap(NULL, a->sqesLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, a->ringFd, IORING_OFF_SQES);
+	if (a->sqes == MAP_FAILED) {
+		a->sqes = NULL;
+		goto fail;
+	}
+
+	sq = a->sqMap;
+	cq = a->cqMap;
+	a->sqEntries = p.sq_entries;
+	a->sqHead = (unsigned *)(sq + p.sq_off.head);
+	a->sqTail = (unsigned *)(sq + p.sq_off.tail);
+	a->sqMask = (unsigned *)(sq + p.sq_off.ring_mask);
+	a->sqArray = (unsigned *)(sq + p.sq_off.array);
+	a->cqHead = (unsigned *)(cq + p.cq_off.head);
+	a->cqTail = (unsigned *)(cq + p.cq_off.tail);
+	a->cqMask = (unsigned *)(cq + p.cq_off.ring_mask);
+	a->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+	a->toSubmit = 0;
+
+	// Registered buffers spare the kernel mapping each write, but count
+	// towards the locked memory limit so are optional
+	if ((iov = malloc((size_t)a->depth * sizeof(struct iovec))) != NULL) {
+		for (i = 0; i < (size_t)a->depth; i++) {
+			iov[i].iov_base = &a->fixed[i * AIO_SLOT_SIZE];
+			iov[i].iov_len = AIO_SLOT_SIZE;
+		}
+		a->registered = syscall(__NR_io_uring_register, a->ringFd, IORING_REGISTER_BUFFERS, iov, a->depth) == 0;
+		free(iov);
+	}
+
+	return true;
+
+fail:
+
+	uringTeardown(a);
+	return false;
+
+}
+
+
+static struct io_uring_sqe* uringSqe(struct aioState *a, const struct aioSlot *s, const int op) {
+
+	unsigned tail = *a->sqTail;
+	unsigned idx;
+	struct io_uring_sqe *sqe;
+
+	// At most three entries per slot await submission, within 4 * depth
+	assert(tail - __atomic_load_n(a->sqHead, __ATOMIC_ACQUIRE) < a->sqEntries);
+
+	idx = tail & *a->sqMask;
+	sqe = &a->sqes[idx];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->user_data = (__u64)((size_t)(s - a->slots) << 8 | (size_t)op);
+	a->sqArray[idx] = idx;
+	__atomic_store_n(a->sqTail, tail + 1, __ATOMIC_RELEASE);
+	a->toSubmit++;
+
+	return sqe;
+
+}
+
+
+static void uringSubmit(struct aioState *a) {
+
+	int n;
+
+	if (a->toSubmit > 0 && (n = uringEnter(a, a->toSubmit, 0, 0)) > 0)
+		a->toSubmit -= (unsigned)n;
+
+}
+
+
+// Once the file is open, allocate, write and close it as a linked chain
+static void uringChain(struct aioState *a, struct aioSlot *s) {
+
+	struct io_uring_sqe *sqe;
+
+	assert(s->len <= UINT32_MAX);
+
+	// Hard links so that the file is closed whatever fails
+	sqe = uringSqe(a, s, OP_FALLOCATE);
+	sqe->opcode = IORING_OP_FALLOCATE;
+	sqe->fd = s->fd;
+	sqe->addr = s->len;
+	sqe->flags = IOSQE_IO_HARDLINK;
+
+	sqe = uringSqe(a, s, OP_WRITE);
+	if (a->registered && s->data == fixedBuffer(a, s)) {
+		sqe->opcode = IORING_OP_WRITE_FIXED;
+		sqe->buf_index = (uint16_t)(s - a->slots);
+	} else {
+		sqe->opcode = IORING_OP_WRITE;
+	}
+	sqe->fd = s->fd;
+	sqe->addr = (uint64_t)(uintptr_t)s->data;
+	sqe->len = (uint32_t)s->len;
+	sqe->flags = IOSQE_IO_HARDLINK;
+
+	sqe = uringSqe(a, s, OP_CLOSE);
+	sqe->opcode = IORING_OP_CLOSE;
+	sqe->fd = s->fd;
+
+	s->pending = 3;
+	s->state = SLOT_WRITING;
+
+}
+
+
+static void uringComplete(struct aioState *a, const uint64_t userData, const int res) {
+
+	struct aioSlot *s = &a->slots[userData >> 8];
+
+	switch ((int)(userData & 0xFF)) {
+	case OP_OPEN:
+		if (res < 0) {
+			fail(a, s);
+			release(a, s);
+			return;
+		}
+		s->fd = res;
+		uringChain(a, s);
+		return;
+	case OP_FALLOCATE:		// Best effort
+		break;
+	case OP_WRITE:
+		if (res < 0 || (size_t)res != s->len)
+			s->failed = true;
+		break;
+	case OP_CLOSE:
+		if (res < 0)
+			s->failed = true;
+		break;
+	}
+
+	if (--s->pending == 0) {
+		if (s->failed)
+			fail(a, s);
+		release(a, s);
+	}
+
+}
+
+
+// Process completions without waiting, submitting any chains they start
+static void uringReap(struct aioState *a) {
+
+	unsigned head = *a->cqHead;
+	unsigned tail = __atomic_load_n(a->cqTail, __ATOMIC_ACQUIRE);
+	const struct io_uring_cqe *cqe;
+
+	while (head != tail) {
+		cqe = &a->cqes[head & *a->cqMask];
+		uringComplete(a, cqe->user_data, cqe->res);
+		head++;
+	}
+	__atomic_store_n(a->cqHead, head, __ATOMIC_RELEASE);
+
+	uringSubmit(a);
+
+}
+
+
+static bool uringInFlight(const struct aioState *a) {
+
+	int i;
+
+	for (i = 0; i < a->depth; i++)
+		if (a->slots[i].state == SLOT_OPENING || a->slots[i].state == SLOT_WRITING)
+			return true;
+	return false;
+
+}
+
+#endif  /* AIO_URING */
+
+
+#ifndef _WIN32
+
+static void* writer(void *arg) {
+
+	struct aioState *a = arg;
+	struct aioSlot *s;
+	bool ok;
+
+	pthread_mutex_lock(&a->lock);
+	for (;;) {
+		while (!a->queueHead && !a->stop)
+			pthread_cond_wait(&a->work, &a->lock);
+		if (!a->queueHead)
+			break;
+		s = a->queueHead;
+		if ((a->queueHead = s->next) == NULL)
+			a->queueTail = NULL;
+		pthread_mutex_unlock(&a->lock);
+
+		ok = writeFile(s);
+
+		pthread_mutex_lock(&a->lock);
+		if (!ok)
+			fail(a, s);
+		release(a, s);
+		pthread_cond_signal(&a->done);
+	}
+	pthread_mutex_unlock(&a->lock);
+
+	return NULL;
+
+}
+
+
+static bool threadsStart(struct aioState *a) {
+
+	int n = a->depth < AIO_THREADS ? a->depth : AIO_THREADS;
+
+	if (pthread_mutex_init(&a->lock, NULL) != 0)
+		return false;
+	if (pthread_cond_init(&a->work, NULL) != 0) {
+		pthread_mutex_destroy(&a->lock);
+		return false;
+	}
+	if (pthread_cond_init(&a->done, NULL) != 0) {
+		pthread_cond_destroy(&a->work);
+		pthread_mutex_destroy(&a->lock);
+		return false;
+	}
+
+	for (a->numThreads = 0; a->numThreads < n; a->numThreads++)
+		if (pthread_create(&a->threads[a->numThreads], NULL, writer, a) != 0)
+			break;
+
+	if (a->numThreads == 0) {
+		pthread_cond_destroy(&a->done);
+		pthread_cond_destroy(&a->work);
+		pthread_mutex_destroy(&a->lock);
+		return false;
+	}
+
+	return true;
+
+}
+
+
+static void threadsStop(struct aioState *a) {
+
+	int i;
+
+	pthread_mutex_lock(&a->lock);
+	a->stop = true;
+	pthread_cond_broadcast(&a->work);
+	pthread_mutex_unlock(&a->lock);
+
+	for (i = 0; i < a->numThreads; i++)
+		pthread_join(a->threads[i], NULL);
+
+	pthread_cond_destroy(&a->done);
+	pthread_cond_destroy(&a->work);
+	pthread_mutex_destroy(&a->lock);
+
+}
+
+#endif  /* _WIN32 */
+
+
+bool gs1_aioOpen(gs1_encoder *ctx, const int depth, const int backend) {
+
+	struct aioState *a;
+	int i;
+
+	if (ctx->aio) {
+		strcpy(ctx->errMsg, "Asynchronous output is already open");
+		ctx->errFlag = true;
+		return false;
+	}
+
+	if (depth < 1 || depth > AIO_MAX_DEPTH) {
+		sprintf(ctx->errMsg, "Valid asynchronous output depth is 1 to %d", AIO_MAX_DEPTH);
+		ctx->errFlag = true;
+		return false;
+	}
+
+	if ((a = calloc(1, sizeof(struct aioState))) == NULL ||
+	    (a->slots = calloc((size_t)depth, sizeof(struct aioSlot))) == NULL ||
+	    (a->fixed = malloc((size_t)depth * AIO_SLOT_SIZE)) == NULL) {
+		if (a)
+			free(a->slots);
+		free(a);
+		strcpy(ctx->errMsg, "Out of memory allocating asynchronous output buffers");
+		ctx->errFlag = true;
+		return false;
+	}
+
+	a->depth = depth;
+	for (i = 0; i < depth; i++)
+		release(a, &a->slots[i]);
+
+	// Use the requested backend, or the best that is available
+	a->backend = gs1_encoder_asyncSYNC;
+#ifdef AIO_URING
+	a->ringFd = -1;
+	if ((backend == gs1_encoder_asyncNONE || backend == gs1_encoder_asyncIOURING) && uringSetup(a))
+		a->backend = gs1_encoder_asyncIOURING;
+	else
+#endif
+#ifndef _WIN32
+	if (backend != gs1_encoder_asyncSYNC && threadsStart(a))
+		a->backend = gs1_encoder_asyncTHREADS;
+#endif
+
+	ctx->aio = a;
+	ctx->driver_aioSlot = NULL;
+	return true;
+
+}
+
+
+// Wait for all files to be written, reporting any that failed
+bool gs1_aioClose(gs1_encoder *ctx) {
+
+	struct aioState *a = ctx->aio;
+	bool ok;
+	int i;
+
+	if (!a) {
+		strcpy(ctx->errMsg, "No asynchronous output is open");
+		ctx->errFlag = true;
+		return false;
+	}
+
+	// An unfinished symbol is discarded
+	ctx->driver_aioSlot = NULL;
+
+#ifdef AIO_URING
+	if (a->backend == gs1_encoder_asyncIOURING) {
+		uringReap(a);
+		while (uringInFlight(a) && uringEnter(a, a->toSubmit, 1, IORING_ENTER_GETEVENTS) >= 0)
+			uringReap(a);
+		uringTeardown(a);
+	}
+#endif
+#ifndef _WIN32
+	if (a->backend == gs1_encoder_asyncTHREADS)
+		threadsStop(a);
+#endif
+
+	for (i = 0; i < a->depth; i++)
+		release(a, &a->slots[i]);
+
+	if ((ok = a->failures == 0) == false) {
+		if (a->failures == 1)
+			strcpy(ctx->errMsg, a->failMsg);
+		else
+			sprintf(ctx->errMsg, "%s, and %d other files", a->failMsg, a->failures - 1);
+		ctx->errFlag = true;
+	}
+
+	free(a->fixed);
+	free(a->slots);
+	free(a);
+	ctx->aio = NULL;
+
+	return ok;
+
+}
+
+
+// Take a free slot to receive the next file, waiting only if all are in flight
+bool gs1_aioAcquire(gs1_encoder *ctx) {
+
+	struct aioState *a = ctx->aio;
+	struct aioSlot *s = ctx->driver_aioSlot;
+
+	if (s) {	// Left by a symbol that failed to complete
+		s->len = 0;
+		return true;
+	}
+
+#ifdef AIO_URING
+	if (a->backend == gs1_encoder_asyncIOURING) {
+		uringReap(a);
+		while ((s = freeSlot(a)) == NULL) {
+			if (uringEnter(a, a->toSubmit, 1, IORING_ENTER_GETEVENTS) < 0) {
+				strcpy(ctx->errMsg, "Failed waiting for asynchronous output");
+				ctx->errFlag = true;
+				return false;
+			}
+			uringReap(a);
+		}
+	}
+#endif
+#ifndef _WIN32
+	if (a->backend == gs1_encoder_asyncTHREADS) {
+		pthread_mutex_lock(&a->lock);
+		while ((s = freeSlot(a)) == NULL)
+			pthread_cond_wait(&a->done, &a->lock);
+		pthread_mutex_unlock(&a->lock);
+	}
+#endif
+	if (a->backend == gs1_encoder_asyncSYNC)
+		s = freeSlot(a);
+
+	assert(s);
+	s->state = SLOT_FILLING;
+	s->len = 0;
+	s->failed = false;
+	ctx->driver_aioSlot = s;
+
+	return true;
+
+}
+
+
+bool gs1_aioAppend(gs1_encoder *ctx, const void *data, const size_t len) {
+
+	struct aioSlot *s = ctx->driver_aioSlot;
+	uint8_t *buf;
+	size_t cap;
+
+	if (s->len + len > s->cap) {
+		cap = s->cap * 2 > s->len + len ? s->cap * 2 : s->len + len;
+		if (s->data == fixedBuffer(ctx->aio, s)) {
+			if ((buf = malloc(cap)) != NULL)
+				memcpy(buf, s->data, s->len);
+		} else {
+			buf = realloc(s->data, cap);
+		}
+		if (!buf) {
+			strcpy(ctx->errMsg, "Out of memory buffering asynchronous output");
+			ctx->errFlag = true;
+			return false;
+		}
+		s->data = buf;
+		s->cap = cap;
+	}
+
+	memcpy(&s->data[s->len], data, len);
+	s->len += len;
+	return true;
+
+}
+
+
+// Queue the completed file to be written under the current output filename
+bool gs1_aioSubmit(gs1_encoder *ctx) {
+
+	struct aioState *a = ctx->aio;
+	struct aioSlot *s = ctx->driver_aioSlot;
+
+	strcpy(s->path, ctx->outFile);
+	ctx->driver_aioSlot = NULL;
+
+#ifdef AIO_URING
+	if (a->backend == gs1_encoder_asyncIOURING) {
+		struct io_uring_sqe *sqe = uringSqe(a, s, OP_OPEN);
+		sqe->opcode = IORING_OP_OPENAT;
+		sqe->fd = AT_FDCWD;
+		sqe->addr = (uint64_t)(uintptr_t)s->path;
+		sqe->len = 0666;
+		sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+		s->state = SLOT_OPENING;
+		uringReap(a);
+		return true;
+	}
+#endif
+#ifndef _WIN32
+	if (a->backend == gs1_encoder_asyncTHREADS) {
+		pthread_mutex_lock(&a->lock);
+		s->state = SLOT_QUEUED;
+		s->next = NULL;
+		if (a->queueTail)
+			a->queueTail->next = s;
+		else
+			a->queueHead = s;
+		a->queueTail = s;
+		pthread_cond_signal(&a->work);
+		pthread_mutex_unlock(&a->lock);
+		return true;
+	}
+#endif
+
+	if (!writeFile(s))
+		fail(a, s);
+	release(a, s);
+	return true;
+
+}
+
+
+int gs1_aioBackend(const gs1_encoder *ctx) {
+	return ctx->aio ? ctx->aio->backend : gs1_encoder_asyncNONE;
+}
+
+#else
+
+/*
+ *  Writer threads and their slot buffers are allocated on the heap, so
+ *  NOMALLOC builds write each file synchronously as it is emitted
+ *
+ */
+bool gs1_aioOpen(gs1_encoder *ctx, const int depth, const int backend) {
+	(void)depth;
+	(void)backend;
+	strcpy(ctx->errMsg, "Asynchronous output is not available in NOMALLOC builds");
+	ctx->errFlag = true;
+	return false;
+}
+
+bool gs1_aioClose(gs1_encoder *ctx) {
+	strcpy(ctx->errMsg, "No asynchronous output is open");
+	ctx->errFlag = true;
+	return false;
+}
+
+bool gs1_aioAcquire(gs1_encoder *ctx) {
+	(void)ctx;
+	return false;
+}
+
+bool gs1_aioAppend(gs1_encoder *ctx, const void *data, const size_t len) {
+	(void)ctx;
+	(void)data;
+	(void)len;
+	return false;
+}
+
+bool gs1_aioSubmit(gs1_encoder *ctx) {
+	(void)ctx;
+	return false;
+}
+
+int gs1_aioBackend(const gs1_encoder *ctx) {
+	(void)ctx;
+	return gs1_encoder_asyncNONE;
+}
+
+#endif  /* NOMALLOC */
+
+
+
+#ifdef UNIT_TESTS
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+
+static uint8_t* readFile(const char *fname, size_t *size) {
+
+	FILE *fp;
+	uint8_t *data;
+	long n;
+
+	if ((fp = fopen(fname, "rb")) == NULL)
+		return NULL;
+	fseek(fp, 0, SEEK_END);
+	n = ftell(fp);
+	rewind(fp);
+	if (n <= 0 || (data = malloc((size_t)n)) == NULL || fread(data, (size_t)n, 1, fp) != 1) {
+		fclose(fp);
+		return NULL;
+	}
+	fclose(fp);
+	*size = (size_t)n;
+	return data;
+
+}
+
+
+void test_aio_backends(void) {
+
+	static const int backends[] = { gs1_encoder_asyncIOURING, gs1_encoder_asyncTHREADS, gs1_encoder_asyncSYNC };
+	static const int pixMults[] = { 1, 2, 3, 24 };		// The last outgrows a slot buffer
+	gs1_encoder* ctx;
+	uint8_t *ref[SIZEOF_ARRAY(pixMults)], *data;
+	size_t refSize[SIZEOF_ARRAY(pixMults)], size = 0;
+	char fname[32];
+	void *buf;
+	size_t i, j, k;
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sQR));
+	TEST_CHECK(gs1_encoder_setDataStr(ctx, "https://id.gs1.org/01/12312312312333"));
+	TEST_CHECK(gs1_encoder_setFormat(ctx, gs1_encoder_dBMP));
+
+	// Reference images from buffer output
+	TEST_CHECK(gs1_encoder_setOutFile(ctx, ""));
+	for (i = 0; i < SIZEOF_ARRAY(pixMults); i++) {
+		TEST_CHECK(gs1_encoder_setPixMult(ctx, pixMults[i]));
+		TEST_ASSERT(gs1_encoder_encode(ctx));
+		refSize[i] = gs1_encoder_getBuffer(ctx, &buf);
+		TEST_ASSERT((ref[i] = malloc(refSize[i])) != NULL);
+		memcpy(ref[i], buf, refSize[i]);
+	}
+	TEST_CHECK(refSize[SIZEOF_ARRAY(pixMults) - 1] > AIO_SLOT_SIZE);
+
+	for (i = 0; i < SIZEOF_ARRAY(backends); i++) {
+
+		// Fewer slots than files, so that slots are recycled
+		TEST_ASSERT(gs1_aioOpen(ctx, 2, backends[i]));
+		TEST_CASE_(gs1_aioBackend(ctx) == gs1_encoder_asyncIOURING ? "io_uring" :
+			   gs1_aioBackend(ctx) == gs1_encoder_asyncTHREADS ? "threads" : "sync");
+#ifndef _WIN32
+		if (backends[i] == gs1_encoder_asyncTHREADS)
+			TEST_CHECK(gs1_aioBackend(ctx) == gs1_encoder_asyncTHREADS);
+#endif
+		if (backends[i] == gs1_encoder_asyncSYNC)
+			TEST_CHECK(gs1_aioBackend(ctx) == gs1_encoder_asyncSYNC);
+
+		for (k = 0; k < 3; k++) {
+			for (j = 0; j < SIZEOF_ARRAY(pixMults); j++) {
+				sprintf(fname, "gs1encoders-test-aio%d.bmp", (int)(k * SIZEOF_ARRAY(pixMults) + j));
+				TEST_CHECK(gs1_encoder_setPixMult(ctx, pixMults[j]));
+				TEST_CHECK(gs1_encoder_setOutFile(ctx, fname));
+				TEST_CHECK(gs1_encoder_encode(ctx));
+			}
+		}
+
+		// Buffer output is unaffected
+		TEST_CHECK(gs1_encoder_setOutFile(ctx, ""));
+		TEST_CHECK(gs1_encoder_encode(ctx));
+		TEST_CHECK(gs1_encoder_getBuffer(ctx, &buf) == refSize[SIZEOF_ARRAY(pixMults) - 1]);
+
+		TEST_CHECK(gs1_aioClose(ctx));
+
+		for (k = 0; k < 3 * SIZEOF_ARRAY(pixMults); k++) {
+			sprintf(fname, "gs1encoders-test-aio%d.bmp", (int)k);
+			j = k % SIZEOF_ARRAY(pixMults);
+			TEST_ASSERT((data = readFile(fname, &size)) != NULL);
+			TEST_CHECK(size == refSize[j]);
+			TEST_CHECK(size == refSize[j] && memcmp(data, ref[j], size) == 0);
+			TEST_MSG("File %s", fname);
+			free(data);
+			remove(fname);
+		}
+
+		// Failures are reported on close
+		TEST_ASSERT(gs1_aioOpen(ctx, 2, backends[i]));
+		TEST_CHECK(gs1_encoder_setOutFile(ctx, "gs1encoders-test-aio/missing.bmp"));
+		TEST_CHECK(gs1_encoder_encode(ctx));
+		TEST_CHECK(gs1_encoder_encode(ctx));
+		TEST_CHECK(!gs1_aioClose(ctx));
+		TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "Failed writing to file: gs1encoders-test-aio/missing.bmp, and 1 other files") == 0);
+		TEST_MSG("Got: %s", gs1_encoder_getErrMsg(ctx));
+
+	}
+
+	for (i = 0; i < SIZEOF_ARRAY(pixMults); i++)
+		free(ref[i]);
+
+	gs1_encoder_free(ctx);
+
+}
+
+
+#endif  /* UNIT_TESTS */
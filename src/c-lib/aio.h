@@ -0,0 +1,52 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef AIO_H
+#define AIO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "gs1encoders.h"
+
+
+#define AIO_MAX_DEPTH	256		// Files in flight
+#define AIO_SLOT_SIZE	(64 * 1024)	// Preallocated buffer per file, outgrown onto the heap
+#define AIO_THREADS	4		// Writer threads when io_uring is unavailable
+
+struct aioState;
+struct aioSlot;
+
+bool gs1_aioOpen(gs1_encoder *ctx, int depth, int backend);
+bool gs1_aioClose(gs1_encoder *ctx);
+bool gs1_aioAcquire(gs1_encoder *ctx);
+bool gs1_aioAppend(gs1_encoder *ctx, const void *data, size_t len);
+bool gs1_aioSubmit(gs1_encoder *ctx);
+int gs1_aioBackend(const gs1_encoder *ctx);
+
+
+#ifdef UNIT_TESTS
+
+void test_aio_backends(void);
+
+#endif
+
+
+#endif  /* AIO_H */
@@ -0,0 +1,162 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+
+#ifndef NOMALLOC
+
+void gs1_arenaInit(struct arena *a, void *base, const size_t size) {
+	(void)base;
+	(void)size;
+	a->base = NULL;
+	a->size = 0;
+	a->used = 0;
+	a->last = NULL;
+}
+
+void gs1_arenaReset(struct arena *a) {
+	(void)a;
+}
+
+void* gs1_arenaAlloc(struct arena *a, const size_t size) {
+	(void)a;
+	return malloc(size);
+}
+
+void* gs1_arenaCalloc(struct arena *a, const size_t n, const size_t size) {
+	(void)a;
+	return calloc(n, size);
+}
+
+void* gs1_arenaRealloc(struct arena *a, void *p, const size_t size) {
+	(void)a;
+	return realloc(p, size);
+}
+
+void gs1_arenaFree(struct arena *a, void *p) {
+	(void)a;
+	free(p);
+}
+
+#else
+
+/*
+ * Each allocation is preceded by its size so that it can be copied when
+ * resized. Only the most recent allocation is resized or released in place;
+ * the space of any other is reclaimed when the arena is next reset.
+ *
+ */
+#define HDR_SIZE	ARENA_ALIGN
+
+static size_t blockSize(const uint8_t *p) {
+	size_t size;
+	memcpy(&size, p - HDR_SIZE, sizeof(size));
+	return size;
+}
+
+static size_t roundUp(const size_t size) {
+	return (size + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+}
+
+void gs1_arenaInit(struct arena *a, void *base, const size_t size) {
+	assert((uintptr_t)base % ARENA_ALIGN == 0);
+	a->base = base;
+	a->size = size;
+	a->used = 0;
+	a->last = NULL;
+}
+
+void gs1_arenaReset(struct arena *a) {
+	a->used = 0;
+	a->last = NULL;
+}
+
+void* gs1_arenaAlloc(struct arena *a, const size_t size) {
+
+	uint8_t *p;
+
+	if (size > a->size || roundUp(size) + HDR_SIZE > a->size - a->used)
+		return NULL;
+
+	p = a->base + a->used + HDR_SIZE;
+	memcpy(p - HDR_SIZE, &size, sizeof(size));
+	a->used += HDR_SIZE + roundUp(size);
+	a->last = p;
+
+	return p;
+
+}
+
+void* gs1_arenaCalloc(struct arena *a, const size_t n, const size_t size) {
+
+	void *p;
+
+	if (size != 0 && n > SIZE_MAX / size)
+		return NULL;
+	if ((p = gs1_arenaAlloc(a, n * size)) != NULL)
+		memset(p, 0, n * size);
+
+	return p;
+
+}
+
+void* gs1_arenaRealloc(struct arena *a, void *p, const size_t size) {
+
+	uint8_t *q;
+	size_t start;
+
+	if (!p)
+		return gs1_arenaAlloc(a, size);
+
+	if (p == a->last) {
+		start = (size_t)(a->last - a->base);
+		if (size > a->size || roundUp(size) > a->size - start)
+			return NULL;
+		memcpy(a->last - HDR_SIZE, &size, sizeof(size));
+		a->used = start + roundUp(size);
+		return p;
+	}
+
+	if ((q = gs1_arenaAlloc(a, size)) != NULL)
+		memcpy(q, p, blockSize(p) < size ? blockSize(p) : size);
+
+	return q;
+
+}
+
+void gs1_arenaFree(struct arena *a, void *p) {
+
+	if (!p || p != a->last)
+		return;
+
+	a->used = (size_t)(a->last - a->base) - HDR_SIZE;
+	a->last = NULL;
+
+}
+
+#endif  /* NOMALLOC */
+
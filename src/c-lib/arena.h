@@ -0,0 +1,52 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define ARENA_ALIGN	8	// Alignment of each allocation, sufficient for double
+
+
+/*
+ * Storage for the allocations made while producing a symbol. Ordinarily this
+ * is just the heap, but NOMALLOC builds carve allocations from fixed storage
+ * within the instance, which is reclaimed in full by gs1_arenaReset().
+ *
+ */
+struct arena {
+	uint8_t *base;
+	size_t size;
+	size_t used;
+	uint8_t *last;		// Most recent allocation, which can be resized or freed in place
+};
+
+void gs1_arenaInit(struct arena *a, void *base, size_t size);
+void gs1_arenaReset(struct arena *a);
+void* gs1_arenaAlloc(struct arena *a, size_t size);
+void* gs1_arenaCalloc(struct arena *a, size_t n, size_t size);
+void* gs1_arenaRealloc(struct arena *a, void *p, size_t size);
+void gs1_arenaFree(struct arena *a, void *p);
+
+
+#endif  /* ARENA_H */
@@ -0,0 +1,274 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bitbuf.h"
+
+
+/*
+ * Big-endian bit fields within a byte array, as used by the QR Code, Composite
+ * Component and DataBar Expanded bitstreams.
+ *
+ * Rather than visiting each bit, the bytes spanned by a field are gathered
+ * into a single 64-bit word, the field is masked into or out of that word and
+ * the affected bytes are written back. Only the spanned bytes are accessed so
+ * a field may end on the last byte of the buffer.
+ *
+ */
+
+
+static uint64_t loadSpan(const uint8_t *p, const int n) {
+
+	uint64_t w = 0;
+	int i;
+
+	for (i = 0; i < n; i++)
+		w = w << 8 | p[i];
+
+	return(w);
+
+}
+
+
+// Store len bits (the low order bits of "bits") starting at bit position pos
+void gs1_bitPut(uint8_t *buf, const size_t pos, const int len, const uint64_t bits) {
+
+	uint8_t *p = buf + pos/8;
+	int n, sh, i;
+	uint64_t w, mask;
+
+	assert(len > 0 && len <= MAX_BITBUF_FIELD);
+
+	n = ((int)(pos%8) + len + 7) / 8;
+	sh = n*8 - (int)(pos%8) - len;
+	mask = ((UINT64_C(1) << len) - 1) << sh;
+
+	w = loadSpan(p, n);
+	w = (w & ~mask) | (bits << sh & mask);
+
+	for (i = n-1; i >= 0; i--) {
+		p[i] = (uint8_t)w;
+		w >>= 8;
+	}
+
+}
+
+
+// Fetch len bits starting at bit position pos
+uint64_t gs1_bitGet(const uint8_t *buf, const size_t pos, const int len) {
+
+	int n;
+
+	assert(len > 0 && len <= MAX_BITBUF_FIELD);
+
+	n = ((int)(pos%8) + len + 7) / 8;
+
+	return(loadSpan(buf + pos/8, n) >> (n*8 - (int)(pos%8) - len) &
+		((UINT64_C(1) << len) - 1));
+
+}
+
+
+#ifdef UNIT_TESTS
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+#include <string.h>
+
+
+// Bit at a time reference implementation
+static void refPut(uint8_t *buf, const size_t pos, const int len, uint64_t bits) {
+
+	int i;
+
+	for (i = len-1; i >= 0; i--) {
+		if (bits & 1) {
+			buf[(pos+(size_t)i)/8] = (uint8_t)(buf[(pos+(size_t)i)/8] | (0x80 >> ((pos+(size_t)i)%8)));
+		}
+		else {
+			buf[(pos+(size_t)i)/8] = (uint8_t)(buf[(pos+(size_t)i)/8] & ~(0x80 >> ((pos+(size_t)i)%8)));
+		}
+		bits >>= 1;
+	}
+
+}
+
+
+static uint64_t refGet(const uint8_t *buf, const size_t pos, const int len) {
+
+	uint64_t bits = 0;
+	int i;
+
+	for (i = 0; i < len; i++) {
+		bits <<= 1;
+		if (buf[(pos+(size_t)i)/8] & (0x80 >> ((pos+(size_t)i)%8)))
+			bits |= 1;
+	}
+
+	return(bits);
+
+}
+
+
+void test_bitbuf_putGet(void) {
+
+	uint8_t buf[16], ref[16];
+	uint64_t x = UINT64_C(0x9E3779B97F4A7C15), v;
+	size_t pos;
+	int len, i;
+
+	// Field ending on the final byte must not touch anything beyond it
+	memset(buf, 0xAA, sizeof(buf));
+	gs1_bitPut(buf, 8*8-12, 12, 0xFFF);
+	TEST_CHECK(buf[6] == 0xAF && buf[7] == 0xFF && buf[8] == 0xAA);
+	TEST_CHECK(gs1_bitGet(buf, 8*8-12, 12) == 0xFFF);
+	TEST_CHECK(gs1_bitGet(buf, 8*8-16, 4) == 0xA);
+
+	// Each 12-bit symbol character of a DataBar Expanded bitstream
+	memcpy(buf, "\x12\x34\x56\x78\x9A\xBC", 6);
+	TEST_CHECK(gs1_bitGet(buf, 0, 12) == 0x123);
+	TEST_CHECK(gs1_bitGet(buf, 12, 12) == 0x456);
+	TEST_CHECK(gs1_bitGet(buf, 36, 12) == 0xABC);
+
+	// Random fields against the bit at a time implementation
+	memset(buf, 0, sizeof(buf));
+	memset(ref, 0, sizeof(ref));
+	for (i = 0; i < 10000; i++) {
+		x ^= x << 13;  x ^= x >> 7;  x ^= x << 17;
+		len = (int)(x % MAX_BITBUF_FIELD) + 1;
+		pos = (size_t)(x >> 8) % (sizeof(buf)*8 - (size_t)len + 1);
+		v = x >> 3;
+		gs1_bitPut(buf, pos, len, v);
+		refPut(ref, pos, len, v);
+		TEST_ASSERT(memcmp(buf, ref, sizeof(buf)) == 0);
+		TEST_CHECK(gs1_bitGet(buf, pos, len) == (v & ((UINT64_C(1) << len) - 1)));
+		TEST_CHECK(gs1_bitGet(buf, pos, len) == refGet(ref, pos, len));
+	}
+
+}
+
+
+#ifdef BENCHMARKS
+
+#include <stdio.h>
+#include <time.h>
+
+#include "gs1encoders.h"
+#include "cc.h"
+
+#define BENCH_ROUNDS	20000
+
+
+static double usPer(const clock_t start, const int n) {
+	return((double)(clock() - start) * 1e6 / CLOCKS_PER_SEC / n);
+}
+
+
+/*
+ *  Run with "make bench".
+ *
+ *  Times a maximal CC-C bitstream packed as 5 to 7 bit fields and read back
+ *  as 69-bit groups, as gs1_pack() and encode928() do, against the bit at a
+ *  time reference. Then times whole GS1-128 with CC-C encodes of a long
+ *  Composite Component. The inputs are fixed so that runs are comparable.
+ *
+ */
+void test_bitbuf_benchCCC(void) {
+
+	static const char dataStr[] =
+		"(01)95012345678903|"
+		"(91)abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789abcdefghijklmnopqrstuvwxyzAB"
+		"(92)0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789abcdefghijklmnopqrstuvwxyz!%&'\"*+,-./:;<=>?_"
+		"(93)ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789ABCDEFGHIJKLMNOPQR"
+		"(94)012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789";
+
+	char in[sizeof(dataStr)];
+	static uint8_t buf[MAX_CCC_BYTES], ref[MAX_CCC_BYTES];
+	static uint8_t lens[MAX_CCC_BYTES*8/5];
+	static uint64_t vals[MAX_CCC_BYTES*8/5];
+	uint64_t x = UINT64_C(0x9E3779B97F4A7C15), sum = 0, refSum = 0;
+	size_t pos;
+	int numFields, i, r;
+	clock_t start;
+	double word, bit;
+	gs1_encoder *ctx;
+
+	// Fields of 5 to 7 bits filling the largest CC-C bitstream
+	for (numFields = 0, pos = 0; ; numFields++) {
+		x ^= x << 13;  x ^= x >> 7;  x ^= x << 17;
+		lens[numFields] = (uint8_t)(5 + x % 3);
+		if (pos + lens[numFields] > sizeof(buf)*8)
+			break;
+		vals[numFields] = x >> 8;
+		pos += lens[numFields];
+	}
+
+	start = clock();
+	for (r = 0; r < BENCH_ROUNDS; r++) {
+		for (i = 0, pos = 0; i < numFields; pos += lens[i], i++) {
+			gs1_bitPut(buf, pos, lens[i], vals[i]);
+		}
+		for (pos = 0; pos + 69 <= sizeof(buf)*8; pos += 69) {
+			sum += gs1_bitGet(buf, pos, 12) ^ gs1_bitGet(buf, pos+12, 57);
+		}
+	}
+	word = usPer(start, BENCH_ROUNDS);
+
+	start = clock();
+	for (r = 0; r < BENCH_ROUNDS; r++) {
+		for (i = 0, pos = 0; i < numFields; pos += lens[i], i++) {
+			refPut(ref, pos, lens[i], vals[i]);
+		}
+		for (pos = 0; pos + 69 <= sizeof(ref)*8; pos += 69) {
+			refSum += refGet(ref, pos, 12) ^ refGet(ref, pos+12, 57);
+		}
+	}
+	bit = usPer(start, BENCH_ROUNDS);
+
+	TEST_CHECK(memcmp(buf, ref, sizeof(buf)) == 0);
+	TEST_CHECK(sum == refSum);
+
+	printf("\n  %d-bit CC-C bitstream of %d fields: %.2f us by word, %.2f us by bit\n",
+		(int)sizeof(buf)*8, numFields, word, bit);
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+	TEST_ASSERT(gs1_encoder_setSym(ctx, gs1_encoder_sGS1_128_CCC));
+	TEST_ASSERT(gs1_encoder_setOutFile(ctx, ""));
+	strcpy(in, dataStr);		// Delimited in place at the '|'
+	TEST_ASSERT(gs1_encoder_setAIdataStr(ctx, in));
+	TEST_ASSERT(gs1_encoder_encode(ctx));
+
+	start = clock();
+	for (r = 0; r < BENCH_ROUNDS/10; r++)
+		TEST_ASSERT(gs1_encoder_encode(ctx));
+	printf("  GS1-128 with CC-C of %d characters: %.2f us per encode\n",
+		(int)strlen(dataStr), usPer(start, BENCH_ROUNDS/10));
+
+	gs1_encoder_free(ctx);
+
+}
+
+#endif  /* BENCHMARKS */
+
+#endif  /* UNIT_TESTS */
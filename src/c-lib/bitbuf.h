@@ -0,0 +1,45 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BITBUF_H
+#define BITBUF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define MAX_BITBUF_FIELD	57	// Widest field that fits a 64-bit word at any bit offset
+
+
+void gs1_bitPut(uint8_t *buf, size_t pos, int len, uint64_t bits);
+uint64_t gs1_bitGet(const uint8_t *buf, size_t pos, int len);
+
+
+#ifdef UNIT_TESTS
+
+void test_bitbuf_putGet(void);
+#ifdef BENCHMARKS
+void test_bitbuf_benchCCC(void);
+#endif
+
+#endif
+
+
+#endif  /* BITBUF_H */
@@ -0,0 +1,494 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "enc-private.h"
+#include "cache.h"
+#include "digest.h"
+
+
+/*
+ *  Persistent symbol cache shared by every process that opens the same file.
+ *
+ *  The file holds a header, an index of slots and a ring of entries. Writers
+ *  reserve space by atomically advancing the tail, write the entry, then
+ *  publish its position into one of the CACHE_WAYS slots for its key. Readers
+ *  take no locks: an entry is used only if it carries the expected position
+ *  and key and its checksum matches. This makes torn writes, from a crash or
+ *  a concurrent writer, simply a miss.
+ *
+ *  Hits are returned without copying as a view into a second, read-only
+ *  mapping of the file, so that a caller writing to the output buffer faults
+ *  rather than corrupting the entry for every process. Since space
+ *  is recycled oldest first, hits are served only from the newest half of the
+ *  ring so that a view remains valid until at least half of the cache's worth
+ *  of newer entries has been appended by any process.
+ *
+ */
+
+struct cacheHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t numSlots;
+	uint64_t dataSize;
+	uint64_t tail;			// Absolute append position, only ever advanced
+	uint64_t reserved[4];
+};
+
+struct cacheEntry {
+	uint64_t pos;			// Absolute position, distinguishing each use of the space
+	uint64_t key;			// Hash of the key material
+	uint64_t check;			// Hash of the key material and data
+	uint32_t keyLen;
+	uint32_t dataLen;
+	int32_t width;
+	int32_t height;
+};
+
+#define CACHE_MAX_KEY	(32 * sizeof(int32_t) + sizeof(double) + 16 + MAX_DATA)
+
+#define ALIGNED(n)	(((n) + CACHE_ALIGN - 1) & ~(uint64_t)(CACHE_ALIGN - 1))
+
+
+// Everything that determines the rendered output, including the library build
+static size_t cacheKey(gs1_encoder *ctx, uint8_t *key) {
+
+	const int32_t settings[] = {
+		CACHE_VERSION, ctx->sym, ctx->pixMult, ctx->Xundercut, ctx->Yundercut, ctx->sepHt,
+		ctx->dataBarExpandedSegmentsWidth, ctx->gs1_128LinearHeight, ctx->dmRows, ctx->dmCols,
+		ctx->qrVersion, ctx->qrEClevel, ctx->format, ctx->addCheckDigit, ctx->permitUnknownAIs,
+		ctx->renderHRI, ctx->pathMode, ctx->pathOptimise,
+		(int32_t)ctx->previewDarkColour, (int32_t)ctx->previewLightColour
+	};
+	const char *version = gs1_encoder_getVersion();
+	size_t len = 0;
+
+	memcpy(key, settings, sizeof(settings));
+	len += sizeof(settings);
+	memcpy(&key[len], &ctx->previewScale, sizeof(ctx->previewScale));
+	len += sizeof(ctx->previewScale);
+	memcpy(&key[len], version, strlen(version) + 1);
+	len += strlen(version) + 1;
+	memcpy(&key[len], ctx->dataStr, strlen(ctx->dataStr));
+	len += strlen(ctx->dataStr);
+
+	assert(len <= CACHE_MAX_KEY);
+	return len;
+
+}
+
+
+static uint64_t hash64(const uint8_t *a, const size_t alen, const uint8_t *b, const size_t blen) {
+
+	struct digestState st;
+	uint8_t out[MAX_DIGEST_LEN];
+	uint64_t h = 0;
+	int i;
+
+	gs1_digestInit(&st, gs1_encoder_digestXXH64);
+	gs1_digestUpdate(&st, a, alen);
+	if (blen)
+		gs1_digestUpdate(&st, b, blen);
+	gs1_digestFinal(&st, out);
+	for (i = 0; i < XXH64_DIGEST_LEN; i++)
+		h = h << 8 | out[i];
+
+	return h;
+
+}
+
+
+#ifndef _WIN32
+
+static struct cacheHeader* header(const struct cacheMap *c) {
+	return (struct cacheHeader*)c->map;
+}
+
+
+static uint64_t* slotFor(const struct cacheMap *c, const uint64_t key, const int way) {
+	return &c->slots[(key + (uint64_t)way) & (c->numSlots - 1)];
+}
+
+
+static struct cacheEntry* find(const struct cacheMap *c, const uint64_t key, const uint8_t *keyData, const size_t keyLen) {
+
+	struct cacheEntry *e;
+	uint64_t pos, phys;
+	const uint8_t *p;
+	int way;
+
+	for (way = 0; way < CACHE_WAYS; way++) {
+
+		if ((pos = __atomic_load_n(slotFor(c, key, way), __ATOMIC_ACQUIRE)) == 0)
+			continue;
+
+		phys = pos % c->dataSize;
+		if (phys + sizeof(struct cacheEntry) > c->dataSize)
+			continue;
+		e = (struct cacheEntry*)&c->data[phys];
+		if (e->pos != pos || e->key != key || e->keyLen != keyLen ||
+		    phys + sizeof(struct cacheEntry) + keyLen + e->dataLen > c->dataSize)
+			continue;
+
+		p = (const uint8_t*)e + sizeof(struct cacheEntry);
+		if (memcmp(p, keyData, keyLen) != 0 || hash64(p, keyLen, p + keyLen, e->dataLen) != e->check)
+			continue;
+
+		// Entries in the older half of the ring are about to be recycled
+		if (__atomic_load_n(&header(c)->tail, __ATOMIC_ACQUIRE) - pos > c->dataSize / 2)
+			continue;
+
+		return e;
+
+	}
+
+	return NULL;
+
+}
+
+#endif  /* _WIN32 */
+
+
+bool gs1_cacheOpen(gs1_encoder *ctx, const char *path, const size_t size) {
+
+#ifdef _WIN32
+
+	(void)path;
+	(void)size;
+	strcpy(ctx->errMsg, "The symbol cache is not supported on this platform");
+	ctx->errFlag = true;
+	return false;
+
+#else
+
+	struct cacheMap *c = &ctx->cache;
+	struct cacheHeader *hdr;
+	struct stat st;
+	size_t len;
+	uint32_t numSlots;
+	bool create;
+	int fd;
+
+	gs1_cacheClose(ctx);
+
+	if ((fd = open(path, O_RDWR | O_CREAT, 0644)) == -1) {
+		sprintf(ctx->errMsg, "Unable to open cache file: %.*s", MAX_FNAME, path);
+		ctx->errFlag = true;
+		return false;
+	}
+
+	// Only creation is serialised, in case several processes start together
+	if (flock(fd, LOCK_EX) != 0 || fstat(fd, &st) != 0) {
+		strcpy(ctx->errMsg, "Unable to lock cache file");
+		goto fail;
+	}
+
+	create = st.st_size == 0;
+	if (create) {
+		if (size < CACHE_MIN_SIZE) {
+			sprintf(ctx->errMsg, "Cache size must be at least %d bytes", CACHE_MIN_SIZE);
+			goto fail;
+		}
+		if (ftruncate(fd, (off_t)size) != 0) {
+			strcpy(ctx->errMsg, "Unable to size cache file");
+			goto fail;
+		}
+		len = size;
+	} else {
+		if ((size_t)st.st_size < CACHE_MIN_SIZE) {
+			strcpy(ctx->errMsg, "Not a symbol cache file");
+			goto fail;
+		}
+		len = (size_t)st.st_size;
+	}
+
+	if ((c->map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		c->map = NULL;
+		strcpy(ctx->errMsg, "Unable to map cache file");
+		goto fail;
+	}
+	if ((c->view = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		munmap(c->map, len);
+		c->map = NULL;
+		c->view = NULL;
+		strcpy(ctx->errMsg, "Unable to map cache file");
+		goto fail;
+	}
+	c->mapLen = len;
+	hdr = header(c);
+
+	if (create) {
+		for (numSlots = 1; (uint64_t)numSlots * 2 * CACHE_SLOT_BYTES <= len; numSlots *= 2);
+		hdr->version = CACHE_VERSION;
+		hdr->numSlots = numSlots;
+		hdr->dataSize = (len - sizeof(struct cacheHeader) - numSlots * sizeof(uint64_t)) & ~(uint64_t)(CACHE_ALIGN - 1);
+		hdr->tail = CACHE_ALIGN;		// Position 0 marks an empty slot
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		memcpy(hdr->magic, CACHE_MAGIC, sizeof(hdr->magic));
+		msync(c->map, sizeof(struct cacheHeader), MS_SYNC);
+	}
+
+	if (memcmp(hdr->magic, CACHE_MAGIC, sizeof(hdr->magic)) != 0 ||
+	    hdr->version != CACHE_VERSION ||
+	    hdr->numSlots == 0 || (hdr->numSlots & (hdr->numSlots - 1)) != 0 ||
+	    sizeof(struct cacheHeader) + hdr->numSlots * sizeof(uint64_t) + hdr->dataSize > len) {
+		strcpy(ctx->errMsg, "Not a symbol cache file");
+		munmap((void*)c->view, len);
+		munmap(c->map, len);
+		c->view = NULL;
+		c->map = NULL;
+		goto fail;
+	}
+
+	c->numSlots = hdr->numSlots;
+	c->slots = (uint64_t*)(c->map + sizeof(struct cacheHeader));
+	c->data = c->map + sizeof(struct cacheHeader) + c->numSlots * sizeof(uint64_t);
+	c->dataSize = hdr->dataSize;
+	c->hit = false;
+
+	flock(fd, LOCK_UN);
+	close(fd);
+	return true;
+
+fail:
+	ctx->errFlag = true;
+	close(fd);
+	return false;
+
+#endif
+
+}
+
+
+void gs1_cacheClose(gs1_encoder *ctx) {
+
+	struct cacheMap *c = &ctx->cache;
+
+	if (!c->map)
+		return;
+
+	// Views of the cache held as the output buffer are about to vanish
+	if (ctx->bufferMapped) {
+		ctx->buffer = NULL;
+		ctx->bufferCap = 0;
+		ctx->bufferSize = 0;
+		ctx->bufferWidth = 0;
+		ctx->bufferHeight = 0;
+		ctx->bufferMapped = false;
+	}
+
+#ifndef _WIN32
+	munmap((void*)c->view, c->mapLen);
+	munmap(c->map, c->mapLen);
+#endif
+	c->view = NULL;
+	c->map = NULL;
+	c->hit = false;
+
+}
+
+
+/*
+ *  On a hit the output buffer becomes a read-only view of the cached symbol
+ *
+ */
+bool gs1_cacheFetch(gs1_encoder *ctx) {
+
+#ifdef _WIN32
+
+	(void)ctx;
+	return false;
+
+#else
+
+	struct cacheMap *c = &ctx->cache;
+	struct cacheEntry *e;
+	uint8_t keyData[CACHE_MAX_KEY];
+	size_t keyLen;
+
+	c->hit = false;
+
+	keyLen = cacheKey(ctx, keyData);
+	if ((e = find(c, hash64(keyData, keyLen, NULL, 0), keyData, keyLen)) == NULL || e->dataLen == 0)
+		return false;
+
+	// Writes through the buffer fault rather than reach the shared entry
+	ctx->buffer = (uint8_t*)(c->view + ((uint8_t*)e - c->map) + sizeof(struct cacheEntry) + keyLen);
+	ctx->bufferCap = e->dataLen;
+	ctx->bufferSize = e->dataLen;
+	ctx->bufferWidth = e->width;
+	ctx->bufferHeight = e->height;
+	ctx->bufferMapped = true;
+	c->hit = true;
+
+	return true;
+
+#endif
+
+}
+
+
+void gs1_cacheStore(gs1_encoder *ctx) {
+
+#ifdef _WIN32
+
+	(void)ctx;
+
+#else
+
+	struct cacheMap *c = &ctx->cache;
+	struct cacheEntry *e;
+	uint8_t keyData[CACHE_MAX_KEY];
+	uint8_t *p;
+	uint64_t key, pos, phys, total, oldest, *slot, *victim;
+	size_t keyLen;
+	int way;
+
+	keyLen = cacheKey(ctx, keyData);
+	total = ALIGNED(sizeof(struct cacheEntry) + keyLen + ctx->bufferSize);
+	if (total > c->dataSize / 4)
+		return;
+
+	// Reservations never wrap, so one that would is abandoned and retried
+	do {
+		pos = __atomic_fetch_add(&header(c)->tail, total, __ATOMIC_ACQ_REL);
+		phys = pos % c->dataSize;
+	} while (phys + total > c->dataSize);
+
+	e = (struct cacheEntry*)&c->data[phys];
+	__atomic_store_n(&e->pos, 0, __ATOMIC_RELEASE);
+
+	key = hash64(keyData, keyLen, NULL, 0);
+	p = (uint8_t*)e + sizeof(struct cacheEntry);
+	memcpy(p, keyData, keyLen);
+	memcpy(p + keyLen, ctx->buffer, ctx->bufferSize);
+	e->key = key;
+	e->check = hash64(p, keyLen, p + keyLen, ctx->bufferSize);
+	e->keyLen = (uint32_t)keyLen;
+	e->dataLen = (uint32_t)ctx->bufferSize;
+	e->width = ctx->bufferWidth;
+	e->height = ctx->bufferHeight;
+	__atomic_store_n(&e->pos, pos, __ATOMIC_RELEASE);
+
+	// Publish into whichever candidate slot holds the oldest entry
+	victim = slotFor(c, key, 0);
+	oldest = UINT64_MAX;
+	for (way = 0; way < CACHE_WAYS; way++) {
+		slot = slotFor(c, key, way);
+		if (__atomic_load_n(slot, __ATOMIC_ACQUIRE) < oldest) {
+			oldest = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+			victim = slot;
+		}
+	}
+	__atomic_store_n(victim, pos, __ATOMIC_RELEASE);
+
+#endif
+
+}
+
+
+#ifdef UNIT_TESTS
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+
+void test_cache_recycle(void) {
+
+#ifndef _WIN32
+
+	gs1_encoder* ctx;
+	const char *fname = "gs1encoders-test-recycle.cache";
+	char data[64];
+	void *buf;
+	size_t size;
+	int i;
+
+	remove(fname);
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sDM));
+	TEST_CHECK(gs1_encoder_setFormat(ctx, gs1_encoder_dRAW));
+	TEST_CHECK(gs1_encoder_setOutFile(ctx, ""));
+
+	TEST_CHECK(!gs1_cacheOpen(ctx, fname, CACHE_MIN_SIZE - 1));
+	remove(fname);
+	TEST_ASSERT(gs1_cacheOpen(ctx, fname, CACHE_MIN_SIZE));
+	TEST_CHECK(ctx->cache.numSlots == 32);
+
+	// Append enough symbols to lap the ring several times
+	for (i = 0; i < 2000; i++) {
+		sprintf(data, "^011231231231233321SERIAL%04d", i);
+		TEST_CHECK(gs1_encoder_setDataStr(ctx, data));
+		TEST_CHECK(gs1_encoder_encode(ctx));
+		TEST_CHECK(!ctx->cache.hit);
+	}
+	TEST_CHECK(header(&ctx->cache)->tail > 3 * ctx->cache.dataSize);
+
+	// The newest is retained while the oldest has been recycled
+	TEST_CHECK(gs1_encoder_encode(ctx));
+	TEST_CHECK(ctx->cache.hit);
+	TEST_CHECK(gs1_encoder_setDataStr(ctx, "^011231231231233321SERIAL0000"));
+	TEST_CHECK(gs1_encoder_encode(ctx));
+	TEST_CHECK(!ctx->cache.hit);
+	TEST_CHECK(gs1_encoder_encode(ctx));
+	TEST_CHECK(ctx->cache.hit);
+
+	// Hits are served from the read-only view rather than the writable mapping
+	TEST_ASSERT((size = gs1_encoder_getBuffer(ctx, &buf)) > 0);
+	TEST_CHECK((const uint8_t*)buf > ctx->cache.view &&
+		   (const uint8_t*)buf + size <= ctx->cache.view + ctx->cache.mapLen);
+
+	// A damaged entry, as from an interrupted write, is a miss
+	ctx->cache.map[(size_t)((const uint8_t*)buf - ctx->cache.view) + size / 2] ^= 0x01;
+	TEST_CHECK(gs1_encoder_encode(ctx));
+	TEST_CHECK(!ctx->cache.hit);
+	TEST_CHECK(gs1_encoder_encode(ctx));
+	TEST_CHECK(ctx->cache.hit);
+
+#ifndef NOMALLOC
+	// Banded rasterisation gives the same pixels, so shares the entry
+	TEST_CHECK(gs1_encoder_setRasterThreads(ctx, 4));
+	TEST_CHECK(gs1_encoder_encode(ctx));
+	TEST_CHECK(ctx->cache.hit);
+#endif
+
+	gs1_encoder_free(ctx);
+	remove(fname);
+
+#endif
+
+}
+
+
+#endif  /* UNIT_TESTS */
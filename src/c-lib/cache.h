@@ -0,0 +1,62 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gs1encoders.h"
+
+
+#define CACHE_MAGIC		"GS1ECACH"
+#define CACHE_VERSION		1
+#define CACHE_MIN_SIZE		(64 * 1024)
+#define CACHE_SLOT_BYTES	2048	// Data bytes per index slot when sizing a new cache
+#define CACHE_WAYS		4	// Index slots that may hold each key
+#define CACHE_ALIGN		8
+
+struct cacheMap {
+	uint8_t *map;			// Whole file, mapped shared between processes
+	const uint8_t *view;		// Same file mapped read-only, from which hits are served
+	size_t mapLen;
+	uint64_t *slots;		// Absolute position of an entry, or 0
+	uint32_t numSlots;
+	uint8_t *data;			// Ring of entries, recycled oldest first
+	uint64_t dataSize;
+	bool hit;			// Last symbol was served from the cache
+};
+
+bool gs1_cacheOpen(gs1_encoder *ctx, const char *path, size_t size);
+void gs1_cacheClose(gs1_encoder *ctx);
+bool gs1_cacheFetch(gs1_encoder *ctx);
+void gs1_cacheStore(gs1_encoder *ctx);
+
+
+#ifdef UNIT_TESTS
+
+void test_cache_recycle(void);
+
+#endif
+
+
+#endif  /* CACHE_H */
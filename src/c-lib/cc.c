@@ -27,11 +27,14 @@
 
 #include "assert.h"
 #include "enc-private.h"
+#include "bitbuf.h"
 #include "cc.h"
 
 struct encodeT {
 	uint8_t *str;
 	int iStr;
+	uint8_t *numRun;	// Length of the run of IS_NUM characters from each position
+	uint8_t *alnuRun;	// Length of the run of IS_ALNU characters from each position
 	uint8_t *bitField;
 	int iBit;
 	int mode;
@@ -48,6 +51,8 @@ enum {
 };
 
 
+#ifndef EXCLUDE_COMPOSITE
+
 static const uint32_t barData[3][929] = {{
  6591070,8688228,10785386,6591133,8688291,10785449,4494038,6591196,4494101,2397006,
  4494164,2397069,4494430,6591588,8688746,4494493,6591651,8688809,2397398,4494556,
@@ -518,10 +523,15 @@ static const int gfPwr[928] = { 1,3,9,27,81,243,729,329,58,174,522,637,53,159,47
  894,824,614,913,881,785,497,562,757,413,310 };
 
 
+#endif  /* EXCLUDE_COMPOSITE */
+
+
 #define min(X,Y) (((X) < (Y)) ? (X) : (Y))
 #define max(X,Y) (((X) > (Y)) ? (X) : (Y))
 
 
+#ifndef EXCLUDE_COMPOSITE
+
 static int gfMul(const int a, const int b) {
 	if ((a == 0) || (b == 0)) return(0);
 	return(gfPwr[(gfLog[a] + gfLog[b]) % 928]);
@@ -568,9 +578,11 @@ static void genECC(gs1_encoder *ctx, const int dsize, const int csize, uint16_t
 	return;
 }
 
+#endif  /* EXCLUDE_COMPOSITE */
 
-void gs1_putBits(gs1_encoder *ctx, uint8_t bitField[], const int bitPos, const int length, uint16_t bits) {
-	int i, maxBytes;
+
+static void putBitField(gs1_encoder *ctx, uint8_t bitField[], const int bitPos, const int length, const int maxLength, uint64_t bits) {
+	int maxBytes;
 
 	if (ctx->linFlag == -1) {
 		maxBytes = MAX_CCC_BYTES; // CC-C
@@ -578,27 +590,20 @@ void gs1_putBits(gs1_encoder *ctx, uint8_t bitField[], const int bitPos, const i
 	else {
 		maxBytes = MAX_CCB4_BYTES; // others
 	}
-	if ((bitPos+length > maxBytes*8) || (length > 16)) {
+	if ((bitPos+length > maxBytes*8) || (length > maxLength)) {
 		sprintf(ctx->errMsg, "putBits error, %d, %d", bitPos, length);
 		ctx->errFlag = true;
 		return;
 	}
-	for (i = length-1; i >= 0; i--) {
-		if ((bits & 1) != 0) {
-			bitField[(bitPos+i)/8] = (uint8_t)(bitField[(bitPos+i)/8] | (0x80 >> ((bitPos+i)%8)));
-		}
-		else {
-			bitField[(bitPos+i)/8] = (uint8_t)(bitField[(bitPos+i)/8] & (~(0x80 >> ((bitPos+i)%8))));
-		}
-		bits >>= 1;
+	if (length > 0) {
+		gs1_bitPut(bitField, (size_t)bitPos, length, bits);
 	}
 	return;
 }
 
 
-/* gets bit in bitString at bitPos */
-static int getBit(const uint8_t bitStr[], const int bitPos) {
-	return(((bitStr[bitPos/8] & (0x80>>(bitPos%8))) == 0) ?	0 : 1);
+void gs1_putBits(gs1_encoder *ctx, uint8_t bitField[], const int bitPos, const int length, uint16_t bits) {
+	putBitField(ctx, bitField, bitPos, length, 16, bits);
 }
 
 
@@ -726,9 +731,37 @@ static int getUnusedBitCnt(gs1_encoder *ctx, int iBit, int *size) {
 #define	IS_FINI		0x80
 
 
+/*
+ * Classify the input ahead of the mode machine into the lengths of the numeric
+ * and alphanumeric runs that start at each position, working backwards from
+ * position "from" to the start. The look-ahead in procNUM, procALNU and
+ * procISO then reads the length of a run rather than probing each character
+ * in turn. Counts saturate, since no decision looks further than 10 ahead.
+ *
+ * Must be rerun over any characters that the encoder rewrites in place.
+ *
+ */
+static void classifyRuns(struct encodeT *encode, int from) {
+
+	int i, what, n, a;
+
+	n = encode->numRun[from+1];
+	a = encode->alnuRun[from+1];
+	for (i = from; i >= 0; i--) {
+		what = iswhat[encode->str[i]];
+		n = (what & IS_NUM) != 0 ? n + (n < UINT8_MAX) : 0;
+		a = (what & IS_ALNU) != 0 ? a + (a < UINT8_MAX) : 0;
+		encode->numRun[i] = (uint8_t)n;
+		encode->alnuRun[i] = (uint8_t)a;
+	}
+
+}
+
+
 static int procNUM(gs1_encoder *ctx, struct encodeT *encode) {
 
 	int bitCnt, char1, char2, what1, what2, i;
+	uint64_t bits;
 
 	// check first char type
 	if ((what1 = iswhat[(char1 = encode->str[encode->iStr])]) == IS_FINI) {
@@ -789,22 +822,44 @@ static int procNUM(gs1_encoder *ctx, struct encodeT *encode) {
 		return(ALNU_MODE);
 	}
 	else {
-		// both "digits", encode as 7-bits
-		encode->iStr += 2;
-		if ((what1 & IS_FNC1) != 0) {
-			char1 = 10;
-		}
-		else {
-			char1 -= (int)'0';
-		}
-		if ((what2 & IS_FNC1) != 0) {
-			char2 = 10;
-		}
-		else {
-			char2 -= (int)'0';
+		// both "digits", encode as 7-bits, continuing through the run while
+		// the pairs are plain digits and collecting them into wide writes
+		bits = 0;
+		bitCnt = 0;
+		for (;;) {
+			encode->iStr += 2;
+			if ((what1 & IS_FNC1) != 0) {
+				char1 = 10;
+			}
+			else {
+				char1 -= (int)'0';
+			}
+			if ((what2 & IS_FNC1) != 0) {
+				char2 = 10;
+			}
+			else {
+				char2 -= (int)'0';
+			}
+			bits = bits << 7 | (uint64_t)((char1 * 11) + char2 + 8);
+			bitCnt += 7;
+			if ((((what1 | what2) & IS_FNC1) != 0) || (encode->numRun[encode->iStr] < 2)) {
+				break;
+			}
+			// stop ahead of a pair with FNC1 since the caller may rewrite the data
+			what1 = iswhat[(char1 = encode->str[encode->iStr])];
+			what2 = iswhat[(char2 = encode->str[(encode->iStr)+1])];
+			if (((what1 | what2) & IS_FNC1) != 0) {
+				break;
+			}
+			if (bitCnt + 7 > MAX_BITBUF_FIELD) {
+				putBitField(ctx, encode->bitField, encode->iBit, bitCnt, MAX_BITBUF_FIELD, bits);
+				encode->iBit += bitCnt;
+				bits = 0;
+				bitCnt = 0;
+			}
 		}
-		gs1_putBits(ctx, encode->bitField, encode->iBit, 7, (uint16_t)((char1 * 11) + char2 + 8));
-		encode->iBit += 7;
+		putBitField(ctx, encode->bitField, encode->iBit, bitCnt, MAX_BITBUF_FIELD, bits);
+		encode->iBit += bitCnt;
 		return(NUM_MODE);
 	}
 }
@@ -812,7 +867,7 @@ static int procNUM(gs1_encoder *ctx, struct encodeT *encode) {
 
 static int procALNU(gs1_encoder *ctx, struct encodeT *encode) {
 
-	int chr, i, what, whatN;
+	int chr, what, numCnt;
 
 	(void)ctx;  // unused
 
@@ -829,27 +884,11 @@ static int procALNU(gs1_encoder *ctx, struct encodeT *encode) {
 	}
 	if (((what & IS_NUM) != 0) &&
 			(((what | iswhat[encode->str[(encode->iStr)+1]]) & IS_FNC1) == 0)) {
-		// next is NUM, look for more
-		for (i = 1; i < 6; i++) {
-			if ((whatN = iswhat[encode->str[(encode->iStr)+i]]) == IS_FINI) {
-				if (i >= 4) {
-					// latch numeric if >= 4 numbers at end
-					gs1_putBits(ctx, encode->bitField, encode->iBit, 3, 0);
-					encode->iBit += 3;
-					return(NUM_MODE);
-				}
-				else {
-					// else continue in ALNU
-					break;
-				}
-			}
-			else if ((whatN & IS_NUM) == 0) {
-				// stay in ALNU if < 6 digits coming up
-				break;
-			}
-		}
-		if (i == 6) {
-			// NUM if 6 or more digits coming up
+		// next is NUM, NUM if 6 or more digits coming up or >= 4 numbers
+		// at end, else stay in ALNU
+		numCnt = encode->numRun[encode->iStr];
+		if ((numCnt >= 6) ||
+				((numCnt >= 4) && (iswhat[encode->str[(encode->iStr)+numCnt]] == IS_FINI))) {
 			gs1_putBits(ctx, encode->bitField, encode->iBit, 3, 0);
 			encode->iBit += 3;
 			return(NUM_MODE);
@@ -896,7 +935,7 @@ static int procALNU(gs1_encoder *ctx, struct encodeT *encode) {
 
 static int procISO(gs1_encoder *ctx, struct encodeT *encode) {
 
-	int chr, i, what, whatN, numCnt;
+	int chr, what, alnuCnt, numCnt;
 
 	(void)ctx;  // unused
 
@@ -905,48 +944,27 @@ static int procISO(gs1_encoder *ctx, struct encodeT *encode) {
 		// end of data
 		return(FINI_MODE);
 	}
-	numCnt = 0;
 	if (((what & IS_ALNU) != 0) && ((what & IS_FNC1) == 0)) {
-		// next is ALNU (& not FNC1), look 9 for more ALNU
-		if ((what & IS_NUM) != 0) {
-			// also count leading "digits"
-			numCnt = 1;
-		}
-		for (i = 1; i < 10; i++) {
-			whatN = iswhat[encode->str[(encode->iStr)+i]];
-			if (whatN == IS_FINI) {
-				if ((numCnt >= 4) || (numCnt <= -4)) {
-					// latch numeric if >= 4 numbers at end
-					gs1_putBits(ctx, encode->bitField, encode->iBit, 3, 0);
-					encode->iBit += 3;
-					return(NUM_MODE);
-				}
-				if (i >= 5) {
-					// latch ALNU if >= 5 alphanumbers at end
-					gs1_putBits(ctx, encode->bitField, encode->iBit, 5, 4);
-					encode->iBit += 5;
-					return(ALNU_MODE);
-				}
-				else {
-					break;
-				}
-			}
-			if ((whatN & IS_NUM) != 0) {
-				if (numCnt > 0) {
-					// count leading diits
-					numCnt++;
-				}
-			}
-			else if (numCnt > 0) {
-				// stop counting if not a digit
-				numCnt = -numCnt;
+		// next is ALNU (& not FNC1), look 9 for more ALNU and count the
+		// leading "digits" amongst them
+		alnuCnt = min(encode->alnuRun[encode->iStr], 10);
+		numCnt = min(encode->numRun[encode->iStr], 10);
+		if ((alnuCnt < 10) && (iswhat[encode->str[(encode->iStr)+alnuCnt]] == IS_FINI)) {
+			if (numCnt >= 4) {
+				// latch numeric if >= 4 numbers at end
+				gs1_putBits(ctx, encode->bitField, encode->iBit, 3, 0);
+				encode->iBit += 3;
+				return(NUM_MODE);
 			}
-			if ((whatN & IS_ALNU) == 0) {
-				break;
+			if (alnuCnt >= 5) {
+				// latch ALNU if >= 5 alphanumbers at end
+				gs1_putBits(ctx, encode->bitField, encode->iBit, 5, 4);
+				encode->iBit += 5;
+				return(ALNU_MODE);
 			}
 		}
-		if (i == 10) {
-			if ((numCnt >= 4) || (numCnt <= -4)) {
+		if (alnuCnt == 10) {
+			if (numCnt >= 4) {
 				// latch numeric if >= 4 numbers follow & no ISO chars in next 10
 				gs1_putBits(ctx, encode->bitField, encode->iBit, 3, 0);
 				encode->iBit += 3;
@@ -1089,6 +1107,7 @@ static void encodeAI90(gs1_encoder *ctx, struct encodeT *encode) {
 					// move up char after "8004" in case it is needed for NUM_MODE
 					encode->str[encode->iStr+1] = encode->str[encode->iStr+5];
 				}
+				classifyRuns(encode, encode->iStr+1);
 			}
 			encode->mode = procNUM(ctx, encode);
 			break;
@@ -1511,42 +1530,61 @@ static int doLinMethods(gs1_encoder *ctx, uint8_t str[], int *iStr, uint8_t bitF
 }
 
 
-int gs1_pack(gs1_encoder *ctx, uint8_t str[], uint8_t bitField[]) {
+// Run the mode machine over the data, leaving encode->iBit ahead of any padding
+static bool packData(gs1_encoder *ctx, struct encodeT *encode) {
 
-	struct encodeT encode = { 0 };
+	size_t len = strlen((char*)encode->str);
 
-	encode.str = str;
-	encode.bitField = bitField;
-	encode.iStr = encode.iBit = 0;
+	assert(len <= MAX_DATA);
+
+	encode->numRun[len+1] = encode->alnuRun[len+1] = 0;
+	classifyRuns(encode, (int)len);
+	encode->iStr = encode->iBit = 0;
 	if (ctx->linFlag == 1) {
-		encode.iBit++; // skip composite link bit if linear component
-		encode.mode = doLinMethods(ctx, encode.str, &encode.iStr,
-						encode.bitField, &encode.iBit);
+		encode->iBit++; // skip composite link bit if linear component
+		encode->mode = doLinMethods(ctx, encode->str, &encode->iStr,
+						encode->bitField, &encode->iBit);
 	}
 	else {
-		encode.mode = doMethods(ctx, &encode);
+		encode->mode = doMethods(ctx, encode);
 	}
-	while (encode.mode != FINI_MODE) {
-		switch (encode.mode) {
+	while (encode->mode != FINI_MODE) {
+		switch (encode->mode) {
 
 		case NUM_MODE: {
-			encode.mode = procNUM(ctx, &encode);
+			encode->mode = procNUM(ctx, encode);
 			break;
 		}
 		case ALNU_MODE: {
-			encode.mode = procALNU(ctx, &encode);
+			encode->mode = procALNU(ctx, encode);
 			break;
 		}
 		case ISO_MODE: {
-			encode.mode = procISO(ctx, &encode);
+			encode->mode = procISO(ctx, encode);
 			break;
 		}
 		default: {
 			strcpy(ctx->errMsg, "mode error");
 			ctx->errFlag = true;
-			return(-1);
+			return(false);
 		} } /* end of case */
 	}
+	return(true);
+}
+
+
+int gs1_pack(gs1_encoder *ctx, uint8_t str[], uint8_t bitField[]) {
+
+	struct encodeT encode = { 0 };
+	uint8_t numRun[MAX_DATA+2], alnuRun[MAX_DATA+2];
+
+	encode.str = str;
+	encode.numRun = numRun;
+	encode.alnuRun = alnuRun;
+	encode.bitField = bitField;
+	if (!packData(ctx, &encode)) {
+		return(-1);
+	}
 	if (ctx->linFlag == -1) { // CC-C
 		if (!insertPad(ctx, &encode)) { // will return false if error
 			strcpy(ctx->errMsg, "symbol too big");
@@ -1561,17 +1599,68 @@ int gs1_pack(gs1_encoder *ctx, uint8_t str[], uint8_t bitField[]) {
 }
 
 
+/*
+ * Pack a copy of the data as gs1_pack() would, returning the number of bits
+ * that the data consumes ahead of any padding, or -1 on error. The size that
+ * gs1_pack() would select is placed in *size, or -1 if the data exceeds the
+ * largest size, and the padded length in bits in *padded.
+ *
+ */
+int gs1_packedBits(gs1_encoder *ctx, const uint8_t str[], int *size, int *padded) {
+
+	struct encodeT encode = { 0 };
+	uint8_t numRun[MAX_DATA+2], alnuRun[MAX_DATA+2];
+	uint8_t buf[MAX_DATA+1];
+	uint8_t bitField[MAX_CCC_BYTES] = { 0 };
+	int bits;
+
+	assert(strlen((const char*)str) <= MAX_DATA);
+
+	strcpy((char*)buf, (const char*)str);	// The encoder rewrites the data in place
+	encode.str = buf;
+	encode.numRun = numRun;
+	encode.alnuRun = alnuRun;
+	encode.bitField = bitField;
+	if (!packData(ctx, &encode)) {
+		return(-1);
+	}
+	bits = encode.iBit;
+	*size = insertPad(ctx, &encode);
+	if (ctx->linFlag == -1) { // CC-C reports success rather than a size
+		*size = *size > 0 ? encode.iBit/8 : -1;
+	}
+	*padded = encode.iBit;
+
+	// Bits beyond the largest bit field are counted but not stored
+	if (ctx->errFlag) {
+		ctx->errFlag = false;
+		ctx->errMsg[0] = '\0';
+		*size = -1;
+	}
+	return(bits);
+}
+
+
+#ifndef EXCLUDE_COMPOSITE
+
 /* converts bit string to base 928 values, codeWords[0] is highest order */
 static int encode928(uint8_t bitString[], uint16_t codeWords[], int bitLng) {
 
-	int i, j, b, bitCnt, cwNdx, cwCnt, cwLng;
+	int i, j, b, bitCnt, cwNdx, cwCnt, cwLng, lo;
+	uint64_t word;
 
 	for (cwNdx = cwLng = b = 0; b < bitLng; b += 69, cwNdx += 7) {
 		bitCnt = min(bitLng-b, 69);
 		cwLng += cwCnt = bitCnt/10 + 1;
 		for (i = 0; i < cwCnt; i++) codeWords[cwNdx+i] = 0; /* init 0 */
+		/* 69-bit group is read as a low word and then the remaining high bits */
+		lo = min(bitCnt, MAX_BITBUF_FIELD);
+		word = gs1_bitGet(bitString, (size_t)(b+bitCnt-lo), lo);
 		for (i = 0; i < bitCnt; i++) {
-			if (getBit(bitString, b+bitCnt-i-1)) {
+			if (i == lo) {
+				word = gs1_bitGet(bitString, (size_t)b, bitCnt-lo);
+			}
+			if (word >> (i < lo ? i : i-lo) & 1) {
 				for (j = 0; j < cwCnt; j++) {
 					codeWords[cwNdx+j] = (uint16_t)(codeWords[cwNdx+j] + pwr928[i][j+7-cwCnt]);
 				}
@@ -1982,6 +2071,7 @@ static void imgCCC(gs1_encoder *ctx, uint16_t codeWords[], uint8_t patCCC[]) {
 static const int CC2Sizes[] = {	59,78,88,108,118,138,167,	// cca sizes
 				208,256,296,336,		// ccb sizes
 				0 };
+static const int CC2Rows[] = { 5,6,7,8,9,10,12,  17,20,23,26 }; // 7 CCA & 4 CCB row counts
 
 static void encCCA2(gs1_encoder *ctx, int size, uint8_t bitField[], uint16_t codeWords[],
 		uint8_t pattern[MAX_CCB4_ROWS][CCB4_ELMNTS]) {
@@ -2017,6 +2107,7 @@ static void encCCB2(gs1_encoder *ctx, int size, uint8_t bitField[], uint16_t cod
 static const int CC3Sizes[] = {	78,98,118,138,167,		// cca sizes
 				208,304,416,536,648,768,	// ccb sizes
 				0 };
+static const int CC3Rows[] = { 4,5,6,7,8,  15,20,26,32,38,44 }; // 5 CCA & 6 CCB row counts
 
 static void encCCA3(gs1_encoder *ctx, int size, uint8_t bitField[], uint16_t codeWords[],
 		uint8_t pattern[MAX_CCB4_ROWS][CCB4_ELMNTS]) {
@@ -2051,6 +2142,7 @@ static void encCCB3(gs1_encoder *ctx, int size, uint8_t bitField[], uint16_t cod
 static const int CC4Sizes[] = {	78,108,138,167,197, // cca sizes
 				208,264,352,496,672,840,1016,1184, // ccb sizes
 				0 };
+static const int CC4Rows[] = { 3,4,5,6,7,  10,12,15,20,26,32,38,44 }; // 5 CCA & 8 CCB row counts
 
 static void encCCA4(gs1_encoder *ctx, int size, uint8_t bitField[], uint16_t codeWords[],
 		uint8_t pattern[MAX_CCB4_ROWS][CCB4_ELMNTS]) {
@@ -2100,7 +2192,6 @@ static void encCCC(gs1_encoder *ctx, int byteCnt, uint8_t bitField[], uint16_t c
 
 int gs1_CC2enc(gs1_encoder *ctx, uint8_t str[], uint8_t pattern[MAX_CCB4_ROWS][CCB4_ELMNTS] ) {
 
-	static const int rows[11] = { 5,6,7,8,9,10,12,  17,20,23,26 }; // 7 CCA & 4 CCB row counts
 
 	uint8_t bitField[MAX_CCB4_BYTES] = { 0 };
 	uint16_t codeWords[MAX_CCB4_CW];
@@ -2130,13 +2221,12 @@ int gs1_CC2enc(gs1_encoder *ctx, uint8_t str[], uint8_t pattern[MAX_CCB4_ROWS][C
 	else {
 		encCCB2(ctx, size-MAX_CCA2_SIZE-1, bitField, codeWords, pattern);
 	}
-	return(rows[size]);
+	return(CC2Rows[size]);
 }
 
 
 int gs1_CC3enc(gs1_encoder *ctx, uint8_t str[], uint8_t pattern[MAX_CCB4_ROWS][CCB4_ELMNTS] ) {
 
-	static const int rows[11] = { 4,5,6,7,8,  15,20,26,32,38,44 }; // 5 CCA & 6 CCB row counts
 
 	uint8_t bitField[MAX_CCB4_BYTES] = { 0 };
 	uint16_t codeWords[MAX_CCB4_CW];
@@ -2166,13 +2256,12 @@ int gs1_CC3enc(gs1_encoder *ctx, uint8_t str[], uint8_t pattern[MAX_CCB4_ROWS][C
 	else {
 		encCCB3(ctx, size-MAX_CCA3_SIZE-1, bitField, codeWords, pattern);
 	}
-	return(rows[size]);
+	return(CC3Rows[size]);
 }
 
 
 int gs1_CC4enc(gs1_encoder *ctx, uint8_t str[], uint8_t pattern[MAX_CCB4_ROWS][CCB4_ELMNTS] ) {
 
-	static const int rows[13] = { 3,4,5,6,7,  10,12,15,20,26,32,38,44 }; // 5 CCA & 8 CCB row counts
 
 	uint8_t bitField[MAX_CCB4_BYTES] = { 0 };
 	uint16_t codeWords[MAX_CCB4_CW];
@@ -2202,7 +2291,7 @@ int gs1_CC4enc(gs1_encoder *ctx, uint8_t str[], uint8_t pattern[MAX_CCB4_ROWS][C
 	else {
 		encCCB4(ctx, size-MAX_CCA4_SIZE-1, bitField, codeWords, pattern);
 	}
-	return(rows[size]);
+	return(CC4Rows[size]);
 }
 
 
@@ -2232,6 +2321,118 @@ bool gs1_CCCenc(gs1_encoder *ctx, uint8_t str[], uint8_t patCCC[] ) {
 }
 
 
+/*
+ * Report the capacity of the CC-A/B with the given number of data columns, or
+ * of the CC-C when columns is zero, without encoding the composite component.
+ * For CC-C the linear component must first have set ctx->colCnt.
+ *
+ * Where the data does not fit the largest size is reported.
+ *
+ */
+bool gs1_CCcapacity(gs1_encoder *ctx, const uint8_t str[], const int columns, gs1_encoder_capacity *cap) {
+
+	const int *CCSizes, *CCRows;
+	int i, size, padded, maxCols, byteCnt;
+
+	assert(columns == 0 || (columns >= 2 && columns <= 4));
+
+	if (*str == '^')
+		str++;
+
+	if ((i=gs1_check2DData(str)) != 0) {
+		sprintf(ctx->errMsg, "illegal character in 2D data = '%c'", str[i]);
+		ctx->errFlag = true;
+		return(false);
+	}
+
+	cap->units = gs1_encoder_capBITS;
+
+	if (columns == 0) { // CC-C
+		ctx->linFlag = -1;
+		maxCols = ctx->colCnt;
+		if ((cap->used = gs1_packedBits(ctx, str, &size, &padded)) < 0)
+			return(false);
+		cap->fits = size >= 0;
+		if (!cap->fits) {
+			// Largest CC-C that sits above this linear component
+			for (byteCnt = MAX_CCC_BYTES; byteCnt > 0; byteCnt--) {
+				ctx->colCnt = maxCols;
+				if ((padded = getUnusedBitCnt(ctx, byteCnt*8, &size)) >= 0)
+					break;
+			}
+			padded += byteCnt*8;
+		}
+		cap->capacity = padded;
+		cap->rows = ctx->rowCnt;
+		cap->columns = ctx->colCnt;
+		ctx->colCnt = maxCols;
+		return(true);
+	}
+
+	CCSizes = columns == 2 ? CC2Sizes : columns == 3 ? CC3Sizes : CC4Sizes;
+	CCRows = columns == 2 ? CC2Rows : columns == 3 ? CC3Rows : CC4Rows;
+
+	ctx->linFlag = 0;
+	ctx->cc_CCSizes = CCSizes;
+	if ((cap->used = gs1_packedBits(ctx, str, &size, &padded)) < 0)
+		return(false);
+	cap->fits = size >= 0;
+	if (size < 0) {
+		for (size = 0; CCSizes[size+1] != 0; size++);
+	}
+	cap->capacity = CCSizes[size];
+	cap->rows = CCRows[size];
+	cap->columns = columns;
+	return(true);
+}
+
+#else  /* EXCLUDE_COMPOSITE */
+
+/*
+ *  Composite component support is compiled out. The linear encoders still
+ *  reach these when given a "|" separated CC, so report it as unsupported.
+ *
+ */
+static int noComposite(gs1_encoder *ctx) {
+	strcpy(ctx->errMsg, "Composite component support is not included in this build");
+	ctx->errFlag = true;
+	return 0;
+}
+
+int gs1_CC2enc(gs1_encoder *ctx, uint8_t str[], uint8_t pattern[MAX_CCB4_ROWS][CCB4_ELMNTS]) {
+	(void)str;
+	(void)pattern;
+	return noComposite(ctx);
+}
+
+int gs1_CC3enc(gs1_encoder *ctx, uint8_t str[], uint8_t pattern[MAX_CCB4_ROWS][CCB4_ELMNTS]) {
+	(void)str;
+	(void)pattern;
+	return noComposite(ctx);
+}
+
+int gs1_CC4enc(gs1_encoder *ctx, uint8_t str[], uint8_t pattern[MAX_CCB4_ROWS][CCB4_ELMNTS]) {
+	(void)str;
+	(void)pattern;
+	return noComposite(ctx);
+}
+
+bool gs1_CCCenc(gs1_encoder *ctx, uint8_t str[], uint8_t patCCC[]) {
+	(void)str;
+	(void)patCCC;
+	return noComposite(ctx) != 0;
+}
+
+bool gs1_CCcapacity(gs1_encoder *ctx, const uint8_t str[], const int columns, gs1_encoder_capacity *cap) {
+	(void)str;
+	(void)columns;
+	(void)cap;
+	return noComposite(ctx) != 0;
+}
+
+#endif  /* EXCLUDE_COMPOSITE */
+
+
 
 #ifdef UNIT_TESTS
 
@@ -2298,4 +2499,209 @@ void test_cc_encode928(void) {
 }
 
 
+void test_cc_CCcapacity(void) {
+
+	static const char *data[] = {
+		"21ABC123",
+		"10ABC123^2112345",
+		"99abcdefghijklmnopqrstuvwxyz",
+		"1712310110ABC^211234567890123",
+		"90ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ",
+		NULL
+	};
+	static const int *const CCSizes[] = { CC2Sizes, CC3Sizes, CC4Sizes };
+
+	gs1_encoder* ctx = gs1_encoder_init(NULL);
+	gs1_encoder_capacity cap;
+	uint8_t bitField[MAX_CCB4_BYTES];
+	uint8_t str[320];
+	int i, j, k, bits, size, padded;
+
+	// The bits ahead of padding lie within the size that gs1_pack() selects
+	for (i = 0; data[i]; i++) {
+		for (j = 0; j < 3; j++) {
+			ctx->linFlag = 0;
+			ctx->cc_CCSizes = CCSizes[j];
+			bits = gs1_packedBits(ctx, (const uint8_t*)data[i], &size, &padded);
+			TEST_CHECK(bits > 0);
+			strcpy((char*)str, data[i]);
+			memset(bitField, 0, sizeof(bitField));
+			TEST_CHECK(gs1_pack(ctx, str, bitField) == size);
+			TEST_MSG("%s in %d columns", data[i], j+2);
+			TEST_CHECK(size < 0 || (bits <= padded && padded == CCSizes[j][size]));
+			for (k = 0; CCSizes[j][k+1] != 0; k++);
+			TEST_CHECK(size >= 0 || bits > CCSizes[j][k]);
+		}
+	}
+
+	// CC-A in two columns
+	TEST_ASSERT(gs1_CCcapacity(ctx, (const uint8_t*)"^21ABC123", 2, &cap));
+	TEST_CHECK(cap.units == gs1_encoder_capBITS);
+	TEST_CHECK(cap.used == 45);
+	TEST_CHECK(cap.capacity == 59);
+	TEST_CHECK(cap.rows == 5 && cap.columns == 2);
+	TEST_CHECK(cap.fits);
+
+	// Too long for CC-B in four columns, so the largest is reported
+	strcpy((char*)str, "90");
+	for (i = 0; i < 3; i++)
+		strcat((char*)str, data[4]+2);
+	TEST_ASSERT(gs1_CCcapacity(ctx, str, 4, &cap));
+	TEST_CHECK(cap.used > 1184);
+	TEST_CHECK(cap.capacity == 1184);
+	TEST_CHECK(cap.rows == 44 && cap.columns == 4);
+	TEST_CHECK(!cap.fits);
+
+	// CC-C narrows to satisfy the aspect ratio
+	ctx->colCnt = 9;
+	TEST_ASSERT(gs1_CCcapacity(ctx, (const uint8_t*)"^91ABCDEFGHIJKLMNOPQRSTUVWXYZ", 0, &cap));
+	TEST_CHECK(cap.used == 168);
+	TEST_CHECK(cap.capacity == 240);
+	TEST_CHECK(cap.rows == 4 && cap.columns == 9);
+	TEST_CHECK(cap.fits);
+	TEST_CHECK(ctx->colCnt == 9);
+
+	TEST_CHECK(!gs1_CCcapacity(ctx, (const uint8_t*)"^21ABC|123", 2, &cap));
+	TEST_CHECK(strcmp(ctx->errMsg, "illegal character in 2D data = '|'") == 0);
+
+	gs1_encoder_free(ctx);
+
+}
+
+
+void test_cc_packLatches(void) {
+
+	// Bits ahead of padding, as packed before the input was classified into runs
+	static const struct {
+		const char *data;
+		const char *bits;
+	} tests[] = {
+		// Numeric runs: odd and even at the end, longer than a single write, and broken by FNC1
+		{ "10123",
+		  "00010011001010101100110000" },
+		{ "101234",
+		  "00010011001010101011010000" },
+		{ "10123456789012345678901234567890123456789012",
+		  "000100110010101010110110001011011101110101100101010101101100010110111011"
+		  "101011001010101011011000101101110111010110010101010110110001011011101110"
+		  "101100101010000" },
+		{ "10123^21456",
+		  "00010011001010101100110011111011100110101000000" },
+		{ "10123^2145^3712",
+		  "0001001100101010110011001111101110011111001101011001010000000" },
+
+		// Alphanumeric to numeric: latch for 4 or more digits at the end or 6 or more digits
+		{ "10A123",
+		  "000100110000100000001100011101000" },
+		{ "10A1234",
+		  "000100110000100000000001010101011010000" },
+		{ "10A12345B",
+		  "0001001100001000000011000111010000100101010100001" },
+		{ "10A123456B",
+		  "0001001100001000000000010101010110110001010000100001" },
+		{ "10A1234^211",
+		  "00010011000010000000000101010101101111100000101000000" },
+		{ "10A12^2112345",
+		  "000100110000100000000001010111110000010100010000101110010000" },
+
+		// ISO/IEC 646 to alphanumeric: latch for 5 or more at the end or 10 or more
+		{ "10abcABCD",
+		  "000100110000001001011010101101110111001000000100000110000101000011" },
+		{ "10abcABCDE",
+		  "000100110000001001011010101101110111000010010000010000110001010001110010"
+		  "0" },
+		{ "10abcABCDEFGHI",
+		  "000100110000001001011010101101110111000010010000010000110001010001110010"
+		  "0100101100110100111101000" },
+		{ "10abcABCDEFGHIJ",
+		  "000100110000001001011010101101110111000010010000010000110001010001110010"
+		  "0100101100110100111101000101001" },
+		{ "10abcABCDEFGHIa",
+		  "000100110000001001011010101101110111001000000100000110000101000011100010"
+		  "010001011000110100011110010001011010" },
+		{ "10abcABCDEFGHIJa",
+		  "000100110000001001011010101101110111000010010000010000110001010001110010"
+		  "0100101100110100111101000101001001001011010" },
+
+		// ISO/IEC 646 to numeric: latch for 4 or more leading digits at the end or within the next 10
+		{ "10abc123",
+		  "00010011000000100101101010110111011100001100011101000" },
+		{ "10abc1234",
+		  "00010011000000100101101010110111011100000001010101011010000" },
+		{ "10abc1234567890",
+		  "000100110000001001011010101101110111000000010101010110110001011011101110"
+		  "101100" },
+		{ "10abc1234ABCDEFz",
+		  "000100110000001001011010101101110111000000010101010110100001000001000011"
+		  "00010100011100100100101001001110011" },
+		{ "10abc123ABCDEFGz",
+		  "000100110000001001011010101101110111000010000110001110100010000010000110"
+		  "0010100011100100100101100110001001110011" },
+
+		// Alphanumeric to ISO/IEC 646
+		{ "10ABCabcdef",
+		  "000100110000100000100001100010001001011010101101110111001011101101111010"
+		  "11111" },
+		{ "10ABC*DEF",
+		  "000100110000100000100001100010111010100011100100100101" },
+		{ "10A*b12345678",
+		  "00010011000010000011101000100101101100000101010101101100010110111010000" },
+
+		// AI 90 method, with AI 21 and AI 8004 rewritten in place
+		{ "90ABC^21123456",
+		  "111110111110000000000000000000100010111110010101010110110001010000" },
+		{ "90ABC^211234567",
+		  "111110111110000000000000000000100010111110010101010110110001011011111000"
+		  "0" },
+		{ "90ABC^8004123456",
+		  "111111111110000000000000000000100010111110010101010110110001010000" },
+		{ "90ABC^8004ABC123",
+		  "111111111110000000000000000000100010111110000100000100001100010001100011"
+		  "101000" },
+		{ "90ABC^21A1B2",
+		  "1111101111100000000000000000001000101111100001000000011010000100111" },
+		{ "901A2^8004ABC123",
+		  "1110111111100000000010000001010000000100000100001100010001100011101000" },
+		{ "90A^2112^8004999",
+		  "111010111110000000000000001110111010100011000000001100111010011101010000" },
+		{ "9012345678^21ABC",
+		  "0110101100101010101101100010110111011111000000000110100000100001100010" },
+		{ "90AB12^2112345^10XYZ",
+		  "110101111100000000000000010000100000101011110111010000101110011110111000"
+		  "000101110111111000111001" },
+
+		// Date method followed by AI 21
+		{ "1712310110ABC^211234567890123",
+		  "100001010111000001100001000001000011000100111100111110010101010110110001"
+		  "0110111011101011001010101100110000" },
+	};
+
+	gs1_encoder* ctx = gs1_encoder_init(NULL);
+	uint8_t bitField[MAX_CCB4_BYTES];
+	uint8_t str[64];
+	char bits[MAX_CCB4_BYTES*8+1];
+	int i, j, n, size, padded;
+
+	TEST_ASSERT(ctx != NULL);
+	ctx->linFlag = 0;
+	ctx->cc_CCSizes = CC4Sizes;
+
+	for (i = 0; i < (int)SIZEOF_ARRAY(tests); i++) {
+		n = gs1_packedBits(ctx, (const uint8_t*)tests[i].data, &size, &padded);
+		TEST_ASSERT(n > 0 && n <= MAX_CCB4_BYTES*8);
+		strcpy((char*)str, tests[i].data);
+		memset(bitField, 0, sizeof(bitField));
+		TEST_CHECK(gs1_pack(ctx, str, bitField) == size);
+		for (j = 0; j < n; j++)
+			bits[j] = (char)('0' + ((bitField[j/8] >> (7 - j%8)) & 1));
+		bits[n] = '\0';
+		TEST_CHECK(strcmp(bits, tests[i].bits) == 0);
+		TEST_MSG("%s: Given %s; Expected %s", tests[i].data, bits, tests[i].bits);
+	}
+
+	gs1_encoder_free(ctx);
+
+}
+
+
 #endif  /* UNIT_TESTS */
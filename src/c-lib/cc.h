@@ -45,6 +45,14 @@
 #define MAX_CCC_ROWS	90	// ccc max rows
 #define MAX_CCC_BYTES	1033	// maximum byte mode capacity for ccc
 
+#ifndef EXCLUDE_COMPOSITE
+#define CCB4_MAX_SYM_H	(MAX_CCB4_ROWS*2)	// Tallest CC-A/B in X, added to the largest linear symbols
+#define CCC_MAX_SYM_H	(MAX_CCC_ROWS*2)	// Tallest CC-C in X
+#else
+#define CCB4_MAX_SYM_H	0
+#define CCC_MAX_SYM_H	0
+#endif
+
 #define MAX_CCA2_SIZE	6	// index to 167 in CC2Sizes
 #define MAX_CCA3_SIZE	4	// index to 167 in CC3Sizes
 #define MAX_CCA4_SIZE	4	// index to 197 in CC4Sizes
@@ -57,15 +65,19 @@ int gs1_CC2enc(gs1_encoder *ctx, uint8_t str[], uint8_t pattern[MAX_CCB4_ROWS][C
 int gs1_CC3enc(gs1_encoder *ctx, uint8_t str[], uint8_t pattern[MAX_CCB4_ROWS][CCB4_ELMNTS]);
 int gs1_CC4enc(gs1_encoder *ctx, uint8_t str[], uint8_t pattern[MAX_CCB4_ROWS][CCB4_ELMNTS]);
 bool gs1_CCCenc(gs1_encoder *ctx, uint8_t str[], uint8_t pattern[]);
+bool gs1_CCcapacity(gs1_encoder *ctx, const uint8_t str[], int columns, gs1_encoder_capacity *cap);
 
 int gs1_check2DData(const uint8_t dataStr[]);
 int gs1_pack(gs1_encoder *ctx, uint8_t str[], uint8_t bitField[]);
+int gs1_packedBits(gs1_encoder *ctx, const uint8_t str[], int *size, int *padded);
 void gs1_putBits(gs1_encoder *ctx, uint8_t bitField[], int bitPos, int length, uint16_t bits);
 
 
 #ifdef UNIT_TESTS
 
 void test_cc_encode928(void);
+void test_cc_CCcapacity(void);
+void test_cc_packLatches(void);
 
 #endif
 
@@ -0,0 +1,388 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "gs1encoders.h"
+#include "digest.h"
+
+
+/*
+ *  SHA-256, per FIPS 180-4
+ *
+ */
+
+static const uint32_t sha256K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256Block(struct sha256State *st, const uint8_t *p) {
+
+	uint32_t w[64];
+	uint32_t a, b, c, d, e, f, g, h, t1, t2;
+	int i;
+
+	for (i = 0; i < 16; i++, p += 4)
+		w[i] = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+	for (; i < 64; i++)
+		w[i] = (ROTR32(w[i-2], 17) ^ ROTR32(w[i-2], 19) ^ (w[i-2] >> 10)) + w[i-7] +
+		       (ROTR32(w[i-15], 7) ^ ROTR32(w[i-15], 18) ^ (w[i-15] >> 3)) + w[i-16];
+
+	a = st->h[0]; b = st->h[1]; c = st->h[2]; d = st->h[3];
+	e = st->h[4]; f = st->h[5]; g = st->h[6]; h = st->h[7];
+
+	for (i = 0; i < 64; i++) {
+		t1 = h + (ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25)) + ((e & f) ^ (~e & g)) + sha256K[i] + w[i];
+		t2 = (ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+		h = g; g = f; f = e; e = d + t1;
+		d = c; c = b; b = a; a = t1 + t2;
+	}
+
+	st->h[0] += a; st->h[1] += b; st->h[2] += c; st->h[3] += d;
+	st->h[4] += e; st->h[5] += f; st->h[6] += g; st->h[7] += h;
+
+}
+
+static void sha256Init(struct sha256State *st) {
+
+	static const uint32_t iv[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+	};
+
+	memcpy(st->h, iv, sizeof(iv));
+	st->len = 0;
+	st->bufLen = 0;
+
+}
+
+static void sha256Update(struct sha256State *st, const uint8_t *p, size_t len) {
+
+	size_t n;
+
+	st->len += len;
+
+	if (st->bufLen) {
+		n = 64 - st->bufLen < len ? 64 - st->bufLen : len;
+		memcpy(st->buf + st->bufLen, p, n);
+		st->bufLen += n;
+		p += n;
+		len -= n;
+		if (st->bufLen < 64)
+			return;
+		sha256Block(st, st->buf);
+		st->bufLen = 0;
+	}
+
+	// Whole blocks are consumed directly from the caller's data
+	for (; len >= 64; p += 64, len -= 64)
+		sha256Block(st, p);
+
+	memcpy(st->buf, p, len);
+	st->bufLen = len;
+
+}
+
+static void sha256Final(struct sha256State *st, uint8_t *out) {
+
+	uint64_t bits = st->len * 8;
+	int i;
+
+	st->buf[st->bufLen++] = 0x80;
+	if (st->bufLen > 56) {
+		memset(st->buf + st->bufLen, 0, 64 - st->bufLen);
+		sha256Block(st, st->buf);
+		st->bufLen = 0;
+	}
+	memset(st->buf + st->bufLen, 0, 56 - st->bufLen);
+	for (i = 0; i < 8; i++)
+		st->buf[56 + i] = (uint8_t)(bits >> (56 - 8 * i));
+	sha256Block(st, st->buf);
+
+	for (i = 0; i < 8; i++) {
+		out[4*i]   = (uint8_t)(st->h[i] >> 24);
+		out[4*i+1] = (uint8_t)(st->h[i] >> 16);
+		out[4*i+2] = (uint8_t)(st->h[i] >> 8);
+		out[4*i+3] = (uint8_t)st->h[i];
+	}
+
+}
+
+
+/*
+ *  XXH64 (seed 0), output in canonical big-endian form
+ *
+ */
+
+#define XXH_P1 UINT64_C(0x9E3779B185EBCA87)
+#define XXH_P2 UINT64_C(0xC2B2AE3D27D4EB4F)
+#define XXH_P3 UINT64_C(0x165667B19E3779F9)
+#define XXH_P4 UINT64_C(0x85EBCA77C2B2AE63)
+#define XXH_P5 UINT64_C(0x27D4EB2F165667C5)
+
+#define ROTL64(x, n) (((x) << (n)) | ((x) >> (64 - (n))))
+
+static uint64_t xxhRead64(const uint8_t *p) {
+	return (uint64_t)p[0]       | (uint64_t)p[1] << 8  | (uint64_t)p[2] << 16 | (uint64_t)p[3] << 24 |
+	       (uint64_t)p[4] << 32 | (uint64_t)p[5] << 40 | (uint64_t)p[6] << 48 | (uint64_t)p[7] << 56;
+}
+
+static uint32_t xxhRead32(const uint8_t *p) {
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t xxhRound(uint64_t acc, const uint64_t input) {
+	acc += input * XXH_P2;
+	acc = ROTL64(acc, 31);
+	return acc * XXH_P1;
+}
+
+static uint64_t xxhMergeRound(uint64_t acc, const uint64_t val) {
+	acc ^= xxhRound(0, val);
+	return acc * XXH_P1 + XXH_P4;
+}
+
+static void xxh64Stripe(struct xxh64State *st, const uint8_t *p) {
+	st->v[0] = xxhRound(st->v[0], xxhRead64(p));
+	st->v[1] = xxhRound(st->v[1], xxhRead64(p + 8));
+	st->v[2] = xxhRound(st->v[2], xxhRead64(p + 16));
+	st->v[3] = xxhRound(st->v[3], xxhRead64(p + 24));
+}
+
+static void xxh64Init(struct xxh64State *st) {
+	st->v[0] = XXH_P1 + XXH_P2;
+	st->v[1] = XXH_P2;
+	st->v[2] = 0;
+	st->v[3] = (uint64_t)0 - XXH_P1;
+	st->len = 0;
+	st->bufLen = 0;
+}
+
+static void xxh64Update(struct xxh64State *st, const uint8_t *p, size_t len) {
+
+	size_t n;
+
+	st->len += len;
+
+	if (st->bufLen) {
+		n = 32 - st->bufLen < len ? 32 - st->bufLen : len;
+		memcpy(st->buf + st->bufLen, p, n);
+		st->bufLen += n;
+		p += n;
+		len -= n;
+		if (st->bufLen < 32)
+			return;
+		xxh64Stripe(st, st->buf);
+		st->bufLen = 0;
+	}
+
+	for (; len >= 32; p += 32, len -= 32)
+		xxh64Stripe(st, p);
+
+	memcpy(st->buf, p, len);
+	st->bufLen = len;
+
+}
+
+static void xxh64Final(const struct xxh64State *st, uint8_t *out) {
+
+	const uint8_t *p = st->buf;
+	size_t len = st->bufLen;
+	uint64_t h;
+	int i;
+
+	if (st->len >= 32) {
+		h = ROTL64(st->v[0], 1) + ROTL64(st->v[1], 7) + ROTL64(st->v[2], 12) + ROTL64(st->v[3], 18);
+		h = xxhMergeRound(h, st->v[0]);
+		h = xxhMergeRound(h, st->v[1]);
+		h = xxhMergeRound(h, st->v[2]);
+		h = xxhMergeRound(h, st->v[3]);
+	} else {
+		h = st->v[2] + XXH_P5;
+	}
+
+	h += st->len;
+
+	for (; len >= 8; p += 8, len -= 8) {
+		h ^= xxhRound(0, xxhRead64(p));
+		h = ROTL64(h, 27) * XXH_P1 + XXH_P4;
+	}
+	if (len >= 4) {
+		h ^= (uint64_t)xxhRead32(p) * XXH_P1;
+		h = ROTL64(h, 23) * XXH_P2 + XXH_P3;
+		p += 4;
+		len -= 4;
+	}
+	for (; len > 0; p++, len--) {
+		h ^= *p * XXH_P5;
+		h = ROTL64(h, 11) * XXH_P1;
+	}
+
+	h ^= h >> 33;
+	h *= XXH_P2;
+	h ^= h >> 29;
+	h *= XXH_P3;
+	h ^= h >> 32;
+
+	for (i = 0; i < 8; i++)
+		out[i] = (uint8_t)(h >> (56 - 8 * i));
+
+}
+
+
+void gs1_digestInit(struct digestState *st, const int alg) {
+
+	assert(st);
+
+	st->alg = alg;
+	switch (alg) {
+		case gs1_encoder_digestSHA256:
+			sha256Init(&st->sha256);
+			break;
+		case gs1_encoder_digestXXH64:
+			xxh64Init(&st->xxh64);
+			break;
+		default:
+			break;
+	}
+
+}
+
+
+void gs1_digestUpdate(struct digestState *st, const void *data, const size_t len) {
+
+	assert(st);
+
+	switch (st->alg) {
+		case gs1_encoder_digestSHA256:
+			sha256Update(&st->sha256, data, len);
+			break;
+		case gs1_encoder_digestXXH64:
+			xxh64Update(&st->xxh64, data, len);
+			break;
+		default:
+			break;
+	}
+
+}
+
+
+size_t gs1_digestFinal(struct digestState *st, uint8_t *out) {
+
+	assert(st);
+	assert(out);
+
+	switch (st->alg) {
+		case gs1_encoder_digestSHA256:
+			sha256Final(&st->sha256, out);
+			return SHA256_DIGEST_LEN;
+		case gs1_encoder_digestXXH64:
+			xxh64Final(&st->xxh64, out);
+			return XXH64_DIGEST_LEN;
+		default:
+			return 0;
+	}
+
+}
+
+
+#ifdef UNIT_TESTS
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+
+static void test_digest(const int alg, const char *data, const size_t chunk, const char *expect) {
+
+	struct digestState st;
+	uint8_t out[MAX_DIGEST_LEN];
+	char hex[2*MAX_DIGEST_LEN+1];
+	size_t i, len, n;
+
+	len = strlen(data);
+	gs1_digestInit(&st, alg);
+	for (i = 0; i < len; i += n) {
+		n = len - i < chunk ? len - i : chunk;
+		gs1_digestUpdate(&st, data + i, n);
+	}
+	n = gs1_digestFinal(&st, out);
+	for (i = 0; i < n; i++)
+		sprintf(&hex[2*i], "%02x", out[i]);
+	hex[2*n] = '\0';
+
+	TEST_CHECK(strcmp(hex, expect) == 0);
+	TEST_MSG("Given: %s; Chunk: %d; Got: %s; Expected: %s", data, (int)chunk, hex, expect);
+
+}
+
+
+void test_digest_SHA256(void) {
+
+	static const char *abc56 = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+	static char million[1000001];
+
+	test_digest(gs1_encoder_digestSHA256, "", 1,
+		"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+	test_digest(gs1_encoder_digestSHA256, "abc", 1,
+		"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+	test_digest(gs1_encoder_digestSHA256, abc56, 1,
+		"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+	test_digest(gs1_encoder_digestSHA256, abc56, 7,
+		"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+	test_digest(gs1_encoder_digestSHA256, abc56, 64,
+		"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+
+	memset(million, 'a', 1000000);
+	million[1000000] = '\0';
+	test_digest(gs1_encoder_digestSHA256, million, 1000,
+		"cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+	test_digest(gs1_encoder_digestSHA256, million, 333,
+		"cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+}
+
+
+void test_digest_XXH64(void) {
+
+	static const char *spam = "Nobody inspects the spammish repetition";
+
+	test_digest(gs1_encoder_digestXXH64, "", 1, "ef46db3751d8e999");
+	test_digest(gs1_encoder_digestXXH64, "a", 1, "d24ec4f1a98c6e5b");
+	test_digest(gs1_encoder_digestXXH64, "abc", 1, "44bc2cf5ad770999");
+	test_digest(gs1_encoder_digestXXH64, spam, 1, "fbcea83c8a378bf1");
+	test_digest(gs1_encoder_digestXXH64, spam, 5, "fbcea83c8a378bf1");
+	test_digest(gs1_encoder_digestXXH64, spam, 32, "fbcea83c8a378bf1");
+	test_digest(gs1_encoder_digestXXH64, spam, 64, "fbcea83c8a378bf1");
+
+}
+
+
+#endif  /* UNIT_TESTS */
@@ -0,0 +1,69 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef DIGEST_H
+#define DIGEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define SHA256_DIGEST_LEN	32
+#define XXH64_DIGEST_LEN	8
+#define MAX_DIGEST_LEN		SHA256_DIGEST_LEN
+
+
+struct sha256State {
+	uint32_t h[8];
+	uint64_t len;
+	uint8_t buf[64];
+	size_t bufLen;
+};
+
+struct xxh64State {
+	uint64_t v[4];
+	uint64_t len;
+	uint8_t buf[32];
+	size_t bufLen;
+};
+
+struct digestState {
+	int alg;				// One of gs1_encoder_digests
+	union {
+		struct sha256State sha256;
+		struct xxh64State xxh64;
+	};
+};
+
+
+void gs1_digestInit(struct digestState *st, int alg);
+void gs1_digestUpdate(struct digestState *st, const void *data, size_t len);
+size_t gs1_digestFinal(struct digestState *st, uint8_t *out);
+
+
+#ifdef UNIT_TESTS
+
+void test_digest_SHA256(void);
+void test_digest_XXH64(void);
+
+#endif
+
+
+#endif  /* DIGEST_H */
@@ -24,7 +24,6 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <ctype.h>
 
 #include "gs1encoders.h"
 #include "enc-private.h"
@@ -64,6 +63,27 @@ static const char* dl_pkeys[] = {
 	"8018",		// GSRN - RECIPIENT; qualifiers=8019
 };
 
+/*
+ * Qualifiers that may follow each DL pkey in the path info, in their required
+ * order, with any alternative qualifier path
+ *
+ */
+struct dlQualifiers {
+	const char *pkey;
+	const char *paths[2][4];
+};
+
+static const struct dlQualifiers dl_qualifiers[] = {
+	{ "01",   { { "22", "10", "21", NULL }, { "235", NULL } } },
+	{ "414",  { { "254", NULL }, { "7040", NULL } } },
+	{ "417",  { { "7040", NULL } } },
+	{ "8004", { { "7040", NULL } } },
+	{ "8006", { { "22", "10", "21", NULL } } },
+	{ "8010", { { "8011", NULL } } },
+	{ "8017", { { "8019", NULL } } },
+	{ "8018", { { "8019", NULL } } },
+};
+
 static bool isDLpkey(char* p) {
 	size_t i;
 	assert(p);
@@ -74,23 +94,48 @@ static bool isDLpkey(char* p) {
 }
 
 
+static int hexDigit(const char c) {
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return -1;
+}
+
+
+/*
+ * Runs of literal characters between escapes are located with memchr() and
+ * copied with memcpy(), which the C library vectorises, so that only the
+ * escapes themselves are handled a character at a time
+ *
+ */
 static size_t URIunescape(char *out, size_t maxlen, const char *in, const size_t inlen) {
 
-	size_t i, j;
-	char hex[3] = { 0 };
+	const char *p = in, *end = in + inlen, *pc;
+	size_t j = 0, run;
+	int hi, lo;
 
 	assert(in);
 	assert(out);
 
-	for (i = 0, j = 0; i < inlen && j < maxlen; i++, j++) {
-		if (i < inlen - 2 && in[i] == '%' && isxdigit(in[i+1]) && isxdigit(in[i+2])) {
-			hex[0] = in[i+1];
-			hex[1] = in[i+2];
-			out[j] = (char)strtoul(hex, NULL, 16);
-			i += 2;
-		}
-		else {
-			out[j] = in[i];
+	while (p < end && j < maxlen) {
+		if ((pc = memchr(p, '%', (size_t)(end - p))) == NULL)
+			pc = end;
+		run = (size_t)(pc - p);
+		if (run > maxlen - j)
+			run = maxlen - j;
+		memcpy(&out[j], p, run);
+		j += run;
+		p += run;
+		if (p == end || j == maxlen)
+			break;
+		if (end - p >= 3 && (hi = hexDigit(p[1])) >= 0 && (lo = hexDigit(p[2])) >= 0) {
+			out[j++] = (char)(hi << 4 | lo);
+			p += 3;
+		} else {
+			out[j++] = *p++;		// Literal "%"
 		}
 	}
 	out[j] = '\0';
@@ -100,6 +145,36 @@ static size_t URIunescape(char *out, size_t maxlen, const char *in, const size_t
 }
 
 
+/*
+ * Length of the http:// or https:// scheme that begins a DL URI, otherwise 0.
+ * Schemes are case-insensitive.
+ *
+ */
+size_t gs1_DLschemeLen(const char *data) {
+
+	static const char *schemes[] = { "https://", "http://" };
+	size_t i, j;
+	char c;
+
+	assert(data);
+
+	for (i = 0; i < SIZEOF_ARRAY(schemes); i++) {
+		for (j = 0; schemes[i][j]; j++) {
+			c = data[j];
+			if (c >= 'A' && c <= 'Z')
+				c = (char)(c - 'A' + 'a');
+			if (c != schemes[i][j])
+				break;
+		}
+		if (!schemes[i][j])
+			return j;
+	}
+
+	return 0;
+
+}
+
+
 /*
  * Convert DL data to regular AI data string with ^ = FNC1
  *
@@ -137,19 +212,16 @@ bool gs1_parseDLuri(gs1_encoder *ctx, char *dlData, char *dataStr) {
 
 	p = dlData;
 
-	if (strspn(p, uriCharacters) != strlen(p)) {
+	if (p[strspn(p, uriCharacters)] != '\0') {
 		strcpy(ctx->errMsg, "URI contains illegal characters");
 		goto fail;
 	}
 
-	if (strlen(p) >= 8 && strncmp(p, "https://", 8) == 0)
-		p += 8;
-	else if (strlen(p) >= 7 && strncmp(p, "http://", 7) == 0)
-		p += 7;
-	else {
+	if ((i = gs1_DLschemeLen(p)) == 0) {
 		strcpy(ctx->errMsg, "Scheme must be http:// or https://");
 		goto fail;
 	}
+	p += i;
 
 	DEBUG_PRINT("  Scheme %.*s\n", (int)(p-dlData-3), dlData);
 
@@ -390,6 +462,168 @@ fail:
 
 
 
+/*
+ *  Characters that are not percent-encoded in canonical URIs
+ *
+ */
+static bool isUnreserved(const char c) {
+	return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+	       c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+
+static int findAI(const gs1_encoder *ctx, const bool *used, const char *ai) {
+	int i;
+	for (i = 0; i < ctx->numAIs; i++)
+		if (!used[i] && ctx->aiData[i].aiEntry && strcmp(ctx->aiData[i].aiEntry->ai, ai) == 0)
+			return i;
+	return -1;
+}
+
+
+/*
+ * Produce the canonical element string and canonical DL URI for the AI data
+ *
+ * Both are ordered with the primary key first, then those of its qualifiers
+ * that are present in their required order, then all other AIs in AI order.
+ * The canonical URI uses the https://id.gs1.org stem, carries the attributes
+ * as query parameters and percent-encodes every character other than the
+ * unreserved characters, in upper case. An AI repeated with the same value
+ * appears once; one repeated with differing values is rejected.
+ *
+ */
+bool gs1_canonicaliseDL(gs1_encoder *ctx, char *elementStr, const size_t esMax, char *uri, const size_t uriMax) {
+
+	static const char *hex = "0123456789ABCDEF";
+	static const char *stem = "https://id.gs1.org";
+	int order[MAX_AIS];
+	bool used[MAX_AIS] = { false };
+	const struct dlQualifiers *q = NULL;
+	const struct aiValue *ai;
+	char *e = elementStr, *u = uri;
+	const char *esEnd = elementStr + esMax - 1, *uriEnd = uri + uriMax - 1;
+	int i, j, k, n = 0, path, num;
+	bool fnc1req = true;
+
+	assert(ctx);
+	assert(elementStr);
+	assert(uri);
+
+#define PUT(p, end, c) do {				\
+	if (p == end)					\
+		goto fail;				\
+	*p++ = (c);					\
+} while (0)
+
+	// Identical repeats of an AI are collapsed into the first; differing ones have no canonical form
+	for (i = 0; i < ctx->numAIs; i++) {
+		if (!ctx->aiData[i].aiEntry)
+			continue;
+		for (j = 0; j < i; j++) {
+			if (used[j] || !ctx->aiData[j].aiEntry || ctx->aiData[j].ailen != ctx->aiData[i].ailen ||
+			    memcmp(ctx->aiData[j].ai, ctx->aiData[i].ai, ctx->aiData[i].ailen) != 0)
+				continue;
+			if (ctx->aiData[j].vallen != ctx->aiData[i].vallen ||
+			    memcmp(ctx->aiData[j].value, ctx->aiData[i].value, ctx->aiData[i].vallen) != 0) {
+				sprintf(ctx->errMsg, "AI (%.*s) is repeated with differing values",
+					ctx->aiData[i].ailen, ctx->aiData[i].ai);
+				ctx->errFlag = true;
+				return false;
+			}
+			used[i] = true;
+			break;
+		}
+	}
+
+	// The first primary key is the root of the path info
+	for (i = 0; i < ctx->numAIs; i++)
+		if (ctx->aiData[i].aiEntry && isDLpkey(ctx->aiData[i].aiEntry->ai))
+			break;
+	if (i == ctx->numAIs) {
+		strcpy(ctx->errMsg, "No GS1 DL primary key in the AI data");
+		ctx->errFlag = true;
+		return false;
+	}
+	order[n++] = i;
+	used[i] = true;
+
+	// Use the first qualifier path of the key that has a qualifier present
+	for (i = 0; i < (int)SIZEOF_ARRAY(dl_qualifiers); i++)
+		if (strcmp(dl_qualifiers[i].pkey, ctx->aiData[order[0]].aiEntry->ai) == 0)
+			q = &dl_qualifiers[i];
+	for (i = 0; q && i < (int)SIZEOF_ARRAY(q->paths); i++) {
+		for (j = 0; q->paths[i][j] && findAI(ctx, used, q->paths[i][j]) < 0; j++)
+			;
+		if (!q->paths[i][j])
+			continue;
+		for (j = 0; q->paths[i][j]; j++) {
+			if ((k = findAI(ctx, used, q->paths[i][j])) >= 0) {
+				order[n++] = k;
+				used[k] = true;
+			}
+		}
+		break;
+	}
+	path = n;
+
+	// Attributes in AI order, stable for repeated AIs
+	for (i = 0; i < ctx->numAIs; i++) {
+		if (used[i] || !ctx->aiData[i].aiEntry)
+			continue;
+		for (j = n; j > path && strcmp(ctx->aiData[order[j-1]].aiEntry->ai, ctx->aiData[i].aiEntry->ai) > 0; j--)
+			order[j] = order[j-1];
+		order[j] = i;
+		n++;
+	}
+	num = n;
+
+	for (i = 0; stem[i]; i++)
+		PUT(u, uriEnd, stem[i]);
+
+	for (n = 0; n < num; n++) {
+		ai = &ctx->aiData[order[n]];
+
+		if (fnc1req)
+			PUT(e, esEnd, '^');
+		for (j = 0; j < ai->ailen; j++)
+			PUT(e, esEnd, ai->ai[j]);
+		for (j = 0; j < ai->vallen; j++)
+			PUT(e, esEnd, ai->value[j]);
+		fnc1req = gs1_isFNC1required(ai->aiEntry->ai);
+
+		PUT(u, uriEnd, n < path ? '/' : n == path ? '?' : '&');
+		for (j = 0; j < ai->ailen; j++)
+			PUT(u, uriEnd, ai->ai[j]);
+		PUT(u, uriEnd, n < path ? '/' : '=');
+		for (j = 0; j < ai->vallen; j++) {
+			if (isUnreserved(ai->value[j])) {
+				PUT(u, uriEnd, ai->value[j]);
+			} else {
+				PUT(u, uriEnd, '%');
+				PUT(u, uriEnd, hex[(uint8_t)ai->value[j] >> 4]);
+				PUT(u, uriEnd, hex[(uint8_t)ai->value[j] & 0x0F]);
+			}
+		}
+	}
+
+#undef PUT
+
+	*e = '\0';
+	*u = '\0';
+	return true;
+
+fail:
+
+	strcpy(ctx->errMsg, "Canonical form of the AI data is too long");
+	ctx->errFlag = true;
+	*elementStr = '\0';
+	*uri = '\0';
+	return false;
+
+}
+
+
+
 #ifdef UNIT_TESTS
 
 #define TEST_NO_MAIN
@@ -442,6 +676,16 @@ void test_dl_parseDLuri(void) {
 		"https://a/00/006141411234567890",
 		"^00006141411234567890");
 
+	test_parseDLuri(ctx, true,					// Scheme in any case
+		"HTTPS://a/00/006141411234567890",
+		"^00006141411234567890");
+
+	test_parseDLuri(ctx, true,
+		"Http://a/00/006141411234567890",
+		"^00006141411234567890");
+
+	test_parseDLuri(ctx, false,  "httpx://a/00/006141411234567890", "");
+
 	test_parseDLuri(ctx, false,					// No domain
 		"https://00/006141411234567890",
 		"");
@@ -700,5 +944,88 @@ void test_dl_URIunescape(void) {
 }
 
 
+
+static void test_canonicaliseDL(gs1_encoder *ctx, const char *dataStr, const char *expectES, const char *expectURI) {
+
+	char es[MAX_DATA+1], uri[3*MAX_DATA+1];
+
+	TEST_CASE(dataStr);
+	TEST_ASSERT(gs1_encoder_setDataStr(ctx, dataStr));
+	TEST_CHECK(gs1_canonicaliseDL(ctx, es, sizeof(es), uri, sizeof(uri)));
+	TEST_CHECK(strcmp(es, expectES) == 0);
+	TEST_MSG("Got: %s; Expected: %s", es, expectES);
+	TEST_CHECK(strcmp(uri, expectURI) == 0);
+	TEST_MSG("Got: %s; Expected: %s", uri, expectURI);
+
+}
+
+
+void test_dl_canonicaliseDL(void) {
+
+	gs1_encoder* ctx;
+	char es[32], uri[32];
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+
+	test_canonicaliseDL(ctx, "https://id.gs1.org/01/09520123456788",
+		"^0109520123456788",
+		"https://id.gs1.org/01/09520123456788");
+
+	// GTIN-13 is padded, scheme and stem are replaced
+	test_canonicaliseDL(ctx, "http://a.b/x/01/9520123456788",
+		"^0109520123456788",
+		"https://id.gs1.org/01/09520123456788");
+	test_canonicaliseDL(ctx, "HTTPS://ID.GS1.ORG/01/09520123456788",
+		"^0109520123456788",
+		"https://id.gs1.org/01/09520123456788");
+
+	// Qualifiers in their required order, whether in path or query
+	test_canonicaliseDL(ctx, "https://a.b/01/09520123456788/21/S1?22=V&10=L",
+		"^010952012345678822V^10L^21S1",
+		"https://id.gs1.org/01/09520123456788/22/V/10/L/21/S1");
+
+	// Alternative qualifier path
+	test_canonicaliseDL(ctx, "https://a.b/01/09520123456788/235/TPX1",
+		"^0109520123456788235TPX1",
+		"https://id.gs1.org/01/09520123456788/235/TPX1");
+	test_canonicaliseDL(ctx, "https://a.b/414/9520123456788?7040=1A23",
+		"^41495201234567887040" "1A23",
+		"https://id.gs1.org/414/9520123456788/7040/1A23");
+
+	// Attributes in AI order, with normalised percent-encoding
+	test_canonicaliseDL(ctx, "https://a.b/00/095201234567891235?99=A%2a?&3103=000500&400=P%2fO",
+		"^00095201234567891235" "3103000500" "400P/O^99A*?",
+		"https://id.gs1.org/00/095201234567891235?3103=000500&400=P%2FO&99=A%2A%3F");
+
+	// Identical repeats are collapsed, wherever they appear
+	test_canonicaliseDL(ctx, "https://a.b/01/09520123456788?10=ABC&10=ABC",
+		"^0109520123456788" "10ABC",
+		"https://id.gs1.org/01/09520123456788/10/ABC");
+	test_canonicaliseDL(ctx, "https://a.b/01/09520123456788?99=X&3103=000500&99=X",
+		"^0109520123456788" "3103000500" "99X",
+		"https://id.gs1.org/01/09520123456788?3103=000500&99=X");
+
+	// AI element strings have a canonical form too
+	test_canonicaliseDL(ctx, "^10ABC^0109520123456788",
+		"^0109520123456788" "10ABC",
+		"https://id.gs1.org/01/09520123456788/10/ABC");
+
+	TEST_ASSERT(gs1_encoder_setDataStr(ctx, "^10ABC"));
+	TEST_CHECK(!gs1_canonicaliseDL(ctx, es, sizeof(es), uri, sizeof(uri)));
+	TEST_CHECK(strcmp(ctx->errMsg, "No GS1 DL primary key in the AI data") == 0);
+
+	TEST_ASSERT(gs1_encoder_setDataStr(ctx, "https://a.b/01/09520123456788?10=ABC&10=ABD"));
+	TEST_CHECK(!gs1_canonicaliseDL(ctx, es, sizeof(es), uri, sizeof(uri)));
+	TEST_CHECK(strcmp(ctx->errMsg, "AI (10) is repeated with differing values") == 0);
+
+	TEST_ASSERT(gs1_encoder_setDataStr(ctx, "^0109520123456788^10ABC"));
+	TEST_CHECK(!gs1_canonicaliseDL(ctx, es, sizeof(es), uri, sizeof(uri)));
+	TEST_CHECK(strcmp(ctx->errMsg, "Canonical form of the AI data is too long") == 0);
+
+	gs1_encoder_free(ctx);
+
+}
+
+
 #endif  /* UNIT_TESTS */
 
@@ -22,16 +22,20 @@
 #define DL_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "gs1encoders.h"
 
+size_t gs1_DLschemeLen(const char *data);
 bool gs1_parseDLuri(gs1_encoder *ctx, char *dlData, char *dataStr);
+bool gs1_canonicaliseDL(gs1_encoder *ctx, char *elementStr, size_t esMax, char *uri, size_t uriMax);
 
 
 #ifdef UNIT_TESTS
 
 void test_dl_parseDLuri(void);
 void test_dl_URIunescape(void);
+void test_dl_canonicaliseDL(void);
 
 #endif
 
@@ -227,6 +227,40 @@ static void createCodewords(gs1_encoder *ctx, const uint8_t *string, uint8_t cws
 }
 
 
+// Number of codewords that createCodewords() produces for the data, without any limit
+static int countCodewords(const uint8_t *string) {
+
+	const uint8_t *q;
+	bool gs1Mode = false;
+	int n = 0;
+
+	if (*string == '^') {
+		gs1Mode = true;
+	} else {
+		q = string;
+		while (*q == '\\')
+			q++;
+		if (*q == '^')
+			string++;
+	}
+
+	while (*string) {
+		if (*string == '^' && gs1Mode) {
+			string++;
+		} else if (*string >= '0' && *string <= '9' &&
+			   *(string+1) >= '0' && *(string+1) <= '9') {
+			string += 2;
+		} else if (*string++ > 127) {
+			n++;	// Upper shift
+		}
+		n++;
+	}
+
+	return n;
+
+}
+
+
 // Select a symbol version that is sufficent to hold the encoded bitstream
 static const struct metric* selectVersion(gs1_encoder *ctx, const uint16_t cwslen) {
 
@@ -465,6 +499,29 @@ static void createMatrix(gs1_encoder *ctx, uint8_t *mtx, const uint8_t *cws, con
 }
 
 
+// Check that the input is an AI element string or DL URI
+static bool checkInput(gs1_encoder *ctx, const uint8_t string[]) {
+
+	if (*string == '^' && strchr((const char*)string, '|') != NULL) {
+		strcpy(ctx->errMsg, "Composite component is not supported for Data Matrix");
+		ctx->errFlag = true;
+		return false;
+	}
+
+	// For GS1 purposes we restrict to AI or DL only
+	if (!(*string == '^' ||
+	     (strlen((const char*)string) >= 8 && strncmp((const char*)string, "https://", 8) == 0) ||
+	     (strlen((const char*)string) >= 7 && strncmp((const char*)string, "http://",  7) == 0)) ) {
+		strcpy(ctx->errMsg, "Data Matrix input must be either an AI element string or a Digital Link URI");
+		ctx->errFlag = true;
+		return false;
+	}
+
+	return true;
+
+}
+
+
 static int DMenc(gs1_encoder *ctx, const uint8_t string[], struct patternLength *pats) {
 
 	uint8_t mtx[MAX_DM_BYTES] = { 0 };
@@ -477,20 +534,8 @@ static int DMenc(gs1_encoder *ctx, const uint8_t string[], struct patternLength
 
 	DEBUG_PRINT("\nData: %s\n", string);
 
-	if (*string == '^' && strchr((char*)string, '|') != NULL) {
-		strcpy(ctx->errMsg, "Composite component is not supported for Data Matrix");
-		ctx->errFlag = true;
-		return 0;
-	}
-
-	// For GS1 purposes we restrict to AI or DL only
-	if (!(*string == '^' ||
-	     (strlen((char*)string) >= 8 && strncmp((char*)string, "https://", 8) == 0) ||
-	     (strlen((char*)string) >= 7 && strncmp((char*)string, "http://",  7) == 0)) ) {
-		strcpy(ctx->errMsg, "Data Matrix input must be either an AI element string or a Digital Link URI");
-		ctx->errFlag = true;
+	if (!checkInput(ctx, string))
 		return 0;
-	}
 
 	createCodewords(ctx, string, cws, &cwslen);
 	if (cwslen == UINT16_MAX) {
@@ -532,6 +577,48 @@ static int DMenc(gs1_encoder *ctx, const uint8_t string[], struct patternLength
 }
 
 
+// Report the size that DMenc() selects for the data, without encoding it
+bool gs1_DMcapacity(gs1_encoder *ctx, gs1_encoder_capacity *cap) {
+
+	const uint8_t *string = (const uint8_t *)ctx->dataStr;
+	const struct metric *m, *largest = NULL;
+	int vers, cwslen;
+
+	if (!checkInput(ctx, string))
+		return false;
+
+	cwslen = countCodewords(string);
+
+	m = selectVersion(ctx, (uint16_t)(cwslen <= MAX_DM_DAT_CWS ? cwslen : UINT16_MAX));
+	if (!m) {
+		// Largest of the sizes that the settings permit
+		for (vers = 1; vers < (int)(SIZEOF_ARRAY(metrics)); vers++) {
+			if ((ctx->dmRows == 0 || ctx->dmRows == metrics[vers].rows) &&
+			    (ctx->dmCols == 0 || ctx->dmCols == metrics[vers].cols) &&
+			    (!largest || metrics[vers].ncws > largest->ncws))
+				largest = &metrics[vers];
+		}
+		m = largest;
+	}
+
+	if (!m) {
+		strcpy(ctx->errMsg, "No Data Matrix symbol has the specified rows and columns");
+		ctx->errFlag = true;
+		return false;
+	}
+
+	cap->units = gs1_encoder_capBITS;
+	cap->used = cwslen*8;
+	cap->capacity = m->ncws*8;
+	cap->rows = m->rows;
+	cap->columns = m->cols;
+	cap->fits = cwslen <= m->ncws;
+
+	return true;
+
+}
+
+
 void gs1_DM(gs1_encoder *ctx) {
 
 	struct sPrints prints = { 0 };
@@ -652,4 +739,64 @@ NULL
 }
 
 
+void test_dm_DMcapacity(void) {
+
+	static const char *data[] = {
+		"^011231231231233310ABC123",
+		"^991",
+		"^9912A3",
+		"\\^99ABC",
+		"\\\\^99ABC",
+		"https://id.gs1.org/01/12312312312333",
+		"https://example.com/\xC0\xFF",
+		NULL
+	};
+
+	gs1_encoder* ctx = gs1_encoder_init(NULL);
+	gs1_encoder_capacity cap;
+	uint8_t cws[MAX_DM_CWS];
+	uint16_t cwslen;
+	int i;
+
+	// The count agrees with the codewords that are generated
+	for (i = 0; data[i]; i++) {
+		createCodewords(ctx, (const uint8_t*)data[i], cws, &cwslen);
+		TEST_CHECK(countCodewords((const uint8_t*)data[i]) == cwslen);
+		TEST_MSG("%s", data[i]);
+	}
+
+	TEST_ASSERT(gs1_encoder_setFormat(ctx, gs1_encoder_dRAW));
+	TEST_ASSERT(gs1_encoder_setSym(ctx, gs1_encoder_sDM));
+	TEST_ASSERT(gs1_encoder_setDataStr(ctx, data[0]));
+
+	TEST_ASSERT(gs1_DMcapacity(ctx, &cap));
+	TEST_CHECK(cap.used == 15*8);
+	TEST_CHECK(cap.capacity == 18*8);
+	TEST_CHECK(cap.rows == 18 && cap.columns == 18);
+	TEST_CHECK(cap.fits);
+	TEST_ASSERT(gs1_encoder_encode(ctx));
+	TEST_CHECK(gs1_encoder_getBufferWidth(ctx) == 18 + 2*DM_QZ);
+
+	// Too large for the specified size
+	TEST_ASSERT(gs1_encoder_setDmRows(ctx, 16));
+	TEST_ASSERT(gs1_encoder_setDmColumns(ctx, 16));
+	TEST_ASSERT(gs1_DMcapacity(ctx, &cap));
+	TEST_CHECK(cap.capacity == 12*8);
+	TEST_CHECK(cap.rows == 16 && cap.columns == 16);
+	TEST_CHECK(!cap.fits);
+	TEST_CHECK(!gs1_encoder_encode(ctx));
+
+	// The largest of the sizes with the specified rows
+	TEST_ASSERT(gs1_encoder_setDmRows(ctx, 8));
+	TEST_ASSERT(gs1_encoder_setDmColumns(ctx, 0));
+	TEST_ASSERT(gs1_DMcapacity(ctx, &cap));
+	TEST_CHECK(cap.capacity == 10*8);
+	TEST_CHECK(cap.rows == 8 && cap.columns == 32);
+	TEST_CHECK(!cap.fits);
+
+	gs1_encoder_free(ctx);
+
+}
+
+
 #endif  /* UNIT_TESTS */
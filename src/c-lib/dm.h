@@ -38,12 +38,14 @@
 
 
 void gs1_DM(gs1_encoder *ctx);
+bool gs1_DMcapacity(gs1_encoder *ctx, gs1_encoder_capacity *cap);
 
 
 #ifdef UNIT_TESTS
 
 void test_dm_DM_dataLength(void);
 void test_dm_DM_encode(void);
+void test_dm_DMcapacity(void);
 
 #endif
 
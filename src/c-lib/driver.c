@@ -22,44 +22,185 @@
 #include <float.h>
 #include <math.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if !defined(NOMALLOC) && !defined(_WIN32)
+#include <pthread.h>
+#define RASTER_THREADS
+#endif
+
 #include "enc-private.h"
 #include "driver.h"
+#include "hri.h"
+#include "path.h"
+#include "preview.h"
 
 
-static bool emitData(gs1_encoder *ctx, const void *data, const size_t len) {
+static bool batchFlush(gs1_encoder *ctx) {
+
+	if (ctx->driver_batchBlockLen == 0)
+		return true;
+
+	if (fwrite(ctx->driver_batchBlock, ctx->driver_batchBlockLen, 1, ctx->driver_batchfp) != 1) {
+		strcpy(ctx->errMsg, "Failed writing to batch file");
+		ctx->errFlag = true;
+		return false;
+	}
+	ctx->driver_batchFlushed += ctx->driver_batchBlockLen;
+	ctx->driver_batchBlockLen = 0;
+	return true;
+
+}
+
+
+// Accumulate output into large blocks so that the file sees few, big writes
+static bool batchWrite(gs1_encoder *ctx, const void *data, size_t len) {
+
+	const uint8_t *p = data;
+	size_t n;
+
+	while (len > 0) {
+		n = BATCH_BLOCK_SIZE - ctx->driver_batchBlockLen;
+		if (n > len)
+			n = len;
+		memcpy(&ctx->driver_batchBlock[ctx->driver_batchBlockLen], p, n);
+		ctx->driver_batchBlockLen += n;
+		p += n;
+		len -= n;
+		if (ctx->driver_batchBlockLen == BATCH_BLOCK_SIZE && !batchFlush(ctx))
+			return false;
+	}
+	return true;
+
+}
+
+
+static uint64_t batchPos(const gs1_encoder *ctx) {
+	return ctx->driver_batchFlushed + ctx->driver_batchBlockLen;
+}
+
+
+// Point the previous IFD, or the file header, at the IFD about to be written
+static bool batchLink(gs1_encoder *ctx, const uint32_t ifd) {
+
+	uint64_t at = ctx->driver_batchNextDir;
+
+	if (at >= ctx->driver_batchFlushed) {
+		memcpy(&ctx->driver_batchBlock[at - ctx->driver_batchFlushed], &ifd, sizeof(ifd));
+		return true;
+	}
+
+	// Already written out, so patch the file in place
+	if (!batchFlush(ctx))
+		return false;
+	if (fseek(ctx->driver_batchfp, (long)at, SEEK_SET) != 0 ||
+	    fwrite(&ifd, sizeof(ifd), 1, ctx->driver_batchfp) != 1 ||
+	    fseek(ctx->driver_batchfp, 0, SEEK_END) != 0) {
+		strcpy(ctx->errMsg, "Failed writing to batch file");
+		ctx->errFlag = true;
+		return false;
+	}
+	return true;
+
+}
+
+
+static bool fileSink(gs1_encoder *ctx, const void *data, const size_t len) {
+	fwrite(data, len, 1, ctx->outfp);
+	return true;
+}
+
+
+static bool bufferSink(gs1_encoder *ctx, const void *data, const size_t len) {
 
 	uint8_t *buf;
 
-	if (strcmp(ctx->outFile, "") != 0) {
-		fwrite(data, len, 1, ctx->outfp);
-	} else {
-		if (ctx->bufferSize + len > ctx-> bufferCap) {
-			if ((buf = realloc(ctx->buffer, ctx->bufferCap * 2)) == NULL) {
-				free(ctx->buffer);
-				ctx->bufferCap = 0;
-				ctx->bufferSize = 0;
-				ctx->bufferWidth = 0;
-				ctx->bufferHeight = 0;
-				strcpy(ctx->errMsg, "Failed to expand output buffer");
-				ctx->errFlag = true;
-				return false;
-			};
-			ctx->buffer = buf;
-			ctx->bufferCap *= 2;
-		}
-		memcpy(&ctx->buffer[ctx->bufferSize], data, len);
-		ctx->bufferSize += len;
+	if (ctx->bufferSize + len > ctx-> bufferCap) {
+		if ((buf = gs1_arenaRealloc(&ctx->bufferArena, ctx->buffer, ctx->bufferCap * 2)) == NULL) {
+			gs1_arenaFree(&ctx->bufferArena, ctx->buffer);
+			ctx->buffer = NULL;
+			ctx->bufferCap = 0;
+			ctx->bufferSize = 0;
+			ctx->bufferWidth = 0;
+			ctx->bufferHeight = 0;
+			strcpy(ctx->errMsg, "Failed to expand output buffer");
+			ctx->errFlag = true;
+			return false;
+		};
+		ctx->buffer = buf;
+		ctx->bufferCap *= 2;
 	}
+	memcpy(&ctx->buffer[ctx->bufferSize], data, len);
+	ctx->bufferSize += len;
 	return true;
 
 }
 
 
+static bool emitData(gs1_encoder *ctx, const void *data, const size_t len) {
+
+	if (ctx->driver_plan.digest)
+		gs1_digestUpdate(&ctx->driver_digest, data, len);
+
+	return ctx->driver_plan.sink(ctx, data, len);
+
+}
+
+
+// Compile the pixel widths and row layout for the current settings, if they have changed
+static void planCompile(gs1_encoder *ctx) {
+
+	struct renderPlan *plan = &ctx->driver_plan;
+	int w;
+
+	plan->digest = ctx->outputDigestAlg != gs1_encoder_digestNONE;
+
+	if (plan->pixMult == ctx->pixMult && plan->Xundercut == ctx->Xundercut && plan->format == ctx->format)
+		return;
+
+	for (w = 0; w < 256; w++) {
+		plan->plain[w] = w * ctx->pixMult;
+		plan->wide[w] = plan->plain[w] + ctx->Xundercut;
+		plan->narrow[w] = plan->plain[w] - ctx->Xundercut;
+	}
+	plan->xorMsk = ctx->format == gs1_encoder_dBMP ? 0xFF : 0;	// invert BMP bits
+	plan->rowAlign = ctx->format == gs1_encoder_dBMP ? 4 : 1;
+	plan->pixMult = ctx->pixMult;
+	plan->Xundercut = ctx->Xundercut;
+	plan->format = ctx->format;
+
+}
+
+
+static size_t planRowBytes(const gs1_encoder *ctx, const long xdim) {
+	return ((size_t)(xdim+7)/8 + ctx->driver_plan.rowAlign - 1) & ~(ctx->driver_plan.rowAlign - 1);
+}
+
+
+static bool isPreview(const gs1_encoder *ctx) {
+	return ctx->format == gs1_encoder_dGRAY || ctx->format == gs1_encoder_dRGBA;
+}
+
+
+// Scale a band of identical rows into the preview, emitting each completed row
+static void previewBand(gs1_encoder *ctx, const uint8_t *bits, const long rows) {
+
+	const uint8_t *px;
+
+	if (rows <= 0)
+		return;
+
+	gs1_previewBand(&ctx->driver_preview, bits, rows);
+	while ((px = gs1_previewNext(&ctx->driver_preview)) != NULL)
+		emitData(ctx, px, (size_t)ctx->driver_preview.outW * (size_t)ctx->driver_preview.bpp);
+
+}
+
+
 static void bmpHeader(gs1_encoder *ctx, const long xdim, const long ydim) {
 
 	uint8_t id[2] = {'B','M'};
@@ -94,24 +235,28 @@ static void bmpHeader(gs1_encoder *ctx, const long xdim, const long ydim) {
 }
 
 
-static void tifHeader(gs1_encoder *ctx, const long xdim, const long ydim) {
-
-	struct t_hdr {
-		uint8_t endian[2];
-		uint16_t version;
-		uint32_t diroff;
-	};
+struct t_hdr {
+	uint8_t endian[2];
+	uint16_t version;
+	uint32_t diroff;
+};
 
-	struct t_tag {
-		uint16_t tag_type;
-		uint16_t num_size;
-		uint32_t length;
-		uint32_t offset;
-	};
+struct t_tag {
+	uint16_t tag_type;
+	uint16_t num_size;
+	uint32_t length;
+	uint32_t offset;
+};
 
 #define TAG_CNT 14
+#define TIF_DIR_SIZE (2+TAG_CNT*12+4+8+8)	// IFD, next IFD offset and resolution data
+#define TIF_NEXTDIR_OFFSET (2+TAG_CNT*12)
+#define TIF_STRIPS_SIZE(strips) ((strips) > 1 ? 8*(strips) : 0)	// Strip offset and byte count arrays
+
+
+// Directory for an image whose IFD is located at offset "base", with the strips following
+static void tifDirectory(gs1_encoder *ctx, const uint32_t base, const uint32_t subfileType, const long xdim, const long ydim, const long rowsPerStrip) {
 
-	struct t_hdr header = { {'I','I'},42,8L };
 	short tagnum = TAG_CNT;
 	struct t_tag type = { 0xFE, 4, 1L, 0L };
 	struct t_tag width = { 0x100, 3, 1L, 6L };
@@ -120,25 +265,39 @@ static void tifHeader(gs1_encoder *ctx, const long xdim, const long ydim) {
 	struct t_tag compress = { 0x103, 3, 1L, 1L };
 	struct t_tag whiteIs = { 0x106, 3, 1L, 0L };
 	struct t_tag thresholding = { 0x107, 3, 1L, 1L };
-	struct t_tag stripOffset = { 0x111, 4, 1L, 8L+2+TAG_CNT*12+4+8+8 };
+	struct t_tag stripOffset = { 0x111, 4, 1L, 0L };
 	struct t_tag samplesPerPix = { 0x115, 3, 1L, 1L };
 	struct t_tag stripRows = { 0x116, 4, 1L, 16L };
 	struct t_tag stripBytes = { 0x117, 4, 1L, 16L };
-	struct t_tag xRes = { 0x11A, 5, 1L, 8L+2+TAG_CNT*12+4 };
-	struct t_tag yRes = { 0x11B, 5, 1L, 8L+2+TAG_CNT*12+4+8 };
+	struct t_tag xRes = { 0x11A, 5, 1L, 0L };
+	struct t_tag yRes = { 0x11B, 5, 1L, 0L };
 	struct t_tag resUnit = { 0x128, 3, 1L, 3L }; // centimeters
 	uint32_t nextdir = 0L;
 	uint32_t xResData[2] = { 120L, 1L }; // 120 = 10mils @ 300 dpi
 	uint32_t yResData[2] = { 120L, 1L }; // 120 = 10mils @ 300 dpi
+	const uint32_t strips = (uint32_t)((ydim + rowsPerStrip - 1) / rowsPerStrip);
+	const uint32_t rowBytes = (uint32_t)((xdim+7)/8);
+	const uint32_t data = base+TIF_DIR_SIZE+TIF_STRIPS_SIZE(strips);
+	uint32_t i, v;
 
+	type.offset = subfileType;
 	width.offset = (uint32_t)xdim;
 	height.offset = (uint32_t)ydim;
-	stripRows.offset = (uint32_t)ydim;
-	stripBytes.offset = (uint32_t)(((xdim+7)/8) * ydim);
+	stripRows.offset = (uint32_t)rowsPerStrip;
+	if (strips > 1) {
+		// Arrays follow the resolution data
+		stripOffset.length = stripBytes.length = strips;
+		stripOffset.offset = base+TIF_DIR_SIZE;
+		stripBytes.offset = base+TIF_DIR_SIZE+4*strips;
+	} else {
+		stripOffset.offset = data;
+		stripBytes.offset = rowBytes * (uint32_t)ydim;
+	}
+	xRes.offset = base+2+TAG_CNT*12+4;
+	yRes.offset = base+2+TAG_CNT*12+4+8;
 	xResData[1] = 1L; //reduce to 10 mils
 	yResData[1] = 1L; //reduce to 10 mils
 
-	emitData(ctx, &header, sizeof(header));
 	emitData(ctx, &tagnum, sizeof(tagnum));
 	emitData(ctx, &type, sizeof(type));
 	emitData(ctx, &width, sizeof(width));
@@ -157,28 +316,56 @@ static void tifHeader(gs1_encoder *ctx, const long xdim, const long ydim) {
 	emitData(ctx, &nextdir, sizeof(nextdir));
 	emitData(ctx, &xResData, sizeof(xResData));
 	emitData(ctx, &yResData, sizeof(yResData));
+	if (strips > 1) {
+		for (i = 0; i < strips; i++) {
+			v = data + i * (uint32_t)rowsPerStrip * rowBytes;
+			emitData(ctx, &v, sizeof(v));
+		}
+		for (i = 0; i < strips; i++) {
+			v = (i < strips-1 ? (uint32_t)rowsPerStrip : (uint32_t)ydim - i * (uint32_t)rowsPerStrip) * rowBytes;
+			emitData(ctx, &v, sizeof(v));
+		}
+	}
 	return;
 }
 
 
-static void printElm(gs1_encoder *ctx, const int width, const int color, int *bits, int *ndx, const uint8_t xorMsk) {
+static void tifHeader(gs1_encoder *ctx, const long xdim, const long ydim) {
+
+	struct t_hdr header = { {'I','I'},42,8L };
+
+	emitData(ctx, &header, sizeof(header));
+	tifDirectory(ctx, sizeof(header), 0, xdim, ydim, ctx->driver_bandRows);
+	return;
+}
+
+
+// A row being rasterised into a line, and the same line Y undercut against the previous row
+struct rasterLine {
+	uint8_t *line;
+	uint8_t *lineUCut;
+	uint8_t xorMsk;
+	int bits;
+	int ndx;
+	bool overflow;
+};
+
+
+static void printElm(struct rasterLine *rl, const int width, const int color) {
 
 	int i;
-	uint8_t *line = ctx->driver_line;
-	uint8_t *lineUCut = ctx->driver_lineUCut;
 
 	for (i = 0; i < width; i++) {
-		*bits = (*bits<<1) + color;
-		if (*bits > 0xff) {
-			lineUCut[*ndx] = (uint8_t)(((line[*ndx]^xorMsk)&(*bits&0xff))^xorMsk); // Y undercut
-			line[(*ndx)++] = (uint8_t)((*bits&0xff) ^ xorMsk);
-			if (*ndx >= MAX_LINE/8 + 1) {
-				*ndx = 0;
-				strcpy(ctx->errMsg, "Print line too long in graphic line.");
-				ctx->errFlag = true;
+		rl->bits = (rl->bits<<1) + color;
+		if (rl->bits > 0xff) {
+			rl->lineUCut[rl->ndx] = (uint8_t)(((rl->line[rl->ndx]^rl->xorMsk)&(rl->bits&0xff))^rl->xorMsk); // Y undercut
+			rl->line[rl->ndx++] = (uint8_t)((rl->bits&0xff) ^ rl->xorMsk);
+			if (rl->ndx >= MAX_LINE/8 + 1) {
+				rl->ndx = 0;
+				rl->overflow = true;
 				return;
 			}
-			*bits = 1;
+			rl->bits = 1;
 		}
 	}
 	return;
@@ -187,111 +374,105 @@ static void printElm(gs1_encoder *ctx, const int width, const int color, int *bi
 
 #define WHITE 0
 
-static void printElmnts(gs1_encoder *ctx, const struct sPrints *prints) {
-
-	int i, bits, width, ndx, white;
-	uint8_t xorMsk;
-	int undercut;
-	uint8_t *line = ctx->driver_line;
-	uint8_t *lineUCut = ctx->driver_lineUCut;
-
-	bits = 1;
-	ndx = 0;
-	if (prints->whtFirst) {
-		white = WHITE;
-		undercut = ctx->Xundercut;
-	}
-	else {
-		white = WHITE^1; // invert white if starting black
-		undercut = -ctx->Xundercut; // -undercut if starting black
-	}
-	if ((prints->reverse) && ((prints->elmCnt & 1) == 0)) {
-		white = white^1; // invert if reversed even elements
-		undercut = -undercut;
-	}
-	xorMsk = ctx->format == gs1_encoder_dBMP ? 0xFF : 0; // invert BMP bits
-	if (ctx->line1) {
+// Rasterise a row into the given lines, returning the bytes in each or -1 on overflow
+static int rasterRow(const gs1_encoder *ctx, const struct sPrints *prints, uint8_t *line, uint8_t *lineUCut, const bool line1) {
+
+	const struct renderPlan *plan = &ctx->driver_plan;
+	struct rasterLine rl;
+	const uint8_t *p;
+	const int *first, *second;	// Pixels for the first and second element of each pair
+	int i, step, white;
+
+	rl.line = line;
+	rl.lineUCut = lineUCut;
+	rl.xorMsk = plan->xorMsk;
+	rl.bits = 1;
+	rl.ndx = 0;
+	rl.overflow = false;
+
+	// Pairs begin white and are undercut, unless starting black or reversed with even elements
+	white = prints->whtFirst ? WHITE : WHITE^1;
+	if ((prints->reverse) && ((prints->elmCnt & 1) == 0))
+		white = white^1;
+	first = white == WHITE ? plan->wide : plan->narrow;
+	second = white == WHITE ? plan->narrow : plan->wide;
+
+	p = prints->reverse ? &prints->pattern[prints->elmCnt-1] : prints->pattern;
+	step = prints->reverse ? -1 : 1;
+
+	if (line1) {
 		for (i = 0; i < MAX_LINE/8; i++) {
-			line[i] = xorMsk;
+			line[i] = rl.xorMsk;
 		}
-		ctx->line1 = false;
 	}
 	// fill left pad worth of WHITE
-	printElm(ctx, prints->leftPad*ctx->pixMult, WHITE , &bits, &ndx, xorMsk);
+	printElm(&rl, prints->leftPad*ctx->pixMult, WHITE);
 
 	// process WHITE/BLACK elements in pairs for undercut
 	if (prints->guards) { // print guard pattern
-		printElm(ctx, ctx->pixMult + undercut, white , &bits, &ndx, xorMsk);
-		printElm(ctx, ctx->pixMult - undercut, (white^1) , &bits, &ndx, xorMsk);
+		printElm(&rl, first[1], white);
+		printElm(&rl, second[1], (white^1));
 	}
 	for(i = 0; i < prints->elmCnt-1; i += 2) {
-		if (prints->reverse) {
-			width = (int)prints->pattern[prints->elmCnt-1-i]*ctx->pixMult + undercut;
-		}
-		else {
-			width = (int)prints->pattern[i]*ctx->pixMult + undercut;
-		}
-		printElm(ctx, width, white , &bits, &ndx, xorMsk);
-
-		if (prints->reverse) {
-			width = (int)prints->pattern[prints->elmCnt-2-i]*ctx->pixMult - undercut;
-		}
-		else {
-			width = (int)prints->pattern[i+1]*ctx->pixMult - undercut;
-		}
-		printElm(ctx, width, (white^1) , &bits, &ndx, xorMsk);
+		printElm(&rl, first[p[0]], white);
+		printElm(&rl, second[p[step]], (white^1));
+		p += 2*step;
 	}
 
 	// process any trailing odd numbered element with no undercut
 	if (i < prints->elmCnt) {
 		if (prints->guards) { // print last element plus guard pattern
-			if (prints->reverse) {
-				width = (int)prints->pattern[0]*ctx->pixMult + undercut;
-			}
-			else {
-				width = (int)prints->pattern[i]*ctx->pixMult + undercut;
-			}
-			printElm(ctx, width, white , &bits, &ndx, xorMsk);
-
-			printElm(ctx, ctx->pixMult - undercut, (white^1) , &bits, &ndx, xorMsk);
-			printElm(ctx, ctx->pixMult, white , &bits, &ndx, xorMsk); // last- no undercut
+			printElm(&rl, first[p[0]], white);
+			printElm(&rl, second[1], (white^1));
+			printElm(&rl, plan->plain[1], white); // last- no undercut
 		}
 		else { // no guard, print last odd without undercut
-			if (prints->reverse) {
-				width = (int)prints->pattern[0]*ctx->pixMult;
-			}
-			else {
-				width = (int)prints->pattern[i]*ctx->pixMult;
-			}
-			printElm(ctx, width, white , &bits, &ndx, xorMsk);
+			printElm(&rl, plan->plain[p[0]], white);
 		}
 	}
 	else if (prints->guards) { // even number, just print guard pattern
-		printElm(ctx, ctx->pixMult + undercut, white , &bits, &ndx, xorMsk);
-		printElm(ctx, ctx->pixMult - undercut, (white^1) , &bits, &ndx, xorMsk);
+		printElm(&rl, first[1], white);
+		printElm(&rl, second[1], (white^1));
 	}
 	// fill right pad worth of WHITE
-	printElm(ctx, prints->rightPad*ctx->pixMult, WHITE , &bits, &ndx, xorMsk);
+	printElm(&rl, prints->rightPad*ctx->pixMult, WHITE);
 	// pad last byte's bits
-	if (bits != 1) {
-		while ((bits = (bits<<1) + WHITE) <= 0xff);
-		lineUCut[ndx] = (uint8_t)(((line[ndx]^xorMsk)&(bits&0xff))^xorMsk); // Y undercut
-		line[ndx++] = (uint8_t)((bits&0xff) ^ xorMsk);
-		if (ndx > MAX_LINE/8 + 1) {
-			strcpy(ctx->errMsg, "Print line too long");
-			ctx->errFlag = true;
-			return;
-		}
+	if (rl.bits != 1) {
+		while ((rl.bits = (rl.bits<<1) + WHITE) <= 0xff);
+		lineUCut[rl.ndx] = (uint8_t)(((line[rl.ndx]^rl.xorMsk)&(rl.bits&0xff))^rl.xorMsk); // Y undercut
+		line[rl.ndx++] = (uint8_t)((rl.bits&0xff) ^ rl.xorMsk);
+		if (rl.ndx > MAX_LINE/8 + 1)
+			return -1;
 	}
-	if (ctx->format == gs1_encoder_dBMP) {
-		while ((ndx & 3) != 0) {
-			line[ndx++] = 0xFF; // pad to long word boundary for .BMP
-			if (ndx >= MAX_LINE/8 + 1) {
-				strcpy(ctx->errMsg, "Print line too long");
-				ctx->errFlag = true;
-				return;
-			}
-		}
+	// pad to the row alignment, which is a long word boundary for .BMP
+	while (((size_t)rl.ndx & (plan->rowAlign - 1)) != 0) {
+		line[rl.ndx++] = rl.xorMsk;
+		if (rl.ndx >= MAX_LINE/8 + 1)
+			return -1;
+	}
+
+	return rl.overflow ? -1 : rl.ndx;
+}
+
+
+static void printElmnts(gs1_encoder *ctx, const struct sPrints *prints) {
+
+	int i, ndx;
+	uint8_t *line = ctx->driver_line;
+	uint8_t *lineUCut = ctx->driver_lineUCut;
+
+	ndx = rasterRow(ctx, prints, line, lineUCut, ctx->line1);
+	ctx->line1 = false;
+	if (ndx < 0) {
+		strcpy(ctx->errMsg, "Print line too long");
+		ctx->errFlag = true;
+		return;
+	}
+
+	if (isPreview(ctx)) {
+		previewBand(ctx, lineUCut, ctx->Yundercut);
+		previewBand(ctx, line, prints->height - ctx->Yundercut);
+		return;
 	}
 
 	for (i = 0; i < ctx->Yundercut; i++) {
@@ -304,20 +485,591 @@ static void printElmnts(gs1_encoder *ctx, const struct sPrints *prints) {
 }
 
 
+// Start a new page at the end of the batch file, chained from the previous page
+static bool batchPage(gs1_encoder *ctx, const long xdim, const long ydim) {
+
+	uint8_t pad = 0;
+	uint32_t *index;
+	uint64_t page;
+
+	if (ctx->format != gs1_encoder_dTIF) {
+		strcpy(ctx->errMsg, "Batch output requires TIFF format");
+		ctx->errFlag = true;
+		return false;
+	}
+
+	// IFDs must begin on a word boundary
+	if (batchPos(ctx) % 2 != 0 && !batchWrite(ctx, &pad, 1))
+		return false;
+
+	page = batchPos(ctx);
+	if (page + TIF_DIR_SIZE + TIF_STRIPS_SIZE((uint64_t)((ydim + ctx->driver_bandRows - 1) / ctx->driver_bandRows)) +
+	    (uint64_t)(((xdim+7)/8) * ydim) > UINT32_MAX) {
+		strcpy(ctx->errMsg, "Batch file would exceed the TIFF size limit");
+		ctx->errFlag = true;
+		return false;
+	}
+
+	if (ctx->driver_batchPages == ctx->driver_batchIndexCap) {
+		ctx->driver_batchIndexCap = ctx->driver_batchIndexCap ? ctx->driver_batchIndexCap * 2 : 256;
+		if ((index = gs1_arenaRealloc(&ctx->driver_batchArena, ctx->driver_batchIndex, (size_t)ctx->driver_batchIndexCap * sizeof(uint32_t))) == NULL) {
+			ctx->driver_batchIndexCap = ctx->driver_batchPages;
+			strcpy(ctx->errMsg, "Out of memory extending batch page index");
+			ctx->errFlag = true;
+			return false;
+		}
+		ctx->driver_batchIndex = index;
+	}
+
+	if (!batchLink(ctx, (uint32_t)page))
+		return false;
+	ctx->driver_batchNextDir = page + TIF_NEXTDIR_OFFSET;
+	ctx->driver_batchIndex[ctx->driver_batchPages++] = (uint32_t)page;
+
+	tifDirectory(ctx, (uint32_t)page, 2, xdim, ydim, ctx->driver_bandRows);  // Single page of a multi-page image
+
+	return true;
+
+}
+
+
+bool gs1_driverOpenBatch(gs1_encoder *ctx, const char *batchFile) {
+
+	struct t_hdr header = { {'I','I'},42,0L };
+
+	if (ctx->driver_batchfp) {
+		strcpy(ctx->errMsg, "A batch file is already open");
+		ctx->errFlag = true;
+		return false;
+	}
+
+	// Index of any previous batch is released, so that the new one follows the block
+	gs1_arenaFree(&ctx->driver_batchArena, ctx->driver_batchIndex);
+	ctx->driver_batchIndex = NULL;
+	ctx->driver_batchIndexCap = 0;
+	gs1_arenaReset(&ctx->driver_batchArena);
+
+	if ((ctx->driver_batchBlock = gs1_arenaAlloc(&ctx->driver_batchArena, BATCH_BLOCK_SIZE)) == NULL) {
+		strcpy(ctx->errMsg, "Out of memory allocating batch output block");
+		ctx->errFlag = true;
+		return false;
+	}
+
+	if ((ctx->driver_batchfp = fopen(batchFile, "wb")) == NULL) {
+		gs1_arenaFree(&ctx->driver_batchArena, ctx->driver_batchBlock);
+		ctx->driver_batchBlock = NULL;
+		sprintf(ctx->errMsg, "Unable to open file: %.*s", MAX_FNAME, batchFile);
+		ctx->errFlag = true;
+		return false;
+	}
+
+	ctx->driver_batchBlockLen = 0;
+	ctx->driver_batchFlushed = 0;
+	ctx->driver_batchPages = 0;
+
+	// The first page is linked from the header's directory offset
+	ctx->driver_batchNextDir = offsetof(struct t_hdr, diroff);
+	return batchWrite(ctx, &header, sizeof(header));
+
+}
+
+
+bool gs1_driverCloseBatch(gs1_encoder *ctx) {
+
+	bool ret;
+
+	if (!ctx->driver_batchfp) {
+		strcpy(ctx->errMsg, "No batch file is open");
+		ctx->errFlag = true;
+		return false;
+	}
+
+	ret = batchFlush(ctx);
+	if (fclose(ctx->driver_batchfp) != 0 && ret) {
+		strcpy(ctx->errMsg, "Failed writing to batch file");
+		ctx->errFlag = true;
+		ret = false;
+	}
+	ctx->driver_batchfp = NULL;
+	gs1_arenaFree(&ctx->driver_batchArena, ctx->driver_batchBlock);
+	ctx->driver_batchBlock = NULL;
+
+	return ret;
+
+}
+
+
+/*
+ *  Marking path output: the module rows of a 2D symbol are captured as they
+ *  are added, then planned and emitted as a list of marks
+ *
+ */
+static bool pathInit(gs1_encoder *ctx, const int w, const int h) {
+
+	gs1_arenaFree(&ctx->workArena, ctx->driver_pathMtx);
+	if ((ctx->driver_pathMtx = gs1_arenaCalloc(&ctx->workArena, (size_t)w * (size_t)h, sizeof(uint8_t))) == NULL) {
+		strcpy(ctx->errMsg, "Out of memory allocating marking path matrix");
+		ctx->errFlag = true;
+		return false;
+	}
+	ctx->driver_pathW = w;
+	ctx->driver_pathH = h;
+	ctx->driver_pathRow = 0;
+
+	if (strcmp(ctx->outFile, "") == 0) {
+		ctx->bufferWidth = w;
+		ctx->bufferHeight = h;
+	}
+
+	return true;
+
+}
+
+
+static void pathAddRow(gs1_encoder *ctx, const struct sPrints *prints) {
+
+	uint8_t *row;
+	int i, x, width;
+	bool dark;
+
+	assert(!prints->guards && !prints->reverse);
+
+	if (ctx->driver_pathRow >= ctx->driver_pathH)
+		return;
+
+	row = &ctx->driver_pathMtx[ctx->driver_pathRow++ * ctx->driver_pathW];
+	x = prints->leftPad;
+	dark = !prints->whtFirst;
+	for (i = 0; i < prints->elmCnt; i++) {
+		width = prints->pattern[i];
+		if (x + width > ctx->driver_pathW)
+			width = ctx->driver_pathW - x;
+		if (dark && width > 0)
+			memset(&row[x], 1, (size_t)width);
+		x += width;
+		dark = !dark;
+	}
+
+}
+
+
+static bool pathEmit(gs1_encoder *ctx) {
+
+	struct pathMark *marks;
+	char line[80];
+	int n, i;
+
+	n = gs1_pathPlan(ctx->driver_pathMtx, ctx->driver_pathW, ctx->driver_pathH,
+			 ctx->pathMode, ctx->pathOptimise, &ctx->workArena, &marks);
+	if (n < 0) {
+		gs1_arenaFree(&ctx->workArena, ctx->driver_pathMtx);
+		ctx->driver_pathMtx = NULL;
+		strcpy(ctx->errMsg, "Out of memory planning marking path");
+		ctx->errFlag = true;
+		return false;
+	}
+
+	sprintf(line, "# modules %d %d\n", ctx->driver_pathW, ctx->driver_pathH);
+	emitData(ctx, line, strlen(line));
+	sprintf(line, "# marks %d\n", n);
+	emitData(ctx, line, strlen(line));
+	sprintf(line, "# travel %ld\n", gs1_pathTravel(marks, n));
+	emitData(ctx, line, strlen(line));
+
+	for (i = 0; i < n; i++) {
+		if (marks[i].x1 == marks[i].x2 && marks[i].y1 == marks[i].y2)
+			sprintf(line, "D %d %d\n", marks[i].x1, marks[i].y1);
+		else
+			sprintf(line, "S %d %d %d %d\n", marks[i].x1, marks[i].y1, marks[i].x2, marks[i].y2);
+		emitData(ctx, line, strlen(line));
+	}
+
+	gs1_arenaFree(&ctx->workArena, marks);
+	gs1_arenaFree(&ctx->workArena, ctx->driver_pathMtx);
+	ctx->driver_pathMtx = NULL;
+	return true;
+
+}
+
+
+/*
+ *  HRI text: the glyph rows of each line are rasterised once, up front, then
+ *  repeated to the font scale as rows are emitted beneath the symbol
+ *
+ */
+static bool hriInit(gs1_encoder *ctx, const long xdim, long *ydim) {
+
+	char text[2*MAX_DATA+1];
+	char *lines[MAX_AIS];
+	const uint8_t xorMsk = ctx->driver_plan.xorMsk;
+	const size_t rowBytes = planRowBytes(ctx, xdim);
+	int i, n, scale;
+
+	gs1_arenaFree(&ctx->workArena, ctx->driver_hriRows);
+	ctx->driver_hriRows = NULL;
+	ctx->driver_hriLines = 0;
+
+	if ((n = gs1_hriLayout(ctx, xdim, text, lines, &scale)) <= 0)
+		return n == 0;
+
+	if ((ctx->driver_hriRows = gs1_arenaAlloc(&ctx->workArena, (1 + (size_t)n * HRI_GLYPH_H) * rowBytes)) == NULL) {
+		strcpy(ctx->errMsg, "Out of memory rendering HRI text");
+		ctx->errFlag = true;
+		return false;
+	}
+	memset(ctx->driver_hriRows, xorMsk, rowBytes);
+	for (i = 0; i < n; i++)
+		gs1_hriRasterise(lines[i], xdim, scale, xorMsk, rowBytes,
+				 &ctx->driver_hriRows[(1 + (size_t)i * HRI_GLYPH_H) * rowBytes]);
+
+	ctx->driver_hriRowBytes = rowBytes;
+	ctx->driver_hriLines = n;
+	ctx->driver_hriScale = scale;
+	*ydim += (long)scale * (HRI_GAP + n * HRI_LINE_H);
+
+	return true;
+
+}
+
+
+static const uint8_t* hriRow(const gs1_encoder *ctx, const long y) {
+
+	long fy = y / ctx->driver_hriScale - HRI_GAP;
+	long r = fy % HRI_LINE_H;
+
+	if (fy < 0 || r >= HRI_GLYPH_H)
+		return ctx->driver_hriRows;
+
+	return &ctx->driver_hriRows[(1 + (size_t)(fy / HRI_LINE_H) * HRI_GLYPH_H + (size_t)r) * ctx->driver_hriRowBytes];
+
+}
+
+
+static void hriEmit(gs1_encoder *ctx, const bool bottomUp) {
+
+	long y, height;
+
+	if (!ctx->driver_hriRows)
+		return;
+
+	height = (long)ctx->driver_hriScale * (HRI_GAP + ctx->driver_hriLines * HRI_LINE_H);
+	for (y = 0; y < height; y++) {
+		if (isPreview(ctx))
+			previewBand(ctx, hriRow(ctx, y), 1);
+		else
+			emitData(ctx, hriRow(ctx, bottomUp ? height - 1 - y : y), ctx->driver_hriRowBytes);
+	}
+
+	gs1_arenaFree(&ctx->workArena, ctx->driver_hriRows);
+	ctx->driver_hriRows = NULL;
+
+}
+
+
+/*
+ *  Banded rasterisation: with several raster threads, the rows of a large
+ *  image are collected and then rasterised as independent horizontal bands,
+ *  each written to its own region of a single image buffer in output order
+ *
+ */
+static void bandPlan(gs1_encoder *ctx, const long xdim, const long height) {
+
+	long bands;
+
+	ctx->driver_height = height;
+	ctx->driver_rowBytes = planRowBytes(ctx, xdim);
+	ctx->driver_bandRows = height > 0 ? height : 1;
+
+	if (ctx->rasterThreads <= 1 || ctx->format == gs1_encoder_dPATH || isPreview(ctx))
+		return;
+
+	bands = (long)(((size_t)height * ctx->driver_rowBytes) / RASTER_BAND_MIN_BYTES);
+	if (bands > ctx->rasterThreads)
+		bands = ctx->rasterThreads;
+	if (bands > 1)
+		ctx->driver_bandRows = (height + bands - 1) / bands;
+
+}
+
+
+static bool banded(const gs1_encoder *ctx) {
+	return ctx->driver_bandRows < ctx->driver_height;
+}
+
+
+#ifdef RASTER_THREADS
+
+struct rasterBand {
+	const gs1_encoder *ctx;
+	const long *start;		// Output row at which each buffered row begins, in output order
+	long hriStart;			// Output row at which the HRI text begins
+	long hriH;
+	long e0, e1;			// Output rows of the band
+	uint8_t *image;			// Output row e0
+	uint8_t *line;
+	uint8_t *lineUCut;
+	bool line1;			// Symbol's first row begins from a blank line
+	bool ok;
+	pthread_t thread;
+	bool threaded;
+};
+
+
+// The buffered row emitted k-th
+static const struct sPrints* bandRow(const gs1_encoder *ctx, const long k) {
+	return &ctx->driver_rowBuffer[ctx->format == gs1_encoder_dBMP ? ctx->driver_numRows - 1 - k : k];
+}
+
+
+static void* rasteriseBand(void *arg) {
+
+	struct rasterBand *band = arg;
+	const gs1_encoder *ctx = band->ctx;
+	const size_t rowBytes = ctx->driver_rowBytes;
+	const long numRows = ctx->driver_numRows;
+	uint8_t *out = band->image;
+	long e = band->e0, k = -1, r;
+	bool line1 = band->line1;
+
+	band->ok = false;
+
+	while (e < band->e1) {
+
+		if (e >= band->hriStart && e < band->hriStart + band->hriH) {
+			r = e - band->hriStart;
+			memcpy(out, hriRow(ctx, ctx->format == gs1_encoder_dBMP ? band->hriH - 1 - r : r), rowBytes);
+			out += rowBytes;
+			e++;
+			continue;
+		}
+
+		if (k < 0) {
+			// Find the symbol row covering output row e, priming the line with its predecessor
+			for (k = 0; k < numRows - 1 && band->start[k + 1] <= e; k++);
+			if (k > 0 && ctx->Yundercut > 0) {
+				if (rasterRow(ctx, bandRow(ctx, k - 1), band->line, band->lineUCut, true) < 0)
+					return NULL;
+				line1 = false;
+			}
+			if (rasterRow(ctx, bandRow(ctx, k), band->line, band->lineUCut, line1) != (int)rowBytes)
+				return NULL;
+		}
+		while (k < numRows - 1 && band->start[k + 1] <= e) {
+			// Every row is rasterised, even if empty, since it forms the next row's undercut
+			if (rasterRow(ctx, bandRow(ctx, ++k), band->line, band->lineUCut, false) != (int)rowBytes)
+				return NULL;
+		}
+
+		memcpy(out, e - band->start[k] < ctx->Yundercut ? band->lineUCut : band->line, rowBytes);
+		out += rowBytes;
+		e++;
+
+	}
+
+	band->ok = true;
+	return NULL;
+
+}
+
+
+// Rasterise the buffered rows and HRI text in parallel bands, or return false to emit them serially
+static bool emitBands(gs1_encoder *ctx) {
+
+	struct rasterBand *bands;
+	long *start;
+	long hriH = 0, hriStart, e;
+	size_t len = (size_t)ctx->driver_height * ctx->driver_rowBytes;
+	uint8_t *image;
+	int n, i, k;
+	bool direct, ok = true;
+
+	if (ctx->driver_hriRows)
+		hriH = (long)ctx->driver_hriScale * (HRI_GAP + ctx->driver_hriLines * HRI_LINE_H);
+
+	if ((start = gs1_arenaAlloc(&ctx->workArena, ((size_t)ctx->driver_numRows + 1) * sizeof(long))) == NULL)
+		return false;
+
+	// BMP is emitted bottom-up with the HRI text first
+	hriStart = ctx->format == gs1_encoder_dBMP ? 0 : ctx->driver_height - hriH;
+	e = ctx->format == gs1_encoder_dBMP ? hriH : 0;
+	for (k = 0; k < ctx->driver_numRows; k++) {
+		start[k] = e;
+		e += bandRow(ctx, k)->height > ctx->Yundercut ? bandRow(ctx, k)->height : ctx->Yundercut;
+	}
+	start[k] = e;
+	if ((ctx->format == gs1_encoder_dBMP ? e : e + hriH) != ctx->driver_height) {
+		gs1_arenaFree(&ctx->workArena, start);
+		return false;
+	}
+
+	// Output to memory is rasterised in place, otherwise through a staging image
+	direct = ctx->driver_plan.sink == bufferSink;
+	if (direct && ctx->bufferSize + len > ctx->bufferCap) {
+		if ((image = gs1_arenaRealloc(&ctx->bufferArena, ctx->buffer, ctx->bufferSize + len)) == NULL) {
+			gs1_arenaFree(&ctx->workArena, start);
+			return false;
+		}
+		ctx->buffer = image;
+		ctx->bufferCap = ctx->bufferSize + len;
+	}
+	image = direct ? &ctx->buffer[ctx->bufferSize] : gs1_arenaAlloc(&ctx->workArena, len);
+
+	n = (int)((ctx->driver_height + ctx->driver_bandRows - 1) / ctx->driver_bandRows);
+	if (!image || (bands = gs1_arenaCalloc(&ctx->workArena, (size_t)n, sizeof(struct rasterBand))) == NULL) {
+		if (!direct)
+			gs1_arenaFree(&ctx->workArena, image);
+		gs1_arenaFree(&ctx->workArena, start);
+		return false;
+	}
+
+	for (i = 0; i < n; i++) {
+		bands[i].ctx = ctx;
+		bands[i].start = start;
+		bands[i].hriStart = hriStart;
+		bands[i].hriH = hriH;
+		bands[i].e0 = (long)i * ctx->driver_bandRows;
+		bands[i].e1 = bands[i].e0 + ctx->driver_bandRows < ctx->driver_height ? bands[i].e0 + ctx->driver_bandRows : ctx->driver_height;
+		bands[i].image = &image[(size_t)bands[i].e0 * ctx->driver_rowBytes];
+		bands[i].line1 = ctx->line1;
+		bands[i].line = gs1_arenaAlloc(&ctx->workArena, 2 * (MAX_LINE/8 + 1));
+		if (!bands[i].line) {
+			ok = false;
+			break;
+		}
+		bands[i].lineUCut = &bands[i].line[MAX_LINE/8 + 1];
+	}
+	if (ok) {
+		// The first row continues from the lines left by any earlier symbol, as serial output would
+		for (i = 0; i < n; i++) {
+			memcpy(bands[i].line, ctx->driver_line, MAX_LINE/8 + 1);
+			memcpy(bands[i].lineUCut, ctx->driver_lineUCut, MAX_LINE/8 + 1);
+		}
+		for (i = 1; i < n; i++)
+			bands[i].threaded = pthread_create(&bands[i].thread, NULL, rasteriseBand, &bands[i]) == 0;
+		for (i = 0; i < n; i++)
+			if (!bands[i].threaded)
+				rasteriseBand(&bands[i]);
+		for (i = 1; i < n; i++)
+			if (bands[i].threaded)
+				pthread_join(bands[i].thread, NULL);
+		for (i = 0; i < n; i++)
+			ok = ok && bands[i].ok;
+	}
+
+	if (ok) {
+		// Leave the lines as serial output would, since a later symbol may be undercut against them
+		for (k = ctx->driver_numRows > 1 ? ctx->driver_numRows - 2 : 0; k < ctx->driver_numRows; k++) {
+			rasterRow(ctx, bandRow(ctx, k), ctx->driver_line, ctx->driver_lineUCut, ctx->line1);
+			ctx->line1 = false;
+		}
+	}
+
+	for (i = n - 1; i >= 0; i--)
+		gs1_arenaFree(&ctx->workArena, bands[i].line);
+	gs1_arenaFree(&ctx->workArena, bands);
+
+	if (ok && direct) {
+		if (ctx->outputDigestAlg != gs1_encoder_digestNONE)
+			gs1_digestUpdate(&ctx->driver_digest, image, len);
+		ctx->bufferSize += len;
+	} else if (ok) {
+		emitData(ctx, image, len);	// Any error is flagged, not retried serially
+	}
+	if (!direct)
+		gs1_arenaFree(&ctx->workArena, image);
+	gs1_arenaFree(&ctx->workArena, start);
+
+	return ok;
+
+}
+
+#else
+
+static bool emitBands(gs1_encoder *ctx) {
+	(void)ctx;
+	return false;
+}
+
+#endif
+
+
+// Rows are buffered for BMP, which is written bottom-up, and for banded output
+static bool rowBufferInit(gs1_encoder *ctx, const long ydim) {
+
+	if (ctx->format != gs1_encoder_dBMP && !banded(ctx))
+		return true;
+
+	if ((ctx->driver_rowBuffer = gs1_arenaAlloc(&ctx->workArena, (unsigned long)ydim * sizeof(struct sPrints))) == NULL) {
+		strcpy(ctx->errMsg, "Out of memory creating initial row buffer");
+		ctx->errFlag = true;
+		return false;
+	}
+
+	return true;
+
+}
+
+
+void gs1_driverFreeRows(gs1_encoder *ctx) {
+
+	int i;
+
+	if (!ctx->driver_rowBuffer)
+		return;
+
+	for (i = ctx->driver_numRows - 1; i >= 0; i--)
+		gs1_arenaFree(&ctx->workArena, ctx->driver_rowBuffer[i].pattern);
+	gs1_arenaFree(&ctx->workArena, ctx->driver_rowBuffer);
+	ctx->driver_rowBuffer = NULL;
+	ctx->driver_numRows = 0;
+
+}
+
+
 bool gs1_doDriverInit(gs1_encoder *ctx, const long xdim, const long ydim) {
 
 	FILE* oFile;
+	long height = ydim;
+
+	if (ctx->format == gs1_encoder_dPATH && ctx->sym != gs1_encoder_sDM && ctx->sym != gs1_encoder_sQR &&
+	    ctx->sym != gs1_encoder_sRMQR) {
+		strcpy(ctx->errMsg, "Marking path output is only supported for Data Matrix and QR Code");
+		ctx->errFlag = true;
+		return false;
+	}
+
+	gs1_digestInit(&ctx->driver_digest, ctx->outputDigestAlg);
+	planCompile(ctx);
+
+	if (ctx->renderHRI && ctx->format != gs1_encoder_dPATH && !hriInit(ctx, xdim, &height))
+		return false;
+
+	bandPlan(ctx, xdim, height);
+	ctx->driver_rowBuffer = NULL;
+	ctx->driver_numRows = 0;
+
+	if (ctx->driver_batchfp) {
+		ctx->driver_plan.sink = batchWrite;
+		return rowBufferInit(ctx, ydim) && batchPage(ctx, xdim, height);
+	}
 
-	if (strcmp(ctx->outFile, "") != 0) {
+	if (strcmp(ctx->outFile, "") != 0 && ctx->aio) {
+		// File is written in the background once complete
+		if (!gs1_aioAcquire(ctx))
+			return false;
+		ctx->driver_plan.sink = gs1_aioAppend;
+	} else if (strcmp(ctx->outFile, "") != 0) {
 		if ((oFile = fopen(ctx->outFile, "wb")) == NULL) {
 			sprintf(ctx->errMsg, "Unable to open file: %s", ctx->outFile);
 			ctx->errFlag = true;
 			return false;
 		}
 		ctx->outfp = oFile;
+		ctx->driver_plan.sink = fileSink;
 	} else {
-		ctx->bufferCap = 1024;		// Initial size, will grow as needed
-		if ((ctx->buffer = malloc(ctx->bufferCap * sizeof(uint8_t))) == NULL) {
+		ctx->driver_plan.sink = bufferSink;
+		ctx->bufferCap = BUFFER_INITIAL_SIZE;
+		if ((ctx->buffer = gs1_arenaAlloc(&ctx->bufferArena, ctx->bufferCap * sizeof(uint8_t))) == NULL) {
 			ctx->bufferCap = 0;
 			strcpy(ctx->errMsg, "Out of memory allocating output buffer");
 			ctx->errFlag = true;
@@ -325,20 +1077,30 @@ bool gs1_doDriverInit(gs1_encoder *ctx, const long xdim, const long ydim) {
 		}
 		ctx->bufferSize = 0;
 		ctx->bufferWidth = (int)xdim;
-		ctx->bufferHeight = (int)ydim;
+		ctx->bufferHeight = (int)height;
 	}
 
+	if (!rowBufferInit(ctx, ydim))
+		return false;
+
 	if (ctx->format == gs1_encoder_dBMP) {
-		if ((ctx->driver_rowBuffer = malloc((unsigned long)ydim * sizeof(struct sPrints))) == NULL) {
-			strcpy(ctx->errMsg, "Out of memory creating initial BMP row buffer");
+		bmpHeader(ctx, xdim, height);
+	} else if (ctx->format == gs1_encoder_dTIF) {
+		tifHeader(ctx, xdim, height);
+	} else if (ctx->format == gs1_encoder_dPATH) {
+		return pathInit(ctx, (int)(xdim / ctx->pixMult), (int)(ydim / ctx->pixMult));
+	} else if (isPreview(ctx)) {
+		if (!gs1_previewInit(&ctx->driver_preview, &ctx->workArena, xdim, height, ctx->previewScale / ctx->pixMult,
+				     ctx->format == gs1_encoder_dRGBA ? 4 : 1,
+				     ctx->previewDarkColour, ctx->previewLightColour)) {
+			strcpy(ctx->errMsg, "Out of memory allocating preview rows");
 			ctx->errFlag = true;
 			return false;
 		}
-		ctx->driver_numRows = 0;
-
-		bmpHeader(ctx, xdim, ydim);
-	} else if (ctx->format == gs1_encoder_dTIF) {
-		tifHeader(ctx, xdim, ydim);
+		if (strcmp(ctx->outFile, "") == 0) {
+			ctx->bufferWidth = ctx->driver_preview.outW;
+			ctx->bufferHeight = ctx->driver_preview.outH;
+		}
 	}
 
 	return true;
@@ -350,18 +1112,22 @@ bool gs1_doDriverAddRow(gs1_encoder *ctx, const struct sPrints *prints) {
 
 	struct sPrints *row;
 
-	if (ctx->format == gs1_encoder_dBMP) {
+	if (ctx->driver_rowBuffer) {
 
-		// Buffer the row and its pattern
+		// Buffer the row and its pattern, for BMP or banded output
 		row = &ctx->driver_rowBuffer[ctx->driver_numRows++];
 		memcpy(row, prints, sizeof(struct sPrints));
-		if ((row->pattern = malloc((unsigned int)prints->elmCnt * sizeof(uint8_t))) == NULL) {
-			strcpy(ctx->errMsg, "Out of memory extending BMP row buffer");
+		if ((row->pattern = gs1_arenaAlloc(&ctx->workArena, (unsigned int)prints->elmCnt * sizeof(uint8_t))) == NULL) {
+			strcpy(ctx->errMsg, "Out of memory extending row buffer");
 			ctx->errFlag = true;
 			return false;
 		}
 		memcpy(row->pattern, prints->pattern, (unsigned int)prints->elmCnt * sizeof(uint8_t));
 
+	} else if (ctx->format == gs1_encoder_dPATH) {
+
+		pathAddRow(ctx, prints);
+
 	} else {  // TIF and RAW
 		// Directly emit the row
 		printElmnts(ctx, prints);
@@ -375,25 +1141,47 @@ bool gs1_doDriverAddRow(gs1_encoder *ctx, const struct sPrints *prints) {
 bool gs1_doDriverFinalise(gs1_encoder *ctx) {
 
 	uint8_t* buf;
+	const uint8_t *px;
 	int i;
-
-	if (ctx->format == gs1_encoder_dBMP) {
-		// Emit the rows in reverse, releasing their patterns
-		for (i = ctx->driver_numRows - 1; i >= 0; i--) {
+	bool ok = true;
+
+	if (banded(ctx) && emitBands(ctx)) {
+		gs1_arenaFree(&ctx->workArena, ctx->driver_hriRows);
+		ctx->driver_hriRows = NULL;
+	} else if (ctx->format == gs1_encoder_dBMP) {
+		// Emit the rows in reverse
+		hriEmit(ctx, true);
+		for (i = ctx->driver_numRows - 1; i >= 0; i--)
 			printElmnts(ctx, &ctx->driver_rowBuffer[i]);
-			free(ctx->driver_rowBuffer[i].pattern);
+	} else if (ctx->format == gs1_encoder_dPATH) {
+		ok = pathEmit(ctx);
+	} else {
+		for (i = 0; i < ctx->driver_numRows; i++)	// Banded rows that could not be split
+			printElmnts(ctx, &ctx->driver_rowBuffer[i]);
+		hriEmit(ctx, false);
+		if (isPreview(ctx)) {
+			// Complete the final, partly covered row
+			while ((px = gs1_previewFlush(&ctx->driver_preview)) != NULL)
+				emitData(ctx, px, (size_t)ctx->driver_preview.outW * (size_t)ctx->driver_preview.bpp);
+			gs1_previewFree(&ctx->driver_preview, &ctx->workArena);
 		}
-
-		free(ctx->driver_rowBuffer);
-		ctx->driver_rowBuffer = NULL;
 	}
 
-	if (strcmp(ctx->outFile, "") != 0) {
+	// Release the buffered rows and their patterns
+	gs1_driverFreeRows(ctx);
+
+	if (ctx->driver_plan.sink == batchWrite) {
+		// Page remains in the block buffer until it fills
+	} else if (ctx->driver_plan.sink == gs1_aioAppend) {
+		if (ok)		// Otherwise the slot is reused by the next symbol
+			gs1_aioSubmit(ctx);
+	} else if (ctx->driver_plan.sink == fileSink) {
 		fclose(ctx->outfp);
 	} else {
 		// Shrink the buffer to fit the data
-		if ((buf = realloc(ctx->buffer, ctx->bufferSize * sizeof(uint8_t))) == NULL) {
-			free(ctx->buffer);
+		if ((buf = gs1_arenaRealloc(&ctx->bufferArena, ctx->buffer, ctx->bufferSize * sizeof(uint8_t))) == NULL) {
+			gs1_arenaFree(&ctx->bufferArena, ctx->buffer);
+			ctx->buffer = NULL;
 			ctx->bufferCap = 0;
 			ctx->bufferSize = 0;
 			strcpy(ctx->errMsg, "Failed to shrink output buffer");
@@ -404,7 +1192,9 @@ bool gs1_doDriverFinalise(gs1_encoder *ctx) {
 		ctx->bufferCap = ctx->bufferSize;
 	}
 
-	return true;
+	ctx->outputDigestLen = gs1_digestFinal(&ctx->driver_digest, ctx->outputDigest);
+
+	return ok;
 
 }
 
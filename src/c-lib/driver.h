@@ -22,17 +22,47 @@
 #define UTIL_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #include "qr.h"
 #include "enc-private.h"
 #include "gs1encoders.h"
 
-#define MAX_LINE (MAX_QR_SIZE * MAX_PIXMULT)
+#define MAX_LINE ((MAX_SYM_W * MAX_PIXMULT + 31) / 32 * 32)	// Room for a row padded to a long word for .BMP
 #define DEFAULT_BMP_FILE "out.bmp"
 #define DEFAULT_TIF_FILE "out.tif"
+#define DEFAULT_PATH_FILE "out.txt"
+#define RASTER_MAX_THREADS 64
+#define RASTER_BAND_MIN_BYTES (1 << 18)	// Smaller images are not worth splitting
+#ifndef NOMALLOC
+#define BATCH_BLOCK_SIZE (1 << 20)
+#define BUFFER_INITIAL_SIZE 1024	// Grows as needed
+#else
+#define BATCH_BLOCK_SIZE (1 << 16)
+#define BUFFER_INITIAL_SIZE (NOMALLOC_BUFFER_SIZE - 2*ARENA_ALIGN)	// Whole of the static buffer
+#endif
 
 struct sPrints;
 
+/*
+ * Rendering decisions that depend only upon the settings, compiled ahead of
+ * the rows so that rasterisation and output need not revisit them
+ *
+ */
+struct renderPlan {
+	int pixMult;				// Settings the tables were compiled for
+	int Xundercut;
+	int format;
+	int wide[256];				// Pixels for each element width, with undercut added
+	int narrow[256];			// Pixels for each element width, with undercut removed
+	int plain[256];				// Pixels for each element width
+	uint8_t xorMsk;				// Inverts the bits for BMP
+	size_t rowAlign;			// Rows are padded to a multiple of this many bytes
+	bool digest;				// Output digest is being computed
+	bool (*sink)(gs1_encoder *ctx, const void *data, size_t len);	// Destination of the output
+};
+
 // Syntactic sugar for return on failure
 #define gs1_driverInit(ctx, xdim, ydim) do {	\
 	if (!gs1_doDriverInit(ctx, xdim, ydim))	\
@@ -52,6 +82,9 @@ struct sPrints;
 bool gs1_doDriverInit(gs1_encoder *ctx, long xdim, long ydim);
 bool gs1_doDriverAddRow(gs1_encoder *ctx, const struct sPrints *prints);
 bool gs1_doDriverFinalise(gs1_encoder *ctx);
+void gs1_driverFreeRows(gs1_encoder *ctx);
+bool gs1_driverOpenBatch(gs1_encoder *ctx, const char *batchFile);
+bool gs1_driverCloseBatch(gs1_encoder *ctx);
 bool gs1_setXdimension(gs1_encoder *ctx, double minX, double targetX, double maxX);
 
 #endif /* UTIL_H */
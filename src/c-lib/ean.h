@@ -25,6 +25,11 @@
 
 #include "gs1encoders.h"
 
+
+#define EAN_MAX_SYM_W	109				// Largest symbol in modules (EAN-13 with quiet zones),
+#define EAN_MAX_SYM_H	(CCB4_MAX_SYM_H + 6 + 74)	// with CC and separator
+
+
 bool gs1_normaliseEAN13(gs1_encoder *ctx, const char *dataStr, char *primaryStr);
 bool gs1_normaliseEAN8(gs1_encoder *ctx, const char *dataStr, char *primaryStr);
 bool gs1_normaliseUPCE(gs1_encoder *ctx, const char *dataStr, char *primaryStr);
@@ -31,7 +31,9 @@
 // Implementation limits that can be changed
 #define MAX_FNAME	120	// Maximum filename
 #define MAX_DATA	8191	// Maximum input buffer size
-#define MAX_PIXMULT	100	// Largest X dimension
+#ifndef MAX_PIXMULT
+#define MAX_PIXMULT	100	// Largest X dimension, for which NOMALLOC arenas are sized
+#endif
 
 
 struct sPrints {
@@ -49,12 +51,22 @@ struct sPrints {
 #define SIZEOF_ARRAY(x) (sizeof(x) / sizeof(x[0]))
 
 
+#include "aio.h"
+#include "guard.h"
+#include "queue.h"
+#include "arena.h"
+#include "cache.h"
 #include "cc.h"
+#include "digest.h"
 #include "dm.h"
 #include "driver.h"
 #include "ean.h"
+#include "hri.h"
 #include "ai.h"
+#include "itf14.h"
 #include "mtx.h"
+#include "path.h"
+#include "preview.h"
 #include "qr.h"
 #include "rss14.h"
 #include "rssexp.h"
@@ -63,6 +75,125 @@ struct sPrints {
 #include "ucc128.h"
 
 
+/*
+ * Largest symbol of the enabled symbologies, in modules including quiet zones
+ * and any composite component
+ *
+ */
+#define SYM_MAX(a, b)	((a) > (b) ? (a) : (b))
+
+#ifndef EXCLUDE_DATABAR
+#define DATABAR_MAX_SYM_W	SYM_MAX(SYM_MAX(RSS14_MAX_SYM_W, RSSLIM_MAX_SYM_W), RSSEXP_MAX_SYM_W)
+#define DATABAR_MAX_SYM_H	SYM_MAX(SYM_MAX(RSS14_MAX_SYM_H, RSSLIM_MAX_SYM_H), RSSEXP_MAX_SYM_H)
+#else
+#define DATABAR_MAX_SYM_W	0
+#define DATABAR_MAX_SYM_H	0
+#endif
+
+#ifndef EXCLUDE_EANUPC
+#define EANUPC_MAX_SYM_W	EAN_MAX_SYM_W
+#define EANUPC_MAX_SYM_H	EAN_MAX_SYM_H
+#else
+#define EANUPC_MAX_SYM_W	0
+#define EANUPC_MAX_SYM_H	0
+#endif
+
+#ifndef EXCLUDE_ITF14
+#define ITF14_SYM_W		ITF14_MAX_SYM_W
+#define ITF14_SYM_H		ITF14_MAX_SYM_H
+#else
+#define ITF14_SYM_W		0
+#define ITF14_SYM_H		0
+#endif
+
+#ifndef EXCLUDE_GS1_128
+#define GS1_128_MAX_SYM_W	UCC128_MAX_SYM_W
+#define GS1_128_MAX_SYM_H	UCC128_MAX_SYM_H
+#else
+#define GS1_128_MAX_SYM_W	0
+#define GS1_128_MAX_SYM_H	0
+#endif
+
+#ifndef EXCLUDE_QR
+#define QR_MAX_SYM_W		MAX_QR_SIZE
+#define QR_MAX_SYM_H		MAX_QR_SIZE
+#else
+#define QR_MAX_SYM_W		0
+#define QR_MAX_SYM_H		0
+#endif
+
+#ifndef EXCLUDE_DM
+#define DM_MAX_SYM_W		MAX_DM_COLS
+#define DM_MAX_SYM_H		MAX_DM_ROWS
+#else
+#define DM_MAX_SYM_W		0
+#define DM_MAX_SYM_H		0
+#endif
+
+#define MATRIX_MAX_SYM_W	SYM_MAX(QR_MAX_SYM_W, DM_MAX_SYM_W)
+#define MATRIX_MAX_SYM_H	SYM_MAX(QR_MAX_SYM_H, DM_MAX_SYM_H)
+#define LINEAR_MAX_SYM_W	SYM_MAX(SYM_MAX(SYM_MAX(DATABAR_MAX_SYM_W, EANUPC_MAX_SYM_W), ITF14_SYM_W), GS1_128_MAX_SYM_W)
+#define LINEAR_MAX_SYM_H	SYM_MAX(SYM_MAX(SYM_MAX(DATABAR_MAX_SYM_H, EANUPC_MAX_SYM_H), ITF14_SYM_H), GS1_128_MAX_SYM_H)
+#define MAX_SYM_W		SYM_MAX(LINEAR_MAX_SYM_W, MATRIX_MAX_SYM_W)
+#define MAX_SYM_H		SYM_MAX(LINEAR_MAX_SYM_H, MATRIX_MAX_SYM_H)
+
+
+#ifdef NOMALLOC
+
+/*
+ * Fixed storage of NOMALLOC builds, held within the instance. Each is sized for
+ * the largest need among the enabled symbologies, each at MAX_PIXMULT beneath
+ * the most HRI text that can be rendered, and may be overridden at build time.
+ *
+ */
+#define ARENA_BLOCK(n)	(((size_t)(n) + 2*ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN)
+#define SYM_PX_W(w)	((size_t)(w) * MAX_PIXMULT)
+#define SYM_PX_H(h)	((size_t)((h) + HRI_GAP + MAX_AIS*HRI_LINE_H) * MAX_PIXMULT)
+
+// BMP, TIFF or raw image; or RGBA image
+#define IMAGE_BUFFER_SIZE(w, h)		SYM_MAX(512 + (SYM_PX_W(w)+31)/32*4 * SYM_PX_H(h),	\
+						4 * SYM_PX_W(w) * SYM_PX_H(h))
+
+// Marking path text, only for matrix symbologies
+#define MATRIX_BUFFER_SIZE(w, h)	SYM_MAX(IMAGE_BUFFER_SIZE(w, h), 64 + (size_t)(w) * (h) * 20)
+
+// Driver working storage: buffered BMP rows, marking path or preview rows; then
+// HRI glyph rows and the buffer strings
+#define ROWS_ARENA_SIZE(w, h)		(ARENA_BLOCK(SYM_PX_H(h) * sizeof(struct sPrints)) + (size_t)(h) * ARENA_BLOCK(w))
+#define PATH_ARENA_SIZE(w, h)		(2*ARENA_BLOCK((size_t)(w) * (h)) + ARENA_BLOCK((size_t)(w) * (h) * sizeof(struct pathMark)))
+#define PREVIEW_ARENA_SIZE(w, h)	(2*ARENA_BLOCK(SYM_PX_W(w) * sizeof(double)) + ARENA_BLOCK(SYM_PX_W(w) * 4))
+#define TEXT_ARENA_SIZE(w, h)		(ARENA_BLOCK((1 + MAX_AIS*HRI_GLYPH_H) * ((SYM_PX_W(w)+31)/32*4)) +	\
+					 ARENA_BLOCK((SYM_PX_H(h)+1) * sizeof(char*) + SYM_PX_H(h) * (SYM_PX_W(w)+1)))
+#define LINEAR_ARENA_SIZE(w, h)		(SYM_MAX(ROWS_ARENA_SIZE(w, h), PREVIEW_ARENA_SIZE(w, h)) + TEXT_ARENA_SIZE(w, h))
+#define MATRIX_ARENA_SIZE(w, h)		(SYM_MAX(SYM_MAX(ROWS_ARENA_SIZE(w, h), PATH_ARENA_SIZE(w, h)),	\
+						 PREVIEW_ARENA_SIZE(w, h)) + TEXT_ARENA_SIZE(w, h))
+
+// Largest need of each group of symbologies, of which the excluded are empty
+#define LINEAR_NEED(f)	SYM_MAX(SYM_MAX(f(DATABAR_MAX_SYM_W, DATABAR_MAX_SYM_H),		\
+				f(EANUPC_MAX_SYM_W, EANUPC_MAX_SYM_H)),				\
+			SYM_MAX(f(ITF14_SYM_W, ITF14_SYM_H),					\
+				f(GS1_128_MAX_SYM_W, GS1_128_MAX_SYM_H)))
+#define MATRIX_NEED(f)	SYM_MAX(f(QR_MAX_SYM_W, QR_MAX_SYM_H), f(DM_MAX_SYM_W, DM_MAX_SYM_H))
+
+// Output buffer
+#ifndef NOMALLOC_BUFFER_SIZE
+#define NOMALLOC_BUFFER_SIZE	ARENA_BLOCK(SYM_MAX(LINEAR_NEED(IMAGE_BUFFER_SIZE), MATRIX_NEED(MATRIX_BUFFER_SIZE)))
+#endif
+
+// Working storage of the driver
+#ifndef NOMALLOC_ARENA_SIZE
+#define NOMALLOC_ARENA_SIZE	SYM_MAX(LINEAR_NEED(LINEAR_ARENA_SIZE), MATRIX_NEED(MATRIX_ARENA_SIZE))
+#endif
+
+// Batch file output block and page index
+#ifndef NOMALLOC_BATCH_PAGES
+#define NOMALLOC_BATCH_PAGES	4096
+#endif
+#define NOMALLOC_BATCH_SIZE	(ARENA_BLOCK(BATCH_BLOCK_SIZE) + ARENA_BLOCK(NOMALLOC_BATCH_PAGES * sizeof(uint32_t)))
+
+#endif  /* NOMALLOC */
+
+
 struct gs1_encoder {
 
 	// members with accessors
@@ -84,17 +215,28 @@ struct gs1_encoder {
 	int qrVersion;				// QR Code fixed symbol version
 	int qrEClevel;				// QR Code error correction level
 	int format;				// BMP, TIF or RAW
+	int outputDigestAlg;			// Digest computed while emitting output
+	int pathMode;				// Dots or strokes for marking path output
+	bool pathOptimise;			// Apply 2-opt to the marking path
+	bool renderHRI;				// Render the HRI text beneath raster output
+	int rasterThreads;			// Threads rasterising bands of a large image
+	double previewScale;			// Pixels per X for grey and RGBA output
+	uint32_t previewDarkColour;		// RGBA
+	uint32_t previewLightColour;		// RGBA
 	bool fileInputFlag;			// True is dataFile else dataStr
 	char dataStr[MAX_DATA+1];		// Input data buffer passed to the encoders
 	char dlAIbuffer[MAX_DATA+1];		// Populated with unbracketed AI string extracted from DL input
+	char dlURI[3*MAX_DATA+1];		// Canonical DL URI, with every value character possibly percent-encoded
 	char dataFile[MAX_FNAME+1];
 	char outFile[MAX_FNAME+1];
 	uint8_t *buffer;			// We may allocate an output buffer
 	int bufferWidth;			// Width of a raw format buffer
 	int bufferHeight;			// Height of a raw format buffer
+	bool bufferMapped;			// Buffer is a view of the cache, not allocated
 	char **bufferStrings;			// We may allocate output as a set of strings
 	char outStr[2*MAX_DATA+1];		// Buffer to return formatted HRI data
 	char *outHRI[MAX_AIS];			// Array of AI element string for HRI printing
+	int outHRIoffsets[MAX_AIS];		// Offsets of the HRI strings within outStr
 	char VERSION[16];
 
 	// per-instance globals
@@ -114,10 +256,47 @@ struct gs1_encoder {
 	uint8_t ccPattern[MAX_CCB4_ROWS][CCB4_ELMNTS];
 	const int *cc_CCSizes;	// will point to CCxSize
 	int cc_gpa[512];
+	struct digestState driver_digest;
+	struct renderPlan driver_plan;		// Compiled by gs1_doDriverInit()
+	uint8_t outputDigest[MAX_DIGEST_LEN];
+	size_t outputDigestLen;
 	uint8_t driver_line[MAX_LINE/8 + 1];
 	uint8_t driver_lineUCut[MAX_LINE/8 + 1];
 	struct sPrints *driver_rowBuffer;
 	int driver_numRows;
+	long driver_height;			// Image rows, including any HRI text
+	size_t driver_rowBytes;			// Bytes in each image row, including padding
+	long driver_bandRows;			// Rows per band, and per TIFF strip
+	uint8_t *driver_pathMtx;		// Modules captured for marking path output
+	int driver_pathW;
+	int driver_pathH;
+	int driver_pathRow;
+	uint8_t *driver_hriRows;		// Glyph rows for each line of HRI text, preceded by a blank row
+	size_t driver_hriRowBytes;
+	int driver_hriLines;
+	int driver_hriScale;			// Pixels per font pixel
+	struct previewState driver_preview;	// Area coverage scaling for grey and RGBA output
+	struct cacheMap cache;			// Persistent symbol cache shared between processes
+	struct guardSet guard;			// GTIN and serial number pairs already issued
+	FILE *driver_batchfp;			// Multi-page TIFF receiving each symbol as a page
+	uint8_t *driver_batchBlock;
+	size_t driver_batchBlockLen;
+	uint64_t driver_batchFlushed;		// Bytes of the batch file already written
+	uint64_t driver_batchNextDir;		// File offset of the link to the next IFD
+	uint32_t *driver_batchIndex;		// File offset of each page's IFD
+	int driver_batchPages;
+	int driver_batchIndexCap;
+	struct aioState *aio;			// Asynchronous output of each symbol to its own file
+	struct queueState *queue;		// Worker pool encoding submitted requests
+	struct arena bufferArena;		// Output buffer, until the next symbol
+	struct arena workArena;			// Driver working storage and buffer strings, until the next symbol
+	struct arena driver_batchArena;		// Batch file block and page index
+#ifdef NOMALLOC
+	uint64_t bufferMem[NOMALLOC_BUFFER_SIZE / sizeof(uint64_t)];
+	uint64_t workMem[NOMALLOC_ARENA_SIZE / sizeof(uint64_t)];
+	uint64_t driver_batchMem[NOMALLOC_BATCH_SIZE / sizeof(uint64_t)];
+#endif
+	struct aioSlot *driver_aioSlot;		// Slot receiving the current symbol
 	struct sPrints rss14_prntSep;
 	uint8_t rss14_sepPattern[RSS14_SYM_W/2+2];
 	int rssexp_rowWidth;
@@ -137,6 +316,10 @@ struct gs1_encoder {
 };
 
 
+bool gs1_symAvailable(int sym);
+bool gs1_requestCopy(gs1_encoder *ctx, gs1_encoder_request *dst, const gs1_encoder_request *src);
+
+
 #ifdef UNIT_TESTS
 
 void test_api_getVersion(void);
@@ -164,6 +347,8 @@ void test_api_outFile(void);
 void test_api_dataFile(void);
 void test_api_dataStr(void);
 void test_api_getAIdataStr(void);
+void test_api_getAIdataJSON(void);
+void test_api_normaliseDLuri(void);
 void test_api_getScanData(void);
 void test_api_setScanData(void);
 void test_api_getHRI(void);
@@ -171,6 +356,18 @@ void test_api_format(void);
 void test_api_getBuffer(void);
 void test_api_copyOutputBuffer(void);
 void test_api_copyHRI(void);
+void test_api_encodeRequest(void);
+void test_api_getCapacity(void);
+void test_api_outputDigest(void);
+void test_api_batchFile(void);
+void test_api_markingPath(void);
+void test_api_renderHRI(void);
+void test_api_rasterThreads(void);
+void test_api_preview(void);
+void test_api_symbolCache(void);
+void test_api_asyncOutput(void);
+void test_api_encodeQueue(void);
+void test_api_serialGuard(void);
 
 #endif
 
@@ -45,6 +45,8 @@ static const char* SYMBOLOGY_NAMES[] =
 	"GS1-128 with CC-C",
 	"GS1 QR Code",
 	"GS1 Data Matrix",
+	"GS1 rMQR",
+	"ITF-14",
 };
 
 
@@ -74,8 +76,9 @@ static bool getSym(gs1_encoder *ctx) {
 		printf("\n\nMAIN MENU:");
 		printf("\n 0)  Exit Program");
 		for (i = 0; i < gs1_encoder_sNUMSYMS; i += 2) {
-			printf("\n%2d)  %-25s     %2d)  %-25s",
-				i+1, SYMBOLOGY_NAMES[i], i+2, SYMBOLOGY_NAMES[i + 1]);
+			printf("\n%2d)  %-25s", i+1, SYMBOLOGY_NAMES[i]);
+			if (i + 1 < gs1_encoder_sNUMSYMS)
+				printf("     %2d)  %-25s", i+2, SYMBOLOGY_NAMES[i + 1]);
 		}
 		printf("\n\nEnter symbology type or 0 to exit: ");
 		if (gets(inpStr) == NULL)
@@ -141,8 +144,12 @@ static bool userInt(gs1_encoder *ctx) {
 				printf("\n Primary data is 8 digits including check digit, or AI syntax: (01)000000........");
 				printf("\n For Composite, provide both primary and 2D components as AI syntax separated by |.");
 				break;
+			case gs1_encoder_sITF14:
+				printf("\n Data is 14 digits with check digit, or AI syntax: (01)..............");
+				break;
 			case gs1_encoder_sQR:
 			case gs1_encoder_sDM:
+			case gs1_encoder_sRMQR:
 				printf("\n Data is in AI syntax, e.g (01)..............(10)......");
 				break;
 			default:
@@ -186,7 +193,7 @@ static bool userInt(gs1_encoder *ctx) {
 			printf("\n 8) Enter GS1 Data Matrix number of columns (0=automatic). Current value = %d",
 								gs1_encoder_getDmColumns(ctx));
 		}
-		if (gs1_encoder_getSym(ctx) == gs1_encoder_sQR) {
+		if (gs1_encoder_getSym(ctx) == gs1_encoder_sQR || gs1_encoder_getSym(ctx) == gs1_encoder_sRMQR) {
 			printf("\n 8) Enter GS1 QR Code error correction level (L=%d, M=%d, Q=%d, H=%d). Current value = %d",
 								gs1_encoder_qrEClevelL,
 								gs1_encoder_qrEClevelM,
@@ -194,7 +201,8 @@ static bool userInt(gs1_encoder *ctx) {
 								gs1_encoder_qrEClevelH,
 								gs1_encoder_getQrEClevel(ctx));
 		}
-		if (gs1_encoder_getSym(ctx) != gs1_encoder_sQR && gs1_encoder_getSym(ctx) != gs1_encoder_sDM) {
+		if (gs1_encoder_getSym(ctx) != gs1_encoder_sQR && gs1_encoder_getSym(ctx) != gs1_encoder_sDM &&
+		    gs1_encoder_getSym(ctx) != gs1_encoder_sRMQR) {
 			printf("\n 8) Enter separator row height. Current value = %d", gs1_encoder_getSepHt(ctx));
 		}
 		printf("\n 9) Select another symbology or exit program");
@@ -357,7 +365,8 @@ static bool userInt(gs1_encoder *ctx) {
 			 }
 			 break;
 			case 8:
-			 if (gs1_encoder_getSym(ctx) != gs1_encoder_sQR && gs1_encoder_getSym(ctx) != gs1_encoder_sDM) {
+			 if (gs1_encoder_getSym(ctx) != gs1_encoder_sQR && gs1_encoder_getSym(ctx) != gs1_encoder_sDM &&
+			     gs1_encoder_getSym(ctx) != gs1_encoder_sRMQR) {
 				printf("\nEnter separator row height %d through %d valid: ",
 -										gs1_encoder_getPixMult(ctx), 2*gs1_encoder_getPixMult(ctx));
 				if (gets(inpStr) == NULL)
@@ -368,7 +377,7 @@ static bool userInt(gs1_encoder *ctx) {
 					continue;
 				}
 			 }
-			 else if (gs1_encoder_getSym(ctx) == gs1_encoder_sQR) {
+			 else if (gs1_encoder_getSym(ctx) == gs1_encoder_sQR || gs1_encoder_getSym(ctx) == gs1_encoder_sRMQR) {
 				printf("\nEnter GS1 QR Code error correction level (L=%d, M=%d, Q=%d, H=%d): ",
 								gs1_encoder_qrEClevelL,
 								gs1_encoder_qrEClevelM,
@@ -0,0 +1,234 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ *  Exercises a NOMALLOC build of the library, which is linked such that any
+ *  reference that it makes to the heap allocator is left unresolved.
+ *
+ *  Each available symbology is encoded with near-maximal content at the largest
+ *  X dimension, with HRI text for the linear symbologies, into each output
+ *  format and then as pages of a batch file, all using storage that is
+ *  provided statically. The instance is first checked to be no larger than
+ *  its fixed state plus the arenas sized for the enabled symbologies.
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "enc-private.h"
+#include "gs1encoders.h"
+
+
+#ifndef NOMALLOC
+#error The library must be built with NOMALLOC
+#endif
+
+
+#define MAX_FIXED_STATE	(160 * 1024)	// Instance storage other than the arenas
+
+static gs1_encoder instance;
+
+#ifndef EXCLUDE_COMPOSITE
+static const char *cc = "|^10ABC123";
+#endif
+
+static const struct {
+	int sym;
+	const char *data;
+} symbols[] = {
+	{ gs1_encoder_sDataBarOmni,		"^0124012345678905" },
+	{ gs1_encoder_sDataBarTruncated,	"^0124012345678905" },
+	{ gs1_encoder_sDataBarStacked,		"^0124012345678905" },
+	{ gs1_encoder_sDataBarStackedOmni,	"^0124012345678905" },
+	{ gs1_encoder_sDataBarLimited,		"^0115012345678907" },
+	{ gs1_encoder_sDataBarExpanded,		"^0112345678901231^3103001234^15201231^10ABCDEF" },
+	{ gs1_encoder_sUPCA,			"416000336108" },
+	{ gs1_encoder_sUPCE,			"001234000057" },
+	{ gs1_encoder_sEAN13,			"2112345678900" },
+	{ gs1_encoder_sEAN8,			"02345673" },
+	{ gs1_encoder_sGS1_128_CCA,		"^0112345678901231^10ABCDEFGHIJKLMNOPQRST" },
+	{ gs1_encoder_sGS1_128_CCC,		"^0112345678901231^10ABCDEFGHIJKLMNOPQRST" },
+	{ gs1_encoder_sQR,			"^0112345678901231^10ABCDEFGHIJKLMNOPQRST" },
+	{ gs1_encoder_sDM,			"^0112345678901231^10ABCDEFGHIJKLMNOPQRST" },
+	{ gs1_encoder_sRMQR,			"^0112345678901231" },
+	{ gs1_encoder_sITF14,			"15012345678907" },
+};
+
+static const int formats[] = {
+	gs1_encoder_dBMP, gs1_encoder_dTIF, gs1_encoder_dRAW,
+	gs1_encoder_dPATH, gs1_encoder_dGRAY, gs1_encoder_dRGBA,
+};
+
+
+static int failures = 0;
+
+static void check(const bool ok, const char *what, const int sym, const int format) {
+	if (ok)
+		return;
+	printf("FAILED: %s, symbology %d, format %d: %s\n", what, sym, format, gs1_encoder_getErrMsg(&instance));
+	failures++;
+}
+
+
+// HRI text beneath each symbol that has room for it
+static bool withHRI(const int sym) {
+
+	if (sym == gs1_encoder_sQR || sym == gs1_encoder_sDM || sym == gs1_encoder_sRMQR)
+		return false;		// Maximal matrix content is too wide for HRI text beneath it
+
+#ifdef EXCLUDE_COMPOSITE
+	if (sym == gs1_encoder_sDataBarStacked || sym == gs1_encoder_sDataBarStackedOmni)
+		return false;		// Narrower than the HRI text without a composite component
+#endif
+
+	return true;
+
+}
+
+
+// Largest content for the symbology, with a composite component where supported
+static void largest(const int sym, const char *data, char *out) {
+
+	char *p;
+	int i;
+
+	strcpy(out, data);
+
+	if (sym == gs1_encoder_sQR || sym == gs1_encoder_sDM) {
+		// Each of the company internal AIs at its maximum length
+		for (i = 1; i <= 9; i++) {
+			p = out + strlen(out);
+			p += sprintf(p, "^9%d", i);
+			memset(p, 'A' + i, 90);
+			p[90] = '\0';
+		}
+	} else if (sym == gs1_encoder_sRMQR) {
+		// Fills the 150 bytes of the largest R17x139 symbol
+		p = out + strlen(out);
+		p += sprintf(p, "^91");
+		memset(p, 'A', 90);
+		p += 90;
+		p += sprintf(p, "^92");
+		memset(p, 'B', 38);
+		p[38] = '\0';
+#ifndef EXCLUDE_COMPOSITE
+	} else if (sym == gs1_encoder_sGS1_128_CCC) {
+		strcat(out, "|^91");
+		for (i = 0; i < 90; i++)
+			strcat(out, "0123456789"[i%10] == '0' ? "A" : "1");
+		strcat(out, "^92ABCDEFGHIJKLMNOPQRSTUVWXYZ^93ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+	} else if (sym != gs1_encoder_sITF14) {		// Fixed length and no composite component
+		strcat(out, cc);
+#endif
+	}
+
+}
+
+
+int main(void) {
+
+	char data[MAX_DATA+1], fname[] = "nomalloc-batch.tif";
+	char **strings;
+	size_t i, j;
+	gs1_encoder *ctx;
+	bool matrix;
+
+	printf("Instance size: %lu bytes\n", (unsigned long)gs1_encoder_instanceSize());
+
+	// Beyond its fixed state, the instance holds only storage sized for the enabled symbologies
+	if (gs1_encoder_instanceSize() != sizeof(instance) ||
+	    sizeof(instance.bufferMem) != NOMALLOC_BUFFER_SIZE ||
+	    sizeof(instance.workMem) != NOMALLOC_ARENA_SIZE ||
+	    sizeof(instance.driver_batchMem) != NOMALLOC_BATCH_SIZE ||
+	    sizeof(instance) > MAX_FIXED_STATE + NOMALLOC_BUFFER_SIZE + NOMALLOC_ARENA_SIZE + NOMALLOC_BATCH_SIZE) {
+		printf("FAILED: Instance size exceeds the storage required by the enabled symbologies\n");
+		return 1;
+	}
+
+	if ((ctx = gs1_encoder_init(NULL)) != NULL) {
+		printf("FAILED: Instance was allocated without storage being provided\n");
+		return 1;
+	}
+
+	ctx = gs1_encoder_init(&instance);
+	gs1_encoder_setOutFile(ctx, "");
+	gs1_encoder_setPixMult(ctx, gs1_encoder_getMaxPixMult());
+	gs1_encoder_setPreviewScale(ctx, gs1_encoder_getMaxPixMult());
+	gs1_encoder_setGS1_128LinearHeight(ctx, gs1_encoder_getMaxGS1_128LinearHeight());
+
+	for (i = 0; i < SIZEOF_ARRAY(symbols); i++) {
+
+		if (!gs1_symAvailable(symbols[i].sym))
+			continue;
+
+		matrix = symbols[i].sym == gs1_encoder_sQR || symbols[i].sym == gs1_encoder_sDM ||
+			 symbols[i].sym == gs1_encoder_sRMQR;
+
+		gs1_encoder_setRenderHRI(ctx, withHRI(symbols[i].sym));
+
+		largest(symbols[i].sym, symbols[i].data, data);
+		check(gs1_encoder_setSym(ctx, symbols[i].sym), "setSym", symbols[i].sym, -1);
+		check(gs1_encoder_setDataStr(ctx, data), "setDataStr", symbols[i].sym, -1);
+
+		for (j = 0; j < SIZEOF_ARRAY(formats); j++) {
+			if (formats[j] == gs1_encoder_dPATH && !matrix)
+				continue;
+			check(gs1_encoder_setFormat(ctx, formats[j]), "setFormat", symbols[i].sym, formats[j]);
+			check(gs1_encoder_encode(ctx), "encode", symbols[i].sym, formats[j]);
+			check(gs1_encoder_getBufferSize(ctx) > 0, "getBufferSize", symbols[i].sym, formats[j]);
+			if (formats[j] == gs1_encoder_dBMP || formats[j] == gs1_encoder_dTIF || formats[j] == gs1_encoder_dRAW)
+				check(gs1_encoder_getBufferStrings(ctx, &strings) > 0, "getBufferStrings", symbols[i].sym, formats[j]);
+		}
+
+	}
+
+	// Each symbology as a page of a batch file
+	gs1_encoder_setFormat(ctx, gs1_encoder_dTIF);
+	check(gs1_encoder_openBatchFile(ctx, fname), "openBatchFile", -1, gs1_encoder_dTIF);
+	for (i = 0; i < SIZEOF_ARRAY(symbols); i++) {
+		if (!gs1_symAvailable(symbols[i].sym))
+			continue;
+		gs1_encoder_setRenderHRI(ctx, withHRI(symbols[i].sym));
+		largest(symbols[i].sym, symbols[i].data, data);
+		gs1_encoder_setSym(ctx, symbols[i].sym);
+		gs1_encoder_setDataStr(ctx, data);
+		check(gs1_encoder_encode(ctx), "encode batch page", symbols[i].sym, gs1_encoder_dTIF);
+	}
+	check(gs1_encoder_closeBatchFile(ctx), "closeBatchFile", -1, gs1_encoder_dTIF);
+	remove(fname);
+
+	check(!gs1_encoder_openAsyncOutput(ctx, 1), "openAsyncOutput is refused", -1, -1);
+	check(!gs1_encoder_openEncodeQueue(ctx, 1, 1), "openEncodeQueue is refused", -1, -1);
+	check(!gs1_encoder_setRasterThreads(ctx, 2), "setRasterThreads is refused", -1, -1);
+
+	gs1_encoder_free(ctx);
+
+	if (failures) {
+		printf("%d checks failed\n", failures);
+		return 1;
+	}
+
+	printf("SUCCESS: All NOMALLOC checks have passed.\n");
+	return 0;
+
+}
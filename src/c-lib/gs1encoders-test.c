@@ -52,12 +52,22 @@
 
 #include "enc-private.h"
 #include "gs1encoders.h"
+#include "aio.h"
+#include "bitbuf.h"
+#include "cache.h"
 #include "cc.h"
 #include "dm.h"
 #include "ean.h"
 #include "ai.h"
+#include "digest.h"
 #include "dl.h"
+#include "guard.h"
+#include "hri.h"
+#include "itf14.h"
+#include "path.h"
+#include "preview.h"
 #include "qr.h"
+#include "queue.h"
 #include "rss14.h"
 #include "rssexp.h"
 #include "rsslim.h"
@@ -182,6 +192,8 @@ TEST_LIST = {
     { "api_dataFile", test_api_dataFile },
     { "api_dataStr", test_api_dataStr },
     { "api_getAIdataStr", test_api_getAIdataStr },
+    { "api_getAIdataJSON", test_api_getAIdataJSON },
+    { "api_normaliseDLuri", test_api_normaliseDLuri },
     { "api_getScanData", test_api_getScanData },
     { "api_setScanData", test_api_setScanData },
     { "api_getHRI", test_api_getHRI },
@@ -189,6 +201,18 @@ TEST_LIST = {
     { "api_getBuffer", test_api_getBuffer },
     { "api_copyOutputBuffer", test_api_copyOutputBuffer },
     { "api_copyHRI", test_api_copyHRI },
+    { "api_encodeRequest", test_api_encodeRequest },
+    { "api_getCapacity", test_api_getCapacity },
+    { "api_outputDigest", test_api_outputDigest },
+    { "api_batchFile", test_api_batchFile },
+    { "api_markingPath", test_api_markingPath },
+    { "api_renderHRI", test_api_renderHRI },
+    { "api_rasterThreads", test_api_rasterThreads },
+    { "api_preview", test_api_preview },
+    { "api_symbolCache", test_api_symbolCache },
+    { "api_asyncOutput", test_api_asyncOutput },
+    { "api_encodeQueue", test_api_encodeQueue },
+    { "api_serialGuard", test_api_serialGuard },
 
 
     /*
@@ -201,6 +225,47 @@ TEST_LIST = {
     { "ai_gs1_processAIdata", test_ai_processAIdata },
     { "ai_validateParity", test_ai_validateParity },
     { "ai_lint_csumalpha", test_ai_lint_csumalpha },
+    { "ai_aiDataToJSON", test_ai_aiDataToJSON },
+    { "ai_validateAIcolumn", test_ai_validateAIcolumn },
+
+
+    /*
+     * aio.c
+     *
+     */
+    { "aio_backends", test_aio_backends },
+
+
+    /*
+     * bitbuf.c
+     *
+     */
+    { "bitbuf_putGet", test_bitbuf_putGet },
+#ifdef BENCHMARKS
+    { "bitbuf_benchCCC", test_bitbuf_benchCCC },
+#endif
+
+
+    /*
+     * cache.c
+     *
+     */
+    { "cache_recycle", test_cache_recycle },
+
+
+    /*
+     * guard.c
+     *
+     */
+    { "guard_set", test_guard_set },
+
+
+    /*
+     * digest.c
+     *
+     */
+    { "digest_SHA256", test_digest_SHA256 },
+    { "digest_XXH64", test_digest_XXH64 },
 
 
     /*
@@ -209,6 +274,7 @@ TEST_LIST = {
      */
     { "dl_gs1_parseDLuri", test_dl_parseDLuri },
     { "dl_URIunescape", test_dl_URIunescape },
+    { "dl_canonicaliseDL", test_dl_canonicaliseDL },
 
 
     /*
@@ -224,6 +290,8 @@ TEST_LIST = {
      *
      */
     { "cc_encode928", test_cc_encode928 },
+    { "cc_CCcapacity", test_cc_CCcapacity },
+    { "cc_packLatches", test_cc_packLatches },
 
 
     /*
@@ -231,6 +299,7 @@ TEST_LIST = {
      *
      */
     { "dm_DM_encode", test_dm_DM_encode },
+    { "dm_DMcapacity", test_dm_DMcapacity },
 
 
     /*
@@ -245,6 +314,13 @@ TEST_LIST = {
     { "ean_zeroCompress", test_ean_zeroCompress },
 
 
+    /*
+     * itf14.c
+     *
+     */
+    { "itf14_ITF14_encode", test_itf14_ITF14_encode },
+
+
     /*
      * rss.c
      *
@@ -269,6 +345,29 @@ TEST_LIST = {
     { "rssexp_RSSEXP_encode", test_rssexp_RSSEXP_encode },
 
 
+    /*
+     * hri.c
+     *
+     */
+    { "hri_hriLayout", test_hri_hriLayout },
+    { "hri_hriRasterise", test_hri_hriRasterise },
+
+
+    /*
+     * path.c
+     *
+     */
+    { "path_pathPlan", test_path_pathPlan },
+
+
+    /*
+     * preview.c
+     *
+     */
+    { "preview_previewCoverage", test_preview_previewCoverage },
+    { "preview_previewColours", test_preview_previewColours },
+
+
     /*
      * qr.c
      *
@@ -278,6 +377,18 @@ TEST_LIST = {
 #endif
     { "qr_QR_fixtures", test_qr_QR_fixtures },
     { "qr_QR_encode", test_qr_QR_encode },
+    { "qr_RMQR_fixtures", test_qr_RMQR_fixtures },
+    { "qr_RMQR_encode", test_qr_RMQR_encode },
+    { "qr_QRcapacity", test_qr_QRcapacity },
+
+
+    /*
+     * queue.c
+     *
+     */
+    { "queue_cost", test_queue_cost },
+    { "queue_encode", test_queue_encode },
+    { "queue_lanes", test_queue_lanes },
 
 
     /*
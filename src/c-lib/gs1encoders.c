@@ -28,6 +28,7 @@
 #include "enc-private.h"
 #include "gs1encoders.h"
 #include "driver.h"
+#include "cc.h"
 #include "dm.h"
 #include "ean.h"
 #include "ai.h"
@@ -48,17 +49,9 @@ static void reset_error(gs1_encoder *ctx) {
 
 
 static void free_bufferStrings(gs1_encoder *ctx) {
-	int i = 0;
 	assert(ctx);
-	if (ctx->bufferStrings) {
-		while (ctx->bufferStrings[i]) {		
-			free(ctx->bufferStrings[i]);
-			ctx->bufferStrings[i] = NULL;
-			i++;
-		}
-		free(ctx->bufferStrings);
-		ctx->bufferStrings = NULL;
-	}
+	gs1_arenaFree(&ctx->workArena, ctx->bufferStrings);	// Strings follow the array
+	ctx->bufferStrings = NULL;
 }
 
 
@@ -123,6 +116,23 @@ GS1_ENCODERS_API gs1_encoder* gs1_encoder_init(void *mem) {
 	ctx->addCheckDigit = false;
 	ctx->permitUnknownAIs = false;
 	ctx->format = gs1_encoder_dTIF;
+	ctx->outputDigestAlg = gs1_encoder_digestNONE;
+	ctx->outputDigestLen = 0;
+	ctx->pathMode = gs1_encoder_pathDOTS;
+	ctx->pathOptimise = false;
+	ctx->driver_pathMtx = NULL;
+	ctx->driver_plan.pixMult = 0;		// Compiled on first use
+	ctx->renderHRI = false;
+	ctx->rasterThreads = 1;
+	ctx->driver_hriRows = NULL;
+	ctx->driver_rowBuffer = NULL;
+	ctx->driver_numRows = 0;
+	ctx->previewScale = 1;
+	ctx->previewDarkColour = 0x000000FF;
+	ctx->previewLightColour = 0xFFFFFFFF;
+	ctx->driver_preview.cov = NULL;
+	ctx->driver_preview.acc = NULL;
+	ctx->driver_preview.px = NULL;
 	strcpy(ctx->dataStr, "");
 	ctx->numAIs = 0;
 	strcpy(ctx->dataFile, "data.txt");
@@ -133,7 +143,33 @@ GS1_ENCODERS_API gs1_encoder* gs1_encoder_init(void *mem) {
 	ctx->bufferCap = 0;
 	ctx->bufferWidth = 0;
 	ctx->bufferHeight = 0;
+	ctx->bufferMapped = false;
+	ctx->cache.map = NULL;
+	ctx->cache.view = NULL;
+	ctx->guard.open = false;
+	ctx->guard.recorded = false;
+	ctx->guard.shared = NULL;
+#ifdef GUARD_THREADS
+	ctx->guard.mutex = NULL;
+#endif
+	ctx->driver_batchfp = NULL;
+	ctx->driver_batchBlock = NULL;
+	ctx->driver_batchIndex = NULL;
+	ctx->driver_batchPages = 0;
+	ctx->driver_batchIndexCap = 0;
+	ctx->aio = NULL;
+	ctx->driver_aioSlot = NULL;
+	ctx->queue = NULL;
 	ctx->bufferStrings = NULL;
+#ifndef NOMALLOC
+	gs1_arenaInit(&ctx->bufferArena, NULL, 0);
+	gs1_arenaInit(&ctx->workArena, NULL, 0);
+	gs1_arenaInit(&ctx->driver_batchArena, NULL, 0);
+#else
+	gs1_arenaInit(&ctx->bufferArena, ctx->bufferMem, sizeof(ctx->bufferMem));
+	gs1_arenaInit(&ctx->workArena, ctx->workMem, sizeof(ctx->workMem));
+	gs1_arenaInit(&ctx->driver_batchArena, ctx->driver_batchMem, sizeof(ctx->driver_batchMem));
+#endif
 	return ctx;
 
 }
@@ -143,9 +179,25 @@ GS1_ENCODERS_API void gs1_encoder_free(gs1_encoder *ctx) {
 	assert(ctx);
 	reset_error(ctx);
 	free_bufferStrings(ctx);
-	free(ctx->buffer);
+	if (ctx->queue)
+		gs1_queueClose(ctx);	// Workers may be recording against the serial guard
+	gs1_cacheClose(ctx);
+	gs1_guardClose(ctx);
+	if (!ctx->bufferMapped)
+		gs1_arenaFree(&ctx->bufferArena, ctx->buffer);
+	if (ctx->driver_batchfp)
+		gs1_driverCloseBatch(ctx);
+	if (ctx->aio)
+		gs1_aioClose(ctx);
+	gs1_arenaFree(&ctx->driver_batchArena, ctx->driver_batchIndex);
+	gs1_arenaFree(&ctx->workArena, ctx->driver_pathMtx);
+	gs1_arenaFree(&ctx->workArena, ctx->driver_hriRows);
+	gs1_driverFreeRows(ctx);
+	gs1_previewFree(&ctx->driver_preview, &ctx->workArena);
+#ifndef NOMALLOC
 	if (ctx->localAlloc)
 		free(ctx);
+#endif
 }
 
 
@@ -159,6 +211,49 @@ GS1_ENCODERS_API int gs1_encoder_getSym(gs1_encoder *ctx) {
 	reset_error(ctx);
 	return ctx->sym;
 }
+// Symbologies may be compiled out to reduce the size of a build
+bool gs1_symAvailable(const int sym) {
+	switch (sym) {
+#ifdef EXCLUDE_DATABAR
+		case gs1_encoder_sDataBarOmni:
+		case gs1_encoder_sDataBarTruncated:
+		case gs1_encoder_sDataBarStacked:
+		case gs1_encoder_sDataBarStackedOmni:
+		case gs1_encoder_sDataBarLimited:
+		case gs1_encoder_sDataBarExpanded:
+			return false;
+#endif
+#ifdef EXCLUDE_EANUPC
+		case gs1_encoder_sUPCA:
+		case gs1_encoder_sUPCE:
+		case gs1_encoder_sEAN13:
+		case gs1_encoder_sEAN8:
+			return false;
+#endif
+#ifdef EXCLUDE_ITF14
+		case gs1_encoder_sITF14:
+			return false;
+#endif
+#ifdef EXCLUDE_GS1_128
+		case gs1_encoder_sGS1_128_CCA:
+		case gs1_encoder_sGS1_128_CCC:
+			return false;
+#endif
+#ifdef EXCLUDE_QR
+		case gs1_encoder_sQR:
+		case gs1_encoder_sRMQR:
+			return false;
+#endif
+#ifdef EXCLUDE_DM
+		case gs1_encoder_sDM:
+			return false;
+#endif
+		default:
+			return true;
+	}
+}
+
+
 GS1_ENCODERS_API bool gs1_encoder_setSym(gs1_encoder *ctx, const int sym) {
 	assert(ctx);
 	reset_error(ctx);
@@ -167,6 +262,11 @@ GS1_ENCODERS_API bool gs1_encoder_setSym(gs1_encoder *ctx, const int sym) {
 		ctx->errFlag = true;
 		return false;
 	}
+	if (!gs1_symAvailable(sym)) {
+		strcpy(ctx->errMsg, "Support for this symbology is not included in this build");
+		ctx->errFlag = true;
+		return false;
+	}
 	ctx->sym = sym;
 	return true;
 }
@@ -581,8 +681,13 @@ GS1_ENCODERS_API bool gs1_encoder_setFormat(gs1_encoder *ctx, const int format)
 				strcpy(ctx->outFile, DEFAULT_TIF_FILE);
 				break;
 			case gs1_encoder_dRAW:
+			case gs1_encoder_dGRAY:
+			case gs1_encoder_dRGBA:
 				strcpy(ctx->outFile, "");
 				break;
+			case gs1_encoder_dPATH:
+				strcpy(ctx->outFile, DEFAULT_PATH_FILE);
+				break;
 			default:     // No such format
 				return false;
 		}
@@ -592,6 +697,143 @@ GS1_ENCODERS_API bool gs1_encoder_setFormat(gs1_encoder *ctx, const int format)
 }
 
 
+GS1_ENCODERS_API int gs1_encoder_getPathMode(gs1_encoder *ctx) {
+	assert(ctx);
+	reset_error(ctx);
+	return ctx->pathMode;
+}
+GS1_ENCODERS_API bool gs1_encoder_setPathMode(gs1_encoder *ctx, const int mode) {
+	assert(ctx);
+	reset_error(ctx);
+	if (mode != gs1_encoder_pathDOTS && mode != gs1_encoder_pathSTROKES) {
+		strcpy(ctx->errMsg, "Unknown marking path mode");
+		ctx->errFlag = true;
+		return false;
+	}
+	ctx->pathMode = mode;
+	return true;
+}
+
+
+GS1_ENCODERS_API bool gs1_encoder_getPathOptimise(gs1_encoder *ctx) {
+	assert(ctx);
+	reset_error(ctx);
+	return ctx->pathOptimise;
+}
+GS1_ENCODERS_API bool gs1_encoder_setPathOptimise(gs1_encoder *ctx, const bool optimise) {
+	assert(ctx);
+	reset_error(ctx);
+	ctx->pathOptimise = optimise;
+	return true;
+}
+
+
+GS1_ENCODERS_API bool gs1_encoder_getRenderHRI(gs1_encoder *ctx) {
+	assert(ctx);
+	reset_error(ctx);
+	return ctx->renderHRI;
+}
+GS1_ENCODERS_API bool gs1_encoder_setRenderHRI(gs1_encoder *ctx, const bool renderHRI) {
+	assert(ctx);
+	reset_error(ctx);
+	ctx->renderHRI = renderHRI;
+	return true;
+}
+
+
+GS1_ENCODERS_API int gs1_encoder_getRasterThreads(gs1_encoder *ctx) {
+	assert(ctx);
+	reset_error(ctx);
+	return ctx->rasterThreads;
+}
+GS1_ENCODERS_API bool gs1_encoder_setRasterThreads(gs1_encoder *ctx, const int threads) {
+	assert(ctx);
+	reset_error(ctx);
+	if (threads < 1 || threads > RASTER_MAX_THREADS) {
+		sprintf(ctx->errMsg, "Valid number of raster threads is 1 to %d", RASTER_MAX_THREADS);
+		ctx->errFlag = true;
+		return false;
+	}
+#if defined(NOMALLOC)
+	if (threads > 1) {
+		strcpy(ctx->errMsg, "Parallel rasterisation is not available in NOMALLOC builds");
+		ctx->errFlag = true;
+		return false;
+	}
+#elif defined(_WIN32)
+	if (threads > 1) {
+		strcpy(ctx->errMsg, "Parallel rasterisation is not available on this platform");
+		ctx->errFlag = true;
+		return false;
+	}
+#endif
+	ctx->rasterThreads = threads;
+	return true;
+}
+
+
+GS1_ENCODERS_API double gs1_encoder_getPreviewScale(gs1_encoder *ctx) {
+	assert(ctx);
+	reset_error(ctx);
+	return ctx->previewScale;
+}
+GS1_ENCODERS_API bool gs1_encoder_setPreviewScale(gs1_encoder *ctx, const double scale) {
+	assert(ctx);
+	reset_error(ctx);
+	if (!(scale > 0 && scale <= MAX_PIXMULT)) {
+		sprintf(ctx->errMsg, "Valid preview scale range is greater than 0 up to %d", MAX_PIXMULT);
+		ctx->errFlag = true;
+		return false;
+	}
+	ctx->previewScale = scale;
+	return true;
+}
+
+
+GS1_ENCODERS_API uint32_t gs1_encoder_getPreviewDarkColour(gs1_encoder *ctx) {
+	assert(ctx);
+	reset_error(ctx);
+	return ctx->previewDarkColour;
+}
+GS1_ENCODERS_API bool gs1_encoder_setPreviewDarkColour(gs1_encoder *ctx, const uint32_t rgba) {
+	assert(ctx);
+	reset_error(ctx);
+	ctx->previewDarkColour = rgba;
+	return true;
+}
+
+
+GS1_ENCODERS_API uint32_t gs1_encoder_getPreviewLightColour(gs1_encoder *ctx) {
+	assert(ctx);
+	reset_error(ctx);
+	return ctx->previewLightColour;
+}
+GS1_ENCODERS_API bool gs1_encoder_setPreviewLightColour(gs1_encoder *ctx, const uint32_t rgba) {
+	assert(ctx);
+	reset_error(ctx);
+	ctx->previewLightColour = rgba;
+	return true;
+}
+
+
+GS1_ENCODERS_API int gs1_encoder_getOutputDigestAlg(gs1_encoder *ctx) {
+	assert(ctx);
+	reset_error(ctx);
+	return ctx->outputDigestAlg;
+}
+GS1_ENCODERS_API bool gs1_encoder_setOutputDigestAlg(gs1_encoder *ctx, const int alg) {
+	assert(ctx);
+	reset_error(ctx);
+	if (alg != gs1_encoder_digestNONE && alg != gs1_encoder_digestXXH64 && alg != gs1_encoder_digestSHA256) {
+		strcpy(ctx->errMsg, "Unknown digest algorithm");
+		ctx->errFlag = true;
+		return false;
+	}
+	ctx->outputDigestAlg = alg;
+	return true;
+}
+
+
 GS1_ENCODERS_API int gs1_encoder_getGS1_128LinearHeight(gs1_encoder *ctx) {
 	assert(ctx);
 	reset_error(ctx);
@@ -652,8 +894,7 @@ GS1_ENCODERS_API bool gs1_encoder_setDataStr(gs1_encoder *ctx, const char* dataS
 
 	// Validate and process data, including extraction of HRI
 	ctx->numAIs = 0;
-	if ((strlen(ctx->dataStr) >= 8 && strncmp(ctx->dataStr, "https://", 8) == 0) ||	// Digital Link URI
-	    (strlen(ctx->dataStr) >= 7 && strncmp(ctx->dataStr, "http://",  7) == 0)) {
+	if (gs1_DLschemeLen(ctx->dataStr) > 0) {			// Digital Link URI
 		// We extract AIs with the element string stored in dlAIbuffer
 		if (!gs1_parseDLuri(ctx, ctx->dataStr, ctx->dlAIbuffer))
 			goto fail;
@@ -768,6 +1009,70 @@ GS1_ENCODERS_API char* gs1_encoder_getAIdataStr(gs1_encoder *ctx) {
 }
 
 
+GS1_ENCODERS_API char* gs1_encoder_getAIdataJSON(gs1_encoder *ctx) {
+
+	assert(ctx);
+	assert(ctx->numAIs <= MAX_AIS);
+	reset_error(ctx);
+
+	if (ctx->numAIs == 0)		// Not GS1 data
+		return NULL;
+
+	if (!gs1_aiDataToJSON(ctx, ctx->outStr, sizeof(ctx->outStr))) {
+		strcpy(ctx->errMsg, "AI data is too long to return as JSON");
+		ctx->errFlag = true;
+		return NULL;
+	}
+
+	return ctx->outStr;
+
+}
+
+
+GS1_ENCODERS_API bool gs1_encoder_normaliseDLuri(gs1_encoder *ctx, const char *uri, char **elementString, char **canonicalURI) {
+
+	assert(ctx);
+	assert(uri);
+	assert(elementString);
+	assert(canonicalURI);
+	reset_error(ctx);
+
+	*elementString = NULL;
+	*canonicalURI = NULL;
+
+	// Parse and validate, as for any input data
+	if (!gs1_encoder_setDataStr(ctx, uri))
+		return false;
+
+	if (!gs1_canonicaliseDL(ctx, ctx->outStr, sizeof(ctx->outStr), ctx->dlURI, sizeof(ctx->dlURI)))
+		return false;
+
+	*elementString = ctx->outStr;
+	*canonicalURI = ctx->dlURI;
+	return true;
+
+}
+
+
+GS1_ENCODERS_API int gs1_encoder_getAIrecord(gs1_encoder *ctx, gs1_encoder_aiRecord *record) {
+	assert(ctx);
+	assert(record);
+	assert(ctx->numAIs <= MAX_AIS);
+	reset_error(ctx);
+	return gs1_aiDataToRecord(ctx, record);
+}
+
+
+GS1_ENCODERS_API long gs1_encoder_validateAIcolumn(gs1_encoder *ctx, const char *ai, const char *data, const int32_t *offsets, const size_t count, uint8_t *validity, uint8_t *faults) {
+	assert(ctx);
+	assert(ai);
+	assert(offsets);
+	assert(validity);
+	reset_error(ctx);
+	return gs1_validateAIcolumn(ctx, ai, data, offsets, count, validity, faults);
+}
+
+
 GS1_ENCODERS_API char* gs1_encoder_getScanData(gs1_encoder* ctx) {
 	assert(ctx);
 	return gs1_generateScanData(ctx);
@@ -882,17 +1187,33 @@ GS1_ENCODERS_API char* gs1_encoder_getErrMsg(gs1_encoder *ctx) {
 GS1_ENCODERS_API bool gs1_encoder_encode(gs1_encoder *ctx) {
 
 	FILE *iFile;
+	bool useCache;
 
 	assert(ctx);
 	reset_error(ctx);
 
 	free_bufferStrings(ctx);
-	free(ctx->buffer);
+	if (!ctx->bufferMapped)
+		gs1_arenaFree(&ctx->bufferArena, ctx->buffer);
+
+	// Release anything left by a symbol that failed, then reclaim the arenas
+	gs1_arenaFree(&ctx->workArena, ctx->driver_pathMtx);
+	ctx->driver_pathMtx = NULL;
+	gs1_arenaFree(&ctx->workArena, ctx->driver_hriRows);
+	ctx->driver_hriRows = NULL;
+	gs1_driverFreeRows(ctx);
+	gs1_previewFree(&ctx->driver_preview, &ctx->workArena);
+	gs1_arenaReset(&ctx->bufferArena);
+	gs1_arenaReset(&ctx->workArena);
+
+	ctx->bufferMapped = false;
+	ctx->cache.hit = false;
 	ctx->buffer = NULL;
 	ctx->bufferCap = 0;
 	ctx->bufferSize = 0;
 	ctx->bufferWidth = 0;
 	ctx->bufferHeight = 0;
+	ctx->outputDigestLen = 0;
 
 	if (ctx->pixMult == 0) {
 		strcpy(ctx->errMsg, "X-dimension must be set before encoding a symbol");
@@ -915,8 +1236,23 @@ GS1_ENCODERS_API bool gs1_encoder_encode(gs1_encoder *ctx) {
 			return false;
 	}
 
+	// Rejected before any output, since the symbol may go straight to a file
+	if (!gs1_guardRecord(ctx))
+		return false;
+
+	useCache = ctx->cache.map && strcmp(ctx->outFile, "") == 0 && !ctx->driver_batchfp;
+	if (useCache && gs1_cacheFetch(ctx)) {
+		if (ctx->outputDigestAlg != gs1_encoder_digestNONE) {
+			gs1_digestInit(&ctx->driver_digest, ctx->outputDigestAlg);
+			gs1_digestUpdate(&ctx->driver_digest, ctx->buffer, ctx->bufferSize);
+			ctx->outputDigestLen = gs1_digestFinal(&ctx->driver_digest, ctx->outputDigest);
+		}
+		return true;
+	}
+
 	switch (ctx->sym) {
 
+#ifndef EXCLUDE_DATABAR
 		case gs1_encoder_sDataBarOmni:
 		case gs1_encoder_sDataBarTruncated:
 			gs1_RSS14(ctx);
@@ -937,7 +1273,9 @@ GS1_ENCODERS_API bool gs1_encoder_encode(gs1_encoder *ctx) {
 		case gs1_encoder_sDataBarExpanded:
 			gs1_RSSExp(ctx);
 			break;
+#endif
 
+#ifndef EXCLUDE_EANUPC
 		case gs1_encoder_sUPCA:
 		case gs1_encoder_sEAN13:
 			gs1_EAN13(ctx);
@@ -950,7 +1288,15 @@ GS1_ENCODERS_API bool gs1_encoder_encode(gs1_encoder *ctx) {
 		case gs1_encoder_sEAN8:
 			gs1_EAN8(ctx);
 			break;
+#endif
+
+#ifndef EXCLUDE_ITF14
+		case gs1_encoder_sITF14:
+			gs1_ITF14(ctx);
+			break;
+#endif
 
+#ifndef EXCLUDE_GS1_128
 		case gs1_encoder_sGS1_128_CCA:
 			gs1_U128A(ctx);
 			break;
@@ -958,14 +1304,23 @@ GS1_ENCODERS_API bool gs1_encoder_encode(gs1_encoder *ctx) {
 		case gs1_encoder_sGS1_128_CCC:
 			gs1_U128C(ctx);
 			break;
+#endif
 
+#ifndef EXCLUDE_QR
 		case gs1_encoder_sQR:
 			gs1_QR(ctx);
 			break;
 
+		case gs1_encoder_sRMQR:
+			gs1_RMQR(ctx);
+			break;
+#endif
+
+#ifndef EXCLUDE_DM
 		case gs1_encoder_sDM:
 			gs1_DM(ctx);
 			break;
+#endif
 
 		default:
 			sprintf(ctx->errMsg, "Unknown symbology type %d", ctx->sym);
@@ -977,72 +1332,351 @@ GS1_ENCODERS_API bool gs1_encoder_encode(gs1_encoder *ctx) {
 	if (ctx->errFlag) {
 		assert(!ctx->buffer && ctx->bufferCap == 0 && ctx->bufferSize == 0 &&
 			ctx->bufferWidth == 0 && ctx->bufferHeight == 0);
+		gs1_guardRevoke(ctx);
 		return false;
 	}
 
+	if (useCache && ctx->buffer)
+		gs1_cacheStore(ctx);
+
 	return true;
 
 }
 
 
-GS1_ENCODERS_API size_t gs1_encoder_getBuffer(gs1_encoder *ctx, void** out) {
-	assert(ctx);
+// Symbologies that hold fixed data have only the composite component to size
+#if !defined(EXCLUDE_DATABAR) || !defined(EXCLUDE_EANUPC) || !defined(EXCLUDE_ITF14)
+static bool ccCapacity(gs1_encoder *ctx, const int columns, gs1_encoder_capacity *capacity) {
 
-	if (!ctx->buffer) {
-		assert(ctx->bufferSize == 0);
-		*out = NULL;
-		return 0;
+	const char *ccStr = strchr(ctx->dataStr, '|');
+
+	if (!ccStr || columns == 0) {
+		strcpy(ctx->errMsg, "Capacity is fixed for this symbology, other than for a composite component");
+		ctx->errFlag = true;
+		return false;
 	}
 
-	assert(ctx->bufferSize > 0);
+	return gs1_CCcapacity(ctx, (const uint8_t*)ccStr+1, columns, capacity);
 
-	*out = ctx->buffer;
-	return ctx->bufferSize;
 }
+#endif
 
 
-GS1_ENCODERS_API size_t gs1_encoder_getBufferSize(gs1_encoder *ctx) {
-	assert(ctx);
-
-	if (!ctx->buffer) {
-		assert(ctx->bufferSize == 0);
-		return 0;
-	}
-
-	return ctx->bufferSize;
-}
+GS1_ENCODERS_API bool gs1_encoder_getCapacity(gs1_encoder *ctx, gs1_encoder_capacity *capacity) {
 
+	bool ret;
 
-GS1_ENCODERS_API size_t gs1_encoder_copyOutputBuffer(gs1_encoder *ctx, void *buf, size_t max) {
 	assert(ctx);
+	assert(capacity);
+	reset_error(ctx);
 
-	if (!ctx->buffer) {
-		assert(ctx->bufferSize == 0);
-		return 0;
+	if (*ctx->dataStr == '\0') {
+		strcpy(ctx->errMsg, "No input data");
+		ctx->errFlag = true;
+		return false;
 	}
 
-	if (max < ctx->bufferSize) {
-		return 0;
-	}
+	switch (ctx->sym) {
 
-	memcpy(buf, ctx->buffer, ctx->bufferSize);
+#ifndef EXCLUDE_DATABAR
+		case gs1_encoder_sDataBarOmni:
+		case gs1_encoder_sDataBarTruncated:
+			ret = ccCapacity(ctx, 4, capacity);
+			break;
 
-	return ctx->bufferSize;
+		case gs1_encoder_sDataBarStacked:
+		case gs1_encoder_sDataBarStackedOmni:
+			ret = ccCapacity(ctx, 2, capacity);
+			break;
 
-}
+		case gs1_encoder_sDataBarLimited:
+			ret = ccCapacity(ctx, 3, capacity);
+			break;
 
+		case gs1_encoder_sDataBarExpanded:
+			ret = gs1_RSSExpCapacity(ctx, capacity);
+			break;
+#endif
 
-GS1_ENCODERS_API size_t gs1_encoder_getBufferStrings(gs1_encoder *ctx, char*** out) {
+#ifndef EXCLUDE_EANUPC
+		case gs1_encoder_sUPCA:
+		case gs1_encoder_sEAN13:
+			ret = ccCapacity(ctx, 4, capacity);
+			break;
 
-	uint8_t *buf;
-	int w, h, bw, x, y;
+		case gs1_encoder_sUPCE:
+			ret = ccCapacity(ctx, 2, capacity);
+			break;
 
-	assert(ctx);
+		case gs1_encoder_sEAN8:
+			ret = ccCapacity(ctx, 3, capacity);
+			break;
+#endif
 
-	if (!ctx->buffer) {
-		*out = NULL;
-		return 0;
-	}
+#ifndef EXCLUDE_ITF14
+		case gs1_encoder_sITF14:
+			ret = ccCapacity(ctx, 0, capacity);
+			break;
+#endif
+
+#ifndef EXCLUDE_GS1_128
+		case gs1_encoder_sGS1_128_CCA:
+		case gs1_encoder_sGS1_128_CCC:
+			ret = gs1_U128capacity(ctx, capacity);
+			break;
+#endif
+
+#ifndef EXCLUDE_QR
+		case gs1_encoder_sQR:
+			ret = gs1_QRcapacity(ctx, capacity);
+			break;
+
+		case gs1_encoder_sRMQR:
+			ret = gs1_RMQRcapacity(ctx, capacity);
+			break;
+#endif
+
+#ifndef EXCLUDE_DM
+		case gs1_encoder_sDM:
+			ret = gs1_DMcapacity(ctx, capacity);
+			break;
+#endif
+
+		default:
+			sprintf(ctx->errMsg, "Unknown symbology type %d", ctx->sym);
+			ctx->errFlag = true;
+			ret = false;
+			break;
+
+	}
+
+	assert(ret != ctx->errFlag);
+
+	return ret;
+
+}
+
+
+GS1_ENCODERS_API size_t gs1_encoder_getBuffer(gs1_encoder *ctx, void** out) {
+	assert(ctx);
+
+	if (!ctx->buffer) {
+		assert(ctx->bufferSize == 0);
+		*out = NULL;
+		return 0;
+	}
+
+	assert(ctx->bufferSize > 0);
+
+	*out = ctx->buffer;
+	return ctx->bufferSize;
+}
+
+
+GS1_ENCODERS_API size_t gs1_encoder_getBufferSize(gs1_encoder *ctx) {
+	assert(ctx);
+
+	if (!ctx->buffer) {
+		assert(ctx->bufferSize == 0);
+		return 0;
+	}
+
+	return ctx->bufferSize;
+}
+
+
+GS1_ENCODERS_API bool gs1_encoder_openBatchFile(gs1_encoder *ctx, const char* batchFile) {
+	assert(ctx);
+	assert(batchFile);
+	reset_error(ctx);
+	return gs1_driverOpenBatch(ctx, batchFile);
+}
+
+
+GS1_ENCODERS_API bool gs1_encoder_closeBatchFile(gs1_encoder *ctx) {
+	assert(ctx);
+	reset_error(ctx);
+	return gs1_driverCloseBatch(ctx);
+}
+
+
+GS1_ENCODERS_API int gs1_encoder_getBatchPageCount(gs1_encoder *ctx) {
+	assert(ctx);
+	reset_error(ctx);
+	return ctx->driver_batchPages;
+}
+
+
+GS1_ENCODERS_API long gs1_encoder_getBatchPageOffset(gs1_encoder *ctx, const int page) {
+	assert(ctx);
+	reset_error(ctx);
+	if (page < 0 || page >= ctx->driver_batchPages)
+		return -1;
+	return (long)ctx->driver_batchIndex[page];
+}
+
+
+GS1_ENCODERS_API bool gs1_encoder_openCache(gs1_encoder *ctx, const char* cacheFile, const size_t size) {
+	assert(ctx);
+	assert(cacheFile);
+	reset_error(ctx);
+	return gs1_cacheOpen(ctx, cacheFile, size);
+}
+
+
+GS1_ENCODERS_API bool gs1_encoder_closeCache(gs1_encoder *ctx) {
+	assert(ctx);
+	reset_error(ctx);
+	if (!ctx->cache.map) {
+		strcpy(ctx->errMsg, "No cache is open");
+		ctx->errFlag = true;
+		return false;
+	}
+	gs1_cacheClose(ctx);
+	return true;
+}
+
+
+GS1_ENCODERS_API bool gs1_encoder_openSerialGuard(gs1_encoder *ctx, const char* guardFile, const size_t capacity) {
+	assert(ctx);
+	reset_error(ctx);
+	return gs1_guardOpen(ctx, guardFile, capacity);
+}
+
+
+GS1_ENCODERS_API bool gs1_encoder_closeSerialGuard(gs1_encoder *ctx) {
+	assert(ctx);
+	reset_error(ctx);
+	if (!ctx->guard.open) {
+		strcpy(ctx->errMsg, "No serial guard is open");
+		ctx->errFlag = true;
+		return false;
+	}
+	gs1_guardClose(ctx);
+	return true;
+}
+
+
+GS1_ENCODERS_API size_t gs1_encoder_getSerialGuardCount(gs1_encoder *ctx) {
+	assert(ctx);
+	reset_error(ctx);
+	return ctx->guard.open ? (size_t)*ctx->guard.count : 0;
+}
+
+
+GS1_ENCODERS_API bool gs1_encoder_getCacheHit(gs1_encoder *ctx) {
+	assert(ctx);
+	reset_error(ctx);
+	return ctx->cache.map && ctx->cache.hit;
+}
+
+
+GS1_ENCODERS_API bool gs1_encoder_openAsyncOutput(gs1_encoder *ctx, const int depth) {
+	assert(ctx);
+	reset_error(ctx);
+	return gs1_aioOpen(ctx, depth, gs1_encoder_asyncNONE);
+}
+
+
+GS1_ENCODERS_API bool gs1_encoder_closeAsyncOutput(gs1_encoder *ctx) {
+	assert(ctx);
+	reset_error(ctx);
+	return gs1_aioClose(ctx);
+}
+
+
+GS1_ENCODERS_API int gs1_encoder_getAsyncBackend(gs1_encoder *ctx) {
+	assert(ctx);
+	reset_error(ctx);
+	return gs1_aioBackend(ctx);
+}
+
+
+GS1_ENCODERS_API bool gs1_encoder_openEncodeQueue(gs1_encoder *ctx, const int threads, const int depth) {
+	assert(ctx);
+	reset_error(ctx);
+	return gs1_queueOpen(ctx, threads, depth);
+}
+
+
+GS1_ENCODERS_API bool gs1_encoder_closeEncodeQueue(gs1_encoder *ctx) {
+	assert(ctx);
+	reset_error(ctx);
+	return gs1_queueClose(ctx);
+}
+
+
+GS1_ENCODERS_API int gs1_encoder_getEncodeQueueFd(gs1_encoder *ctx) {
+	assert(ctx);
+	reset_error(ctx);
+	return gs1_queueFd(ctx);
+}
+
+
+GS1_ENCODERS_API int gs1_encoder_estimateEncodeCost(gs1_encoder *ctx, const gs1_encoder_request *req) {
+	assert(ctx);
+	assert(req);
+	reset_error(ctx);
+	return gs1_queueCost(req);
+}
+
+
+GS1_ENCODERS_API bool gs1_encoder_submitEncode(gs1_encoder *ctx, const gs1_encoder_request *req, const uint64_t tag) {
+	assert(ctx);
+	assert(req);
+	reset_error(ctx);
+	return gs1_queueSubmit(ctx, req, tag);
+}
+
+
+GS1_ENCODERS_API int gs1_encoder_harvestEncodes(gs1_encoder *ctx, gs1_encoder_completion *completions, const int max) {
+	assert(ctx);
+	assert(completions || max == 0);
+	reset_error(ctx);
+	return gs1_queueHarvest(ctx, completions, max);
+}
+
+
+GS1_ENCODERS_API size_t gs1_encoder_getOutputDigest(gs1_encoder *ctx, void** out) {
+	assert(ctx);
+	assert(out);
+	*out = ctx->outputDigestLen ? ctx->outputDigest : NULL;
+	return ctx->outputDigestLen;
+}
+
+
+GS1_ENCODERS_API size_t gs1_encoder_copyOutputBuffer(gs1_encoder *ctx, void *buf, size_t max) {
+	assert(ctx);
+
+	if (!ctx->buffer) {
+		assert(ctx->bufferSize == 0);
+		return 0;
+	}
+
+	if (max < ctx->bufferSize) {
+		return 0;
+	}
+
+	memcpy(buf, ctx->buffer, ctx->bufferSize);
+
+	return ctx->bufferSize;
+
+}
+
+
+GS1_ENCODERS_API size_t gs1_encoder_getBufferStrings(gs1_encoder *ctx, char*** out) {
+
+	uint8_t *buf;
+	char *row;
+	int w, h, bw, x, y;
+
+	assert(ctx);
+
+	if (!ctx->buffer || ctx->format == gs1_encoder_dPATH ||
+	    ctx->format == gs1_encoder_dGRAY || ctx->format == gs1_encoder_dRGBA) {
+		*out = NULL;
+		return 0;
+	}
 
 	assert(ctx->bufferHeight > 0);
 	assert(ctx->bufferWidth > 0);
@@ -1054,15 +1688,16 @@ GS1_ENCODERS_API size_t gs1_encoder_getBufferStrings(gs1_encoder *ctx, char*** o
 	h = ctx->bufferHeight;
 	bw = (w-1)/8+1;
 
-	ctx->bufferStrings = malloc((size_t)(h+1) * sizeof(char*));
+	// Array of row pointers, followed by the rows
+	ctx->bufferStrings = gs1_arenaAlloc(&ctx->workArena,
+		(size_t)(h+1) * sizeof(char*) + (size_t)h * (size_t)(w+1) * sizeof(char));
 	if (!ctx->bufferStrings)
 		return 0;
 
+	row = (char*)&ctx->bufferStrings[h+1];
 	for (y = 0; y < h; y++) {
-		if (!(ctx->bufferStrings[y] = malloc((size_t)(w+1) * sizeof(char)))) {
-			free_bufferStrings(ctx);
-			return 0;
-		}
+		ctx->bufferStrings[y] = row;
+		row += w+1;
 		for (x = 0; x < w; x++) {
 			ctx->bufferStrings[y][x] = (buf[bw*y + x/8] >> (7-x%8) & 1) ? 'X' : ' ';
 		}
@@ -1090,6 +1725,114 @@ GS1_ENCODERS_API int gs1_encoder_getBufferHeight(gs1_encoder *ctx) {
 }
 
 
+/*
+ *  Copy a request into the current layout. Members beyond the size given by
+ *  the caller are zeroed so that they take their defaults
+ *
+ */
+bool gs1_requestCopy(gs1_encoder *ctx, gs1_encoder_request *dst, const gs1_encoder_request *src) {
+
+	if (src->size < offsetof(gs1_encoder_request, renderHRI) || src->size > sizeof(gs1_encoder_request)) {
+		strcpy(ctx->errMsg, "Request size is not recognised");
+		ctx->errFlag = true;
+		return false;
+	}
+
+	memset(dst, 0, sizeof(gs1_encoder_request));
+	memcpy(dst, src, src->size);
+	dst->size = sizeof(gs1_encoder_request);
+	return true;
+
+}
+
+
+GS1_ENCODERS_API bool gs1_encoder_encodeRequest(gs1_encoder *ctx, const gs1_encoder_request *request, gs1_encoder_result *res) {
+
+	gs1_encoder_request r;
+	const gs1_encoder_request *req = &r;
+	char **hri;
+	void *digest;
+	int i;
+	bool ok;
+
+	assert(ctx);
+	assert(request);
+	assert(res);
+
+	memset(res, 0, sizeof(gs1_encoder_result));
+	reset_error(ctx);
+
+	if (!gs1_requestCopy(ctx, &r, request)) {
+		res->errMsg = ctx->errMsg;
+		return false;
+	}
+
+	// setFormat accepts any value when writing to a buffer
+	if (req->format < gs1_encoder_dBMP || req->format > gs1_encoder_dRGBA) {
+		strcpy(ctx->errMsg, "Unknown output format");
+		ctx->errFlag = true;
+		res->errMsg = ctx->errMsg;
+		return false;
+	}
+
+	// Output format before the filename since changing format resets it
+	ok = gs1_encoder_setSym(ctx, req->sym) &&
+	     gs1_encoder_setFormat(ctx, req->format) &&
+	     gs1_encoder_setOutFile(ctx, req->outFile ? req->outFile : "") &&
+	     gs1_encoder_setPixMult(ctx, req->pixMult ? req->pixMult : 1) &&
+	     gs1_encoder_setXundercut(ctx, req->Xundercut) &&
+	     gs1_encoder_setYundercut(ctx, req->Yundercut) &&
+	     gs1_encoder_setSepHt(ctx, req->sepHt ? req->sepHt : ctx->pixMult) &&
+	     gs1_encoder_setDataBarExpandedSegmentsWidth(ctx, req->dataBarExpandedSegmentsWidth ? req->dataBarExpandedSegmentsWidth : 22) &&
+	     gs1_encoder_setGS1_128LinearHeight(ctx, req->gs1_128LinearHeight ? req->gs1_128LinearHeight : 25) &&
+	     gs1_encoder_setDmRows(ctx, req->dmRows) &&
+	     gs1_encoder_setDmColumns(ctx, req->dmColumns) &&
+	     gs1_encoder_setQrVersion(ctx, req->qrVersion) &&
+	     gs1_encoder_setQrEClevel(ctx, req->qrEClevel ? req->qrEClevel : gs1_encoder_qrEClevelM) &&
+	     gs1_encoder_setAddCheckDigit(ctx, req->addCheckDigit != 0) &&
+	     gs1_encoder_setPermitUnknownAIs(ctx, req->permitUnknownAIs != 0) &&
+	     gs1_encoder_setRenderHRI(ctx, req->renderHRI != 0) &&
+	     gs1_encoder_setPathMode(ctx, req->pathMode) &&
+	     gs1_encoder_setPathOptimise(ctx, req->pathOptimise != 0) &&
+	     gs1_encoder_setPreviewScale(ctx, req->previewScale != 0 ? req->previewScale : 1) &&
+	     gs1_encoder_setPreviewDarkColour(ctx, req->previewDarkColour ? req->previewDarkColour : 0x000000FF) &&
+	     gs1_encoder_setPreviewLightColour(ctx, req->previewLightColour ? req->previewLightColour : 0xFFFFFFFF) &&
+	     gs1_encoder_setOutputDigestAlg(ctx, req->outputDigestAlg) &&
+	     gs1_encoder_setRasterThreads(ctx, req->rasterThreads ? req->rasterThreads : 1) &&
+	     gs1_encoder_setFileInputFlag(ctx, false);
+
+	if (ok) {
+		const char *dataStr = req->dataStr ? req->dataStr : "";
+		ok = req->aiSyntax ? gs1_encoder_setAIdataStr(ctx, dataStr) : gs1_encoder_setDataStr(ctx, dataStr);
+	}
+
+	if (ok)
+		ok = gs1_encoder_encode(ctx);
+
+	res->status = ok;
+	res->errMsg = ctx->errMsg;
+	if (!ok)
+		return false;
+
+	res->buffer = ctx->buffer;
+	res->bufferSize = ctx->bufferSize;
+	res->width = ctx->bufferWidth;
+	res->height = ctx->bufferHeight;
+
+	res->numHRI = gs1_encoder_getHRI(ctx, &hri);
+	for (i = 0; i < res->numHRI; i++)
+		ctx->outHRIoffsets[i] = (int)(hri[i] - ctx->outStr);
+	res->hri = ctx->outStr;
+	res->hriOffsets = ctx->outHRIoffsets;
+
+	res->digestSize = gs1_encoder_getOutputDigest(ctx, &digest);
+	res->digest = digest;
+
+	return true;
+
+}
+
+
 
 #ifdef UNIT_TESTS
 
@@ -1187,6 +1930,15 @@ void test_api_defaults(void) {
 
 	gs1_encoder_free(ctx);
 
+	// Storage that is passed in need not be zeroed
+	memset(static_buf, 0xA5, sizeof(static_buf));
+	TEST_ASSERT((ctx = gs1_encoder_init(&static_buf)) != NULL);
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sEAN13));
+	TEST_CHECK(gs1_encoder_setOutFile(ctx, ""));
+	TEST_CHECK(gs1_encoder_setDataStr(ctx, "2112345678900"));
+	TEST_CHECK(gs1_encoder_encode(ctx));
+	gs1_encoder_free(ctx);
+
 }
 
 
@@ -1218,7 +1970,7 @@ void test_api_sym(void) {
 	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sUPCA));
 	TEST_CHECK(gs1_encoder_getSym(ctx) == gs1_encoder_sUPCA);
 
-	TEST_CHECK(gs1_encoder_sNUMSYMS == 14);  // Remember to add new symbologies
+	TEST_CHECK(gs1_encoder_sNUMSYMS == 16);  // Remember to add new symbologies
 
 	gs1_encoder_free(ctx);
 
@@ -1993,32 +2745,106 @@ void test_api_getAIdataStr(void) {
 }
 
 
-void test_api_getScanData(void) {
+void test_api_getAIdataJSON(void) {
 
 	gs1_encoder* ctx;
+	gs1_encoder_aiRecord rec;
 	char *out;
 
 	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
 
-	TEST_ASSERT(gs1_encoder_setSym(ctx, gs1_encoder_sDataBarExpanded));
-	TEST_ASSERT(gs1_encoder_setDataStr(ctx, "^011231231231233310ABC123^11991225|^98COMPOSITE^97XYZ"));
-	TEST_ASSERT((out = gs1_encoder_getScanData(ctx)) != NULL);
-	TEST_CHECK(strcmp(out, "]e0011231231231233310ABC123" "\x1D" "1199122598COMPOSITE" "\x1D" "97XYZ") == 0);
+	TEST_ASSERT(gs1_encoder_setDataStr(ctx, "^011231231231233310ABC123^17251231^400PO123"));
+	TEST_ASSERT((out = gs1_encoder_getAIdataJSON(ctx)) != NULL);
+	TEST_CHECK(strcmp(out, "{\"01\":\"12312312312333\",\"10\":\"ABC123\",\"17\":\"251231\",\"400\":\"PO123\"}") == 0);
+	TEST_MSG("Got: %s", out);
+
+	TEST_CHECK(gs1_encoder_getAIrecord(ctx, &rec) == 4);
+	TEST_CHECK(rec.gtin.aiLen == 2 && rec.gtin.valueLen == 14 && strncmp(rec.gtin.value, "12312312312333", 14) == 0);
+	TEST_CHECK(rec.batch.valueLen == 6 && strncmp(rec.batch.value, "ABC123", 6) == 0);
+	TEST_CHECK(rec.expiry.valueLen == 6 && strncmp(rec.expiry.value, "251231", 6) == 0);
+	TEST_CHECK(rec.serial.ai == NULL);
+	TEST_CHECK(rec.numOther == 1);
+	TEST_CHECK(rec.other[0].aiLen == 3 && strncmp(rec.other[0].ai, "400", 3) == 0);
+	TEST_CHECK(rec.other[0].valueLen == 5 && strncmp(rec.other[0].value, "PO123", 5) == 0);
+
+	// Composite strings, with quotes escaped
+	TEST_ASSERT(gs1_encoder_setDataStr(ctx, "^0112312312312333|^21A\"B^99XYZ"));
+	TEST_ASSERT((out = gs1_encoder_getAIdataJSON(ctx)) != NULL);
+	TEST_CHECK(strcmp(out, "{\"01\":\"12312312312333\",\"21\":\"A\\\"B\",\"99\":\"XYZ\"}") == 0);
+	TEST_MSG("Got: %s", out);
+	TEST_CHECK(gs1_encoder_getAIrecord(ctx, &rec) == 3);
+	TEST_CHECK(rec.serial.valueLen == 3 && strncmp(rec.serial.value, "A\"B", 3) == 0);
+
+	TEST_ASSERT(gs1_encoder_setDataStr(ctx, "TESTING"));
+	TEST_CHECK(gs1_encoder_getAIdataJSON(ctx) == NULL);
+	TEST_CHECK(gs1_encoder_getAIrecord(ctx, &rec) == 0);
+	TEST_CHECK(rec.gtin.ai == NULL && rec.numOther == 0);
 
 	gs1_encoder_free(ctx);
 
 }
 
 
-void test_api_setScanData(void) {
+void test_api_normaliseDLuri(void) {
 
 	gs1_encoder* ctx;
+	char *es, *uri;
 
 	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
 
-	TEST_ASSERT(gs1_encoder_setScanData(ctx, "]e0011231231231233310ABC123" "\x1D" "99XYZ"));
-	TEST_CHECK(gs1_encoder_getSym(ctx) == gs1_encoder_sDataBarExpanded);
-	TEST_CHECK(strcmp(gs1_encoder_getDataStr(ctx), "^011231231231233310ABC123^99XYZ") == 0);
+	TEST_CHECK(gs1_encoder_normaliseDLuri(ctx, "http://example.com/some/stem/01/09520123456788/21/A%2fB/10/L1?99=%41Z&17=251231#frag", &es, &uri));
+	TEST_CHECK(strcmp(es, "^010952012345678810L1^21A/B^1725123199AZ") == 0);
+	TEST_MSG("Got: %s", es);
+	TEST_CHECK(strcmp(uri, "https://id.gs1.org/01/09520123456788/10/L1/21/A%2FB?17=251231&99=AZ") == 0);
+	TEST_MSG("Got: %s", uri);
+
+	// The input is retained, so may be encoded
+	TEST_CHECK(strcmp(gs1_encoder_getDataStr(ctx), "http://example.com/some/stem/01/09520123456788/21/A%2fB/10/L1?99=%41Z&17=251231#frag") == 0);
+
+	// The scheme is matched without regard to case
+	TEST_CHECK(gs1_encoder_normaliseDLuri(ctx, "HTTPS://id.gs1.org/01/09520123456788", &es, &uri));
+	TEST_CHECK(strcmp(uri, "https://id.gs1.org/01/09520123456788") == 0);
+	TEST_MSG("Got: %s", uri);
+
+	// Input is validated
+	TEST_CHECK(!gs1_encoder_normaliseDLuri(ctx, "https://example.com/01/09520123456789", &es, &uri));
+	TEST_CHECK(es == NULL && uri == NULL);
+	TEST_CHECK(strstr(gs1_encoder_getErrMsg(ctx), "check digit") != NULL);
+
+	TEST_CHECK(!gs1_encoder_normaliseDLuri(ctx, "TESTING", &es, &uri));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "No GS1 DL primary key in the AI data") == 0);
+
+	gs1_encoder_free(ctx);
+
+}
+
+
+void test_api_getScanData(void) {
+
+	gs1_encoder* ctx;
+	char *out;
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+
+	TEST_ASSERT(gs1_encoder_setSym(ctx, gs1_encoder_sDataBarExpanded));
+	TEST_ASSERT(gs1_encoder_setDataStr(ctx, "^011231231231233310ABC123^11991225|^98COMPOSITE^97XYZ"));
+	TEST_ASSERT((out = gs1_encoder_getScanData(ctx)) != NULL);
+	TEST_CHECK(strcmp(out, "]e0011231231231233310ABC123" "\x1D" "1199122598COMPOSITE" "\x1D" "97XYZ") == 0);
+
+	gs1_encoder_free(ctx);
+
+}
+
+
+void test_api_setScanData(void) {
+
+	gs1_encoder* ctx;
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+
+	TEST_ASSERT(gs1_encoder_setScanData(ctx, "]e0011231231231233310ABC123" "\x1D" "99XYZ"));
+	TEST_CHECK(gs1_encoder_getSym(ctx) == gs1_encoder_sDataBarExpanded);
+	TEST_CHECK(strcmp(gs1_encoder_getDataStr(ctx), "^011231231231233310ABC123^99XYZ") == 0);
 
 	gs1_encoder_free(ctx);
 
@@ -2201,6 +3027,1026 @@ void test_api_getBuffer(void) {
 }
 
 
+void test_api_encodeRequest(void) {
+
+	gs1_encoder* ctx;
+	gs1_encoder_request req;
+	gs1_encoder_result res;
+	void *buf;
+	uint8_t test_tif[] = { 0x49, 0x49, 0x2A, 0x00 };
+	uint8_t test_raw[] = { 0x01, 0x49, 0xBD, 0x3A };
+	int height;
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+
+	memset(&req, 0, sizeof(req));
+	req.sym = gs1_encoder_sEAN13;
+	req.format = gs1_encoder_dTIF;
+	req.dataStr = "1234567890128";
+	TEST_CHECK(!gs1_encoder_encodeRequest(ctx, &req, &res));
+	TEST_CHECK(strcmp(res.errMsg, "Request size is not recognised") == 0);
+	req.size = sizeof(req);
+	TEST_CHECK(gs1_encoder_encodeRequest(ctx, &req, &res));
+	TEST_CHECK(res.status == 1);
+	TEST_CHECK(res.bufferSize == 1234);
+	TEST_CHECK(res.width == 109);
+	TEST_CHECK(res.height == 74);
+	TEST_ASSERT(res.buffer != NULL);
+	TEST_CHECK(memcmp(res.buffer, test_tif, sizeof(test_tif)) == 0);
+	TEST_CHECK(res.numHRI == 0);
+
+	// Result matches the equivalent sequence of setter calls
+	req.format = gs1_encoder_dRAW;
+	TEST_CHECK(gs1_encoder_encodeRequest(ctx, &req, &res));
+	TEST_CHECK(res.bufferSize == gs1_encoder_getBuffer(ctx, &buf));
+	TEST_CHECK(res.buffer == buf);
+	TEST_ASSERT(res.buffer != NULL);
+	TEST_CHECK(memcmp(res.buffer, test_raw, sizeof(test_raw)) == 0);
+
+	// HRI is returned as offsets into a single string area
+	memset(&req, 0, sizeof(req));
+	req.size = sizeof(req);
+	req.sym = gs1_encoder_sQR;
+	req.format = gs1_encoder_dRAW;
+	req.aiSyntax = 1;
+	req.dataStr = "(01)12312312312333(10)ABC123";
+	TEST_CHECK(gs1_encoder_encodeRequest(ctx, &req, &res));
+	TEST_ASSERT(res.numHRI == 2);
+	TEST_CHECK(strcmp(res.hri + res.hriOffsets[0], "(01) 12312312312333") == 0);
+	TEST_CHECK(strcmp(res.hri + res.hriOffsets[1], "(10) ABC123") == 0);
+	TEST_CHECK(gs1_encoder_getQrEClevel(ctx) == gs1_encoder_qrEClevelM);
+
+	// Failures report the error message without a buffer
+	req.dataStr = "(01)12312312312334";
+	TEST_CHECK(!gs1_encoder_encodeRequest(ctx, &req, &res));
+	TEST_CHECK(res.status == 0);
+	TEST_CHECK(res.buffer == NULL);
+	TEST_CHECK(res.errMsg != NULL && *res.errMsg != '\0');
+
+	req.dataStr = "(01)12312312312333";
+	req.format = 99;
+	TEST_CHECK(!gs1_encoder_encodeRequest(ctx, &req, &res));
+	TEST_CHECK(strcmp(res.errMsg, "Unknown output format") == 0);
+
+	// Later settings are carried by the request, with their digest in the result
+	req.format = gs1_encoder_dRAW;
+	req.pixMult = 4;
+	TEST_CHECK(gs1_encoder_encodeRequest(ctx, &req, &res));
+	height = res.height;
+	TEST_CHECK(res.digest == NULL && res.digestSize == 0);
+	req.renderHRI = 1;
+	req.outputDigestAlg = gs1_encoder_digestSHA256;
+	TEST_CHECK(gs1_encoder_encodeRequest(ctx, &req, &res));
+	TEST_CHECK(res.height > height);
+	TEST_CHECK(res.digest != NULL && res.digestSize == 32);
+	req.pathMode = 99;
+	TEST_CHECK(!gs1_encoder_encodeRequest(ctx, &req, &res));
+	TEST_CHECK(strcmp(res.errMsg, "Unknown marking path mode") == 0);
+
+	// Settings not known to an earlier caller are reset to their defaults
+	TEST_CHECK(gs1_encoder_setPreviewScale(ctx, 2));
+	TEST_CHECK(gs1_encoder_setPathMode(ctx, gs1_encoder_pathSTROKES));
+	req.size = offsetof(gs1_encoder_request, renderHRI);
+	TEST_CHECK(gs1_encoder_encodeRequest(ctx, &req, &res));
+	TEST_CHECK(res.height == height);
+	TEST_CHECK(res.digest == NULL);
+	TEST_CHECK(!gs1_encoder_getRenderHRI(ctx));
+	TEST_CHECK(gs1_encoder_getPreviewScale(ctx) == 1);
+	TEST_CHECK(gs1_encoder_getPathMode(ctx) == gs1_encoder_pathDOTS);
+	TEST_CHECK(gs1_encoder_getOutputDigestAlg(ctx) == gs1_encoder_digestNONE);
+	req.size = sizeof(req) + 1;
+	TEST_CHECK(!gs1_encoder_encodeRequest(ctx, &req, &res));
+
+	gs1_encoder_free(ctx);
+
+}
+
+
+void test_api_getCapacity(void) {
+
+	gs1_encoder* ctx;
+	gs1_encoder_capacity cap;
+	char data[64];
+	int n;
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+	TEST_CHECK(gs1_encoder_setFormat(ctx, gs1_encoder_dRAW));
+
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sQR));
+	TEST_CHECK(!gs1_encoder_getCapacity(ctx, &cap));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "No input data") == 0);
+
+	TEST_CHECK(gs1_encoder_setAIdataStr(ctx, "(01)12312312312333(10)ABC123"));
+	TEST_ASSERT(gs1_encoder_getCapacity(ctx, &cap));
+	TEST_CHECK(cap.units == gs1_encoder_capBITS);
+	TEST_CHECK(cap.used == 208 && cap.capacity == 224);
+	TEST_CHECK(cap.rows == 25 && cap.columns == 25);
+	TEST_CHECK(cap.fits);
+
+	// Fixed version is too small, so it is reported as is
+	TEST_CHECK(gs1_encoder_setQrVersion(ctx, gs1_encoder_qrVersion3));
+	TEST_CHECK(gs1_encoder_setAIdataStr(ctx, "(01)12312312312333(91)ABCDEFGHIJKLMNOPQRSTUVWXYZ1234"));
+	TEST_ASSERT(gs1_encoder_getCapacity(ctx, &cap));
+	TEST_CHECK(cap.used == 400 && cap.capacity == 352);
+	TEST_CHECK(cap.rows == 29 && cap.columns == 29);
+	TEST_CHECK(!cap.fits);
+	TEST_CHECK(gs1_encoder_setQrVersion(ctx, gs1_encoder_qrVersionAutomatic));
+
+	// How long a serial number fits in Data Matrix 16x16
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sDM));
+	TEST_CHECK(gs1_encoder_setDmRows(ctx, gs1_encoder_dmRows16));
+	TEST_CHECK(gs1_encoder_setDmColumns(ctx, gs1_encoder_dmColumns16));
+	for (n = 1; n <= 20; n++) {
+		sprintf(data, "(01)12312312312333(21)%.*s", n, "ABCDEFGHIJKLMNOPQRST");
+		TEST_ASSERT(gs1_encoder_setAIdataStr(ctx, data));
+		TEST_ASSERT(gs1_encoder_getCapacity(ctx, &cap));
+		TEST_CHECK(cap.rows == 16 && cap.columns == 16);
+		TEST_CHECK(cap.fits == gs1_encoder_encode(ctx));
+		if (!cap.fits)
+			break;
+	}
+	TEST_CHECK(n == 3);	// (01) in 9 codewords, (21) and two characters in 3 more
+	TEST_CHECK(gs1_encoder_setDmRows(ctx, gs1_encoder_dmRowsAutomatic));
+	TEST_CHECK(gs1_encoder_setDmColumns(ctx, gs1_encoder_dmColumnsAutomatic));
+
+	// CC-A on DataBar Stacked
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sDataBarStacked));
+	TEST_CHECK(gs1_encoder_setAIdataStr(ctx, "(01)12312312312333"));
+	TEST_CHECK(!gs1_encoder_getCapacity(ctx, &cap));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "Capacity is fixed for this symbology, other than for a composite component") == 0);
+	strcpy(data, "(01)12312312312333|(21)ABC123");	// Written to in place
+	TEST_CHECK(gs1_encoder_setAIdataStr(ctx, data));
+	TEST_ASSERT(gs1_encoder_getCapacity(ctx, &cap));
+	TEST_CHECK(cap.used == 45 && cap.capacity == 59);
+	TEST_CHECK(cap.rows == 5 && cap.columns == 2);
+	TEST_CHECK(cap.fits);
+
+	// CC-A on EAN-13
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sEAN13));
+	strcpy(data, "(01)02112345678900|(99)1234-abcd");
+	TEST_CHECK(gs1_encoder_setAIdataStr(ctx, data));
+	TEST_ASSERT(gs1_encoder_getCapacity(ctx, &cap));
+	TEST_CHECK(cap.used == 65 && cap.capacity == 78);
+	TEST_CHECK(cap.rows == 3 && cap.columns == 4);
+
+	// DataBar Expanded in a single row of nine segments
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sDataBarExpanded));
+	TEST_CHECK(gs1_encoder_setAIdataStr(ctx, "(01)12312312312333(10)ABC123"));
+	TEST_ASSERT(gs1_encoder_getCapacity(ctx, &cap));
+	TEST_CHECK(cap.used == 92 && cap.capacity == 96);
+	TEST_CHECK(cap.rows == 1 && cap.columns == 9);
+
+	// GS1-128 is sized in symbol characters
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sGS1_128_CCA));
+	TEST_ASSERT(gs1_encoder_getCapacity(ctx, &cap));
+	TEST_CHECK(cap.units == gs1_encoder_capSYMCHARS);
+	TEST_CHECK(cap.used == 20 && cap.capacity == 53);
+	TEST_CHECK(cap.fits);
+	TEST_ASSERT(gs1_encoder_encode(ctx));
+	TEST_CHECK(cap.rows == 1 && cap.columns == (int)gs1_encoder_getBufferWidth(ctx));
+
+	// CC-C above GS1-128
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sGS1_128_CCC));
+	strcpy(data, "(01)12312312312333(10)ABC123|(91)ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+	TEST_CHECK(gs1_encoder_setAIdataStr(ctx, data));
+	TEST_ASSERT(gs1_encoder_getCapacity(ctx, &cap));
+	TEST_CHECK(cap.units == gs1_encoder_capBITS);
+	TEST_CHECK(cap.used == 168 && cap.capacity == 240);
+	TEST_CHECK(cap.rows == 4 && cap.columns == 9);
+
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sITF14));
+	TEST_CHECK(gs1_encoder_setAIdataStr(ctx, "(01)12312312312333"));
+	TEST_CHECK(!gs1_encoder_getCapacity(ctx, &cap));
+
+	gs1_encoder_free(ctx);
+
+}
+
+
+void test_api_outputDigest(void) {
+
+	gs1_encoder* ctx;
+	struct digestState st;
+	uint8_t expect[MAX_DIGEST_LEN];
+	void *digest, *buf;
+	size_t size;
+	int format;
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+
+	TEST_CHECK(gs1_encoder_getOutputDigestAlg(ctx) == gs1_encoder_digestNONE);
+	TEST_CHECK(!gs1_encoder_setOutputDigestAlg(ctx, 99));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "Unknown digest algorithm") == 0);
+
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sQR));
+	TEST_CHECK(gs1_encoder_setDataStr(ctx, "https://id.gs1.org/01/12312312312333"));
+	TEST_CHECK(gs1_encoder_setOutFile(ctx, ""));
+
+	// No digest by default
+	TEST_CHECK(gs1_encoder_encode(ctx));
+	TEST_CHECK(gs1_encoder_getOutputDigest(ctx, &digest) == 0);
+	TEST_CHECK(digest == NULL);
+
+	// Digest of the emitted output matches a second pass over the buffer
+	for (format = gs1_encoder_dBMP; format <= gs1_encoder_dRAW; format++) {
+		TEST_CHECK(gs1_encoder_setFormat(ctx, format));
+
+		TEST_CHECK(gs1_encoder_setOutputDigestAlg(ctx, gs1_encoder_digestSHA256));
+		TEST_CHECK(gs1_encoder_encode(ctx));
+		TEST_ASSERT((size = gs1_encoder_getBuffer(ctx, &buf)) > 0);
+		gs1_digestInit(&st, gs1_encoder_digestSHA256);
+		gs1_digestUpdate(&st, buf, size);
+		TEST_CHECK(gs1_digestFinal(&st, expect) == SHA256_DIGEST_LEN);
+		TEST_CHECK(gs1_encoder_getOutputDigest(ctx, &digest) == SHA256_DIGEST_LEN);
+		TEST_CHECK(memcmp(digest, expect, SHA256_DIGEST_LEN) == 0);
+		TEST_MSG("Format %d", format);
+
+		TEST_CHECK(gs1_encoder_setOutputDigestAlg(ctx, gs1_encoder_digestXXH64));
+		TEST_CHECK(gs1_encoder_encode(ctx));
+		TEST_ASSERT((size = gs1_encoder_getBuffer(ctx, &buf)) > 0);
+		gs1_digestInit(&st, gs1_encoder_digestXXH64);
+		gs1_digestUpdate(&st, buf, size);
+		TEST_CHECK(gs1_digestFinal(&st, expect) == XXH64_DIGEST_LEN);
+		TEST_CHECK(gs1_encoder_getOutputDigest(ctx, &digest) == XXH64_DIGEST_LEN);
+		TEST_CHECK(memcmp(digest, expect, XXH64_DIGEST_LEN) == 0);
+		TEST_MSG("Format %d", format);
+	}
+
+	// Failed encode leaves no digest
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sEAN13));
+	TEST_CHECK(gs1_encoder_setDataStr(ctx, "1234567890128"));
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sNONE));
+	TEST_CHECK(!gs1_encoder_encode(ctx));
+	TEST_CHECK(gs1_encoder_getOutputDigest(ctx, &digest) == 0);
+
+	gs1_encoder_free(ctx);
+
+}
+
+
+static uint32_t test_tifLong(const uint8_t *p) {
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint32_t test_tifTag(const uint8_t *ifd, const uint16_t tag) {
+	int i, n = ifd[0] | ifd[1] << 8;
+	for (i = 0; i < n; i++) {
+		const uint8_t *t = ifd + 2 + i * 12;
+		if ((t[0] | t[1] << 8) == tag)
+			return test_tifLong(t + 8);
+	}
+	return 0;
+}
+
+void test_api_batchFile(void) {
+
+	gs1_encoder* ctx;
+	const char *fname = "gs1encoders-test-batch.tif";
+	const int syms[3] = { gs1_encoder_sEAN13, gs1_encoder_sQR, gs1_encoder_sDM };
+	const char *data[3] = { "1234567890128", "https://id.gs1.org/01/12312312312333", "^011231231231233310ABC123" };
+	uint8_t *raw[3];
+	size_t rawSize[3];
+	uint8_t *file;
+	FILE *fp;
+	long size;
+	uint32_t off;
+	void *buf;
+	int i, pages;
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+
+	// Reference images for each page
+	TEST_CHECK(gs1_encoder_setFormat(ctx, gs1_encoder_dRAW));
+	TEST_CHECK(gs1_encoder_setOutFile(ctx, ""));
+	for (i = 0; i < 3; i++) {
+		TEST_CHECK(gs1_encoder_setSym(ctx, syms[i]));
+		TEST_CHECK(gs1_encoder_setDataStr(ctx, data[i]));
+		TEST_CHECK(gs1_encoder_encode(ctx));
+		rawSize[i] = gs1_encoder_getBuffer(ctx, &buf);
+		TEST_ASSERT((raw[i] = malloc(rawSize[i])) != NULL);
+		memcpy(raw[i], buf, rawSize[i]);
+	}
+
+	TEST_CHECK(!gs1_encoder_closeBatchFile(ctx));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "No batch file is open") == 0);
+
+	TEST_ASSERT(gs1_encoder_openBatchFile(ctx, fname));
+	TEST_CHECK(!gs1_encoder_openBatchFile(ctx, fname));
+
+	// Batch pages must be TIFF
+	TEST_CHECK(!gs1_encoder_encode(ctx));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "Batch output requires TIFF format") == 0);
+
+	TEST_CHECK(gs1_encoder_setFormat(ctx, gs1_encoder_dTIF));
+	for (i = 0; i < 3; i++) {
+		TEST_CHECK(gs1_encoder_setSym(ctx, syms[i]));
+		TEST_CHECK(gs1_encoder_setDataStr(ctx, data[i]));
+		TEST_CHECK(gs1_encoder_encode(ctx));
+		TEST_CHECK(gs1_encoder_getBuffer(ctx, &buf) == 0);
+	}
+
+	// Enough further pages to span several output blocks
+	TEST_CHECK(gs1_encoder_setPixMult(ctx, 20));
+	for (i = 3; i < 200; i++)
+		TEST_CHECK(gs1_encoder_encode(ctx));
+
+	TEST_CHECK(gs1_encoder_closeBatchFile(ctx));
+	TEST_CHECK(gs1_encoder_getBatchPageCount(ctx) == 200);
+	TEST_CHECK(gs1_encoder_getBatchPageOffset(ctx, 200) == -1);
+
+	TEST_ASSERT((fp = fopen(fname, "rb")) != NULL);
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	TEST_CHECK(size > 2 * BATCH_BLOCK_SIZE);
+	rewind(fp);
+	TEST_ASSERT((file = malloc((size_t)size)) != NULL);
+	TEST_CHECK(fread(file, (size_t)size, 1, fp) == 1);
+	fclose(fp);
+	remove(fname);
+
+	// Follow the IFD chain, checking it against the index and reference images
+	TEST_CHECK(memcmp(file, "II*\0", 4) == 0);
+	for (pages = 0, off = test_tifLong(file + 4); off != 0; pages++) {
+		TEST_ASSERT(off % 2 == 0 && (long)off < size);
+		TEST_CHECK((long)off == gs1_encoder_getBatchPageOffset(ctx, pages));
+		TEST_CHECK(test_tifTag(file + off, 0xFE) == 2);
+		if (pages < 3) {
+			TEST_CHECK(test_tifTag(file + off, 0x117) == rawSize[pages]);
+			TEST_CHECK(memcmp(file + test_tifTag(file + off, 0x111), raw[pages], rawSize[pages]) == 0);
+			TEST_MSG("Page %d", pages);
+		}
+		off = test_tifLong(file + off + 2 + 14 * 12);
+	}
+	TEST_CHECK(pages == 200);
+
+	free(file);
+	for (i = 0; i < 3; i++)
+		free(raw[i]);
+
+	gs1_encoder_free(ctx);
+
+}
+
+
+void test_api_markingPath(void) {
+
+	gs1_encoder* ctx;
+	char **strings;
+	char *text, *line;
+	char hits[MAX_DM_ROWS][MAX_DM_COLS] = { { 0 } };
+	size_t size;
+	void *buf;
+	int rows, cols, mode, x, y, x1, y1, x2, y2, marks, n, w, h;
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+
+	TEST_CHECK(gs1_encoder_getPathMode(ctx) == gs1_encoder_pathDOTS);
+	TEST_CHECK(!gs1_encoder_setPathMode(ctx, 2));
+	TEST_CHECK(!gs1_encoder_getPathOptimise(ctx));
+
+	// Reference module matrix
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sDM));
+	TEST_CHECK(gs1_encoder_setAIdataStr(ctx, "(01)12312312312333(10)ABC123"));
+	TEST_CHECK(gs1_encoder_setFormat(ctx, gs1_encoder_dRAW));
+	TEST_CHECK(gs1_encoder_setOutFile(ctx, ""));
+	TEST_CHECK(gs1_encoder_encode(ctx));
+	rows = (int)gs1_encoder_getBufferStrings(ctx, &strings);
+	cols = gs1_encoder_getBufferWidth(ctx);
+	TEST_ASSERT(rows > 0 && rows <= MAX_DM_ROWS && cols <= MAX_DM_COLS);
+
+	TEST_CHECK(gs1_encoder_setFormat(ctx, gs1_encoder_dPATH));
+	TEST_CHECK(strcmp(gs1_encoder_getOutFile(ctx), "") == 0);
+
+	for (mode = gs1_encoder_pathDOTS; mode <= gs1_encoder_pathSTROKES; mode++) {
+
+		TEST_CHECK(gs1_encoder_setPathMode(ctx, mode));
+		TEST_CHECK(gs1_encoder_setPathOptimise(ctx, mode == gs1_encoder_pathSTROKES));
+		TEST_CHECK(gs1_encoder_encode(ctx));
+		TEST_CHECK(gs1_encoder_getBufferWidth(ctx) == cols);
+		TEST_CHECK(gs1_encoder_getBufferHeight(ctx) == rows);
+		TEST_CHECK(gs1_encoder_getBufferStrings(ctx, &strings) == 0);
+		TEST_ASSERT((size = gs1_encoder_getBuffer(ctx, &buf)) > 0);
+		TEST_ASSERT((text = malloc(size + 1)) != NULL);
+		memcpy(text, buf, size);
+		text[size] = '\0';
+
+		memset(hits, 0, sizeof(hits));
+		marks = n = 0;
+		for (line = strtok(text, "\n"); line; line = strtok(NULL, "\n")) {
+			if (sscanf(line, "# modules %d %d", &w, &h) == 2) {
+				TEST_CHECK(w == cols && h == rows);
+			} else if (sscanf(line, "# marks %d", &marks) == 1) {
+				continue;
+			} else if (line[0] == '#') {
+				continue;
+			} else if (sscanf(line, "D %d %d", &x1, &y1) == 2) {
+				TEST_ASSERT(x1 >= 0 && x1 < cols && y1 >= 0 && y1 < rows);
+				hits[y1][x1]++;
+				n++;
+			} else if (sscanf(line, "S %d %d %d %d", &x1, &y1, &x2, &y2) == 4) {
+				TEST_ASSERT(mode == gs1_encoder_pathSTROKES);
+				TEST_ASSERT(x1 == x2 || y1 == y2);
+				for (y = y1 < y2 ? y1 : y2; y <= (y1 < y2 ? y2 : y1); y++)
+					for (x = x1 < x2 ? x1 : x2; x <= (x1 < x2 ? x2 : x1); x++)
+						hits[y][x]++;
+				n++;
+			} else {
+				TEST_CHECK(false);
+				TEST_MSG("Bad line: %s", line);
+			}
+		}
+		free(text);
+		TEST_CHECK(n == marks);
+
+		// Reference matrix is regenerated as the path output replaced it
+		TEST_CHECK(gs1_encoder_setFormat(ctx, gs1_encoder_dRAW));
+		TEST_CHECK(gs1_encoder_encode(ctx));
+		TEST_CHECK(gs1_encoder_getBufferStrings(ctx, &strings) == (size_t)rows);
+		for (y = 0; y < rows; y++)
+			for (x = 0; x < cols; x++)
+				TEST_CHECK(hits[y][x] == (strings[y][x] == 'X' ? 1 : 0));
+		TEST_CHECK(gs1_encoder_setFormat(ctx, gs1_encoder_dPATH));
+
+	}
+
+	// Only for 2D matrix symbologies
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sEAN13));
+	TEST_CHECK(gs1_encoder_setDataStr(ctx, "2112345678900"));
+	TEST_CHECK(!gs1_encoder_encode(ctx));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "Marking path output is only supported for Data Matrix and QR Code") == 0);
+
+	gs1_encoder_free(ctx);
+
+}
+
+
+void test_api_renderHRI(void) {
+
+	gs1_encoder* ctx;
+	char **strings;
+	uint8_t *ref;
+	void *buf;
+	size_t size;
+	int i, w, h, hriH;
+	bool dark;
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+
+	TEST_CHECK(!gs1_encoder_getRenderHRI(ctx));
+	TEST_CHECK(gs1_encoder_setRenderHRI(ctx, true));
+	TEST_CHECK(gs1_encoder_getRenderHRI(ctx));
+
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sGS1_128_CCA));
+	TEST_CHECK(gs1_encoder_setAIdataStr(ctx, "(01)12312312312333(10)ABC123"));
+	TEST_CHECK(gs1_encoder_setFormat(ctx, gs1_encoder_dRAW));
+	TEST_CHECK(gs1_encoder_setOutFile(ctx, ""));
+
+	// Reference symbol without text
+	TEST_CHECK(gs1_encoder_setRenderHRI(ctx, false));
+	TEST_ASSERT(gs1_encoder_encode(ctx));
+	w = gs1_encoder_getBufferWidth(ctx);
+	h = gs1_encoder_getBufferHeight(ctx);
+	TEST_ASSERT(w >= 31 * HRI_ADVANCE);	// Room for a single line of text
+	TEST_ASSERT((size = gs1_encoder_getBuffer(ctx, &buf)) > 0);
+	TEST_ASSERT((ref = malloc(size)) != NULL);
+	memcpy(ref, buf, size);
+
+	// The symbol is unchanged, with the text beneath it
+	TEST_CHECK(gs1_encoder_setRenderHRI(ctx, true));
+	TEST_ASSERT(gs1_encoder_encode(ctx));
+	hriH = HRI_GAP + HRI_LINE_H;
+	TEST_CHECK(gs1_encoder_getBufferWidth(ctx) == w);
+	TEST_ASSERT(gs1_encoder_getBufferHeight(ctx) == h + hriH);
+	TEST_ASSERT(gs1_encoder_getBuffer(ctx, &buf) == size + (size_t)hriH * (size_t)((w + 7) / 8));
+	TEST_CHECK(memcmp(buf, ref, size) == 0);
+	free(ref);
+	TEST_ASSERT((int)gs1_encoder_getBufferStrings(ctx, &strings) == h + hriH);
+	for (i = h; i < h + HRI_GAP; i++)
+		TEST_CHECK(strchr(strings[i], 'X') == NULL);
+	dark = false;
+	for (i = h + HRI_GAP; i < h + HRI_GAP + HRI_GLYPH_H; i++)
+		dark |= strchr(strings[i], 'X') != NULL;
+	TEST_CHECK(dark);
+	for (i = h + HRI_GAP + HRI_GLYPH_H; i < h + hriH; i++)
+		TEST_CHECK(strchr(strings[i], 'X') == NULL);
+
+	// Text is scaled with the X-dimension
+	TEST_CHECK(gs1_encoder_setPixMult(ctx, 2));
+	TEST_ASSERT(gs1_encoder_encode(ctx));
+	TEST_CHECK(gs1_encoder_getBufferHeight(ctx) == 2 * (h + hriH));
+
+	// BMP rows are padded to a 32-bit boundary
+	TEST_CHECK(gs1_encoder_setPixMult(ctx, 1));
+	TEST_CHECK(gs1_encoder_setFormat(ctx, gs1_encoder_dBMP));
+	TEST_ASSERT(gs1_encoder_encode(ctx));
+	TEST_CHECK(gs1_encoder_getBuffer(ctx, &buf) == (size_t)(0x3E + ((w + 31) / 32) * 4 * (h + hriH)));
+
+	// Too narrow
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sDM));
+	TEST_CHECK(gs1_encoder_setAIdataStr(ctx, "(01)12312312312333(10)ABC123"));
+	TEST_CHECK(!gs1_encoder_encode(ctx));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "HRI text is too wide to fit beneath the symbol") == 0);
+
+	gs1_encoder_free(ctx);
+
+}
+
+
+void test_api_rasterThreads(void) {
+
+	static const int formats[] = { gs1_encoder_dRAW, gs1_encoder_dBMP, gs1_encoder_dTIF };
+
+	gs1_encoder* ctx;
+	uint8_t *ref;
+	void *buf;
+	size_t size, refSize, image;
+	uint32_t strips;
+	int i;
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+
+	TEST_CHECK(gs1_encoder_getRasterThreads(ctx) == 1);
+	TEST_CHECK(!gs1_encoder_setRasterThreads(ctx, 0));
+	TEST_CHECK(!gs1_encoder_setRasterThreads(ctx, RASTER_MAX_THREADS + 1));
+	TEST_CHECK(gs1_encoder_setRasterThreads(ctx, RASTER_MAX_THREADS));
+	TEST_CHECK(gs1_encoder_getRasterThreads(ctx) == RASTER_MAX_THREADS);
+
+	// Large enough to be divided into several bands, with undercut and text crossing the bands
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sQR));
+	TEST_CHECK(gs1_encoder_setAIdataStr(ctx, "(01)12312312312333(10)ABC123(21)SERIAL0123456789"));
+	TEST_CHECK(gs1_encoder_setOutFile(ctx, ""));
+	TEST_CHECK(gs1_encoder_setPixMult(ctx, 80));
+	TEST_CHECK(gs1_encoder_setXundercut(ctx, 3));
+	TEST_CHECK(gs1_encoder_setYundercut(ctx, 5));
+	TEST_CHECK(gs1_encoder_setRenderHRI(ctx, true));
+
+	for (i = 0; i < (int)(sizeof(formats) / sizeof(formats[0])); i++) {
+
+		TEST_CASE_("Format %d", formats[i]);
+
+		TEST_CHECK(gs1_encoder_setFormat(ctx, formats[i]));
+		TEST_CHECK(gs1_encoder_setRasterThreads(ctx, 1));
+		TEST_ASSERT(gs1_encoder_encode(ctx));
+		TEST_ASSERT((refSize = gs1_encoder_getBuffer(ctx, &buf)) > 4 * RASTER_BAND_MIN_BYTES);
+		TEST_ASSERT((ref = malloc(refSize)) != NULL);
+		memcpy(ref, buf, refSize);
+
+		TEST_CHECK(gs1_encoder_setRasterThreads(ctx, 4));
+		TEST_ASSERT(gs1_encoder_encode(ctx));
+		size = gs1_encoder_getBuffer(ctx, &buf);
+
+		if (formats[i] == gs1_encoder_dTIF) {
+			// Same pixels, split into strips whose offsets and lengths precede the image data
+			strips = (uint32_t)((size - refSize) / 8);
+			TEST_CHECK(strips == 4);
+			TEST_CHECK(size == refSize + 8 * strips);
+			image = (size_t)((gs1_encoder_getBufferWidth(ctx) + 7) / 8) * (size_t)gs1_encoder_getBufferHeight(ctx);
+			TEST_CHECK(memcmp((uint8_t *)buf + size - image, ref + refSize - image, image) == 0);
+		} else {
+			TEST_CHECK(size == refSize);
+			TEST_CHECK(memcmp(buf, ref, refSize) == 0);
+		}
+
+		free(ref);
+
+	}
+
+	gs1_encoder_free(ctx);
+
+}
+
+
+void test_api_preview(void) {
+
+	gs1_encoder* ctx;
+	char **strings;
+	uint8_t *ref;
+	const uint8_t *px;
+	void *buf;
+	size_t size;
+	long dark, sum;
+	int i, x, y, w, h, outW, outH;
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+
+	TEST_CHECK(gs1_encoder_getPreviewScale(ctx) == 1);
+	TEST_CHECK(gs1_encoder_getPreviewDarkColour(ctx) == 0x000000FF);
+	TEST_CHECK(gs1_encoder_getPreviewLightColour(ctx) == 0xFFFFFFFF);
+	TEST_CHECK(!gs1_encoder_setPreviewScale(ctx, 0));
+	TEST_CHECK(!gs1_encoder_setPreviewScale(ctx, -1));
+	TEST_CHECK(!gs1_encoder_setPreviewScale(ctx, MAX_PIXMULT + 0.5));
+	TEST_CHECK(gs1_encoder_getPreviewScale(ctx) == 1);
+
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sDM));
+	TEST_CHECK(gs1_encoder_setAIdataStr(ctx, "(01)12312312312333(10)ABC123"));
+
+	// Reference matrix
+	TEST_CHECK(gs1_encoder_setFormat(ctx, gs1_encoder_dRAW));
+	TEST_CHECK(gs1_encoder_setOutFile(ctx, ""));
+	TEST_ASSERT(gs1_encoder_encode(ctx));
+	w = gs1_encoder_getBufferWidth(ctx);
+	h = gs1_encoder_getBufferHeight(ctx);
+	TEST_ASSERT((int)gs1_encoder_getBufferStrings(ctx, &strings) == h);
+	TEST_ASSERT((ref = malloc((size_t)(w * h))) != NULL);
+	dark = 0;
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			ref[y * w + x] = strings[y][x] == 'X' ? 0 : 255;
+			dark += strings[y][x] == 'X';
+		}
+	}
+
+	// At a scale of 1 each pixel is either dark or light
+	TEST_CHECK(gs1_encoder_setFormat(ctx, gs1_encoder_dGRAY));
+	TEST_CHECK(strcmp(gs1_encoder_getOutFile(ctx), "") == 0);
+	TEST_ASSERT(gs1_encoder_encode(ctx));
+	TEST_CHECK(gs1_encoder_getBufferWidth(ctx) == w);
+	TEST_CHECK(gs1_encoder_getBufferHeight(ctx) == h);
+	TEST_ASSERT(gs1_encoder_getBuffer(ctx, &buf) == (size_t)(w * h));
+	TEST_CHECK(memcmp(buf, ref, (size_t)(w * h)) == 0);
+	TEST_CHECK(gs1_encoder_getBufferStrings(ctx, &strings) == 0);
+	free(ref);
+
+	// At a fractional scale the dark area is preserved, to within rounding
+	TEST_CHECK(gs1_encoder_setPreviewScale(ctx, 2.5));
+	TEST_ASSERT(gs1_encoder_encode(ctx));
+	outW = gs1_encoder_getBufferWidth(ctx);
+	outH = gs1_encoder_getBufferHeight(ctx);
+	TEST_CHECK(outW == (w * 5 + 1) / 2);
+	TEST_CHECK(outH == (h * 5 + 1) / 2);
+	TEST_ASSERT((size = gs1_encoder_getBuffer(ctx, &buf)) == (size_t)(outW * outH));
+	px = buf;
+	sum = 0;
+	for (i = 0; i < outW * outH; i++)
+		sum += 255 - px[i];
+	TEST_CHECK(labs(sum * 4 - dark * 25 * 255) <= (long)outW * outH * 2);
+
+	// The preview scale is independent of the pixel multiplier
+	TEST_ASSERT((ref = malloc(size)) != NULL);
+	memcpy(ref, buf, size);
+	TEST_CHECK(gs1_encoder_setPixMult(ctx, 2));
+	TEST_ASSERT(gs1_encoder_encode(ctx));
+	TEST_ASSERT(gs1_encoder_getBuffer(ctx, &buf) == size);
+	TEST_CHECK(memcmp(buf, ref, size) == 0);
+	free(ref);
+
+	// RGBA blends the configured colours
+	TEST_CHECK(gs1_encoder_setPixMult(ctx, 1));
+	TEST_CHECK(gs1_encoder_setPreviewScale(ctx, 1));
+	TEST_CHECK(gs1_encoder_setPreviewDarkColour(ctx, 0x102030FF));
+	TEST_CHECK(gs1_encoder_setPreviewLightColour(ctx, 0xFFFFFF00));
+	TEST_CHECK(gs1_encoder_setFormat(ctx, gs1_encoder_dRGBA));
+	TEST_ASSERT(gs1_encoder_encode(ctx));
+	TEST_ASSERT(gs1_encoder_getBuffer(ctx, &buf) == (size_t)(4 * w * h));
+	px = buf;
+	TEST_CHECK(memcmp(px, "\xFF\xFF\xFF\x00", 4) == 0);	// Quiet zone
+	for (i = 0; i < w * h && px[4 * i + 3] == 0; i++);
+	TEST_ASSERT(i < w * h);
+	TEST_CHECK(memcmp(&px[4 * i], "\x10\x20\x30\xFF", 4) == 0);
+
+	gs1_encoder_free(ctx);
+
+}
+
+
+void test_api_symbolCache(void) {
+
+#ifndef _WIN32
+
+	gs1_encoder *ctx, *ctx2;
+	const char *fname = "gs1encoders-test-symbol.cache";
+	uint8_t *ref, digest[MAX_DIGEST_LEN];
+	void *buf;
+	size_t size;
+	FILE *fp;
+
+	remove(fname);
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+	TEST_ASSERT((ctx2 = gs1_encoder_init(NULL)) != NULL);
+
+	TEST_CHECK(!gs1_encoder_closeCache(ctx));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "No cache is open") == 0);
+
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sQR));
+	TEST_CHECK(gs1_encoder_setDataStr(ctx, "https://id.gs1.org/01/12312312312333"));
+	TEST_CHECK(gs1_encoder_setFormat(ctx, gs1_encoder_dRAW));
+	TEST_CHECK(gs1_encoder_setOutFile(ctx, ""));
+	TEST_CHECK(gs1_encoder_setOutputDigestAlg(ctx, gs1_encoder_digestSHA256));
+
+	TEST_ASSERT(gs1_encoder_openCache(ctx, fname, 1 << 20));
+
+	// Miss renders and stores the symbol
+	TEST_ASSERT(gs1_encoder_encode(ctx));
+	TEST_CHECK(!gs1_encoder_getCacheHit(ctx));
+	TEST_ASSERT((size = gs1_encoder_getBuffer(ctx, &buf)) > 0);
+	TEST_ASSERT((ref = malloc(size)) != NULL);
+	memcpy(ref, buf, size);
+	TEST_CHECK(gs1_encoder_getOutputDigest(ctx, &buf) == 32);
+	memcpy(digest, buf, 32);
+
+	// Hit returns the same output, including its digest
+	TEST_ASSERT(gs1_encoder_encode(ctx));
+	TEST_CHECK(gs1_encoder_getCacheHit(ctx));
+	TEST_CHECK(gs1_encoder_getBuffer(ctx, &buf) == size);
+	TEST_CHECK(memcmp(buf, ref, size) == 0);
+	TEST_CHECK(gs1_encoder_getBufferWidth(ctx) > 0);
+	TEST_CHECK(gs1_encoder_getOutputDigest(ctx, &buf) == 32);
+	TEST_CHECK(memcmp(buf, digest, 32) == 0);
+
+	// Shared with other users of the same file
+	TEST_CHECK(gs1_encoder_setSym(ctx2, gs1_encoder_sQR));
+	TEST_CHECK(gs1_encoder_setDataStr(ctx2, "https://id.gs1.org/01/12312312312333"));
+	TEST_CHECK(gs1_encoder_setFormat(ctx2, gs1_encoder_dRAW));
+	TEST_CHECK(gs1_encoder_setOutFile(ctx2, ""));
+	TEST_ASSERT(gs1_encoder_openCache(ctx2, fname, 0));
+	TEST_ASSERT(gs1_encoder_encode(ctx2));
+	TEST_CHECK(gs1_encoder_getCacheHit(ctx2));
+	TEST_CHECK(gs1_encoder_getBuffer(ctx2, &buf) == size);
+	TEST_CHECK(memcmp(buf, ref, size) == 0);
+
+	// Any change of setting is a different symbol
+	TEST_CHECK(gs1_encoder_setPixMult(ctx2, 2));
+	TEST_ASSERT(gs1_encoder_encode(ctx2));
+	TEST_CHECK(!gs1_encoder_getCacheHit(ctx2));
+	TEST_CHECK(gs1_encoder_getBuffer(ctx2, &buf) > size);
+
+	// Not consulted for file output
+	TEST_CHECK(gs1_encoder_setOutFile(ctx, "gs1encoders-test-symbol.raw"));
+	TEST_ASSERT(gs1_encoder_encode(ctx));
+	TEST_CHECK(!gs1_encoder_getCacheHit(ctx));
+	remove("gs1encoders-test-symbol.raw");
+	TEST_CHECK(gs1_encoder_setOutFile(ctx, ""));
+
+	// Closing releases a mapped buffer
+	TEST_ASSERT(gs1_encoder_encode(ctx));
+	TEST_CHECK(gs1_encoder_getCacheHit(ctx));
+	TEST_CHECK(gs1_encoder_closeCache(ctx));
+	TEST_CHECK(gs1_encoder_getBuffer(ctx, &buf) == 0);
+	TEST_CHECK(!gs1_encoder_getCacheHit(ctx));
+	TEST_ASSERT(gs1_encoder_encode(ctx));
+	TEST_CHECK(!gs1_encoder_getCacheHit(ctx));
+	TEST_CHECK(gs1_encoder_getBuffer(ctx, &buf) == size);
+
+	free(ref);
+	gs1_encoder_free(ctx2);		// While holding a mapped buffer
+	remove(fname);
+
+	// Other files are not used
+	TEST_ASSERT((fp = fopen(fname, "w")) != NULL);
+	fputs("Not a cache", fp);
+	fclose(fp);
+	TEST_CHECK(!gs1_encoder_openCache(ctx, fname, 1 << 20));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "Not a symbol cache file") == 0);
+	remove(fname);
+
+	gs1_encoder_free(ctx);
+
+#endif
+
+}
+
+
+void test_api_asyncOutput(void) {
+
+	gs1_encoder* ctx;
+	const char *fname = "gs1encoders-test-async.tif";
+	uint8_t *ref;
+	size_t size;
+	void *buf;
+	FILE *fp;
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+
+	TEST_CHECK(gs1_encoder_getAsyncBackend(ctx) == gs1_encoder_asyncNONE);
+	TEST_CHECK(!gs1_encoder_closeAsyncOutput(ctx));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "No asynchronous output is open") == 0);
+	TEST_CHECK(!gs1_encoder_openAsyncOutput(ctx, 0));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "Valid asynchronous output depth is 1 to 256") == 0);
+	TEST_CHECK(!gs1_encoder_openAsyncOutput(ctx, 257));
+
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sDM));
+	TEST_CHECK(gs1_encoder_setDataStr(ctx, "^011231231231233310ABC123"));
+	TEST_CHECK(gs1_encoder_setFormat(ctx, gs1_encoder_dTIF));
+	TEST_CHECK(gs1_encoder_setOutFile(ctx, ""));
+	TEST_ASSERT(gs1_encoder_encode(ctx));
+	TEST_ASSERT((size = gs1_encoder_getBuffer(ctx, &buf)) > 0);
+	TEST_ASSERT((ref = malloc(size)) != NULL);
+	memcpy(ref, buf, size);
+
+	TEST_ASSERT(gs1_encoder_openAsyncOutput(ctx, 8));
+	TEST_CHECK(gs1_encoder_getAsyncBackend(ctx) != gs1_encoder_asyncNONE);
+	TEST_CHECK(!gs1_encoder_openAsyncOutput(ctx, 8));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "Asynchronous output is already open") == 0);
+
+	TEST_CHECK(gs1_encoder_setOutFile(ctx, fname));
+	TEST_CHECK(gs1_encoder_encode(ctx));
+
+	TEST_CHECK(gs1_encoder_closeAsyncOutput(ctx));
+	TEST_CHECK(gs1_encoder_getAsyncBackend(ctx) == gs1_encoder_asyncNONE);
+
+	TEST_ASSERT((fp = fopen(fname, "rb")) != NULL);
+	TEST_ASSERT((buf = malloc(size + 1)) != NULL);
+	TEST_CHECK(fread(buf, 1, size + 1, fp) == size);
+	TEST_CHECK(memcmp(buf, ref, size) == 0);
+	fclose(fp);
+	free(buf);
+	free(ref);
+	remove(fname);
+
+	// Closed on free
+	TEST_ASSERT(gs1_encoder_openAsyncOutput(ctx, 1));
+	TEST_CHECK(gs1_encoder_setDataStr(ctx, "^011231231231233310ABC123"));
+	TEST_CHECK(gs1_encoder_setOutFile(ctx, fname));
+	TEST_CHECK(gs1_encoder_encode(ctx));
+	gs1_encoder_free(ctx);
+	TEST_ASSERT((fp = fopen(fname, "rb")) != NULL);
+	fclose(fp);
+	remove(fname);
+
+}
+
+
+void test_api_encodeQueue(void) {
+
+	gs1_encoder* ctx;
+	gs1_encoder_request req = { 0 };
+	gs1_encoder_completion done[2];
+	int n = 0;
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+
+	TEST_CHECK(gs1_encoder_getEncodeQueueFd(ctx) == -1);
+	TEST_CHECK(!gs1_encoder_closeEncodeQueue(ctx));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "No encode queue is open") == 0);
+	TEST_CHECK(!gs1_encoder_submitEncode(ctx, &req, 0));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "No encode queue is open") == 0);
+
+#if !defined(NOMALLOC) && !defined(_WIN32)
+
+	TEST_CHECK(!gs1_encoder_openEncodeQueue(ctx, 0, 8));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "Valid encode queue threads is 1 to 64") == 0);
+	TEST_CHECK(!gs1_encoder_openEncodeQueue(ctx, 1, 0));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "Valid encode queue depth is 1 to 1024") == 0);
+	TEST_CHECK(!gs1_encoder_openEncodeQueue(ctx, 1, 1025));
+
+	TEST_ASSERT(gs1_encoder_openEncodeQueue(ctx, 1, 2));
+	TEST_CHECK(gs1_encoder_getEncodeQueueFd(ctx) >= 0);
+	TEST_CHECK(!gs1_encoder_openEncodeQueue(ctx, 1, 2));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "Encode queue is already open") == 0);
+
+	req.sym = gs1_encoder_sDM;
+	req.format = gs1_encoder_dRAW;
+	req.dataStr = "^011231231231233310ABC123";
+	TEST_CHECK(!gs1_encoder_submitEncode(ctx, &req, 42));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "Request size is not recognised") == 0);
+	req.size = sizeof(req);
+	TEST_CHECK(gs1_encoder_submitEncode(ctx, &req, 42));
+
+	while (n == 0)
+		n = gs1_encoder_harvestEncodes(ctx, done, 2);
+	TEST_CHECK(n == 1);
+	TEST_CHECK(done[0].tag == 42);
+	TEST_CHECK(done[0].result.status);
+	TEST_CHECK(done[0].result.width == 20 && done[0].result.height == 20);
+	TEST_CHECK(done[0].result.numHRI == 2);
+	TEST_CHECK(strcmp(done[0].result.hri, "(01) 12312312312333") == 0);
+	TEST_CHECK(done[0].result.digest == NULL);
+
+	// Workers honour the settings carried by the request
+	req.renderHRI = 1;
+	req.pixMult = 8;
+	req.outputDigestAlg = gs1_encoder_digestXXH64;
+	TEST_CHECK(gs1_encoder_submitEncode(ctx, &req, 43));
+	n = 0;
+	while (n == 0)
+		n = gs1_encoder_harvestEncodes(ctx, done, 2);
+	TEST_CHECK(n == 1);
+	TEST_CHECK(done[0].result.status);
+	TEST_CHECK(done[0].result.width == 160 && done[0].result.height > 160);
+	TEST_CHECK(done[0].result.digest != NULL && done[0].result.digestSize == 8);
+	req.renderHRI = 0;
+	req.pixMult = 0;
+	req.outputDigestAlg = gs1_encoder_digestNONE;
+
+	TEST_CHECK(gs1_encoder_closeEncodeQueue(ctx));
+	TEST_CHECK(gs1_encoder_getEncodeQueueFd(ctx) == -1);
+
+	// Closed on free
+	TEST_ASSERT(gs1_encoder_openEncodeQueue(ctx, 2, 2));
+	TEST_CHECK(gs1_encoder_submitEncode(ctx, &req, 1));
+
+#else
+
+	TEST_CHECK(!gs1_encoder_openEncodeQueue(ctx, 1, 2));
+	(void)done;
+	(void)n;
+
+#endif
+
+	gs1_encoder_free(ctx);
+
+}
+
+
+void test_api_serialGuard(void) {
+
+	gs1_encoder* ctx;
+	gs1_encoder_request req;
+	gs1_encoder_completion done[3];
+	int n = 0, i, ok = 0;
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+
+	TEST_CHECK(!gs1_encoder_closeSerialGuard(ctx));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "No serial guard is open") == 0);
+	TEST_CHECK(gs1_encoder_getSerialGuardCount(ctx) == 0);
+
+	TEST_ASSERT(gs1_encoder_openSerialGuard(ctx, NULL, 1000));
+	TEST_CHECK(!gs1_encoder_openSerialGuard(ctx, NULL, 1000));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "A serial guard is already open") == 0);
+
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sDM));
+	TEST_CHECK(gs1_encoder_setOutFile(ctx, ""));
+	TEST_CHECK(gs1_encoder_setDataStr(ctx, "^011231231231233321SERIAL1"));
+	TEST_CHECK(gs1_encoder_encode(ctx));
+	TEST_CHECK(!gs1_encoder_encode(ctx));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "Duplicate GTIN and serial number: (01)12312312312333 (21)SERIAL1") == 0);
+	TEST_MSG("Got: %s", gs1_encoder_getErrMsg(ctx));
+	TEST_CHECK(gs1_encoder_getBufferSize(ctx) == 0);
+
+	// Bracketed AIs and Digital Link URIs are keyed the same
+	TEST_CHECK(gs1_encoder_setAIdataStr(ctx, "(01)12312312312333(21)SERIAL1"));
+	TEST_CHECK(!gs1_encoder_encode(ctx));
+	TEST_CHECK(gs1_encoder_setDataStr(ctx, "https://id.gs1.org/01/12312312312333/21/SERIAL1"));
+	TEST_CHECK(!gs1_encoder_encode(ctx));
+
+	// A symbol that fails does not use up its serial
+	TEST_CHECK(gs1_encoder_setDataStr(ctx, "^011231231231233321SERIAL2"));
+	TEST_CHECK(gs1_encoder_setDmRows(ctx, 10));
+	TEST_CHECK(gs1_encoder_setDmColumns(ctx, 10));
+	TEST_CHECK(!gs1_encoder_encode(ctx));
+	TEST_CHECK(gs1_encoder_setDmRows(ctx, 0));
+	TEST_CHECK(gs1_encoder_setDmColumns(ctx, 0));
+	TEST_CHECK(gs1_encoder_encode(ctx));
+	TEST_CHECK(gs1_encoder_getSerialGuardCount(ctx) == 2);
+
+	// Only symbols carrying both a GTIN and a serial are checked
+	TEST_CHECK(gs1_encoder_setDataStr(ctx, "^011231231231233310BATCH"));
+	TEST_CHECK(gs1_encoder_encode(ctx));
+	TEST_CHECK(gs1_encoder_encode(ctx));
+	TEST_CHECK(gs1_encoder_getSerialGuardCount(ctx) == 2);
+
+#if !defined(NOMALLOC) && !defined(_WIN32)
+
+	// Requests submitted to the encode queue are checked against the same set
+	TEST_ASSERT(gs1_encoder_openEncodeQueue(ctx, 2, 4));
+	memset(&req, 0, sizeof(req));
+	req.size = sizeof(req);
+	req.sym = gs1_encoder_sDM;
+	req.format = gs1_encoder_dRAW;
+	req.dataStr = "^011231231231233321SERIAL1";
+	TEST_CHECK(gs1_encoder_submitEncode(ctx, &req, 1));
+	req.dataStr = "^011231231231233321SERIAL3";
+	TEST_CHECK(gs1_encoder_submitEncode(ctx, &req, 2));
+	TEST_CHECK(gs1_encoder_submitEncode(ctx, &req, 3));
+	while (n < 3)
+		n += gs1_encoder_harvestEncodes(ctx, &done[n], 3 - n);
+	for (i = 0; i < 3; i++) {
+		if (done[i].result.status)
+			ok++;
+		else
+			TEST_CHECK(strncmp(done[i].result.errMsg, "Duplicate GTIN and serial number", 32) == 0);
+		if (done[i].tag == 1)
+			TEST_CHECK(!done[i].result.status);
+	}
+	TEST_CHECK(ok == 1);
+	TEST_CHECK(gs1_encoder_getSerialGuardCount(ctx) == 3);
+
+	// ... as are direct encodes while the queue is open
+	TEST_CHECK(gs1_encoder_setDataStr(ctx, "^011231231231233321SERIAL3"));
+	TEST_CHECK(!gs1_encoder_encode(ctx));
+	TEST_CHECK(gs1_encoder_closeEncodeQueue(ctx));
+
+#else
+
+	(void)req;
+	(void)done;
+	(void)n;
+	(void)i;
+	(void)ok;
+
+#endif
+
+	TEST_CHECK(gs1_encoder_closeSerialGuard(ctx));
+	TEST_CHECK(gs1_encoder_setDataStr(ctx, "^011231231231233321SERIAL1"));
+	TEST_CHECK(gs1_encoder_encode(ctx));
+
+	gs1_encoder_free(ctx);
+
+}
+
+
 void test_api_copyOutputBuffer(void) {
 
 	gs1_encoder* ctx;
@@ -37,9 +37,11 @@
  *   * GS1 DataBar family
  *   * GS1-128
  *   * UPC and EAN
+ *   * ITF-14
  *   * 2D Composite Components are supported for each of the above.
  *   * Data Matrix
  *   * QR Code
+ *   * Rectangular Micro QR Code (rMQR)
  *
  * The encoder implementations are intended for use with GS1 standards and
  * applications and do not contain additional features that might be required
@@ -208,6 +210,7 @@
 /// \cond
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
@@ -247,6 +250,8 @@ enum gs1_encoder_symbologies {
 	gs1_encoder_sGS1_128_CCC,		///< GS1-128 with CC-C
 	gs1_encoder_sQR,			///< (GS1) QR Code
 	gs1_encoder_sDM,			///< (GS1) Data Matrix
+	gs1_encoder_sRMQR,			///< (GS1) Rectangular Micro QR Code (rMQR)
+	gs1_encoder_sITF14,			///< ITF-14
 	gs1_encoder_sNUMSYMS,			///< Value is the number of symbologies
 };
 
@@ -257,6 +262,52 @@ enum gs1_encoder_formats {
 	gs1_encoder_dBMP = 0,			///< BMP format
 	gs1_encoder_dTIF = 1,			///< TIFF format
 	gs1_encoder_dRAW = 2,			///< TIFF, without header (1-bit per pixel matrix with byte-aligned rows)
+	gs1_encoder_dPATH = 3,			///< Marking path for Data Matrix and QR Code (text list of dots or strokes)
+	gs1_encoder_dGRAY = 4,			///< Preview, without header (8-bit grey per pixel matrix at a fractional scale)
+	gs1_encoder_dRGBA = 5,			///< Preview, without header (32-bit RGBA per pixel matrix at a fractional scale)
+};
+
+
+/// Marking path output can mark each dark module individually or merge
+/// adjacent dark modules into strokes.
+enum gs1_encoder_pathModes {
+	gs1_encoder_pathDOTS = 0,		///< A dot per dark module, in serpentine order
+	gs1_encoder_pathSTROKES = 1,		///< Horizontal and vertical strokes covering runs of dark modules
+};
+
+
+/// A digest of the output can be computed as the image is written.
+enum gs1_encoder_digests {
+	gs1_encoder_digestNONE = 0,		///< No digest is computed
+	gs1_encoder_digestXXH64 = 1,		///< XXH64 (8 bytes), suitable for deduplication
+	gs1_encoder_digestSHA256 = 2,		///< SHA-256 (32 bytes), suitable for audit
+};
+
+
+/// Classes of fault for each value validated by gs1_encoder_validateAIcolumn().
+enum gs1_encoder_columnFaults {
+	gs1_encoder_colOK = 0,			///< Value is valid
+	gs1_encoder_colEMPTY = 1,		///< Value is empty
+	gs1_encoder_colLENGTH = 2,		///< Value is too short or too long for the AI
+	gs1_encoder_colCHARSET = 3,		///< Value contains a character that the AI does not permit
+	gs1_encoder_colCHECKDIGIT = 4,		///< Value has an incorrect check digit
+	gs1_encoder_colCONTENT = 5,		///< Value breaks another rule of the AI
+};
+
+
+/// Files can be written asynchronously by one of several mechanisms.
+enum gs1_encoder_asyncBackends {
+	gs1_encoder_asyncNONE = 0,		///< No asynchronous output is open; when opening, the best available
+	gs1_encoder_asyncIOURING = 1,		///< Linux io_uring
+	gs1_encoder_asyncTHREADS = 2,		///< A pool of writer threads
+	gs1_encoder_asyncSYNC = 3,		///< Written synchronously from a buffer, where neither is available
+};
+
+
+/// Units in which gs1_encoder_getCapacity() reports the size of the data.
+enum gs1_encoder_capacityUnits {
+	gs1_encoder_capBITS = 0,		///< Bits of the encoded data
+	gs1_encoder_capSYMCHARS = 1,		///< Symbol characters, including start, check and stop
 };
 
 
@@ -411,6 +462,135 @@ enum gs1_encoder_qrVersion {
 typedef struct gs1_encoder gs1_encoder;
 
 
+/**
+ * @brief Settings and input data for a single call to gs1_encoder_encodeRequest().
+ *
+ * Every setting is applied on each call. A zero value selects the library
+ * default for those settings that do not otherwise accept zero.
+ *
+ * The size member must be set to sizeof(gs1_encoder_request). Members are
+ * only ever added to the end of the struct, so members beyond those known to
+ * a caller built against an earlier release take their defaults.
+ *
+ * Flag members are int rather than bool so that the layout of the struct is
+ * straightforward to reproduce in foreign function interfaces.
+ *
+ * @see gs1_encoder_encodeRequest()
+ */
+typedef struct gs1_encoder_request {
+	size_t size;				///< sizeof(gs1_encoder_request)
+	int sym;				///< Symbology, one of ::gs1_encoder_symbologies
+	int format;				///< Output format, one of ::gs1_encoder_formats
+	int pixMult;				///< Device dots per module, or 0 for 1
+	int Xundercut;				///< X undercut in pixels
+	int Yundercut;				///< Y undercut in pixels
+	int sepHt;				///< Separator height, or 0 to match pixMult
+	int dataBarExpandedSegmentsWidth;	///< Segments per row, or 0 for 22
+	int gs1_128LinearHeight;		///< GS1-128 height in modules, or 0 for 25
+	int dmRows;				///< Data Matrix rows, or 0 for automatic
+	int dmColumns;				///< Data Matrix columns, or 0 for automatic
+	int qrVersion;				///< QR Code version, or 0 for automatic
+	int qrEClevel;				///< QR Code error correction level, or 0 for M
+	int addCheckDigit;			///< Non-zero to calculate rather than validate check digits
+	int permitUnknownAIs;			///< Non-zero to accept AIs that are not in the AI table
+	int aiSyntax;				///< Non-zero if dataStr is bracketed AI syntax, otherwise raw data as for gs1_encoder_setDataStr()
+	const char *dataStr;			///< Barcode input data
+	const char *outFile;			///< Output filename, or NULL or "" for buffer output
+	int renderHRI;				///< Non-zero to render the HRI text beneath the symbol
+	int pathMode;				///< Marking path mode, one of ::gs1_encoder_pathModes
+	int pathOptimise;			///< Non-zero to reorder the marking path to reduce travel
+	double previewScale;			///< Preview pixels per device dot, or 0 for 1
+	uint32_t previewDarkColour;		///< Preview dark colour as 0xRRGGBBAA, or 0 for opaque black
+	uint32_t previewLightColour;		///< Preview light colour as 0xRRGGBBAA, or 0 for opaque white
+	int outputDigestAlg;			///< Digest of the output, one of ::gs1_encoder_digests
+	int rasterThreads;			///< Threads rasterising a large image, or 0 for 1
+} gs1_encoder_request;
+
+
+/**
+ * @brief Outcome of a call to gs1_encoder_encodeRequest().
+ *
+ * All pointers reference storage owned by the ::gs1_encoder instance and
+ * remain valid until the next library call that modifies the input data or
+ * regenerates the output.
+ *
+ * @see gs1_encoder_encodeRequest()
+ */
+typedef struct gs1_encoder_result {
+	int status;				///< Non-zero on success
+	int width;				///< Width of the buffer image in pixels
+	int height;				///< Height of the buffer image in pixels
+	int numHRI;				///< Number of HRI strings
+	const void *buffer;			///< Output buffer, or NULL when writing to a file
+	size_t bufferSize;			///< Length of the output buffer
+	const char *hri;			///< HRI strings, stored consecutively and each terminated by NUL
+	const int *hriOffsets;			///< Offset of each of the numHRI strings within hri
+	const char *errMsg;			///< Error message, empty on success
+	const void *digest;			///< Digest of the output, or NULL when none was requested
+	size_t digestSize;			///< Length of the digest
+} gs1_encoder_result;
+
+
+/**
+ * @brief A request submitted to the encode queue, once it is complete.
+ *
+ * @see gs1_encoder_harvestEncodes()
+ */
+typedef struct gs1_encoder_completion {
+	uint64_t tag;				///< Value given to gs1_encoder_submitEncode()
+	gs1_encoder_result result;		///< Outcome, as for gs1_encoder_encodeRequest()
+} gs1_encoder_completion;
+
+
+/**
+ * @brief Size of the symbol that the input data requires.
+ *
+ * Where the data does not fit, the largest size that the settings permit is
+ * described.
+ *
+ * @see gs1_encoder_getCapacity()
+ */
+typedef struct gs1_encoder_capacity {
+	int units;				///< Units of used and capacity, one of ::gs1_encoder_capacityUnits
+	int used;				///< Consumed by the data, excluding any padding
+	int capacity;				///< Available in the selected size
+	int rows;				///< Rows of the selected size, see gs1_encoder_getCapacity()
+	int columns;				///< Columns of the selected size, see gs1_encoder_getCapacity()
+	int fits;				///< Non-zero if the data fits
+} gs1_encoder_capacity;
+
+
+/**
+ * @brief Reference to an AI and its value within the input data.
+ *
+ * The strings are not NUL-terminated.
+ *
+ * @see gs1_encoder_getAIrecord()
+ */
+typedef struct gs1_encoder_aiField {
+	const char *ai;				///< AI, or NULL if the field is absent
+	int aiLen;				///< Length of the AI
+	const char *value;			///< Value of the AI
+	int valueLen;				///< Length of the value
+} gs1_encoder_aiField;
+
+
+/**
+ * @brief The AIs of the input data as a record with fixed fields for the
+ * commonest AIs.
+ *
+ * @see gs1_encoder_getAIrecord()
+ */
+typedef struct gs1_encoder_aiRecord {
+	gs1_encoder_aiField gtin;		///< (01) GTIN
+	gs1_encoder_aiField batch;		///< (10) BATCH/LOT
+	gs1_encoder_aiField expiry;		///< (17) USE BY or EXPIRY
+	gs1_encoder_aiField serial;		///< (21) SERIAL
+	int numOther;				///< Number of other AIs
+	gs1_encoder_aiField other[64];		///< Other AIs, including repeats of the above, in the order of the input data
+} gs1_encoder_aiRecord;
+
+
 /**
  * @brief Get the version string of the library.
  *
@@ -500,8 +680,8 @@ GS1_ENCODERS_API int gs1_encoder_getMaxDataStrLength(void);
 /**
  * @brief Get the maximum X-dimension in pixels
  *
- * This is an implementation limit that may be lowered for systems with limited
- * memory by rebuilding the library.
+ * This is an implementation limit of 100 that may be lowered for systems with
+ * limited memory by rebuilding the library with -DMAX_PIXMULT=n.
  *
  * @see gs1_encoder_setPixMult()
  * @see gs1_encoder_getPixMult()
@@ -533,6 +713,18 @@ GS1_ENCODERS_API int gs1_encoder_getMaxGS1_128LinearHeight(void);
  * returned by gs1_encoder_instanceSize() and this buffer should not be reused
  * or freed until gs1_encoder_free() is called.
  *
+ * When the library is built with NOMALLOC defined it makes no use of the heap:
+ * storage must be provided, and all working buffers are carved from fixed
+ * arenas within the instance that are sized at compile time for the enabled
+ * symbologies and for the maximum X dimension, as returned by
+ * gs1_encoder_getMaxPixMult(). The arenas grow with the square of the X
+ * dimension, so the default limit of 100 requires an instance of about
+ * 38 GB. A NOMALLOC build should therefore set the limit that it needs with
+ * -DMAX_PIXMULT=n, which gives an instance of about 4.5 MB for 1, 16 MB for
+ * 2, 62 MB for 4 and 383 MB for 10, when all symbologies are enabled.
+ * Excluding the symbologies and composite components that are not needed
+ * further reduces the size of the instance.
+ *
  * @see gs1_encoder_instanceSize()
  *
  * @param [in,out] mem buffer to use for storage, or NULL for automatic allocation
@@ -576,6 +768,9 @@ GS1_ENCODERS_API int gs1_encoder_getSym(gs1_encoder *ctx);
  * This allows the symbology to be specified as any one of the known
  * ::gs1_encoder_symbologies other than ::gs1_encoder_sNONE or ::gs1_encoder_sNUMSYMS.
  *
+ * A library built with support for some symbologies excluded (for example
+ * using EXCLUDE_QR=yes) rejects those symbologies.
+ *
  * @see ::gs1_encoder_symbologies
  * @see gs1_encoder_getSym()
  *
@@ -1068,6 +1263,9 @@ GS1_ENCODERS_API int gs1_encoder_getQrEClevel(gs1_encoder *ctx);
  * This determines what proportion of a symbols data can be reliably
  * reconstructed if it is damaged.
  *
+ * The level also applies to rMQR symbols, which support only levels M and H:
+ * level L is encoded as M and level Q is encoded as H.
+ *
  * Default is ::gs1_encoder_qrEClevelM
  *
  * @see ::gs1_encoder_qrEClevel
@@ -1373,6 +1571,154 @@ GS1_ENCODERS_API bool gs1_encoder_setAIdataStr(gs1_encoder *ctx, const char *dat
 GS1_ENCODERS_API char* gs1_encoder_getAIdataStr(gs1_encoder *ctx);
 
 
+/**
+ * @brief Return the AIs of the input data as a compact JSON object.
+ *
+ * The object is keyed by AI with string values, in the order of the input
+ * data. For example, if the input data buffer were to contain:
+ *
+ *     ^011231231231233310ABC123|^99XYZ(TM)_CORP
+ *
+ * Then this function would return:
+ *
+ *     {"01":"12312312312333","10":"ABC123","99":"XYZ(TM)_CORP"}
+ *
+ * An AI that occurs more than once appears once, at the position of its first
+ * occurrence, with an array of its values in input order, for example
+ * {"21":["S1","S2"]}.
+ *
+ * The object is written directly from the AIs extracted when the input data
+ * was processed, without forming the HRI text.
+ *
+ * \note
+ * The return data does not need to be free()ed and the content should be
+ * copied if it must persist in user code after subsequent calls to library
+ * functions that modify the input data buffer or return HRI.
+ *
+ * @see gs1_encoder_getAIrecord()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @return a pointer to the JSON object, or a null pointer if the input data does not contain AI data
+ */
+GS1_ENCODERS_API char* gs1_encoder_getAIdataJSON(gs1_encoder *ctx);
+
+
+/**
+ * @brief Set the input data to a GS1 Digital Link URI and return its
+ * canonical element string and canonical URI.
+ *
+ * The URI is parsed and validated as by gs1_encoder_setDataStr(), after
+ * which it remains the input data. Equivalent URIs, which may differ by
+ * scheme or its case, domain, path stem, the placement and order of AIs, and
+ * percent-encoding, all give the same canonical forms.
+ *
+ * In both canonical forms the primary key comes first, followed by those of
+ * its key qualifiers that are present, in their required order, then all
+ * other AIs in AI order. The canonical URI uses the https://id.gs1.org stem,
+ * places the key and its qualifiers in the path info and all other AIs in
+ * the query parameters, and percent-encodes, in upper case, every character
+ * that is not unreserved. The element string is unbracketed, with "^"
+ * representing FNC1, as accepted by gs1_encoder_setDataStr().
+ *
+ * An AI that is repeated with the same value, in the path info or the query
+ * parameters, appears once in the canonical forms. An AI that is repeated
+ * with differing values has no canonical form and is an error.
+ *
+ * AI data, rather than a URI, is also accepted provided that it contains a
+ * GS1 Digital Link primary key.
+ *
+ * For example, the URI:
+ *
+ *     http://example.com/01/9520123456788/21/A%2fB?99=XYZ&10=L1
+ *
+ * Gives the element string and URI:
+ *
+ *     ^010952012345678810L1^21A/B^99XYZ
+ *     https://id.gs1.org/01/09520123456788/10/L1/21/A%2FB?99=XYZ
+ *
+ * \note
+ * This replaces any input data previously set on the context, exactly as a
+ * call to gs1_encoder_setDataStr() would, including clearing it if the URI
+ * fails validation. Use a separate ::gs1_encoder instance to normalise
+ * URIs without disturbing the data being encoded.
+ *
+ * \note
+ * The returned strings do not need to be free()ed and should be copied if
+ * they must persist in user code after subsequent calls to library functions
+ * that modify the input data buffer or return HRI.
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [in] uri the Digital Link URI
+ * @param [out] elementString pointer to the canonical element string
+ * @param [out] canonicalURI pointer to the canonical URI
+ * @return true on success, otherwise false and an error message is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_normaliseDLuri(gs1_encoder *ctx, const char *uri, char **elementString, char **canonicalURI);
+
+
+/**
+ * @brief Return the AIs of the input data as a record.
+ *
+ * GTIN (01), BATCH/LOT (10), USE BY or EXPIRY (17) and SERIAL (21) are placed
+ * in fixed fields and all other AIs follow in the order of the input data.
+ * The fields reference the input data buffer without copying, so remain
+ * valid until the input data is next modified.
+ *
+ * @see gs1_encoder_getAIdataJSON()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [out] record the record to populate
+ * @return the number of AIs, 0 if the input data does not contain AI data
+ */
+GS1_ENCODERS_API int gs1_encoder_getAIrecord(gs1_encoder *ctx, gs1_encoder_aiRecord *record);
+
+
+/**
+ * @brief Validate a column of values for a single AI, such as extracted from
+ * a database, without setting the input data buffer for each value.
+ *
+ * The values are held back-to-back in an arena with an array of count+1
+ * offsets, as in the Apache Arrow string layout: value i is
+ * data[offsets[i]] up to, but excluding, data[offsets[i+1]]. The values are
+ * not NUL-terminated.
+ *
+ * Each value is validated exactly as the value of the AI within an element
+ * string. Fixed-length numeric AIs with a check digit, such as GTIN (01) and
+ * SSCC (00), are validated eight digits at a time.
+ *
+ * The validity of each value is written to a bitmap of (count+7)/8 bytes,
+ * least-significant bit first, with a set bit indicating that the value is
+ * valid. If faults is not NULL then the class of fault for each value is
+ * written to it, as a ::gs1_encoder_columnFaults value.
+ *
+ * When some value is invalid the error message describes the number of
+ * invalid values and the fault with the first of them. Invalid values are
+ * not an error in the arguments, so the bitmap is always complete unless -1
+ * is returned.
+ *
+ * Example:
+ *
+ * \code
+ * const char *data = "123123123123331231231231233410012345000017";
+ * int32_t offsets[] = { 0, 14, 28, 42 };
+ * uint8_t validity[1];
+ *
+ * long invalid = gs1_encoder_validateAIcolumn(ctx, "01", data, offsets, 3, validity, NULL);
+ * // invalid == 1 and validity[0] == 0x05, i.e. values 0 and 2 are valid
+ * \endcode
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [in] ai the AI of the values in the column, for example "01"
+ * @param [in] data arena holding the values
+ * @param [in] offsets count+1 offsets of the values within the arena
+ * @param [in] count number of values
+ * @param [out] validity bitmap receiving the validity of each value
+ * @param [out] faults optional array of count bytes receiving the fault with each value
+ * @return number of invalid values, or -1 if the AI or offsets are invalid and an error message is set
+ */
+GS1_ENCODERS_API long gs1_encoder_validateAIcolumn(gs1_encoder *ctx, const char *ai, const char *data, const int32_t *offsets, size_t count, uint8_t *validity, uint8_t *faults);
+
+
 /**
  * @brief Process scan data received from a barcode reader with reporting of
  * AIM symbology identifiers enabled to extract the message data and perform
@@ -1443,6 +1789,7 @@ GS1_ENCODERS_API bool gs1_encoder_setScanData(gs1_encoder* ctx, const char *scan
  * ::gs1_encoder_sUPCA        | 416000336108                                   | ]E00416000336108
  * ::gs1_encoder_sEAN8        | 02345673                                       | ]E402345673
  * ::gs1_encoder_sEAN8        | 02345673\|^99COMPOSITE^98XYZ                   | ]E402345673\|]e099COMPOSITE{GS}98XYZ
+ * ::gs1_encoder_sITF14       | 15012345678907                                 | ]I115012345678907
  * ::gs1_encoder_sGS1_128_CCA | ^011231231231233310ABC123^99TESTING            | ]C1011231231231233310ABC123{GS}99TESTING
  * ::gs1_encoder_sGS1_128_CCA | ^0112312312312333\|^98COMPOSITE^97XYZ          | ]e00112312312312333{GS}98COMPOSITE{GS}97XYZ
  * ::gs1_encoder_sQR          | https://example.org/01/12312312312333          | ]Q1https://example.org/01/12312312312333
@@ -1615,7 +1962,36 @@ GS1_ENCODERS_API int gs1_encoder_getFormat(gs1_encoder *ctx);
  *   * ::gs1_encoder_dBMP: BMP format
  *   * ::gs1_encoder_dTIF: TIFF format
  *   * ::gs1_encoder_dRAW: TIFF format, without the header
+ *   * ::gs1_encoder_dPATH: Marking path, for Data Matrix and QR Code only
+ *   * ::gs1_encoder_dGRAY: 8-bit grey preview, without a header
+ *   * ::gs1_encoder_dRGBA: 32-bit RGBA preview, without a header
  *
+ * The marking path format is a text list of the marks needed to produce the
+ * dark modules of the symbol, ordered to minimise travel of the marking head
+ * between marks. Each line is one of:
+ *
+ * \code
+ * D x y           // A dot at module (x,y)
+ * S x1 y1 x2 y2   // A stroke from module (x1,y1) to module (x2,y2)
+ * \endcode
+ *
+ * Coordinates are in modules, with the origin at the top-left corner of the
+ * quiet zone. Preceding comment lines beginning "#" give the matrix size, the
+ * number of marks and the total travel, measured as the larger of the X and
+ * Y movement between marks.
+ *
+ * The preview formats are intended for on-screen display at an arbitrary
+ * zoom. The image is scaled by gs1_encoder_setPreviewScale() and each pixel
+ * is shaded according to the exact proportion of its area that is covered by
+ * dark modules, so module edges that fall within a pixel are anti-aliased
+ * rather than blurred. Rows are top-down, without padding, with one byte per
+ * pixel for ::gs1_encoder_dGRAY and four bytes per pixel, in R, G, B, A
+ * order, for ::gs1_encoder_dRGBA.
+ *
+ * @see gs1_encoder_setPathMode()
+ * @see gs1_encoder_setPathOptimise()
+ * @see gs1_encoder_setPreviewScale()
+ * @see gs1_encoder_setPreviewDarkColour()
  * @see gs1_encoder_getFormat()
  *
  * @param [in,out] ctx ::gs1_encoder context
@@ -1625,6 +2001,250 @@ GS1_ENCODERS_API int gs1_encoder_getFormat(gs1_encoder *ctx);
 GS1_ENCODERS_API bool gs1_encoder_setFormat(gs1_encoder *ctx, int format);
 
 
+/**
+ * @brief Get the current marking path mode.
+ *
+ * @see gs1_encoder_setPathMode()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @return path mode, one of ::gs1_encoder_pathModes
+ */
+GS1_ENCODERS_API int gs1_encoder_getPathMode(gs1_encoder *ctx);
+
+
+/**
+ * @brief Set whether marking path output consists of dots or strokes.
+ *
+ *   * ::gs1_encoder_pathDOTS: A dot per dark module (default)
+ *   * ::gs1_encoder_pathSTROKES: Horizontal runs of dark modules are merged
+ *     into strokes, then any remaining vertical runs
+ *
+ * @see gs1_encoder_getPathMode()
+ * @see gs1_encoder_setFormat()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [in] mode path mode, one of ::gs1_encoder_pathModes
+ * @return true on success, otherwise false and an error message is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_setPathMode(gs1_encoder *ctx, int mode);
+
+
+/**
+ * @brief Get the current marking path optimisation flag.
+ *
+ * @see gs1_encoder_setPathOptimise()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @return current value of the marking path optimisation flag
+ */
+GS1_ENCODERS_API bool gs1_encoder_getPathOptimise(gs1_encoder *ctx);
+
+
+/**
+ * @brief Enable a 2-opt pass that reorders and reverses marks to further
+ * reduce travel in the marking path.
+ *
+ * This costs additional encoding time and is disabled by default.
+ *
+ * @see gs1_encoder_getPathOptimise()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [in] optimise enabled if true; disabled if false
+ * @return true on success, otherwise false and an error message is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_setPathOptimise(gs1_encoder *ctx, bool optimise);
+
+
+/**
+ * @brief Get the current HRI rendering flag.
+ *
+ * @see gs1_encoder_setRenderHRI()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @return current value of the HRI rendering flag
+ */
+GS1_ENCODERS_API bool gs1_encoder_getRenderHRI(gs1_encoder *ctx);
+
+
+/**
+ * @brief Render the Human Readable Interpretation text beneath the symbol,
+ * so that a complete label is produced in a single pass.
+ *
+ * The text is that returned by gs1_encoder_getHRI(), or the input data when
+ * it does not contain AIs. It is drawn using a compact built-in bitmap font
+ * with each font pixel one X-dimension wide, reduced as necessary so that the
+ * longest AI element fits within the width of the symbol. AI elements are
+ * packed onto as few lines as will fit, centred beneath the symbol, and the
+ * height of the image is increased accordingly.
+ *
+ * Encoding fails if the text cannot be made to fit, which may be the case for
+ * small 2D symbols.
+ *
+ * This has no effect for the ::gs1_encoder_dPATH format. It is disabled by
+ * default.
+ *
+ * @see gs1_encoder_getRenderHRI()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [in] renderHRI enabled if true; disabled if false
+ * @return true on success, otherwise false and an error message is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_setRenderHRI(gs1_encoder *ctx, bool renderHRI);
+
+
+/**
+ * @brief Get the current number of raster threads.
+ *
+ * @see gs1_encoder_setRasterThreads()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @return current number of threads used to rasterise an image
+ */
+GS1_ENCODERS_API int gs1_encoder_getRasterThreads(gs1_encoder *ctx);
+
+
+/**
+ * @brief Rasterise very large images as bands of rows in parallel, using up
+ * to the given number of threads.
+ *
+ * The rows of the symbol are collected, then the image is divided into
+ * horizontal bands that are rasterised concurrently into a single image
+ * buffer, which is emitted once complete. Images of less than a few hundred
+ * kilobytes are not divided and this has no effect for the
+ * ::gs1_encoder_dPATH, ::gs1_encoder_dGRAY and ::gs1_encoder_dRGBA formats.
+ *
+ * The pixel data is identical to that of serial rasterisation. TIFF output is
+ * written with one strip per band, so that a reader may also decode it in
+ * parallel.
+ *
+ * Values greater than 1 are not available in NOMALLOC builds or on Windows.
+ * The default is 1.
+ *
+ * @see gs1_encoder_getRasterThreads()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [in] threads number of threads, from 1 to 64
+ * @return true on success, otherwise false and an error message is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_setRasterThreads(gs1_encoder *ctx, int threads);
+
+
+/**
+ * @brief Get the current preview scale.
+ *
+ * @see gs1_encoder_setPreviewScale()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @return pixels per X-dimension of the preview formats
+ */
+GS1_ENCODERS_API double gs1_encoder_getPreviewScale(gs1_encoder *ctx);
+
+
+/**
+ * @brief Set the number of pixels per X-dimension of the ::gs1_encoder_dGRAY
+ * and ::gs1_encoder_dRGBA preview formats, which need not be a whole number.
+ *
+ * The symbol is laid out at the current pixel multiplier, as for the other
+ * formats, then scaled by the ratio of the preview scale to the pixel
+ * multiplier. The default is 1.
+ *
+ * @see gs1_encoder_getPreviewScale()
+ * @see gs1_encoder_setFormat()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [in] scale pixels per X-dimension, greater than 0 and at most gs1_encoder_getMaxPixMult()
+ * @return true on success, otherwise false and an error message is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_setPreviewScale(gs1_encoder *ctx, double scale);
+
+
+/**
+ * @brief Get the current preview colour for dark modules.
+ *
+ * @see gs1_encoder_setPreviewDarkColour()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @return colour as 0xRRGGBBAA
+ */
+GS1_ENCODERS_API uint32_t gs1_encoder_getPreviewDarkColour(gs1_encoder *ctx);
+
+
+/**
+ * @brief Set the colour of dark modules in the preview formats.
+ *
+ * Partly covered pixels are blended between the dark and light colours,
+ * including their alpha. The ::gs1_encoder_dGRAY format uses the luma of
+ * each colour. The default is opaque black, 0x000000FF.
+ *
+ * @see gs1_encoder_getPreviewDarkColour()
+ * @see gs1_encoder_setPreviewLightColour()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [in] rgba colour as 0xRRGGBBAA
+ * @return true on success, otherwise false and an error message is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_setPreviewDarkColour(gs1_encoder *ctx, uint32_t rgba);
+
+
+/**
+ * @brief Get the current preview colour for light modules and the quiet zone.
+ *
+ * @see gs1_encoder_setPreviewLightColour()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @return colour as 0xRRGGBBAA
+ */
+GS1_ENCODERS_API uint32_t gs1_encoder_getPreviewLightColour(gs1_encoder *ctx);
+
+
+/**
+ * @brief Set the colour of light modules and the quiet zone in the preview
+ * formats.
+ *
+ * The default is opaque white, 0xFFFFFFFF.
+ *
+ * @see gs1_encoder_getPreviewLightColour()
+ * @see gs1_encoder_setPreviewDarkColour()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [in] rgba colour as 0xRRGGBBAA
+ * @return true on success, otherwise false and an error message is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_setPreviewLightColour(gs1_encoder *ctx, uint32_t rgba);
+
+
+/**
+ * @brief Get the current output digest algorithm.
+ *
+ * @see gs1_encoder_setOutputDigestAlg()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @return digest algorithm, one of ::gs1_encoder_digests
+ */
+GS1_ENCODERS_API int gs1_encoder_getOutputDigestAlg(gs1_encoder *ctx);
+
+
+/**
+ * @brief Set the algorithm used to compute a digest of the output.
+ *
+ * When set, the digest is updated incrementally as each part of the image is
+ * written to the output file or buffer, so that no second pass over the
+ * output is required to obtain it:
+ *
+ *   * ::gs1_encoder_digestNONE: No digest (default)
+ *   * ::gs1_encoder_digestXXH64: XXH64
+ *   * ::gs1_encoder_digestSHA256: SHA-256
+ *
+ * @see gs1_encoder_getOutputDigestAlg()
+ * @see gs1_encoder_getOutputDigest()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [in] alg digest algorithm, one of ::gs1_encoder_digests
+ * @return true on success, otherwise false and an error message is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_setOutputDigestAlg(gs1_encoder *ctx, int alg);
+
+
 /**
  * @brief Get the current output filename.
  *
@@ -1691,6 +2311,57 @@ GS1_ENCODERS_API bool gs1_encoder_setOutFile(gs1_encoder *ctx, const char *outFi
 GS1_ENCODERS_API bool gs1_encoder_encode(gs1_encoder *ctx);
 
 
+/**
+ * @brief Report the size of symbol that the input data requires, without
+ * generating the symbol.
+ *
+ * This sizes the data provided by gs1_encoder_setDataStr() or
+ * gs1_encoder_setAIdataStr() for the symbology specified by
+ * gs1_encoder_setSym() using the same encodation and version selection as
+ * gs1_encoder_encode(), honouring a fixed Data Matrix size or QR Code version
+ * and the error correction level. It is suitable for calling in a loop, for
+ * example to find how many characters of an AI value fit in a given size.
+ *
+ * What is reported depends upon the symbology:
+ *
+ *   - Data Matrix, QR Code and rMQR: bits of data, with the rows and columns
+ *     of modules.
+ *   - Composite symbols, when the data contains a "|" separated composite
+ *     component: bits of data in the CC-A/B or CC-C, with its rows and data
+ *     columns.
+ *   - GS1 DataBar Expanded: bits of data, with the rows and segments per row.
+ *   - GS1-128: symbol characters, with a single row and the width in
+ *     modules. The data is further limited to 48 characters.
+ *
+ * The remaining symbologies hold fixed data, so only their composite
+ * component can be sized. For a composite symbol the data is reported as not
+ * fitting if the linear component is too long.
+ *
+ * \code
+ * gs1_encoder_capacity cap;
+ *
+ * gs1_encoder_setSym(ctx, gs1_encoder_sDM);
+ * gs1_encoder_setDmRows(ctx, 16);
+ * gs1_encoder_setDmColumns(ctx, 16);
+ * gs1_encoder_setAIdataStr(ctx, "(01)12345678901231(21)ABC123");
+ * if (gs1_encoder_getCapacity(ctx, &cap))
+ *     printf("%d of %d bits used\n", cap.used, cap.capacity);
+ * \endcode
+ *
+ * \note
+ * A successful query reports the size only. The data is fully validated by
+ * gs1_encoder_encode().
+ *
+ * @see ::gs1_encoder_capacity
+ * @see gs1_encoder_encode()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [out] capacity the size of the data and the selected symbol
+ * @return true on success, including when the data does not fit, otherwise false and an error message is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_getCapacity(gs1_encoder *ctx, gs1_encoder_capacity *capacity);
+
+
 /**
  * @brief Get the output buffer.
  *
@@ -1708,6 +2379,414 @@ GS1_ENCODERS_API bool gs1_encoder_encode(gs1_encoder *ctx);
 GS1_ENCODERS_API size_t gs1_encoder_getBuffer(gs1_encoder *ctx, void **buffer);
 
 
+/**
+ * @brief Get the digest of the output generated by the last call to
+ * gs1_encoder_encode().
+ *
+ * The digest covers exactly the bytes written to the output file or buffer,
+ * including any image header. XXH64 is given in its canonical (big-endian)
+ * byte order.
+ *
+ * \note
+ * The return data does not need to be free()ed and the content should be
+ * copied if it must persist in user code after subsequent library function
+ * calls.
+ *
+ * @see gs1_encoder_setOutputDigestAlg()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [out] digest a pointer to the digest bytes
+ * @return length of the digest, or 0 if no digest is available
+ */
+GS1_ENCODERS_API size_t gs1_encoder_getOutputDigest(gs1_encoder *ctx, void **digest);
+
+
+/**
+ * @brief Open a multi-page TIFF file that receives each subsequently encoded
+ * symbol as a new page.
+ *
+ * While a batch file is open, gs1_encoder_encode() appends its output to the
+ * batch file instead of writing to the output file or buffer. Each page is a
+ * separate image file directory (IFD) chained from the previous one, so the
+ * file is a standard multi-page TIFF. Output is accumulated in large blocks
+ * before being written, avoiding the cost of creating a file per symbol.
+ *
+ * The output format must be ::gs1_encoder_dTIF when encoding into a batch.
+ *
+ * The file is complete only once gs1_encoder_closeBatchFile() has been
+ * called.
+ *
+ * @see gs1_encoder_closeBatchFile()
+ * @see gs1_encoder_getBatchPageOffset()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [in] batchFile the filename of the multi-page TIFF to create
+ * @return true on success, otherwise false and an error message is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_openBatchFile(gs1_encoder *ctx, const char *batchFile);
+
+
+/**
+ * @brief Flush and close the batch file opened by gs1_encoder_openBatchFile().
+ *
+ * The page index remains available until the next batch file is opened.
+ *
+ * @see gs1_encoder_openBatchFile()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @return true on success, otherwise false and an error message is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_closeBatchFile(gs1_encoder *ctx);
+
+
+/**
+ * @brief Get the number of pages written to the current or last batch file.
+ *
+ * @see gs1_encoder_openBatchFile()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @return number of pages
+ */
+GS1_ENCODERS_API int gs1_encoder_getBatchPageCount(gs1_encoder *ctx);
+
+
+/**
+ * @brief Get the file offset of a page within the current or last batch file.
+ *
+ * The offset is that of the page's IFD, allowing a page to be read directly
+ * without following the chain of IFDs from the start of the file.
+ *
+ * @see gs1_encoder_openBatchFile()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [in] page zero-based page number
+ * @return offset of the page's IFD, or -1 if there is no such page
+ */
+GS1_ENCODERS_API long gs1_encoder_getBatchPageOffset(gs1_encoder *ctx, int page);
+
+
+/**
+ * @brief Open a persistent cache of rendered symbols, shared with any other
+ * process that opens the same file.
+ *
+ * While a cache is open, gs1_encoder_encode() first looks up a symbol keyed by
+ * the current settings and input data. On a hit no symbol is rendered and the
+ * output buffer is a read-only view of the cached symbol, mapped directly from
+ * the cache file without copying. On a miss the symbol is rendered as usual and then
+ * added to the cache.
+ *
+ * The cache is only consulted when output is to a buffer, i.e. the output
+ * file is "", and no batch file is open. The number of raster threads is not
+ * part of the key since it does not change the pixel data, so a cached TIFF
+ * keeps the strip layout with which it was first rendered.
+ *
+ * The cache file is created with the given size if it does not exist;
+ * otherwise the existing file is used at its current size. Space is recycled
+ * oldest first once the cache is full. Readers take no locks and writers
+ * append concurrently. Each entry carries a checksum so that entries that are
+ * incompletely written, for instance due to a crash, are ignored.
+ *
+ * \note
+ * The buffer for a cache hit is mapped read-only, so writing to it faults. It
+ * remains valid until the next call to gs1_encoder_encode() or
+ * gs1_encoder_closeCache(), provided that new symbols amounting to less
+ * than half the size of the cache have been added by all processes in the
+ * meantime; copy it if it must persist.
+ *
+ * \note
+ * The cache is only available on POSIX platforms.
+ *
+ * @see gs1_encoder_closeCache()
+ * @see gs1_encoder_getCacheHit()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [in] cacheFile the filename of the cache
+ * @param [in] size size in bytes of a newly created cache
+ * @return true on success, otherwise false and an error message is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_openCache(gs1_encoder *ctx, const char *cacheFile, size_t size);
+
+
+/**
+ * @brief Close the cache opened by gs1_encoder_openCache().
+ *
+ * Any output buffer that is a view of the cache is released.
+ *
+ * @see gs1_encoder_openCache()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @return true on success, otherwise false and an error message is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_closeCache(gs1_encoder *ctx);
+
+
+/**
+ * @brief Determine whether the most recently encoded symbol was served from
+ * the cache.
+ *
+ * @see gs1_encoder_openCache()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @return true if the output buffer is a view of a cached symbol
+ */
+GS1_ENCODERS_API bool gs1_encoder_getCacheHit(gs1_encoder *ctx);
+
+
+/**
+ * @brief Refuse to encode any GTIN and serial number pair that has been
+ * encoded before.
+ *
+ * While a serial guard is open, gs1_encoder_encode() fails for input that
+ * carries both AI (01) and AI (21) when the same GTIN and serial number were
+ * in any previous symbol recorded by the guard. The check is made before any
+ * output, including to a batch file, and a symbol that then fails to encode
+ * is not recorded. Input lacking either AI is not checked. Requests submitted
+ * to an encode queue of the instance are checked against the same set.
+ *
+ * Each pair is recorded as a 128-bit hash of the AI values already extracted
+ * from the input, in an open-addressing hash set.
+ *
+ * If a guard file is given then the set is persisted in that file, which is
+ * mapped into memory, so that a serialisation run may span several days and
+ * processes. The file is created with room for at least the given number of
+ * pairs, and cannot then be grown. Updates are serialised with a lock on the
+ * file, so several processes may share it. Otherwise the set is held in
+ * memory and grows as required.
+ *
+ * \note
+ * A persisted serial guard is only available on POSIX platforms, and an
+ * in-memory serial guard is not available in NOMALLOC builds.
+ *
+ * @see gs1_encoder_closeSerialGuard()
+ * @see gs1_encoder_getSerialGuardCount()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [in] guardFile the filename of a persisted set, or NULL or "" to hold the set in memory
+ * @param [in] capacity number of pairs for which a new set has room
+ * @return true on success, otherwise false and an error message is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_openSerialGuard(gs1_encoder *ctx, const char *guardFile, size_t capacity);
+
+
+/**
+ * @brief Close the serial guard opened by gs1_encoder_openSerialGuard().
+ *
+ * @see gs1_encoder_openSerialGuard()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @return true on success, otherwise false and an error message is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_closeSerialGuard(gs1_encoder *ctx);
+
+
+/**
+ * @brief Get the number of GTIN and serial number pairs recorded by the serial
+ * guard.
+ *
+ * @see gs1_encoder_openSerialGuard()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @return number of pairs, or 0 if no serial guard is open
+ */
+GS1_ENCODERS_API size_t gs1_encoder_getSerialGuardCount(gs1_encoder *ctx);
+
+
+/**
+ * @brief Write each subsequently encoded symbol to its output file
+ * asynchronously.
+ *
+ * While asynchronous output is open, gs1_encoder_encode() renders the symbol
+ * into one of a fixed number of preallocated buffers and queues the open,
+ * write and close of the output file, returning without waiting for them.
+ * An encode only blocks when all of the buffers are still in flight. This
+ * suits producing a large number of individual image files.
+ *
+ * On Linux the files are written using io_uring where the kernel supports it,
+ * otherwise by a small pool of writer threads.
+ *
+ * Since writing completes later, failure to write a file is not reported by
+ * gs1_encoder_encode() but by gs1_encoder_closeAsyncOutput().
+ *
+ * Output to a buffer, i.e. the output file is "", and to a batch file are
+ * unaffected.
+ *
+ * @see gs1_encoder_closeAsyncOutput()
+ * @see gs1_encoder_getAsyncBackend()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [in] depth number of files that may be in flight at once
+ * @return true on success, otherwise false and an error message is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_openAsyncOutput(gs1_encoder *ctx, int depth);
+
+
+/**
+ * @brief Wait for all files queued since gs1_encoder_openAsyncOutput() to
+ * be written, then close the asynchronous output.
+ *
+ * @see gs1_encoder_openAsyncOutput()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @return true if every file was written, otherwise false and an error
+ *         message naming the first file that failed is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_closeAsyncOutput(gs1_encoder *ctx);
+
+
+/**
+ * @brief Get the mechanism used to write files asynchronously.
+ *
+ * @see gs1_encoder_openAsyncOutput()
+ * @see ::gs1_encoder_asyncBackends
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @return backend, or ::gs1_encoder_asyncNONE if no asynchronous output is open
+ */
+GS1_ENCODERS_API int gs1_encoder_getAsyncBackend(gs1_encoder *ctx);
+
+
+/**
+ * @brief Start a pool of worker threads that encode requests submitted with
+ * gs1_encoder_submitEncode() without blocking the caller.
+ *
+ * This suits an event loop that must not stall while a large symbol is
+ * generated. Each worker encodes using an instance of its own, so the
+ * settings of this instance are not used; every setting is taken from the
+ * request.
+ *
+ * When requests complete, the descriptor returned by
+ * gs1_encoder_getEncodeQueueFd() becomes readable and the results are
+ * collected in batches with gs1_encoder_harvestEncodes().
+ *
+ * Submitting and harvesting take no locks, but must be performed by a single
+ * thread at a time, as for all other operations on an instance.
+ *
+ * The encode queue is not available on Windows, nor in NOMALLOC builds.
+ *
+ * \code
+ * gs1_encoder_completion done[64];
+ * int i, n;
+ *
+ * gs1_encoder_openEncodeQueue(ctx, 4, 256);
+ * fd = gs1_encoder_getEncodeQueueFd(ctx);   // Add to epoll for EPOLLIN
+ * ...
+ * gs1_encoder_submitEncode(ctx, &req, requestId);
+ * ...
+ * // When fd is readable
+ * n = gs1_encoder_harvestEncodes(ctx, done, 64);
+ * for (i = 0; i < n; i++)
+ *     reply(done[i].tag, &done[i].result);
+ * \endcode
+ *
+ * @see gs1_encoder_submitEncode()
+ * @see gs1_encoder_harvestEncodes()
+ * @see gs1_encoder_closeEncodeQueue()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [in] threads number of worker threads
+ * @param [in] depth number of requests that may be in flight at once
+ * @return true on success, otherwise false and an error message is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_openEncodeQueue(gs1_encoder *ctx, int threads, int depth);
+
+
+/**
+ * @brief Wait for the submitted requests to be encoded, then stop the workers
+ * of the encode queue.
+ *
+ * Results that have not been harvested are discarded.
+ *
+ * @see gs1_encoder_openEncodeQueue()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @return true on success, otherwise false and an error message is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_closeEncodeQueue(gs1_encoder *ctx);
+
+
+/**
+ * @brief Get a descriptor that is readable while completed requests are
+ * waiting to be harvested.
+ *
+ * The descriptor is suitable for poll(), epoll and other event loops. It is
+ * owned by the library and must neither be read nor closed. On Linux it is an
+ * eventfd.
+ *
+ * @see gs1_encoder_harvestEncodes()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @return descriptor, or -1 if no encode queue is open
+ */
+GS1_ENCODERS_API int gs1_encoder_getEncodeQueueFd(gs1_encoder *ctx);
+
+
+/**
+ * @brief Estimate the time to process an encode request.
+ *
+ * The estimate is derived cheaply from the symbology, the length of the
+ * input data, the output format and the X dimension, without encoding. It is
+ * in units of roughly a microsecond, but is intended for comparing requests
+ * rather than for predicting elapsed time.
+ *
+ * The encode queue uses the estimate to schedule requests, so that requests
+ * for small symbols are not held up behind those for large ones.
+ *
+ * @see gs1_encoder_submitEncode()
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [in] request settings and input data
+ * @return estimated cost of the request
+ */
+GS1_ENCODERS_API int gs1_encoder_estimateEncodeCost(gs1_encoder *ctx, const gs1_encoder_request *request);
+
+
+/**
+ * @brief Queue an encode request to be processed by the workers.
+ *
+ * The request, including its input data and output filename, is copied so
+ * it need not outlive the call.
+ *
+ * Requests whose estimated cost is small are processed ahead of any costly
+ * requests that are waiting, and when there is more than one worker then one
+ * of them is reserved for requests whose estimated cost is small.
+ *
+ * The call never waits: if as many requests as the queue depth are in
+ * flight, including those harvested by the most recent call to
+ * gs1_encoder_harvestEncodes(), it fails and the caller should harvest first.
+ *
+ * @see gs1_encoder_openEncodeQueue()
+ * @see gs1_encoder_estimateEncodeCost()
+ * @see ::gs1_encoder_request
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [in] request settings and input data
+ * @param [in] tag value returned with the completion to identify the request
+ * @return true on success, otherwise false and an error message is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_submitEncode(gs1_encoder *ctx, const gs1_encoder_request *request, uint64_t tag);
+
+
+/**
+ * @brief Collect the results of completed requests.
+ *
+ * Requests complete in no particular order. The pointers within each result
+ * reference storage owned by the encode queue and remain valid until the next
+ * call to gs1_encoder_harvestEncodes() or gs1_encoder_closeEncodeQueue().
+ *
+ * If more than max requests have completed then the descriptor remains
+ * readable and the remainder are returned by a further call.
+ *
+ * @see gs1_encoder_getEncodeQueueFd()
+ * @see ::gs1_encoder_completion
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [out] completions array receiving the completed requests
+ * @param [in] max capacity of the array
+ * @return number of completed requests that were returned
+ */
+GS1_ENCODERS_API int gs1_encoder_harvestEncodes(gs1_encoder *ctx, gs1_encoder_completion *completions, int max);
+
+
 /**
  * @brief Get the required output buffer size.
  *
@@ -1821,6 +2900,43 @@ GS1_ENCODERS_API int gs1_encoder_getBufferHeight(gs1_encoder *ctx);
 GS1_ENCODERS_API size_t gs1_encoder_getBufferStrings(gs1_encoder *ctx, char ***strings);
 
 
+/**
+ * @brief Apply a set of options, load the input data and generate a symbol,
+ * reporting the outcome, in a single call.
+ *
+ * This is equivalent to calling each of the relevant setters, then
+ * gs1_encoder_setDataStr() (or gs1_encoder_setAIdataStr()),
+ * gs1_encoder_encode(), gs1_encoder_getBuffer(), gs1_encoder_getHRI() and
+ * gs1_encoder_getErrMsg(). It exists for callers such as managed runtimes
+ * for which each transition into native code carries a significant cost.
+ *
+ * Processing stops at the first setting that is rejected, in which case the
+ * result status is zero and the error message describes the problem.
+ *
+ * \code
+ * gs1_encoder_request req = { 0 };
+ * gs1_encoder_result res;
+ *
+ * req.size = sizeof(req);
+ * req.sym = gs1_encoder_sDM;
+ * req.format = gs1_encoder_dRAW;
+ * req.aiSyntax = 1;
+ * req.dataStr = "(01)12345678901231(10)ABC123";
+ * if (!gs1_encoder_encodeRequest(ctx, &req, &res))
+ *     printf("Error: %s\n", res.errMsg);
+ * \endcode
+ *
+ * @see ::gs1_encoder_request
+ * @see ::gs1_encoder_result
+ *
+ * @param [in,out] ctx ::gs1_encoder context
+ * @param [in] request settings and input data
+ * @param [out] result status, image dimensions, output buffer and HRI
+ * @return true on success, otherwise false and an error message is set
+ */
+GS1_ENCODERS_API bool gs1_encoder_encodeRequest(gs1_encoder *ctx, const gs1_encoder_request *request, gs1_encoder_result *result);
+
+
 /**
  *  @brief Destroy a ::gs1_encoder instance.
  *
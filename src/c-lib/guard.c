@@ -0,0 +1,600 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "enc-private.h"
+#include "ai.h"
+#include "digest.h"
+#include "guard.h"
+
+
+/*
+ *  Uniqueness guard for serialised GTINs: each symbol carrying both (01) and
+ *  (21) is keyed by a pair of 64-bit hashes of its GTIN and serial, which is
+ *  added to an open-addressing set with linear probing before the symbol is
+ *  output, and withdrawn should the symbol then fail. The key is taken from
+ *  the AIs already extracted from the input, so nothing is re-parsed.
+ *
+ *  The set is either held on the heap, growing as required, or persisted in a
+ *  file of fixed capacity that is mapped shared and updated under an exclusive
+ *  file lock, so that runs spanning several days or processes see every serial
+ *  issued before.
+ *
+ */
+
+struct guardHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved0;
+	uint64_t numSlots;
+	uint64_t count;
+	uint64_t reserved[4];
+};
+
+
+static uint64_t hash64(const char *a, const size_t alen, const char *b, const size_t blen) {
+
+	static const uint8_t gs = 0x1D;
+	struct digestState st;
+	uint8_t out[MAX_DIGEST_LEN];
+	uint64_t h = 0;
+	int i;
+
+	gs1_digestInit(&st, gs1_encoder_digestXXH64);
+	gs1_digestUpdate(&st, a, alen);
+	gs1_digestUpdate(&st, &gs, 1);
+	gs1_digestUpdate(&st, b, blen);
+	gs1_digestFinal(&st, out);
+	for (i = 0; i < XXH64_DIGEST_LEN; i++)
+		h = h << 8 | out[i];
+
+	return h;
+
+}
+
+
+// Hashes of the first (01) and (21), in either order so that both must collide
+static bool guardKey(const gs1_encoder *ctx, uint64_t key[2], const struct aiValue **gtinOut, const struct aiValue **serialOut) {
+
+	const struct aiValue *gtin = NULL, *serial = NULL, *ai;
+	int i;
+
+	for (i = 0; i < ctx->numAIs; i++) {
+		ai = &ctx->aiData[i];
+		if (!ai->aiEntry || ai->ailen != 2)
+			continue;
+		if (!gtin && ai->ai[0] == '0' && ai->ai[1] == '1')
+			gtin = ai;
+		else if (!serial && ai->ai[0] == '2' && ai->ai[1] == '1')
+			serial = ai;
+	}
+
+	if (!gtin || !serial)
+		return false;
+
+	key[0] = hash64(gtin->value, gtin->vallen, serial->value, serial->vallen) | 1;	// Zero marks an empty slot
+	key[1] = hash64(serial->value, serial->vallen, gtin->value, gtin->vallen);
+	*gtinOut = gtin;
+	*serialOut = serial;
+	return true;
+
+}
+
+
+static uint64_t home(const struct guardSet *g, const uint64_t key0) {
+	return (key0 >> 1) & (g->numSlots - 1);
+}
+
+
+// Slot holding the key, or else the empty slot where it belongs
+static bool probe(const struct guardSet *g, const uint64_t key[2], uint64_t *slot) {
+
+	uint64_t i = home(g, key[0]);
+
+	while (g->slots[2*i] != 0) {
+		if (g->slots[2*i] == key[0] && g->slots[2*i+1] == key[1]) {
+			*slot = i;
+			return true;
+		}
+		i = (i + 1) & (g->numSlots - 1);
+	}
+	*slot = i;
+	return false;
+
+}
+
+
+// Close the gap by moving back any later entries of the cluster that may fill it
+static void erase(struct guardSet *g, uint64_t i) {
+
+	const uint64_t mask = g->numSlots - 1;
+	uint64_t j = i, k;
+
+	for (;;) {
+		j = (j + 1) & mask;
+		if (g->slots[2*j] == 0)
+			break;
+		k = home(g, g->slots[2*j]);
+		if (((j - k) & mask) >= ((j - i) & mask)) {
+			g->slots[2*i] = g->slots[2*j];
+			g->slots[2*i+1] = g->slots[2*j+1];
+			i = j;
+		}
+	}
+	g->slots[2*i] = 0;
+	g->slots[2*i+1] = 0;
+	(*g->count)--;
+
+}
+
+
+static void insert(struct guardSet *g, const uint64_t key[2], const uint64_t slot) {
+	g->slots[2*slot+1] = key[1];
+	g->slots[2*slot] = key[0];
+	(*g->count)++;
+}
+
+
+#ifndef NOMALLOC
+
+static bool grow(struct guardSet *g) {
+
+	struct guardSet old = *g;
+	uint64_t i, slot, key[2];
+
+	if ((g->slots = calloc((size_t)(2 * old.numSlots * 2), sizeof(uint64_t))) == NULL) {
+		g->slots = old.slots;
+		return false;
+	}
+	g->numSlots = old.numSlots * 2;
+	*g->count = 0;
+
+	for (i = 0; i < old.numSlots; i++) {
+		if ((key[0] = old.slots[2*i]) == 0)
+			continue;
+		key[1] = old.slots[2*i+1];
+		probe(g, key, &slot);
+		insert(g, key, slot);
+	}
+
+	free(old.slots);
+	return true;
+
+}
+
+#endif
+
+
+// Serialise the workers of an encode queue that share the set
+static void threadLock(const struct guardSet *g) {
+#ifdef GUARD_THREADS
+	if (g->mutex)
+		(void)pthread_mutex_lock(g->mutex);
+#else
+	(void)g;
+#endif
+}
+
+
+static void threadUnlock(const struct guardSet *g) {
+#ifdef GUARD_THREADS
+	if (g->mutex)
+		(void)pthread_mutex_unlock(g->mutex);
+#else
+	(void)g;
+#endif
+}
+
+
+static void lock(const struct guardSet *g) {
+	threadLock(g);
+#ifndef _WIN32
+	if (g->map)
+		(void)flock(g->fd, LOCK_EX);
+#endif
+}
+
+
+static void unlock(const struct guardSet *g) {
+#ifndef _WIN32
+	if (g->map)
+		(void)flock(g->fd, LOCK_UN);
+#endif
+	threadUnlock(g);
+}
+
+
+static uint64_t slotsFor(const size_t capacity) {
+
+	uint64_t n = GUARD_MIN_SLOTS;
+
+	while (GUARD_MAX_LOAD(n) < capacity)
+		n *= 2;
+	return n;
+
+}
+
+
+static bool openFile(gs1_encoder *ctx, const char *path, const size_t capacity) {
+
+#ifdef _WIN32
+
+	(void)path;
+	(void)capacity;
+	strcpy(ctx->errMsg, "A persisted serial guard is not supported on this platform");
+	ctx->errFlag = true;
+	return false;
+
+#else
+
+	struct guardSet *g = &ctx->guard;
+	struct guardHeader *hdr;
+	struct stat st;
+	uint64_t numSlots;
+	size_t len;
+	bool create;
+	int fd;
+
+	if ((fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644)) == -1) {
+		sprintf(ctx->errMsg, "Unable to open serial guard file: %.*s", MAX_FNAME, path);
+		ctx->errFlag = true;
+		return false;
+	}
+
+	if (flock(fd, LOCK_EX) != 0 || fstat(fd, &st) != 0) {
+		strcpy(ctx->errMsg, "Unable to lock serial guard file");
+		goto fail;
+	}
+
+	create = st.st_size == 0;
+	if (create) {
+		numSlots = slotsFor(capacity);
+		len = sizeof(struct guardHeader) + (size_t)numSlots * 2 * sizeof(uint64_t);
+		if (ftruncate(fd, (off_t)len) != 0) {
+			strcpy(ctx->errMsg, "Unable to size serial guard file");
+			goto fail;
+		}
+	} else {
+		if ((size_t)st.st_size < sizeof(struct guardHeader)) {
+			strcpy(ctx->errMsg, "Not a serial guard file");
+			goto fail;
+		}
+		len = (size_t)st.st_size;
+	}
+
+	if ((g->map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		g->map = NULL;
+		strcpy(ctx->errMsg, "Unable to map serial guard file");
+		goto fail;
+	}
+	g->mapLen = len;
+	hdr = (struct guardHeader*)g->map;
+
+	if (create) {
+		hdr->version = GUARD_VERSION;
+		hdr->numSlots = numSlots;
+		hdr->count = 0;
+		memcpy(hdr->magic, GUARD_MAGIC, sizeof(hdr->magic));
+		msync(g->map, sizeof(struct guardHeader), MS_SYNC);
+	}
+
+	if (memcmp(hdr->magic, GUARD_MAGIC, sizeof(hdr->magic)) != 0 ||
+	    hdr->version != GUARD_VERSION ||
+	    hdr->numSlots == 0 || (hdr->numSlots & (hdr->numSlots - 1)) != 0 ||
+	    sizeof(struct guardHeader) + hdr->numSlots * 2 * sizeof(uint64_t) > len) {
+		strcpy(ctx->errMsg, "Not a serial guard file");
+		munmap(g->map, len);
+		g->map = NULL;
+		goto fail;
+	}
+
+	g->numSlots = hdr->numSlots;
+	g->count = &hdr->count;
+	g->slots = (uint64_t*)(g->map + sizeof(struct guardHeader));
+	g->fd = fd;		// Kept open for locking
+
+	flock(fd, LOCK_UN);
+	return true;
+
+fail:
+	ctx->errFlag = true;
+	close(fd);
+	return false;
+
+#endif
+
+}
+
+
+static bool guardOpen(gs1_encoder *ctx, const char *path, const size_t capacity) {
+
+	struct guardSet *g = &ctx->guard;
+
+	if (g->open) {
+		strcpy(ctx->errMsg, "A serial guard is already open");
+		ctx->errFlag = true;
+		return false;
+	}
+
+	g->map = NULL;
+	g->fd = -1;
+	g->recorded = false;
+
+	if (path && *path) {
+		if (!openFile(ctx, path, capacity))
+			return false;
+	} else {
+#ifndef NOMALLOC
+		g->numSlots = slotsFor(capacity);
+		g->localCount = 0;
+		g->count = &g->localCount;
+		if ((g->slots = calloc((size_t)(2 * g->numSlots), sizeof(uint64_t))) == NULL) {
+			strcpy(ctx->errMsg, "Out of memory allocating the serial guard");
+			ctx->errFlag = true;
+			return false;
+		}
+#else
+		strcpy(ctx->errMsg, "An in-memory serial guard is not available in NOMALLOC builds");
+		ctx->errFlag = true;
+		return false;
+#endif
+	}
+
+	g->open = true;
+	return true;
+
+}
+
+
+// Workers of an encode queue may be recording against the set meanwhile
+bool gs1_guardOpen(gs1_encoder *ctx, const char *path, const size_t capacity) {
+
+	bool ok;
+
+	threadLock(&ctx->guard);
+	ok = guardOpen(ctx, path, capacity);
+	threadUnlock(&ctx->guard);
+	return ok;
+
+}
+
+
+void gs1_guardClose(gs1_encoder *ctx) {
+
+	struct guardSet *g = &ctx->guard;
+
+	threadLock(g);
+	if (!g->open) {
+		threadUnlock(g);
+		return;
+	}
+
+#ifndef _WIN32
+	if (g->map) {
+		msync(g->map, g->mapLen, MS_SYNC);
+		munmap(g->map, g->mapLen);
+		close(g->fd);
+		g->map = NULL;
+		g->fd = -1;
+	} else
+#endif
+	{
+#ifndef NOMALLOC
+		free(g->slots);
+#endif
+	}
+
+	g->slots = NULL;
+	g->open = false;
+	threadUnlock(g);
+
+}
+
+
+/*
+ *  Add the GTIN and serial of the current input, failing if they were seen
+ *  before. Input without both is not checked. The workers of an encode queue
+ *  record against the set of the instance that owns the queue
+ *
+ */
+bool gs1_guardRecord(gs1_encoder *ctx) {
+
+	struct guardSet *g = &ctx->guard;
+	struct guardSet *s = g->shared ? g->shared : g;
+	const struct aiValue *gtin, *serial;
+	uint64_t slot;
+
+	g->recorded = false;
+	if ((!g->shared && !g->open) || !guardKey(ctx, g->key, &gtin, &serial))
+		return true;
+
+	lock(s);
+
+	if (!s->open) {
+		unlock(s);
+		return true;
+	}
+
+	if (probe(s, g->key, &slot)) {
+		unlock(s);
+		sprintf(ctx->errMsg, "Duplicate GTIN and serial number: (01)%.*s (21)%.*s",
+			(int)gtin->vallen, gtin->value, (int)serial->vallen, serial->value);
+		ctx->errFlag = true;
+		return false;
+	}
+
+	if (*s->count + 1 > GUARD_MAX_LOAD(s->numSlots)) {
+#ifndef NOMALLOC
+		if (s->map || !grow(s)) {
+#else
+		{
+#endif
+			unlock(s);
+			strcpy(ctx->errMsg, s->map ? "Serial guard file is full" : "Out of memory growing the serial guard");
+			ctx->errFlag = true;
+			return false;
+		}
+		probe(s, g->key, &slot);
+	}
+
+	insert(s, g->key, slot);
+	unlock(s);
+
+	g->recorded = true;
+	return true;
+
+}
+
+
+// Withdraw the entry added for a symbol that then failed
+void gs1_guardRevoke(gs1_encoder *ctx) {
+
+	struct guardSet *g = &ctx->guard;
+	struct guardSet *s = g->shared ? g->shared : g;
+	uint64_t slot;
+
+	if (!g->recorded)
+		return;
+
+	lock(s);
+	if (s->open && probe(s, g->key, &slot))
+		erase(s, slot);
+	unlock(s);
+
+	g->recorded = false;
+
+}
+
+
+#ifdef UNIT_TESTS
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+
+void test_guard_set(void) {
+
+	gs1_encoder *ctx;
+	struct guardSet g;
+	uint64_t keys[12][2], slot, count = 0;
+	char data[64];
+	const char *fname = "gs1encoders-test-guard.bin";
+	FILE *fp;
+	int i, j;
+
+	// Clusters that wrap around the end of a small table, erased in turn
+	g.numSlots = 16;
+	g.count = &count;
+	TEST_ASSERT((g.slots = calloc(2 * 16, sizeof(uint64_t))) != NULL);
+	for (i = 0; i < 12; i++) {
+		keys[i][0] = (uint64_t)((i % 3) + 13) << 1 | 1;		// Homes of 13, 14 and 15
+		keys[i][1] = (uint64_t)i;
+		TEST_CHECK(!probe(&g, keys[i], &slot));
+		insert(&g, keys[i], slot);
+	}
+	TEST_CHECK(count == 12);
+	for (i = 0; i < 12; i++) {
+		TEST_ASSERT(probe(&g, keys[i], &slot));
+		erase(&g, slot);
+		for (j = 0; j < 12; j++)
+			TEST_CHECK(probe(&g, keys[j], &slot) == (j > i));
+		TEST_MSG("Erased %d, probing %d", i, j);
+	}
+	TEST_CHECK(count == 0);
+	free(g.slots);
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+
+	// In memory, growing past the initial capacity
+	TEST_ASSERT(gs1_guardOpen(ctx, NULL, 0));
+	TEST_CHECK(!gs1_guardOpen(ctx, NULL, 0));
+	for (i = 0; i < 2 * GUARD_MIN_SLOTS; i++) {
+		sprintf(data, "^0112345678901231^21S%d", i);
+		TEST_ASSERT(gs1_encoder_setDataStr(ctx, data));
+		TEST_CHECK(gs1_guardRecord(ctx));
+	}
+	TEST_CHECK(ctx->guard.numSlots > GUARD_MIN_SLOTS);
+	TEST_CHECK(*ctx->guard.count == 2 * GUARD_MIN_SLOTS);
+	for (i = 0; i < 2 * GUARD_MIN_SLOTS; i += 97) {
+		sprintf(data, "^0112345678901231^21S%d", i);
+		TEST_ASSERT(gs1_encoder_setDataStr(ctx, data));
+		TEST_CHECK(!gs1_guardRecord(ctx));
+	}
+
+	// Same serial with another GTIN is distinct
+	TEST_ASSERT(gs1_encoder_setDataStr(ctx, "^0112312312312333^21S0"));
+	TEST_CHECK(gs1_guardRecord(ctx));
+
+	// Withdrawn entries may be issued again
+	gs1_guardRevoke(ctx);
+	TEST_CHECK(gs1_guardRecord(ctx));
+	gs1_guardClose(ctx);
+
+	// Persisted across opens
+	remove(fname);
+	TEST_ASSERT(gs1_guardOpen(ctx, fname, 100));
+	TEST_ASSERT(gs1_encoder_setDataStr(ctx, "^0112345678901231^21ABC"));
+	TEST_CHECK(gs1_guardRecord(ctx));
+	gs1_guardClose(ctx);
+	TEST_ASSERT(gs1_guardOpen(ctx, fname, 0));
+	TEST_CHECK(ctx->guard.numSlots == GUARD_MIN_SLOTS);
+	TEST_CHECK(!gs1_guardRecord(ctx));
+	TEST_CHECK(strcmp(ctx->errMsg, "Duplicate GTIN and serial number: (01)12345678901231 (21)ABC") == 0);
+	TEST_MSG("Got: %s", ctx->errMsg);
+
+	// A persisted set does not grow
+	for (i = 0; i < GUARD_MAX_LOAD(GUARD_MIN_SLOTS) - 1; i++) {
+		sprintf(data, "^0112345678901231^21S%d", i);
+		TEST_ASSERT(gs1_encoder_setDataStr(ctx, data));
+		TEST_CHECK(gs1_guardRecord(ctx));
+	}
+	TEST_ASSERT(gs1_encoder_setDataStr(ctx, "^0112345678901231^21LAST"));
+	TEST_CHECK(!gs1_guardRecord(ctx));
+	TEST_CHECK(strcmp(ctx->errMsg, "Serial guard file is full") == 0);
+	gs1_guardClose(ctx);
+	remove(fname);
+
+	TEST_ASSERT((fp = fopen(fname, "wb")) != NULL);
+	fprintf(fp, "Not a guard file, but long enough to hold a header..........");
+	fclose(fp);
+	TEST_CHECK(!gs1_guardOpen(ctx, fname, 0));
+	TEST_CHECK(strcmp(ctx->errMsg, "Not a serial guard file") == 0);
+	remove(fname);
+
+	gs1_encoder_free(ctx);
+
+}
+
+
+#endif  /* UNIT_TESTS */
@@ -0,0 +1,71 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef GUARD_H
+#define GUARD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gs1encoders.h"
+
+#if !defined(NOMALLOC) && !defined(_WIN32)
+#include <pthread.h>
+#define GUARD_THREADS
+#endif
+
+
+#define GUARD_MAGIC		"GS1EGUAR"
+#define GUARD_VERSION		1
+#define GUARD_MIN_SLOTS		1024
+#define GUARD_MAX_LOAD(n)	((n) / 4 * 3)		// Entries before an in-memory set is grown
+
+struct guardSet {
+	uint64_t *slots;		// Pairs of hashes of GTIN and serial, or zero
+	uint64_t numSlots;		// Power of two
+	uint64_t *count;		// Entries recorded
+	uint64_t localCount;
+	uint8_t *map;			// Whole file, when the set is persisted
+	size_t mapLen;
+	int fd;
+	bool open;
+	bool recorded;			// Current symbol added an entry
+	uint64_t key[2];		// ... with this key
+	struct guardSet *shared;	// Set of the instance whose encode queue this instance serves
+#ifdef GUARD_THREADS
+	pthread_mutex_t *mutex;		// Held while the set is shared with encode queue workers
+#endif
+};
+
+bool gs1_guardOpen(gs1_encoder *ctx, const char *path, size_t capacity);
+void gs1_guardClose(gs1_encoder *ctx);
+bool gs1_guardRecord(gs1_encoder *ctx);
+void gs1_guardRevoke(gs1_encoder *ctx);
+
+
+#ifdef UNIT_TESTS
+
+void test_guard_set(void);
+
+#endif
+
+
+#endif  /* GUARD_H */
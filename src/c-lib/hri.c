@@ -0,0 +1,334 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "enc-private.h"
+#include "hri.h"
+
+
+/*
+ *  Compact 5x7 bitmap font covering printable ASCII (0x20-0x7E), in the
+ *  spirit of OCR-B: plain strokes, open counters and a slashless zero.
+ *
+ *  Each glyph is five columns, left to right, with bit 0 as the top row.
+ *
+ */
+static const uint8_t font[][HRI_GLYPH_W] = {
+	{ 0x00, 0x00, 0x00, 0x00, 0x00 },	// space
+	{ 0x00, 0x00, 0x5F, 0x00, 0x00 },	// !
+	{ 0x00, 0x07, 0x00, 0x07, 0x00 },	// "
+	{ 0x14, 0x7F, 0x14, 0x7F, 0x14 },	// #
+	{ 0x24, 0x2A, 0x7F, 0x2A, 0x12 },	// $
+	{ 0x23, 0x13, 0x08, 0x64, 0x62 },	// %
+	{ 0x36, 0x49, 0x55, 0x22, 0x50 },	// &
+	{ 0x00, 0x05, 0x03, 0x00, 0x00 },	// '
+	{ 0x00, 0x1C, 0x22, 0x41, 0x00 },	// (
+	{ 0x00, 0x41, 0x22, 0x1C, 0x00 },	// )
+	{ 0x08, 0x2A, 0x1C, 0x2A, 0x08 },	// *
+	{ 0x08, 0x08, 0x3E, 0x08, 0x08 },	// +
+	{ 0x00, 0x50, 0x30, 0x00, 0x00 },	// ,
+	{ 0x08, 0x08, 0x08, 0x08, 0x08 },	// -
+	{ 0x00, 0x60, 0x60, 0x00, 0x00 },	// .
+	{ 0x20, 0x10, 0x08, 0x04, 0x02 },	// /
+	{ 0x3E, 0x51, 0x49, 0x45, 0x3E },	// 0
+	{ 0x00, 0x42, 0x7F, 0x40, 0x00 },	// 1
+	{ 0x42, 0x61, 0x51, 0x49, 0x46 },	// 2
+	{ 0x21, 0x41, 0x45, 0x4B, 0x31 },	// 3
+	{ 0x18, 0x14, 0x12, 0x7F, 0x10 },	// 4
+	{ 0x27, 0x45, 0x45, 0x45, 0x39 },	// 5
+	{ 0x3C, 0x4A, 0x49, 0x49, 0x30 },	// 6
+	{ 0x01, 0x71, 0x09, 0x05, 0x03 },	// 7
+	{ 0x36, 0x49, 0x49, 0x49, 0x36 },	// 8
+	{ 0x06, 0x49, 0x49, 0x29, 0x1E },	// 9
+	{ 0x00, 0x36, 0x36, 0x00, 0x00 },	// :
+	{ 0x00, 0x56, 0x36, 0x00, 0x00 },	// ;
+	{ 0x08, 0x14, 0x22, 0x41, 0x00 },	// <
+	{ 0x14, 0x14, 0x14, 0x14, 0x14 },	// =
+	{ 0x00, 0x41, 0x22, 0x14, 0x08 },	// >
+	{ 0x02, 0x01, 0x51, 0x09, 0x06 },	// ?
+	{ 0x32, 0x49, 0x79, 0x41, 0x3E },	// @
+	{ 0x7E, 0x11, 0x11, 0x11, 0x7E },	// A
+	{ 0x7F, 0x49, 0x49, 0x49, 0x36 },	// B
+	{ 0x3E, 0x41, 0x41, 0x41, 0x22 },	// C
+	{ 0x7F, 0x41, 0x41, 0x22, 0x1C },	// D
+	{ 0x7F, 0x49, 0x49, 0x49, 0x41 },	// E
+	{ 0x7F, 0x09, 0x09, 0x09, 0x01 },	// F
+	{ 0x3E, 0x41, 0x49, 0x49, 0x7A },	// G
+	{ 0x7F, 0x08, 0x08, 0x08, 0x7F },	// H
+	{ 0x00, 0x41, 0x7F, 0x41, 0x00 },	// I
+	{ 0x20, 0x40, 0x41, 0x3F, 0x01 },	// J
+	{ 0x7F, 0x08, 0x14, 0x22, 0x41 },	// K
+	{ 0x7F, 0x40, 0x40, 0x40, 0x40 },	// L
+	{ 0x7F, 0x02, 0x0C, 0x02, 0x7F },	// M
+	{ 0x7F, 0x04, 0x08, 0x10, 0x7F },	// N
+	{ 0x3E, 0x41, 0x41, 0x41, 0x3E },	// O
+	{ 0x7F, 0x09, 0x09, 0x09, 0x06 },	// P
+	{ 0x3E, 0x41, 0x51, 0x21, 0x5E },	// Q
+	{ 0x7F, 0x09, 0x19, 0x29, 0x46 },	// R
+	{ 0x46, 0x49, 0x49, 0x49, 0x31 },	// S
+	{ 0x01, 0x01, 0x7F, 0x01, 0x01 },	// T
+	{ 0x3F, 0x40, 0x40, 0x40, 0x3F },	// U
+	{ 0x1F, 0x20, 0x40, 0x20, 0x1F },	// V
+	{ 0x3F, 0x40, 0x38, 0x40, 0x3F },	// W
+	{ 0x63, 0x14, 0x08, 0x14, 0x63 },	// X
+	{ 0x07, 0x08, 0x70, 0x08, 0x07 },	// Y
+	{ 0x61, 0x51, 0x49, 0x45, 0x43 },	// Z
+	{ 0x00, 0x7F, 0x41, 0x41, 0x00 },	// [
+	{ 0x02, 0x04, 0x08, 0x10, 0x20 },	// backslash
+	{ 0x00, 0x41, 0x41, 0x7F, 0x00 },	// ]
+	{ 0x04, 0x02, 0x01, 0x02, 0x04 },	// ^
+	{ 0x40, 0x40, 0x40, 0x40, 0x40 },	// _
+	{ 0x00, 0x01, 0x02, 0x04, 0x00 },	// `
+	{ 0x20, 0x54, 0x54, 0x54, 0x78 },	// a
+	{ 0x7F, 0x48, 0x44, 0x44, 0x38 },	// b
+	{ 0x38, 0x44, 0x44, 0x44, 0x20 },	// c
+	{ 0x38, 0x44, 0x44, 0x48, 0x7F },	// d
+	{ 0x38, 0x54, 0x54, 0x54, 0x18 },	// e
+	{ 0x08, 0x7E, 0x09, 0x01, 0x02 },	// f
+	{ 0x0C, 0x52, 0x52, 0x52, 0x3E },	// g
+	{ 0x7F, 0x08, 0x04, 0x04, 0x78 },	// h
+	{ 0x00, 0x44, 0x7D, 0x40, 0x00 },	// i
+	{ 0x20, 0x40, 0x44, 0x3D, 0x00 },	// j
+	{ 0x7F, 0x10, 0x28, 0x44, 0x00 },	// k
+	{ 0x00, 0x41, 0x7F, 0x40, 0x00 },	// l
+	{ 0x7C, 0x04, 0x18, 0x04, 0x78 },	// m
+	{ 0x7C, 0x08, 0x04, 0x04, 0x78 },	// n
+	{ 0x38, 0x44, 0x44, 0x44, 0x38 },	// o
+	{ 0x7C, 0x14, 0x14, 0x14, 0x08 },	// p
+	{ 0x08, 0x14, 0x14, 0x18, 0x7C },	// q
+	{ 0x7C, 0x08, 0x04, 0x04, 0x08 },	// r
+	{ 0x48, 0x54, 0x54, 0x54, 0x20 },	// s
+	{ 0x04, 0x3F, 0x44, 0x40, 0x20 },	// t
+	{ 0x3C, 0x40, 0x40, 0x20, 0x7C },	// u
+	{ 0x1C, 0x20, 0x40, 0x20, 0x1C },	// v
+	{ 0x3C, 0x40, 0x30, 0x40, 0x3C },	// w
+	{ 0x44, 0x28, 0x10, 0x28, 0x44 },	// x
+	{ 0x0C, 0x50, 0x50, 0x50, 0x3C },	// y
+	{ 0x44, 0x64, 0x54, 0x4C, 0x44 },	// z
+	{ 0x00, 0x08, 0x36, 0x41, 0x00 },	// {
+	{ 0x00, 0x00, 0x7F, 0x00, 0x00 },	// |
+	{ 0x00, 0x41, 0x36, 0x08, 0x00 },	// }
+	{ 0x08, 0x04, 0x08, 0x10, 0x08 },	// ~
+};
+
+
+static long textWidth(const size_t len, const int scale) {
+	return len == 0 ? 0 : (long)scale * ((long)len * HRI_ADVANCE - 1);
+}
+
+
+/*
+ *  Arrange the HRI text into lines for a symbol "width" pixels wide.
+ *
+ *  Text is formatted one AI element at a time, as for gs1_encoder_getHRI(),
+ *  falling back to the raw data when there are no AIs. The font is scaled so
+ *  that each font pixel is one module wide, reduced as necessary for the
+ *  longest element to fit. Elements are then packed onto lines without being
+ *  broken, joining them in place within "text".
+ *
+ *  Returns the number of lines, which is zero if there is nothing to render,
+ *  or -1 if the text cannot fit.
+ *
+ */
+int gs1_hriLayout(gs1_encoder *ctx, const long width, char *text, char **lines, int *scale) {
+
+	int i, n, m;
+	char *p = text;
+	struct aiValue ai;
+	size_t len, l, longest = 0;
+	int s;
+
+	n = 0;
+	for (i = 0; i < ctx->numAIs; i++) {
+		ai = ctx->aiData[i];
+		if (!ai.aiEntry)
+			continue;
+		lines[n++] = p;
+		p += sprintf(p, "(%.*s) %.*s", ai.ailen, ai.ai, ai.vallen, ai.value);
+		p++;
+	}
+	if (n == 0 && *ctx->dataStr != '\0') {
+		strcpy(p, ctx->dataStr);
+		lines[n++] = p;
+	}
+	if (n == 0)
+		return 0;
+
+	for (i = 0; i < n; i++) {
+		len = strlen(lines[i]);
+		if (len > longest)
+			longest = len;
+	}
+
+	s = ctx->pixMult;
+	if (textWidth(longest, s) > width)
+		s = (int)(width / textWidth(longest, 1));
+	if (s < 1) {
+		strcpy(ctx->errMsg, "HRI text is too wide to fit beneath the symbol");
+		ctx->errFlag = true;
+		return -1;
+	}
+	*scale = s;
+
+	// Elements are contiguous, so joining replaces the terminator with a space
+	m = 0;
+	len = strlen(lines[0]);
+	for (i = 1; i < n; i++) {
+		l = strlen(lines[i]);
+		if (textWidth(len + 1 + l, s) <= width) {
+			lines[m][len] = ' ';
+			len += 1 + l;
+		} else {
+			lines[++m] = lines[i];
+			len = l;
+		}
+	}
+
+	return m + 1;
+
+}
+
+
+/*
+ *  Rasterise the glyph rows of a line of text, centred within "width" pixels,
+ *  into HRI_GLYPH_H packed rows of "rowBytes" each. Each is later repeated
+ *  "scale" times to form the output.
+ *
+ *  Rows start out blank (xorMsk) with each dark pixel toggled, so that the
+ *  inverted sense of BMP is handled without a separate path.
+ *
+ */
+void gs1_hriRasterise(const char *line, const long width, const int scale, const uint8_t xorMsk, const size_t rowBytes, uint8_t *rows) {
+
+	size_t len, k;
+	long left, x, x0;
+	int cx, r;
+	uint8_t col;
+	unsigned char c;
+
+	len = strlen(line);
+	left = (width - textWidth(len, scale)) / 2;
+
+	memset(rows, xorMsk, HRI_GLYPH_H * rowBytes);
+
+	for (k = 0; k < len; k++) {
+		c = (unsigned char)line[k];
+		if (c < 0x20 || c > 0x7E)
+			continue;
+		for (cx = 0; cx < HRI_GLYPH_W; cx++) {
+			if ((col = font[c - 0x20][cx]) == 0)
+				continue;
+			x0 = left + ((long)k * HRI_ADVANCE + cx) * scale;
+			for (r = 0; r < HRI_GLYPH_H; r++) {
+				if (!(col & (1 << r)))
+					continue;
+				for (x = x0; x < x0 + scale; x++)
+					rows[(size_t)r * rowBytes + (size_t)(x >> 3)] ^= (uint8_t)(0x80 >> (x & 7));
+			}
+		}
+	}
+
+}
+
+
+#ifdef UNIT_TESTS
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+
+void test_hri_hriLayout(void) {
+
+	gs1_encoder* ctx;
+	char text[2*MAX_DATA+1];
+	char *lines[MAX_AIS];
+	int scale;
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+
+	// "(01) 12312312312333" is 113 units wide; joined with "(10) ABC123" it is 185
+	TEST_ASSERT(gs1_encoder_setAIdataStr(ctx, "(01)12312312312333(10)ABC123"));
+	TEST_CHECK(gs1_encoder_setPixMult(ctx, 1));
+
+	TEST_CHECK(gs1_hriLayout(ctx, 200, text, lines, &scale) == 1);
+	TEST_CHECK(scale == 1);
+	TEST_CHECK(strcmp(lines[0], "(01) 12312312312333 (10) ABC123") == 0);
+
+	TEST_CHECK(gs1_hriLayout(ctx, 150, text, lines, &scale) == 2);
+	TEST_CHECK(strcmp(lines[0], "(01) 12312312312333") == 0);
+	TEST_CHECK(strcmp(lines[1], "(10) ABC123") == 0);
+
+	// Scaled to the X-dimension, reduced to fit the longest element
+	TEST_CHECK(gs1_encoder_setPixMult(ctx, 4));
+	TEST_CHECK(gs1_hriLayout(ctx, 800, text, lines, &scale) == 1);
+	TEST_CHECK(scale == 4);
+	TEST_CHECK(gs1_hriLayout(ctx, 300, text, lines, &scale) == 2);
+	TEST_CHECK(scale == 2);
+
+	TEST_CHECK(gs1_hriLayout(ctx, 100, text, lines, &scale) == -1);
+	TEST_CHECK(gs1_encoder_getErrMsg(ctx)[0] != '\0');
+
+	// Without AIs the data itself is shown
+	TEST_CHECK(gs1_encoder_setSym(ctx, gs1_encoder_sEAN13));
+	TEST_ASSERT(gs1_encoder_setDataStr(ctx, "2112345678900"));
+	TEST_CHECK(gs1_hriLayout(ctx, 800, text, lines, &scale) == 1);
+	TEST_CHECK(strcmp(lines[0], "2112345678900") == 0);
+
+	gs1_encoder_free(ctx);
+
+}
+
+
+void test_hri_hriRasterise(void) {
+
+	uint8_t rows[HRI_GLYPH_H * 2];
+	const uint8_t one[HRI_GLYPH_H] = { 0x10, 0x30, 0x10, 0x10, 0x10, 0x10, 0x38 };
+	int r;
+
+	// "1" centred in 7 pixels occupies pixels 1-5
+	gs1_hriRasterise("1", 7, 1, 0x00, 1, rows);
+	for (r = 0; r < HRI_GLYPH_H; r++) {
+		TEST_CHECK(rows[r] == one[r]);
+		TEST_MSG("Row %d: got %02x, expected %02x", r, rows[r], one[r]);
+	}
+
+	// Inverted for BMP
+	gs1_hriRasterise("1", 7, 1, 0xFF, 1, rows);
+	for (r = 0; r < HRI_GLYPH_H; r++)
+		TEST_CHECK((rows[r] ^ one[r]) == 0xFF);
+
+	// Doubled, centred in 12 pixels, the stem occupies pixels 5-6
+	gs1_hriRasterise("1", 12, 2, 0x00, 2, rows);
+	TEST_CHECK(rows[0] == 0x06 && rows[1] == 0x00);
+	TEST_CHECK(rows[12] == 0x1F && rows[13] == 0x80);
+
+	// Unsupported characters are left blank
+	gs1_hriRasterise("\x7f", 7, 1, 0x00, 1, rows);
+	for (r = 0; r < HRI_GLYPH_H; r++)
+		TEST_CHECK(rows[r] == 0x00);
+
+}
+
+
+#endif  /* UNIT_TESTS */
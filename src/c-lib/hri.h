@@ -0,0 +1,49 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef HRI_H
+#define HRI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gs1encoders.h"
+
+
+#define HRI_GLYPH_W	5
+#define HRI_GLYPH_H	7
+#define HRI_ADVANCE	6	// Glyph width plus inter-character space
+#define HRI_GAP		3	// Font rows between the symbol and the first line of text
+#define HRI_LEADING	2	// Font rows following each line of text
+#define HRI_LINE_H	(HRI_GLYPH_H + HRI_LEADING)
+
+int gs1_hriLayout(gs1_encoder *ctx, long width, char *text, char **lines, int *scale);
+void gs1_hriRasterise(const char *line, long width, int scale, uint8_t xorMsk, size_t rowBytes, uint8_t *rows);
+
+
+#ifdef UNIT_TESTS
+
+void test_hri_hriLayout(void);
+void test_hri_hriRasterise(void);
+
+#endif
+
+
+#endif  /* HRI_H */
@@ -0,0 +1,233 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "enc-private.h"
+#include "debug.h"
+#include "driver.h"
+#include "itf14.h"
+#include "ai.h"
+
+
+#define ITF14_ELMNTS	79	// includes qz's
+#define ITF14_QZ	10	// quiet zone in X
+#define ITF14_WIDE	3	// wide element in X, for a 3:1 ratio
+#define ITF14_BAR_H	32	// bar height in X
+#define ITF14_BEARER	5	// horizontal bearer bar height in X
+
+
+// call with str = 14-digit primary
+static void ITF14enc(const uint8_t *str, uint8_t pattern[]) {
+
+	// Wide elements of each digit, first element in the MSB
+	static const uint8_t itfTbl[10] = {	0x06, 0x11, 0x09, 0x18, 0x05,
+						0x14, 0x0C, 0x03, 0x12, 0x0A };
+	static const uint8_t start[4] = { 1,1,1,1 };
+	static const uint8_t stop[3] = { ITF14_WIDE,1,1 };
+
+	int i, j, pNdx, bars, spaces;
+
+	assert(str && strlen((const char*)str) == 14);
+
+	pNdx = 0;
+	pattern[pNdx++] = ITF14_QZ;
+	for (i = 0; i < 4; i++)
+		pattern[pNdx++] = start[i];
+
+	// Each pair of digits is interleaved: the first in the bars and the
+	// second in the spaces
+	for (i = 0; i < 14; i += 2) {
+		bars = itfTbl[str[i]-'0'];
+		spaces = itfTbl[str[i+1]-'0'];
+		for (j = 4; j >= 0; j--) {
+			pattern[pNdx++] = (bars >> j) & 1 ? ITF14_WIDE : 1;
+			pattern[pNdx++] = (spaces >> j) & 1 ? ITF14_WIDE : 1;
+		}
+	}
+
+	for (i = 0; i < 3; i++)
+		pattern[pNdx++] = stop[i];
+	pattern[pNdx++] = ITF14_QZ;
+
+	assert(pNdx == ITF14_ELMNTS);
+
+}
+
+
+bool gs1_normaliseITF14(gs1_encoder *ctx, const char *dataStr, char *primaryStr) {
+
+	if (strlen(dataStr) >= 3 && strncmp(dataStr, "^01", 3) == 0)
+		dataStr += 3;
+
+	if (!ctx->addCheckDigit) {
+		if (strlen(dataStr) != 14) {
+			strcpy(ctx->errMsg, "primary data must be 14 digits");
+			ctx->errFlag = true;
+			*primaryStr = '\0';
+			return false;
+		}
+	}
+	else {
+		if (strlen(dataStr) != 13) {
+			strcpy(ctx->errMsg, "primary data must be 13 digits without check digit");
+			ctx->errFlag = true;
+			*primaryStr = '\0';
+			return false;
+		}
+	}
+
+	if (!gs1_allDigits((uint8_t*)dataStr, 0)) {
+		strcpy(ctx->errMsg, "primary data must be all digits");
+		ctx->errFlag = true;
+		*primaryStr = '\0';
+		return false;
+	}
+
+	strcpy(primaryStr, dataStr);
+
+	if (ctx->addCheckDigit)
+		strcat(primaryStr, "-");
+
+	if (!gs1_validateParity((uint8_t*)primaryStr) && !ctx->addCheckDigit) {
+		strcpy(ctx->errMsg, "primary data check digit is incorrect");
+		ctx->errFlag = true;
+		*primaryStr = '\0';
+		return false;
+	}
+
+	return true;
+
+}
+
+
+void gs1_ITF14(gs1_encoder *ctx) {
+
+	struct sPrints prints = { 0 };
+	struct sPrints bearer = { 0 };
+
+	uint8_t linPattern[ITF14_ELMNTS];
+	uint8_t bearerPat[1] = { ITF14_W };	// Solid bar spanning the quiet zones
+
+	char *dataStr = ctx->dataStr;
+	char primaryStr[14+1];
+
+	DEBUG_PRINT("\nData: %s\n", dataStr);
+
+	if (strchr(dataStr, '|') != NULL) {
+		strcpy(ctx->errMsg, "Composite component is not supported for ITF-14");
+		ctx->errFlag = true;
+		return;
+	}
+
+	if (!gs1_normaliseITF14(ctx, dataStr, primaryStr))
+		return;
+
+	DEBUG_PRINT("Checked: %s\n", primaryStr);
+
+	ITF14enc((uint8_t*)primaryStr, linPattern);
+
+	DEBUG_PRINT_PATTERN("Linear pattern", linPattern, ITF14_ELMNTS);
+
+	ctx->line1 = true; // so first line is not Y undercut
+	prints.elmCnt = ITF14_ELMNTS;
+	prints.pattern = linPattern;
+	prints.guards = false;
+	prints.height = ctx->pixMult*ITF14_BAR_H;
+	prints.leftPad = 0;
+	prints.rightPad = 0;
+	prints.whtFirst = true;
+	prints.reverse = false;
+	// The bearer bars are a single row each, repeated to their height
+	bearer.elmCnt = 1;
+	bearer.pattern = bearerPat;
+	bearer.guards = false;
+	bearer.height = ctx->pixMult*ITF14_BEARER;
+	bearer.leftPad = 0;
+	bearer.rightPad = 0;
+	bearer.whtFirst = false;
+	bearer.reverse = false;
+
+	gs1_driverInit(ctx, (long)ctx->pixMult*ITF14_W, (long)ctx->pixMult*(ITF14_BAR_H + 2*ITF14_BEARER));
+
+	gs1_driverAddRow(ctx, &bearer);
+	gs1_driverAddRow(ctx, &prints);
+	gs1_driverAddRow(ctx, &bearer);
+
+	gs1_driverFinalise(ctx);
+
+}
+
+
+#ifdef UNIT_TESTS
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+#include "gs1encoders-test.h"
+
+
+void test_itf14_ITF14_encode(void) {
+
+	const char** expect;
+	char **strings;
+
+	gs1_encoder* ctx = gs1_encoder_init(NULL);
+
+	expect = (const char*[]){
+"XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX",
+"XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX",
+"XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX",
+"XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX",
+"XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX",
+"          X X XXX   X X   X XXX X   X XXX XXX X   X   XXX   X X XXX X   X XXX   X XXX X XXX XXX X   X   XXX X   X XXX   X X X XXX XXX   X   XXX X          ",
+"..."
+	};
+	TEST_CHECK(test_encode(ctx, true, gs1_encoder_sITF14, "15012345678907", expect));
+
+	// Bars are followed by the bottom bearer bar
+	TEST_ASSERT(gs1_encoder_getBufferStrings(ctx, &strings) == 32 + 2*5);
+	TEST_CHECK(strcmp(strings[36], expect[5]) == 0);
+	TEST_CHECK(strcmp(strings[37], expect[0]) == 0);
+	TEST_CHECK(strcmp(strings[41], expect[0]) == 0);
+
+	// AI syntax is the same symbol
+	TEST_CHECK(test_encode(ctx, true, gs1_encoder_sITF14, "^0115012345678907", expect));
+
+	TEST_CHECK(test_encode(ctx, false, gs1_encoder_sITF14, "15012345678908", NULL));		// Bad check digit
+	TEST_CHECK(test_encode(ctx, false, gs1_encoder_sITF14, "1501234567890", NULL));		// Short
+	TEST_CHECK(test_encode(ctx, false, gs1_encoder_sITF14, "150123456789070", NULL));	// Long
+	TEST_CHECK(test_encode(ctx, false, gs1_encoder_sITF14, "150123ABC78907", NULL));	// Non-numeric
+	TEST_CHECK(test_encode(ctx, false, gs1_encoder_sITF14, "15012345678907|^99COMPOSITE", NULL));
+
+	// Check digit calculated
+	TEST_ASSERT(gs1_encoder_setAddCheckDigit(ctx, true));
+	TEST_CHECK(test_encode(ctx, true, gs1_encoder_sITF14, "1501234567890", expect));
+	TEST_CHECK(test_encode(ctx, false, gs1_encoder_sITF14, "15012345678907", NULL));
+
+	gs1_encoder_free(ctx);
+
+}
+
+#endif  /* UNIT_TESTS */
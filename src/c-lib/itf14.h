@@ -0,0 +1,45 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ITF14_H
+#define ITF14_H
+
+#include <stdbool.h>
+
+#include "gs1encoders.h"
+
+
+#define ITF14_W		155	// includes 10X quiet zones
+#define ITF14_MAX_SYM_W	ITF14_W
+#define ITF14_MAX_SYM_H	(32 + 2*5)	// with bearer bars
+
+
+bool gs1_normaliseITF14(gs1_encoder *ctx, const char *dataStr, char *primaryStr);
+void gs1_ITF14(gs1_encoder *ctx);
+
+
+#ifdef UNIT_TESTS
+
+void test_itf14_ITF14_encode(void);
+
+#endif
+
+
+#endif  /* ITF14_H */
@@ -0,0 +1,335 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gs1encoders.h"
+#include "path.h"
+
+
+/*
+ *  Travel between marks is measured as max(|dx|,|dy|), which is the move time
+ *  for a head whose X and Y axes are driven simultaneously (galvo or XY
+ *  table). The head starts at the origin.
+ *
+ */
+static int travel(const int ax, const int ay, const int bx, const int by) {
+	int dx = abs(ax - bx);
+	int dy = abs(ay - by);
+	return dx > dy ? dx : dy;
+}
+
+
+static void flip(struct pathMark *m) {
+	int t;
+	t = m->x1; m->x1 = m->x2; m->x2 = t;
+	t = m->y1; m->y1 = m->y2; m->y2 = t;
+}
+
+
+// Row by row, alternating direction on each row
+static int cmpSerpentine(const void *a, const void *b) {
+
+	const struct pathMark *p = a;
+	const struct pathMark *q = b;
+	int py = p->y1 < p->y2 ? p->y1 : p->y2;
+	int qy = q->y1 < q->y2 ? q->y1 : q->y2;
+	int px = p->x1 < p->x2 ? p->x1 : p->x2;
+	int qx = q->x1 < q->x2 ? q->x1 : q->x2;
+
+	if (py != qy)
+		return py - qy;
+	return py % 2 == 0 ? px - qx : qx - px;
+
+}
+
+
+/*
+ *  Windowed 2-opt: reversing the run of marks i+1..j (and the direction of
+ *  each) replaces the moves e(i)->s(i+1) and e(j)->s(j+1) with e(i)->e(j) and
+ *  s(i+1)->s(j+1), leaving the moves within the run unchanged in length.
+ *
+ */
+static void twoOpt(struct pathMark *marks, const int n) {
+
+	struct pathMark t;
+	bool improved = true;
+	int pass, i, j, k, l, ex, ey, d0, d1;
+
+	for (pass = 0; improved && pass < PATH_2OPT_PASSES; pass++) {
+		improved = false;
+		for (i = -1; i < n - 1; i++) {
+			ex = i < 0 ? 0 : marks[i].x2;
+			ey = i < 0 ? 0 : marks[i].y2;
+			for (j = i + 1; j < n && j <= i + PATH_2OPT_WINDOW; j++) {
+				d0 = travel(ex, ey, marks[i+1].x1, marks[i+1].y1);
+				d1 = travel(ex, ey, marks[j].x2, marks[j].y2);
+				if (j + 1 < n) {
+					d0 += travel(marks[j].x2, marks[j].y2, marks[j+1].x1, marks[j+1].y1);
+					d1 += travel(marks[i+1].x1, marks[i+1].y1, marks[j+1].x1, marks[j+1].y1);
+				}
+				if (d1 >= d0)
+					continue;
+				for (k = i + 1, l = j; k < l; k++, l--) {
+					t = marks[k];
+					marks[k] = marks[l];
+					marks[l] = t;
+				}
+				for (k = i + 1; k <= j; k++)
+					flip(&marks[k]);
+				improved = true;
+			}
+		}
+	}
+
+}
+
+
+/*
+ *  Plan the marking of the dark modules of a w x h matrix (one byte per
+ *  module, non-zero for dark) as either individual dots in serpentine order,
+ *  or as horizontal runs merged into strokes with the remaining modules
+ *  merged into vertical strokes, each oriented to start nearest the head.
+ *
+ *  Returns the number of marks, storing them in an array allocated from "ar"
+ *  that the caller must free, or -1 if memory cannot be allocated.
+ *
+ */
+int gs1_pathPlan(const uint8_t *mtx, const int w, const int h, const int mode, const bool optimise, struct arena *ar, struct pathMark **marks) {
+
+	struct pathMark *m;
+	uint8_t *covered;
+	int n = 0, x, y, x2, y2, hx, hy, i;
+
+	assert(mtx);
+	assert(w > 0 && h > 0);
+	assert(marks);
+
+	if ((m = gs1_arenaAlloc(ar, (size_t)w * (size_t)h * sizeof(struct pathMark))) == NULL)
+		return -1;
+
+	if (mode == gs1_encoder_pathDOTS) {
+
+		for (y = 0; y < h; y++) {
+			for (i = 0; i < w; i++) {
+				x = y % 2 == 0 ? i : w - 1 - i;
+				if (mtx[y*w + x]) {
+					m[n].x1 = m[n].x2 = x;
+					m[n].y1 = m[n].y2 = y;
+					n++;
+				}
+			}
+		}
+
+	} else {
+
+		if ((covered = gs1_arenaCalloc(ar, (size_t)w * (size_t)h, sizeof(uint8_t))) == NULL) {
+			gs1_arenaFree(ar, m);
+			return -1;
+		}
+
+		for (y = 0; y < h; y++) {
+			for (x = 0; x < w; x = x2 + 1) {
+				for (x2 = x; x2 < w && mtx[y*w + x2]; x2++);
+				if (x2 - x < 2)
+					continue;
+				m[n].x1 = x;  m[n].x2 = x2 - 1;
+				m[n].y1 = m[n].y2 = y;
+				n++;
+				memset(&covered[y*w + x], 1, (size_t)(x2 - x));
+			}
+		}
+
+		for (x = 0; x < w; x++) {
+			for (y = 0; y < h; y = y2 + 1) {
+				for (y2 = y; y2 < h && mtx[y2*w + x] && !covered[y2*w + x]; y2++)
+					covered[y2*w + x] = 1;
+				if (y2 == y)
+					continue;
+				m[n].x1 = m[n].x2 = x;
+				m[n].y1 = y;  m[n].y2 = y2 - 1;
+				n++;
+			}
+		}
+
+		gs1_arenaFree(ar, covered);
+
+		qsort(m, (size_t)n, sizeof(struct pathMark), cmpSerpentine);
+
+		for (i = 0, hx = 0, hy = 0; i < n; i++) {
+			if (travel(hx, hy, m[i].x2, m[i].y2) < travel(hx, hy, m[i].x1, m[i].y1))
+				flip(&m[i]);
+			hx = m[i].x2;
+			hy = m[i].y2;
+		}
+
+	}
+
+	if (optimise)
+		twoOpt(m, n);
+
+	*marks = m;
+	return n;
+
+}
+
+
+long gs1_pathTravel(const struct pathMark *marks, const int n) {
+
+	long t = 0;
+	int i, hx = 0, hy = 0;
+
+	for (i = 0; i < n; i++) {
+		t += travel(hx, hy, marks[i].x1, marks[i].y1);
+		hx = marks[i].x2;
+		hy = marks[i].y2;
+	}
+	return t;
+
+}
+
+
+#ifdef UNIT_TESTS
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+
+// Each dark module is marked exactly once and nothing else is marked
+static bool test_covers(const uint8_t *mtx, const int w, const int h, const struct pathMark *marks, const int n) {
+
+	uint8_t hits[64*64] = { 0 };
+	int i, x, y, dx, dy;
+
+	for (i = 0; i < n; i++) {
+		if (marks[i].x1 != marks[i].x2 && marks[i].y1 != marks[i].y2)
+			return false;		// Neither horizontal nor vertical
+		dx = marks[i].x2 > marks[i].x1 ? 1 : marks[i].x2 < marks[i].x1 ? -1 : 0;
+		dy = marks[i].y2 > marks[i].y1 ? 1 : marks[i].y2 < marks[i].y1 ? -1 : 0;
+		for (x = marks[i].x1, y = marks[i].y1; ; x += dx, y += dy) {
+			if (x < 0 || x >= w || y < 0 || y >= h)
+				return false;
+			hits[y*w + x]++;
+			if (x == marks[i].x2 && y == marks[i].y2)
+				break;
+		}
+	}
+
+	for (i = 0; i < w*h; i++)
+		if (hits[i] != (mtx[i] ? 1 : 0))
+			return false;
+
+	return true;
+
+}
+
+
+void test_path_pathPlan(void) {
+
+	static const char *pic[] = {
+		"XXXX.X..",
+		"X....X..",
+		"X.XX.X.X",
+		".....X..",
+		"XXXXXXXX",
+		"X.X.X.X.",
+		NULL
+	};
+	uint8_t mtx[64*64];
+	static struct pathMark rasterMarks[64*64];
+	struct pathMark *marks;
+	struct arena ar;
+	uint32_t seed = 1;
+	int i, n, nd, w, h, x, y;
+	long raster, dots, dotsOpt, strokes, strokesOpt;
+
+	gs1_arenaInit(&ar, NULL, 0);
+
+	for (h = 0; pic[h]; h++)
+		for (i = 0; i < 8; i++)
+			mtx[h*8 + i] = pic[h][i] == 'X';
+	w = 8;
+
+	TEST_ASSERT((n = gs1_pathPlan(mtx, w, h, gs1_encoder_pathDOTS, false, &ar, &marks)) == 25);
+	TEST_CHECK(test_covers(mtx, w, h, marks, n));
+	TEST_CHECK(marks[0].x1 == 0 && marks[0].y1 == 0);
+	TEST_CHECK(marks[5].x1 == 5 && marks[5].y1 == 1);	// Second row is reversed
+	gs1_arenaFree(&ar, marks);
+
+	// Rows of length two or more, then vertical merges of what remains
+	TEST_ASSERT((n = gs1_pathPlan(mtx, w, h, gs1_encoder_pathSTROKES, false, &ar, &marks)) == 10);
+	TEST_CHECK(test_covers(mtx, w, h, marks, n));
+	gs1_arenaFree(&ar, marks);
+
+	TEST_ASSERT((n = gs1_pathPlan(mtx, w, h, gs1_encoder_pathSTROKES, true, &ar, &marks)) == 10);
+	TEST_CHECK(test_covers(mtx, w, h, marks, n));
+	gs1_arenaFree(&ar, marks);
+
+	// Random matrix: serpentine beats raster; merging and 2-opt reduce travel further
+	w = h = 64;
+	for (i = 0; i < w*h; i++) {
+		seed = seed * 1103515245 + 12345;
+		mtx[i] = (seed >> 16) % 2 == 0;
+	}
+
+	for (n = 0, y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			if (!mtx[y*w + x])
+				continue;
+			rasterMarks[n].x1 = rasterMarks[n].x2 = x;
+			rasterMarks[n].y1 = rasterMarks[n].y2 = y;
+			n++;
+		}
+	}
+	raster = gs1_pathTravel(rasterMarks, n);
+
+	TEST_ASSERT((nd = gs1_pathPlan(mtx, w, h, gs1_encoder_pathDOTS, false, &ar, &marks)) == n);
+	TEST_CHECK(test_covers(mtx, w, h, marks, nd));
+	dots = gs1_pathTravel(marks, nd);
+	gs1_arenaFree(&ar, marks);
+	TEST_CHECK(dots < raster);
+
+	TEST_ASSERT((n = gs1_pathPlan(mtx, w, h, gs1_encoder_pathDOTS, true, &ar, &marks)) == nd);
+	TEST_CHECK(test_covers(mtx, w, h, marks, n));
+	dotsOpt = gs1_pathTravel(marks, n);
+	gs1_arenaFree(&ar, marks);
+	TEST_CHECK(dotsOpt <= dots);
+
+	TEST_ASSERT((n = gs1_pathPlan(mtx, w, h, gs1_encoder_pathSTROKES, false, &ar, &marks)) > 0);
+	TEST_CHECK(n < nd);
+	TEST_CHECK(test_covers(mtx, w, h, marks, n));
+	strokes = gs1_pathTravel(marks, n);
+	gs1_arenaFree(&ar, marks);
+
+	TEST_ASSERT((n = gs1_pathPlan(mtx, w, h, gs1_encoder_pathSTROKES, true, &ar, &marks)) > 0);
+	TEST_CHECK(test_covers(mtx, w, h, marks, n));
+	strokesOpt = gs1_pathTravel(marks, n);
+	gs1_arenaFree(&ar, marks);
+	TEST_CHECK(strokesOpt < strokes);
+	TEST_MSG("raster %ld; dots %ld; dots+2opt %ld; strokes %ld; strokes+2opt %ld", raster, dots, dotsOpt, strokes, strokesOpt);
+
+}
+
+
+#endif  /* UNIT_TESTS */
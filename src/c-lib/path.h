@@ -0,0 +1,53 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef PATH_H
+#define PATH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "arena.h"
+
+
+#define PATH_2OPT_WINDOW	64	// Furthest reordering considered by the 2-opt pass
+#define PATH_2OPT_PASSES	8
+
+
+// A dot when (x1,y1) == (x2,y2), otherwise a stroke marked from (x1,y1) to (x2,y2)
+struct pathMark {
+	int x1;
+	int y1;
+	int x2;
+	int y2;
+};
+
+int gs1_pathPlan(const uint8_t *mtx, int w, int h, int mode, bool optimise, struct arena *ar, struct pathMark **marks);
+long gs1_pathTravel(const struct pathMark *marks, int n);
+
+
+#ifdef UNIT_TESTS
+
+void test_path_pathPlan(void);
+
+#endif
+
+
+#endif  /* PATH_H */
@@ -0,0 +1,298 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "preview.h"
+
+
+/*
+ *  Each band of identical source rows is reduced to the fraction of each
+ *  output column that it covers, then weighted by the height of each output
+ *  row that it overlaps, so that every output pixel receives the exact dark
+ *  area of the source beneath it
+ *
+ */
+static void channels(const uint32_t rgba, const int bpp, uint8_t *out) {
+
+	out[0] = (uint8_t)(rgba >> 24);
+	out[1] = (uint8_t)(rgba >> 16);
+	out[2] = (uint8_t)(rgba >> 8);
+	out[3] = (uint8_t)rgba;
+
+	if (bpp == 1)	// Luma
+		out[0] = (uint8_t)((299u * out[0] + 587u * out[1] + 114u * out[2] + 500u) / 1000u);
+
+}
+
+
+/*
+ *  Ceiling of the scaled length, taken without libm which the library does
+ *  not link against
+ *
+ */
+static int scaledLen(const long len, const double scale) {
+
+	const double x = (double)len * scale - 1e-9;
+	int n = (int)x;
+
+	if ((double)n < x)
+		n++;
+
+	return n;
+
+}
+
+
+bool gs1_previewInit(struct previewState *st, struct arena *ar, const long srcW, const long srcH, const double scale,
+		     const int bpp, const uint32_t dark, const uint32_t light) {
+
+	gs1_previewFree(st, ar);
+
+	st->scale = scale;
+	st->srcW = srcW;
+	st->srcRows = 0;
+	st->outW = scaledLen(srcW, scale);
+	st->outH = scaledLen(srcH, scale);
+	if (st->outW < 1)
+		st->outW = 1;
+	if (st->outH < 1)
+		st->outH = 1;
+	st->outY = 0;
+	st->outPos = 0;
+	st->bandEnd = 0;
+	st->bpp = bpp;
+	channels(dark, bpp, st->dark);
+	channels(light, bpp, st->light);
+
+	st->cov = gs1_arenaCalloc(ar, (size_t)st->outW, sizeof(double));
+	st->acc = gs1_arenaCalloc(ar, (size_t)st->outW, sizeof(double));
+	st->px = gs1_arenaAlloc(ar, (size_t)st->outW * (size_t)bpp);
+	if (!st->cov || !st->acc || !st->px) {
+		gs1_previewFree(st, ar);
+		return false;
+	}
+
+	return true;
+
+}
+
+
+static void addRun(struct previewState *st, const long a, const long b) {
+
+	double x0 = (double)a * st->scale;
+	double x1 = (double)b * st->scale;
+	double lo, hi;
+	int i;
+
+	for (i = (int)x0; i < st->outW && i < x1; i++) {
+		lo = x0 > i ? x0 : i;
+		hi = x1 < i + 1 ? x1 : i + 1;
+		st->cov[i] += hi - lo;
+	}
+
+}
+
+
+// Start a band of identical source rows, given as a 1-bit row with dark set
+void gs1_previewBand(struct previewState *st, const uint8_t *bits, const long rows) {
+
+	long x = 0, a;
+
+	memset(st->cov, 0, (size_t)st->outW * sizeof(double));
+
+	while (x < st->srcW) {
+		if ((x & 7) == 0 && bits[x >> 3] == 0) {	// Skip light bytes
+			x += 8;
+			continue;
+		}
+		if (!(bits[x >> 3] >> (7 - (x & 7)) & 1)) {
+			x++;
+			continue;
+		}
+		a = x;
+		while (x < st->srcW && (bits[x >> 3] >> (7 - (x & 7)) & 1))
+			x++;
+		addRun(st, a, x);
+	}
+
+	st->srcRows += rows;
+	st->bandEnd = (double)st->srcRows * st->scale;
+
+}
+
+
+static void accumulate(struct previewState *st, const double weight) {
+
+	int i;
+
+	if (weight <= 0)
+		return;
+	for (i = 0; i < st->outW; i++)
+		st->acc[i] += st->cov[i] * weight;
+
+}
+
+
+static const uint8_t* emitRow(struct previewState *st) {
+
+	uint8_t *p = st->px;
+	double c;
+	int i, ch;
+
+	for (i = 0; i < st->outW; i++) {
+		c = st->acc[i];
+		if (c > 1)
+			c = 1;
+		for (ch = 0; ch < st->bpp; ch++)
+			*p++ = (uint8_t)(st->light[ch] + (st->dark[ch] - st->light[ch]) * c + 0.5);
+		st->acc[i] = 0;
+	}
+	st->outY++;
+
+	return st->px;
+
+}
+
+
+// Continue the current band, returning each output row that it completes
+const uint8_t* gs1_previewNext(struct previewState *st) {
+
+	double edge = st->outY + 1;
+
+	if (st->outY >= st->outH) {
+		st->outPos = st->bandEnd;
+		return NULL;
+	}
+
+	if (st->bandEnd < edge) {
+		accumulate(st, st->bandEnd - st->outPos);
+		st->outPos = st->bandEnd;
+		return NULL;
+	}
+
+	accumulate(st, edge - st->outPos);
+	st->outPos = edge;
+	return emitRow(st);
+
+}
+
+
+// Return each remaining output row, the last of which may be partly covered
+const uint8_t* gs1_previewFlush(struct previewState *st) {
+
+	if (st->outY >= st->outH)
+		return NULL;
+	st->outPos = st->outY + 1;
+	return emitRow(st);
+
+}
+
+
+void gs1_previewFree(struct previewState *st, struct arena *ar) {
+
+	// Reverse order of allocation, so that an arena can reclaim the space
+	gs1_arenaFree(ar, st->px);
+	gs1_arenaFree(ar, st->acc);
+	gs1_arenaFree(ar, st->cov);
+	st->cov = NULL;
+	st->acc = NULL;
+	st->px = NULL;
+
+}
+
+
+#ifdef UNIT_TESTS
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+
+void test_preview_previewCoverage(void) {
+
+	struct previewState st = { 0 };
+	struct arena ar;
+	const uint8_t bits[] = { 0x60 };	// Source pixels 1 and 2 are dark
+	const uint8_t *px;
+
+	gs1_arenaInit(&ar, NULL, 0);
+
+	// Half scale: each output pixel covers two source pixels, one dark
+	TEST_ASSERT(gs1_previewInit(&st, &ar, 4, 2, 0.5, 1, 0x000000FF, 0xFFFFFFFF));
+	TEST_CHECK(st.outW == 2 && st.outH == 1);
+	gs1_previewBand(&st, bits, 2);
+	TEST_ASSERT((px = gs1_previewNext(&st)) != NULL);
+	TEST_CHECK(px[0] == 128 && px[1] == 128);
+	TEST_CHECK(gs1_previewNext(&st) == NULL);
+	TEST_CHECK(gs1_previewFlush(&st) == NULL);
+
+	// Scale of 1.5: the dark run covers output [1.5,4.5) and the single
+	// source row covers the first output row and half of the second
+	TEST_ASSERT(gs1_previewInit(&st, &ar, 4, 1, 1.5, 1, 0x000000FF, 0xFFFFFFFF));
+	TEST_CHECK(st.outW == 6 && st.outH == 2);
+	gs1_previewBand(&st, bits, 1);
+	TEST_ASSERT((px = gs1_previewNext(&st)) != NULL);
+	TEST_CHECK(px[0] == 255 && px[1] == 128 && px[2] == 0 && px[3] == 0 && px[4] == 128 && px[5] == 255);
+	TEST_CHECK(gs1_previewNext(&st) == NULL);
+	TEST_ASSERT((px = gs1_previewFlush(&st)) != NULL);
+	TEST_CHECK(px[0] == 255 && px[1] == 191 && px[2] == 128 && px[3] == 128 && px[4] == 191 && px[5] == 255);
+	TEST_CHECK(gs1_previewFlush(&st) == NULL);
+
+	gs1_previewFree(&st, &ar);
+
+}
+
+
+void test_preview_previewColours(void) {
+
+	struct previewState st = { 0 };
+	struct arena ar;
+	const uint8_t three[] = { 0xE0 };
+	const uint8_t two[] = { 0xC0 };
+	const uint8_t *px;
+
+	gs1_arenaInit(&ar, NULL, 0);
+
+	// RGBA: a fully dark pixel then a half covered pixel
+	TEST_ASSERT(gs1_previewInit(&st, &ar, 3, 1, 0.5, 4, 0x20406080, 0xFFFFFF00));
+	TEST_CHECK(st.outW == 2);
+	gs1_previewBand(&st, three, 1);
+	TEST_CHECK(gs1_previewNext(&st) == NULL);
+	TEST_ASSERT((px = gs1_previewFlush(&st)) != NULL);
+
+	// Half of the output row height is covered by the source
+	TEST_CHECK(px[0] == 0x90 && px[1] == 0xA0 && px[2] == 0xB0 && px[3] == 0x40);
+	TEST_CHECK(px[4] == 0xC7 && px[5] == 0xCF && px[6] == 0xD7 && px[7] == 0x20);
+
+	// Grey uses the luma of each colour
+	TEST_ASSERT(gs1_previewInit(&st, &ar, 8, 2, 1, 1, 0xFF0000FF, 0x0000FFFF));
+	gs1_previewBand(&st, two, 2);
+	TEST_ASSERT((px = gs1_previewNext(&st)) != NULL);
+	TEST_CHECK(px[0] == 76 && px[1] == 76 && px[2] == 29);
+
+	gs1_previewFree(&st, &ar);
+
+}
+
+#endif  /* UNIT_TESTS */
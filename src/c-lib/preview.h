@@ -0,0 +1,64 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef PREVIEW_H
+#define PREVIEW_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+
+
+// Scaling of a 1-bit source image to an 8-bit grey or 32-bit RGBA image
+struct previewState {
+	double scale;			// Output pixels per source pixel
+	long srcW;
+	long srcRows;			// Source rows consumed so far
+	int outW;
+	int outH;
+	int outY;			// Output row being accumulated
+	double outPos;			// Output position reached within the current row
+	double bandEnd;			// Output position at which the current band ends
+	int bpp;			// Output bytes per pixel
+	uint8_t dark[4];
+	uint8_t light[4];
+	double *cov;			// Horizontal dark coverage of the current band
+	double *acc;			// Area coverage accumulated for the current row
+	uint8_t *px;			// Pixels of a completed row
+};
+
+bool gs1_previewInit(struct previewState *st, struct arena *ar, long srcW, long srcH, double scale, int bpp, uint32_t dark, uint32_t light);
+void gs1_previewBand(struct previewState *st, const uint8_t *bits, long rows);
+const uint8_t* gs1_previewNext(struct previewState *st);
+const uint8_t* gs1_previewFlush(struct previewState *st);
+void gs1_previewFree(struct previewState *st, struct arena *ar);
+
+
+#ifdef UNIT_TESTS
+
+void test_preview_previewCoverage(void);
+void test_preview_previewColours(void);
+
+#endif
+
+
+#endif  /* PREVIEW_H */
@@ -26,6 +26,7 @@
 #include <stdlib.h>
 
 #include "enc-private.h"
+#include "bitbuf.h"
 #include "debug.h"
 #include "qr.h"
 #include "mtx.h"
@@ -116,6 +117,79 @@ static const uint8_t cclens[3][4] = {
 };
 
 
+/*
+ *  Definition of the rMQR symbol properties for each version, indexed by
+ *  the version indicator. Versions are ordered by height then width, so the
+ *  first version that holds the data is also the shortest.
+ *
+ */
+
+#define RMETRIC(h, w, a1, a2, a3, a4, m, cc, em, eh, m1, m2, h1, h2) {		\
+	   .height = h,									\
+	   .width = w,									\
+	   .align = { a1, a2, a3, a4 },							\
+	   .modules = m,								\
+	   .cclen = cc,									\
+	   .ecc_cws = { em, eh }, 							\
+	   .ecc_blks = { {m1,m2}, {h1,h2} },						\
+	}
+
+
+struct rmqrMetric {
+	uint8_t height;			// Rows
+	uint8_t width;			// Columns
+	uint8_t align[4];		// Columns of the alignment pattern centres, zero terminated
+	uint16_t modules;		// Total number of modules for data and ECC
+	uint8_t cclen;			// Character count length for byte mode
+	uint8_t ecc_cws[2];		// Number of ECC codewords for each ECC level
+	uint8_t ecc_blks[2][2];		// Number of ECC blocks in two groups for each ECC level
+};
+
+
+static const struct rmqrMetric rmetrics[32] = {
+
+	//      h    w              align  modules cc   ecc_cws  ecc_blks
+	//                                                M    H  M1 M2 H1 H2
+	RMETRIC( 7,  43,  21,   0,   0,   0,   104,  3,    7,  10,  1, 0, 1, 0),
+	RMETRIC( 7,  59,  19,  39,   0,   0,   171,  4,    9,  14,  1, 0, 1, 0),
+	RMETRIC( 7,  77,  25,  51,   0,   0,   261,  5,   12,  22,  1, 0, 1, 0),
+	RMETRIC( 7,  99,  23,  49,  75,   0,   358,  5,   16,  30,  1, 0, 1, 0),
+	RMETRIC( 7, 139,  27,  55,  83, 111,   545,  6,   24,  44,  1, 0, 2, 0),
+	RMETRIC( 9,  43,  21,   0,   0,   0,   170,  4,    9,  14,  1, 0, 1, 0),
+	RMETRIC( 9,  59,  19,  39,   0,   0,   267,  5,   12,  22,  1, 0, 1, 0),
+	RMETRIC( 9,  77,  25,  51,   0,   0,   393,  5,   18,  32,  1, 0, 1, 1),
+	RMETRIC( 9,  99,  23,  49,  75,   0,   532,  6,   24,  44,  1, 0, 2, 0),
+	RMETRIC( 9, 139,  27,  55,  83, 111,   797,  6,   36,  66,  1, 1, 3, 0),
+	RMETRIC(11,  27,   0,   0,   0,   0,   122,  3,    8,  10,  1, 0, 1, 0),
+	RMETRIC(11,  43,  21,   0,   0,   0,   249,  5,   12,  20,  1, 0, 1, 0),
+	RMETRIC(11,  59,  19,  39,   0,   0,   376,  5,   16,  32,  1, 0, 1, 1),
+	RMETRIC(11,  77,  25,  51,   0,   0,   538,  6,   24,  44,  1, 0, 1, 1),
+	RMETRIC(11,  99,  23,  49,  75,   0,   719,  6,   32,  60,  1, 1, 1, 1),
+	RMETRIC(11, 139,  27,  55,  83, 111,  1062,  7,   48,  90,  2, 0, 3, 0),
+	RMETRIC(13,  27,   0,   0,   0,   0,   172,  4,    9,  14,  1, 0, 1, 0),
+	RMETRIC(13,  43,  21,   0,   0,   0,   329,  5,   14,  28,  1, 0, 1, 0),
+	RMETRIC(13,  59,  19,  39,   0,   0,   486,  6,   22,  40,  1, 0, 2, 0),
+	RMETRIC(13,  77,  25,  51,   0,   0,   684,  6,   32,  56,  1, 1, 1, 1),
+	RMETRIC(13,  99,  23,  49,  75,   0,   907,  7,   40,  78,  1, 1, 1, 2),
+	RMETRIC(13, 139,  27,  55,  83, 111,  1328,  7,   60, 112,  2, 1, 2, 2),
+	RMETRIC(15,  43,  21,   0,   0,   0,   409,  6,   18,  36,  1, 0, 1, 1),
+	RMETRIC(15,  59,  19,  39,   0,   0,   596,  6,   26,  48,  1, 0, 2, 0),
+	RMETRIC(15,  77,  25,  51,   0,   0,   830,  7,   36,  72,  1, 1, 2, 1),
+	RMETRIC(15,  99,  23,  49,  75,   0,  1095,  7,   48,  88,  2, 0, 4, 0),
+	RMETRIC(15, 139,  27,  55,  83, 111,  1594,  7,   72, 130,  2, 1, 1, 4),
+	RMETRIC(17,  43,  21,   0,   0,   0,   489,  6,   22,  40,  1, 0, 1, 1),
+	RMETRIC(17,  59,  19,  39,   0,   0,   706,  6,   32,  60,  2, 0, 2, 0),
+	RMETRIC(17,  77,  25,  51,   0,   0,   976,  7,   44,  84,  2, 0, 1, 2),
+	RMETRIC(17,  99,  23,  49,  75,   0,  1283,  7,   60, 104,  2, 1, 4, 0),
+	RMETRIC(17, 139,  27,  55,  83, 111,  1860,  8,   80, 156,  4, 0, 2, 4),
+};
+
+
+// rMQR format information masks for the finder and sub-finder sides
+#define RMQR_FMT_MASK_FINDER	0x1FAB2
+#define RMQR_FMT_MASK_SUB	0x20A7B
+
+
 // Finder pattern bitmap
 static const uint8_t finder[8][8] = {
 	{ 1,1,1,1,1,1,1,0 },
@@ -186,7 +260,7 @@ static const uint32_t versionmap[34] = {
 	0x07c94, 0x085bc, 0x09a99, 0x0a4d3, 0x0bbf6, 0x0c762, 0x0d847,   //  v7-13
 	0x0e60d, 0x0f928, 0x10b78, 0x1145d, 0x12a17, 0x13532, 0x149a6,   // v14-20
 	0x15683, 0x168c9, 0x177ec, 0x18ec4, 0x191e1, 0x1afab, 0x1b08e,   // v21-27
-	0x1cc1a, 0x1d33f, 0x1ed75, 0x1f250, 0x209d5, 0x216fd, 0x228ba,   // v28-34
+	0x1cc1a, 0x1d33f, 0x1ed75, 0x1f250, 0x209d5, 0x216f0, 0x228ba,   // v28-34
 	0x2379f, 0x24b0b, 0x2542e, 0x26a64, 0x27541, 0x28c69,            // v35-40
 };
 
@@ -533,7 +607,6 @@ static uint32_t evalMask(const uint8_t *mtx, const struct metric *m) {
 
 // Append bits to a byte-encoded sequence
 static void addBits(uint8_t bitField[], uint16_t* bitPos, int length, uint16_t bits, const int max_length, const bool truncate) {
-	int i;
 
 	if (length == 0 || *bitPos == UINT16_MAX)
 		return;
@@ -550,41 +623,77 @@ static void addBits(uint8_t bitField[], uint16_t* bitPos, int length, uint16_t b
 	if (*bitPos + length > max_length)
 		length = max_length - *bitPos;
 
-	for (i = length-1; i >= 0; i--) {
-		if ((bits & 1) != 0) {
-			bitField[(*bitPos+i)/8] = (uint8_t)(bitField[(*bitPos+i)/8] | (0x80 >> ((*bitPos+i)%8)));
-		}
-		else {
-			bitField[(*bitPos+i)/8] = (uint8_t)(bitField[(*bitPos+i)/8] & (~(0x80 >> ((*bitPos+i)%8))));
-		}
-		bits >>= 1;
-	}
+	if (length > 0)
+		gs1_bitPut(bitField, *bitPos, length, bits);
 	*bitPos = (uint16_t)(*bitPos + length);
 
 	return;
 }
 
 
+// Strip the "^" that selects GS1 mode, or unescape a leading "\\...^" -> "\...^"
+static bool stripGS1Mode(const uint8_t **str) {
+
+	const uint8_t *p;
+
+	if (**str == '^') {		// "^..." => GS1 mode
+		(*str)++;
+		return true;
+	}
+
+	p = *str;
+	while (*p == '\\')
+		p++;
+	if (*p == '^')
+		(*str)++;
+
+	return false;
+
+}
+
+
+// Append a byte mode segment, preceded by FNC1 in first position for GS1 mode
+static void addByteSegment(uint8_t *cws, uint16_t *bits, const uint8_t *p, const bool gs1Mode,
+			   const int indlen, const uint16_t fnc1ind, const uint16_t byteind,
+			   const int cclen, const int max_length) {
+
+	// FNC1 in first
+	if (gs1Mode)
+		addBits(cws, bits, indlen, fnc1ind, max_length, false);
+
+	// Enter byte mode
+	addBits(cws, bits, indlen, byteind, max_length, false);
+
+	// Character count indicator
+	addBits(cws, bits, cclen, (uint16_t)strlen((const char *)p), max_length, false);
+
+	// Byte per character
+	while (*p) {
+		if (*p == '^' && gs1Mode)
+			addBits(cws, bits, 8, 0x1d, max_length, false);  // FNC1 -> GS
+		else
+			addBits(cws, bits, 8, *p, max_length, false);
+		p++;
+	}
+
+}
+
+
+// Length of the segment that addByteSegment() produces, without building it
+static int byteSegmentBits(const int len, const bool gs1Mode, const int indlen, const int cclen) {
+	return (gs1Mode ? indlen : 0) + indlen + cclen + 8*len;
+}
+
+
 // Generate the bitstream that represents the data message as a sequence of 8-bit codewords and length
 static void createCodewords(gs1_encoder *ctx, const uint8_t *str, uint8_t cws_v[3][MAX_QR_CWS], uint16_t bits_v[3]) {
 
 	int i;
-	bool gs1Mode = false;
-	const uint8_t *p;
+	bool gs1Mode;
 
 	(void) ctx;		// Silence compiler
 
-	if (*str == '^') {		// "^..." => GS1 mode
-		gs1Mode = true;
-		str++;
-	} else {
-		// Unescape leading sequence "\\...^" -> "\...^"
-		p = str;
-		while (*p == '\\')
-			p++;
-		if (*p == '^')
-			str++;
-	}
+	gs1Mode = stripGS1Mode(&str);
 
 	/*
 	 * Elements of the encoded message have differing lengths based on the
@@ -594,31 +703,8 @@ static void createCodewords(gs1_encoder *ctx, const uint8_t *str, uint8_t cws_v[
 	 * available vergrp, based on the format of symbol.
 	 *
 	 */
-	for (i = 0; i < 3; i++) {
-
-		p = str;
-
-		// 0101 FNC1 in first
-		if (gs1Mode)
-			addBits(cws_v[i], &bits_v[i], 4, 0x05, MAX_QR_DAT_BITS, false);
-
-		// 0100 Enter byte mode
-		addBits(cws_v[i], &bits_v[i], 4, 0x04, MAX_QR_DAT_BITS, false);
-
-		// Character count indicator
-		addBits(cws_v[i], &bits_v[i], cclens[i][2],
-			(uint16_t)strlen((char *)p), MAX_QR_DAT_BITS, false);
-
-		// Byte per character
-		while (*p) {
-			if (*p == '^' && gs1Mode)
-				addBits(cws_v[i], &bits_v[i], 8, 0x1d, MAX_QR_DAT_BITS, false);  // FNC1 -> GS
-			else
-				addBits(cws_v[i], &bits_v[i], 8, *p, MAX_QR_DAT_BITS, false);
-			p++;
-		}
-
-	}
+	for (i = 0; i < 3; i++)		// 0101 FNC1 in first; 0100 byte mode
+		addByteSegment(cws_v[i], &bits_v[i], str, gs1Mode, 4, 0x05, 0x04, cclens[i][2], MAX_QR_DAT_BITS);
 
 }
 
@@ -653,27 +739,25 @@ static const struct metric* selectVersion(gs1_encoder *ctx, const uint16_t bits_
 
 
 // Add terminator and padding to the bitstream then perform Reed Solomon Error Correction
-static void finaliseCodewords(gs1_encoder *ctx, uint8_t *cws, uint16_t *bits, const struct metric *m) {
+//
+// The symbol provides the number of modules, the number of error correction
+// codewords, the shorter and longer block counts and the terminator length
+static void finaliseCodewords(uint8_t *cws, uint16_t *bits, const int modules, const int ecws,
+			      const int ecb1, const int ecb2, const int termlen) {
 
 	uint8_t tmpcws[MAX_QR_CWS];
 
 	uint8_t coeffs[MAX_QR_ECC_CWS_PER_BLK+1];
 
-	int ncws, rbit, ecws, dcws, dmod, ecb1, ecb2, dcpb, ecpb;
+	int ncws, rbit, dcws, dmod, dcpb, ecpb;
 
 	uint8_t *p;
 	int i, j, a, b;
 
-	ncws = m->modules/8;				// Total number of codewords
-	rbit = m->modules%8;				// Number of remainder bit
-	ecws = m->ecc_cws[ctx->qrEClevel -
-		gs1_encoder_qrEClevelL];		// Number of error correction codewords
+	ncws = modules/8;				// Total number of codewords
+	rbit = modules%8;				// Number of remainder bit
 	dcws = ncws - ecws;				// Number of data codeword
 	dmod = dcws*8;					// Number of data modules
-	ecb1 = m->ecc_blks[ctx->qrEClevel -
-		gs1_encoder_qrEClevelL][0];		// First error correction blocks
-	ecb2 = m->ecc_blks[ctx->qrEClevel -
-		gs1_encoder_qrEClevelL][1];		// First error correction blocks
 	dcpb = dcws/(ecb1+ecb2);			// Base data codewords per block
 	ecpb = ncws/(ecb1+ecb2) - dcpb;			// Error correction codewords per block
 
@@ -681,7 +765,7 @@ static void finaliseCodewords(gs1_encoder *ctx, uint8_t *cws, uint16_t *bits, co
 	assert(ecpb <= MAX_QR_ECC_CWS_PER_BLK);
 
 	// Complete the message bits by adding the terminator, truncated if neccessary
-	addBits(cws, bits, 4, 0x00, dmod, true);  // 0000, or shorter at end
+	addBits(cws, bits, termlen, 0x00, dmod, true);  // 0000 (or 000), or shorter at end
 
 	// Expand the message bits by adding padding as necessary
 	while (*bits < dmod) {
@@ -723,6 +807,46 @@ static void finaliseCodewords(gs1_encoder *ctx, uint8_t *cws, uint16_t *bits, co
 }
 
 
+// Walk the symbol upwards and downwards in two module wide columns from the
+// right, placing the bitstream in modules that are not fixed patterns and
+// hopping over the given column. Coordinates are oblivious to the quiet zone.
+static int placeCodewords(uint8_t *mtx, const uint8_t *fix, const int w, const int h, const int qz,
+			  int x, const int hop, const uint8_t *cws) {
+
+	const int cols = w + 2*qz;
+	int y = h - 1;
+	int dir = -1;	// -1 upwards; 1 downwards
+	int col = 1;	// 0 is left bit; 1 is right bit
+	int k = 0;
+
+	while (x >= 0) {
+		if (!gs1_mtxGetModule(fix, cols, x + qz, y + qz)) {
+			gs1_mtxPutModule(mtx, cols, x + qz, y + qz, (uint8_t)((cws[k/8] >> (7-k%8)) & 1));
+			k++;
+		}
+		if (col == 1) {
+			col = 0;
+			x--;
+			continue;
+		}
+		col = 1;
+		x++;
+		y += dir;
+		if (y >= 0 && y < h)
+			continue;
+		// Turn around at top and bottom
+		dir *= -1;
+		x -= 2;
+		y += dir;
+		if (x == hop)
+			x--;
+	}
+
+	return k;
+
+}
+
+
 // Create a symbol that holds the given bitstream
 static void createMatrix(gs1_encoder *ctx, uint8_t *mtx, const uint8_t *cws, const struct metric *m) {
 
@@ -733,40 +857,17 @@ static void createMatrix(gs1_encoder *ctx, uint8_t *mtx, const uint8_t *cws, con
 	uint32_t formatval, versionval;
 	uint32_t bestScore = UINT32_MAX, score;
 
-	int i, j, k, col, dir;
+	int i, k;
 
 	// Plot fixtures, including reservation of format and version
 	// information
 	plotFixtures(mtx, fix, m);
 
-	// Walk the symbol placing the bitstream avoiding fixed patterns
-	i = j = m->size;
-	dir = -1;   // -1 updates; 1 downwards
-	col = 1;    // 0 is left bit; 1 is right bit
-	for (k = 0; i >= 1; )
-	{
-		if (!getModule(fix, i, j)) {
-			putModule(mtx, i, j, (uint8_t)((cws[k/8] >> (7-k%8)) & 1));
-			k++;
-		}
-		if (col == 1) {
-			col = 0;
-			i--;
-			continue;
-		}
-		col = 1;
-		i++;
-		j += dir;
-		if (j >= 1 && j <= m->size)
-			continue;
-		// Turn around at top and bottom
-		dir *= -1;
-		i -= 2;
-		j += dir;
-		if (i == 7)  // Hop over the timing pattern
-			i--;
-	}
+	// Walk the symbol placing the bitstream avoiding fixed patterns,
+	// hopping over the vertical timing pattern
+	k = placeCodewords(mtx, fix, m->size, m->size, QR_QZ, m->size - 1, 6, cws);
 	assert(k == m->modules);  // Filled the symbol
+	(void)k;
 
 	// Evaluate the masked symbols to find the most suitable
 	for (k = 0; k < (int)(SIZEOF_ARRAY(maskfun)); k++) {
@@ -809,32 +910,179 @@ static void createMatrix(gs1_encoder *ctx, uint8_t *mtx, const uint8_t *cws, con
 }
 
 
+// Syntactic sugar for rMQR coordinates, with (0,0) at top-left inside the quiet zone
+#define putRmqrModule(d, x, y, b) do {						\
+	assert((x) >= 0 && (y) >= 0 && (x) < rm->width && (y) < rm->height);	\
+	gs1_mtxPutModule(d, rm->width + 2*RMQR_QZ,				\
+		(x) + RMQR_QZ, (y) + RMQR_QZ, b);				\
+} while(0)
+
+#define getRmqrModule(s, x, y)							\
+	gs1_mtxGetModule(s, rm->width + 2*RMQR_QZ, (x) + RMQR_QZ, (y) + RMQR_QZ)
+
+#define putRmqrFixtureModule(x, y, b) do {					\
+	putRmqrModule(mtx, x, y, b);						\
+	putRmqrModule(fix, x, y, 1);						\
+} while(0)
+
+
+// Position of the k-th format information module beside the finder pattern
+// and beside the finder sub-pattern of an rMQR symbol
+static void rmqrFormatPos(const struct rmqrMetric *rm, const int k, int pos[2][2]) {
+
+	pos[0][0] = 8 + k/5;
+	pos[0][1] = 1 + k%5;
+	pos[1][0] = k < 15 ? rm->width - 8 + k/5 : rm->width - 20 + k;
+	pos[1][1] = k < 15 ? rm->height - 6 + k%5 : rm->height - 6;
+
+}
+
+
+// Plot all of the fixed-position artifacts of an rMQR symbol and reserve the
+// format information
+static void plotRmqrFixtures(uint8_t *mtx, uint8_t *fix, const struct rmqrMetric *rm) {
+
+	int i, j, k, pos[2][2];
+
+	// Plot timing patterns around the edges and down the alignment columns
+	for (i = 0; i < rm->width; i++) {
+		putRmqrFixtureModule(i, 0, (uint8_t)(i%2 == 0));
+		putRmqrFixtureModule(i, rm->height - 1, (uint8_t)(i%2 == 0));
+	}
+	for (j = 0; j < rm->height; j++) {
+		putRmqrFixtureModule(0, j, (uint8_t)(j%2 == 0));
+		putRmqrFixtureModule(rm->width - 1, j, (uint8_t)(j%2 == 0));
+		for (k = 0; k < (int)sizeof(rm->align) && rm->align[k]; k++)
+			putRmqrFixtureModule(rm->align[k], j, (uint8_t)(j%2 == 0));
+	}
+
+	// Plot corner finder patterns at top-right and bottom-left
+	putRmqrFixtureModule(rm->width - 2, 0, 1);
+	putRmqrFixtureModule(rm->width - 1, 0, 1);
+	putRmqrFixtureModule(rm->width - 2, 1, 0);
+	putRmqrFixtureModule(rm->width - 1, 1, 1);
+	for (i = 0; i < 3; i++)
+		putRmqrFixtureModule(i, rm->height - 1, 1);
+	if (rm->height >= 11) {
+		putRmqrFixtureModule(0, rm->height - 2, 1);
+		putRmqrFixtureModule(1, rm->height - 2, 0);
+	}
+
+	// Plot the finder pattern and its separator, clipped by the shortest symbols
+	for (i = 0; i < (int)sizeof(finder[0]); i++)
+		for (j = 0; j < (int)sizeof(finder[0]) && j < rm->height; j++)
+			putRmqrFixtureModule(i, j, finder[i][j]);
+
+	// Plot the finder sub-pattern, which has the form of a QR Code alignment pattern
+	for (i = 0; i < (int)sizeof(algnpat[0]); i++)
+		for (j = 0; j < (int)sizeof(algnpat[0]); j++)
+			putRmqrFixtureModule(rm->width - 5 + i, rm->height - 5 + j, algnpat[i][j]);
+
+	// Plot the alignment patterns at the top and bottom of each alignment column
+	for (k = 0; k < (int)sizeof(rm->align) && rm->align[k]; k++) {
+		for (i = -1; i <= 1; i++) {
+			for (j = 0; j < 3; j++) {
+				putRmqrFixtureModule(rm->align[k] + i, j, (uint8_t)(i != 0 || j != 1));
+				putRmqrFixtureModule(rm->align[k] + i, rm->height - 1 - j, (uint8_t)(i != 0 || j != 1));
+			}
+		}
+	}
+
+	// Reserve the format information modules
+	for (k = 0; k < 18; k++) {
+		rmqrFormatPos(rm, k, pos);
+		putRmqrFixtureModule(pos[0][0], pos[0][1], 0);
+		putRmqrFixtureModule(pos[1][0], pos[1][1], 0);
+	}
+
+}
+
+
+// Append the (18,6) BCH code to the rMQR format information
+static uint32_t rmqrFormatBCH(const uint32_t fmt) {
+
+	uint32_t rem = fmt << 12;
+	int i;
+
+	for (i = 5; i >= 0; i--)
+		if (rem & (UINT32_C(1) << (i + 12)))
+			rem ^= UINT32_C(0x1F25) << i;	// x^12+x^11+x^10+x^9+x^8+x^5+x^2+1
+
+	return fmt << 12 | rem;
+
+}
+
+
+// Create an rMQR symbol that holds the given bitstream
+static void createRmqrMatrix(uint8_t *mtx, const uint8_t *cws, const struct rmqrMetric *rm, const int ec) {
+
+	uint8_t fix[MAX_RMQR_BYTES] = { 0 };	// Matrix in which 1 indicates fixed pattern
+	uint32_t formatval;
+	int i, j, k, pos[2][2];
+
+	plotRmqrFixtures(mtx, fix, rm);
+
+	// Walk the symbol placing the bitstream avoiding fixed patterns, starting
+	// inside the vertical timing pattern on the right edge
+	k = placeCodewords(mtx, fix, rm->width, rm->height, RMQR_QZ, rm->width - 2, -1, cws);
+	assert(k == rm->modules);  // Filled the symbol
+	(void)k;
+
+	// There is a single mask
+	for (j = 0; j < rm->height; j++)
+		for (i = 0; i < rm->width; i++)
+			if (!getRmqrModule(fix, i, j) && (j/2 + i/3) % 2 == 0)
+				putRmqrModule(mtx, i, j, (uint8_t)(getRmqrModule(mtx, i, j) ^ 1));
+
+	// Plot the format information: ECC level then version indicator
+	formatval = rmqrFormatBCH((uint32_t)(ec << 5 | (int)(rm - rmetrics)));
+	for (k = 0; k < 18; k++) {
+		rmqrFormatPos(rm, k, pos);
+		putRmqrModule(mtx, pos[0][0], pos[0][1], (uint8_t)(((formatval ^ RMQR_FMT_MASK_FINDER) >> k) & 1));
+		putRmqrModule(mtx, pos[1][0], pos[1][1], (uint8_t)(((formatval ^ RMQR_FMT_MASK_SUB) >> k) & 1));
+	}
+
+}
+
+
+// Check that the input to a matrix symbology is an AI element string or DL URI
+static bool checkMatrixInput(gs1_encoder *ctx, const uint8_t *string, const char *name) {
+
+	if (*string == '^' && strchr((const char *)string, '|') != NULL) {
+		sprintf(ctx->errMsg, "Composite component is not supported for %s", name);
+		ctx->errFlag = true;
+		return false;
+	}
+
+	// For GS1 purposes we restrict to AI or DL only
+	if (!(*string == '^' ||
+	     (strlen((const char*)string) >= 8 && strncmp((const char*)string, "https://", 8) == 0) ||
+	     (strlen((const char*)string) >= 7 && strncmp((const char*)string, "http://",  7) == 0)) ) {
+		sprintf(ctx->errMsg, "%s input must be either an AI element string or a Digital Link URI", name);
+		ctx->errFlag = true;
+		return false;
+	}
+
+	return true;
+
+}
+
+
 static int QRenc(gs1_encoder *ctx, const uint8_t string[], struct patternLength *pats) {
 
 	uint8_t mtx[MAX_QR_BYTES] = { 0 };
 	uint8_t cws_v[3][MAX_QR_CWS] = { 0 };	// vergrp specific encodings
 	uint16_t bits_v[3] = { 0 };
 	const struct metric *m;
+	int ec;
 
 	assert(ctx->qrEClevel >= gs1_encoder_qrEClevelL && ctx->qrEClevel <= gs1_encoder_qrEClevelH);
 	assert(ctx->qrVersion >= 0 && ctx->qrVersion <= 40);
 
 	DEBUG_PRINT("\nData: %s\n", string);
 
-	if (*string == '^' && strchr((char *)string, '|') != NULL) {
-		strcpy(ctx->errMsg, "Composite component is not supported for QR Code");
-		ctx->errFlag = true;
+	if (!checkMatrixInput(ctx, string, "QR Code"))
 		return 0;
-	}
-
-	// For GS1 purposes we restrict to AI or DL only
-	if (!(*string == '^' ||
-	     (strlen((char*)string) >= 8 && strncmp((char*)string, "https://", 8) == 0) ||
-	     (strlen((char*)string) >= 7 && strncmp((char*)string, "http://",  7) == 0)) ) {
-		strcpy(ctx->errMsg, "QR Code input must be either an AI element string or a Digital Link URI");
-		ctx->errFlag = true;
-		return 0;
-	}
 
 	createCodewords(ctx, string, cws_v, bits_v);
 	if (bits_v[0] == UINT16_MAX && bits_v[1] == UINT16_MAX && bits_v[2] == UINT16_MAX) {
@@ -869,7 +1117,9 @@ static int QRenc(gs1_encoder *ctx, const uint8_t string[], struct patternLength
 
 	DEBUG_PRINT_CWS("Codewords", cws_v[m->vergrp], (uint16_t)((bits_v[m->vergrp]-1)/8+1));
 
-	finaliseCodewords(ctx, cws_v[m->vergrp], &bits_v[m->vergrp], m);
+	ec = ctx->qrEClevel - gs1_encoder_qrEClevelL;
+	finaliseCodewords(cws_v[m->vergrp], &bits_v[m->vergrp],
+			  m->modules, m->ecc_cws[ec], m->ecc_blks[ec][0], m->ecc_blks[ec][1], 4);
 
 	assert(bits_v[m->vergrp] <= MAX_QR_CWS*8);
 
@@ -888,7 +1138,145 @@ static int QRenc(gs1_encoder *ctx, const uint8_t string[], struct patternLength
 }
 
 
-void gs1_QR(gs1_encoder *ctx) {
+static int RMQRenc(gs1_encoder *ctx, const uint8_t string[], struct patternLength *pats) {
+
+	uint8_t mtx[MAX_RMQR_BYTES] = { 0 };
+	uint8_t cws[MAX_RMQR_CWS];
+	uint16_t bits = 0;
+	const struct rmqrMetric *rm = NULL;
+	const uint8_t *p = string;
+	bool gs1Mode;
+	int v, ec, len, dmod;
+
+	assert(ctx->qrEClevel >= gs1_encoder_qrEClevelL && ctx->qrEClevel <= gs1_encoder_qrEClevelH);
+
+	// rMQR has only levels M and H, so L is raised to M and Q to H
+	ec = ctx->qrEClevel >= gs1_encoder_qrEClevelQ ? 1 : 0;
+
+	DEBUG_PRINT("\nData: %s\n", string);
+
+	if (!checkMatrixInput(ctx, string, "rMQR"))
+		return 0;
+
+	gs1Mode = stripGS1Mode(&p);
+	len = (int)strlen((const char *)p);
+
+	// Select the first version that holds the bitstream, which is the
+	// shortest and then the narrowest
+	for (v = 0; v < (int)(SIZEOF_ARRAY(rmetrics)); v++) {
+		rm = &rmetrics[v];
+		if (len >= 1 << rm->cclen)
+			continue;
+		dmod = (rm->modules/8 - rm->ecc_cws[ec])*8;
+		memset(cws, 0, sizeof(cws));
+		bits = 0;
+		addByteSegment(cws, &bits, p, gs1Mode, 3, 0x05, 0x03, rm->cclen, dmod);	// 101 FNC1 in first; 011 byte mode
+		if (bits != UINT16_MAX)
+			break;
+	}
+	if (v == (int)(SIZEOF_ARRAY(rmetrics))) {
+		strcpy(ctx->errMsg, "Data exceeds the capacity of any rMQR symbol");
+		ctx->errFlag = true;
+		return 0;
+	}
+
+	DEBUG_PRINT("Symbol: R%dx%d-%d (ecc: %d; blocks: %d+%d)\n",
+		rm->height, rm->width, ctx->qrEClevel, rm->ecc_cws[ec],
+		rm->ecc_blks[ec][0], rm->ecc_blks[ec][1]);
+
+	DEBUG_PRINT_BITS("Bitstream", cws, bits);
+
+	finaliseCodewords(cws, &bits, rm->modules, rm->ecc_cws[ec], rm->ecc_blks[ec][0], rm->ecc_blks[ec][1], 3);
+
+	DEBUG_PRINT_CWS("Final codewords", cws, bits/8);
+
+	createRmqrMatrix(mtx, cws, rm, ec);
+
+	DEBUG_PRINT_MATRIX("Matrix", mtx, rm->width + 2*RMQR_QZ, rm->height + 2*RMQR_QZ);
+
+	gs1_mtxToPatterns(mtx, rm->width + 2*RMQR_QZ, rm->height + 2*RMQR_QZ, pats);
+
+	DEBUG_PRINT_PATTERN_LENGTHS("Patterns", pats, rm->height + 2*RMQR_QZ);
+
+	return rm->height + 2*RMQR_QZ;
+
+}
+
+
+// Report the version that QRenc() selects for the data, without encoding it
+bool gs1_QRcapacity(gs1_encoder *ctx, gs1_encoder_capacity *cap) {
+
+	const uint8_t *p = (const uint8_t *)ctx->dataStr;
+	const struct metric *m = NULL;
+	bool gs1Mode;
+	int vers, ec, len;
+
+	assert(ctx->qrEClevel >= gs1_encoder_qrEClevelL && ctx->qrEClevel <= gs1_encoder_qrEClevelH);
+	assert(ctx->qrVersion >= 0 && ctx->qrVersion <= 40);
+
+	if (!checkMatrixInput(ctx, p, "QR Code"))
+		return false;
+
+	gs1Mode = stripGS1Mode(&p);
+	len = (int)strlen((const char *)p);
+	ec = ctx->qrEClevel - gs1_encoder_qrEClevelL;
+
+	for (vers = ctx->qrVersion ? ctx->qrVersion : 1; vers < (int)(SIZEOF_ARRAY(metrics)); vers++) {
+		m = &metrics[vers];
+		cap->used = byteSegmentBits(len, gs1Mode, 4, cclens[m->vergrp][2]);
+		cap->capacity = (m->modules/8 - m->ecc_cws[ec])*8;
+		if (cap->used <= cap->capacity || ctx->qrVersion != 0)
+			break;
+	}
+
+	cap->units = gs1_encoder_capBITS;
+	cap->rows = cap->columns = m->size;
+	cap->fits = cap->used <= cap->capacity;
+
+	return true;
+
+}
+
+
+// Report the version that RMQRenc() selects for the data, without encoding it
+bool gs1_RMQRcapacity(gs1_encoder *ctx, gs1_encoder_capacity *cap) {
+
+	const uint8_t *p = (const uint8_t *)ctx->dataStr;
+	const struct rmqrMetric *rm = NULL;
+	bool gs1Mode;
+	int v, ec, len;
+
+	assert(ctx->qrEClevel >= gs1_encoder_qrEClevelL && ctx->qrEClevel <= gs1_encoder_qrEClevelH);
+
+	if (!checkMatrixInput(ctx, p, "rMQR"))
+		return false;
+
+	gs1Mode = stripGS1Mode(&p);
+	len = (int)strlen((const char *)p);
+	ec = ctx->qrEClevel >= gs1_encoder_qrEClevelQ ? 1 : 0;
+
+	cap->fits = false;
+	for (v = 0; v < (int)(SIZEOF_ARRAY(rmetrics)); v++) {
+		rm = &rmetrics[v];
+		cap->used = byteSegmentBits(len, gs1Mode, 3, rm->cclen);
+		cap->capacity = (rm->modules/8 - rm->ecc_cws[ec])*8;
+		if (len < 1 << rm->cclen && cap->used <= cap->capacity) {
+			cap->fits = true;
+			break;
+		}
+	}
+
+	cap->units = gs1_encoder_capBITS;
+	cap->rows = rm->height;
+	cap->columns = rm->width;
+
+	return true;
+
+}
+
+
+// Plot the rows of a matrix symbol produced by the given encoder
+static void plotMatrix(gs1_encoder *ctx, int (*enc)(gs1_encoder *ctx, const uint8_t string[], struct patternLength *pats)) {
 
 	struct sPrints prints = { 0 };
 	struct patternLength *pats;
@@ -897,7 +1285,7 @@ void gs1_QR(gs1_encoder *ctx) {
 
 	pats = ctx->qr_pats;
 
-	if (!(rows = QRenc(ctx, (uint8_t*)dataStr, pats)) || ctx->errFlag)
+	if (!(rows = enc(ctx, (uint8_t*)dataStr, pats)) || ctx->errFlag)
 		goto out;
 
 	cols = 0;
@@ -928,6 +1316,16 @@ out:
 }
 
 
+void gs1_QR(gs1_encoder *ctx) {
+	plotMatrix(ctx, QRenc);
+}
+
+
+void gs1_RMQR(gs1_encoder *ctx) {
+	plotMatrix(ctx, RMQRenc);
+}
+
+
 
 #ifdef UNIT_TESTS
 
@@ -1088,4 +1486,175 @@ NULL
 }
 
 
+void test_qr_RMQR_fixtures(void) {
+
+	int v, i, j, cnt, ec, dcws;
+	const struct rmqrMetric *rm;
+	uint8_t mtx[MAX_RMQR_BYTES];
+	uint8_t fix[MAX_RMQR_BYTES];
+	char casename[10];
+
+	// Check that the modules available after plotting the fixtures matches
+	// the values provided by the specification, and that the blocks evenly
+	// divide the ECC codewords
+	for (v = 0; v < (int)(SIZEOF_ARRAY(rmetrics)); v++) {
+		rm = &rmetrics[v];
+		memset(mtx, 0, MAX_RMQR_BYTES);
+		memset(fix, 0, MAX_RMQR_BYTES);
+		plotRmqrFixtures(mtx, fix, rm);
+		for (j = 0, cnt = 0; j < rm->height; j++)
+			for (i = 0; i < rm->width; i++)
+				cnt += getRmqrModule(fix, i, j) ^ 1;
+		sprintf(casename, "R%dx%d", rm->height, rm->width);
+		TEST_CASE(casename);
+		TEST_CHECK(cnt == rm->modules);
+		TEST_MSG("Expected %d; Got %d", rm->modules, cnt);
+		for (ec = 0; ec <= 1; ec++) {
+			dcws = rm->modules/8 - rm->ecc_cws[ec];
+			TEST_CHECK(rm->ecc_cws[ec] % (rm->ecc_blks[ec][0] + rm->ecc_blks[ec][1]) == 0);
+			TEST_CHECK(dcws % (rm->ecc_blks[ec][0] + rm->ecc_blks[ec][1]) == rm->ecc_blks[ec][1]);
+		}
+		TEST_CHECK(v == 0 || rm->height > rmetrics[v-1].height ||
+			   (rm->height == rmetrics[v-1].height && rm->width > rmetrics[v-1].width));
+	}
+
+	// The format information uses the same (18,6) code as the QR Code version
+	// information
+	for (v = 7; v <= 40; v++)
+		TEST_CHECK(rmqrFormatBCH((uint32_t)v) == versionmap[v-7]);
+
+}
+
+
+void test_qr_RMQR_encode(void) {
+
+	const char** expect;
+	char **strings;
+	char data[128];
+	size_t rows, lastRows;
+	int i;
+
+	gs1_encoder* ctx = gs1_encoder_init(NULL);
+
+	expect = (const char*[]){
+"                                                                                                       ",
+"                                                                                                       ",
+"  XXXXXXX X X X X X X X XXX X X X X X X X X X X X XXX X X X X X X X X X X X XXX X X X X X X X X X XXX  ",
+"  X     X  XXXXX XX XX  X X X    XXX XX  X   X XXXX XXX X X  X XXXX X    XXXX XXXX X   XX XX XXX  X X  ",
+"  X XXX X  X X  X XX  X XXXX       X   X     XXXXXXXXXX  X XXX XXXX      X XXXX X  X     XXX    XXXXX  ",
+"  X XXX X  X  X  XX  XX      XX X   X  X X X   XX    X X    X X    X XXXX X   XX  X XXXX XXXX  XX   X  ",
+"  X XXX X X    X   XXX  XXXXXX X    XX X X XXX X  XXXX   XX X X      XXXX X XXX   X  XXX X XX  XX X X  ",
+"  X     X X X XXXX  X X X XXX     X XXXX    X X XXX X  XXXX  X XXXX X      XX XXXX X   XX XX X  X   X  ",
+"  XXXXXXX X X X X X X X XXX X X X X X X X X X X X XXX X X X X X X X X X X X XXX X X X X X X X X XXXXX  ",
+"                                                                                                       ",
+"                                                                                                       ",
+NULL
+	};
+	TEST_CHECK(test_encode(ctx, true, gs1_encoder_sRMQR, "^011231231231233310ABC123", expect));
+
+	// Version selection favours the shortest symbol as the data grows
+	lastRows = 0;
+	for (i = 1; i <= 60; i++) {
+		sprintf(data, "^99%0*d", i, 0);
+		TEST_CHECK(gs1_encoder_setDataStr(ctx, data));
+		TEST_CHECK(gs1_encoder_encode(ctx));
+		TEST_MSG("Error: %s", gs1_encoder_getErrMsg(ctx));
+		rows = gs1_encoder_getBufferStrings(ctx, &strings);
+		TEST_CHECK(rows >= lastRows);
+		lastRows = rows;
+	}
+
+	TEST_CHECK(gs1_encoder_setDataStr(ctx, "^99A"));
+	TEST_CHECK(gs1_encoder_encode(ctx));
+	TEST_CHECK(gs1_encoder_getBufferStrings(ctx, &strings) == 7 + 2*RMQR_QZ);
+	TEST_CHECK(strlen(strings[0]) == 43 + 2*RMQR_QZ);
+
+	TEST_CHECK(gs1_encoder_setQrEClevel(ctx, gs1_encoder_qrEClevelH));
+	TEST_CHECK(gs1_encoder_encode(ctx));
+	TEST_CHECK(gs1_encoder_getBufferStrings(ctx, &strings) == 7 + 2*RMQR_QZ);
+	TEST_CHECK(strlen(strings[0]) == 59 + 2*RMQR_QZ);
+	TEST_CHECK(gs1_encoder_setQrEClevel(ctx, gs1_encoder_qrEClevelM));
+
+	TEST_CHECK(test_encode(ctx, false, gs1_encoder_sRMQR, "^0112345678901231|^99ABC", NULL));  // CC is invalid
+	TEST_CHECK(test_encode(ctx, false, gs1_encoder_sRMQR, "ABC", NULL));  // Not AI or DL
+
+	memset(data, 0, sizeof(data));
+	strcpy(data, "^99");
+	memset(data + 3, 'A', 90);
+	TEST_CHECK(gs1_encoder_setDataStr(ctx, data));
+	TEST_CHECK(gs1_encoder_setQrEClevel(ctx, gs1_encoder_qrEClevelH));
+	TEST_CHECK(!gs1_encoder_encode(ctx));
+	TEST_CHECK(strcmp(gs1_encoder_getErrMsg(ctx), "Data exceeds the capacity of any rMQR symbol") == 0);
+
+	gs1_encoder_free(ctx);
+
+}
+
+
+void test_qr_QRcapacity(void) {
+
+	static uint8_t cws_v[3][MAX_QR_CWS];
+	uint16_t bits_v[3];
+	const struct metric *m, *sel;
+	gs1_encoder_capacity cap;
+	int ec, v, len, n;
+	bool okay;
+
+	gs1_encoder* ctx = gs1_encoder_init(NULL);
+
+	// Either side of the capacity of each version the query agrees with the
+	// selection made by the encoder
+	for (ec = gs1_encoder_qrEClevelL; ec <= gs1_encoder_qrEClevelH; ec++) {
+		TEST_ASSERT(gs1_encoder_setQrEClevel(ctx, ec));
+		for (v = 1; v <= 40; v++) {
+			m = &metrics[v];
+			len = ((m->modules/8 - m->ecc_cws[ec - gs1_encoder_qrEClevelL])*8 - 4 - 4 -
+				cclens[m->vergrp][2]) / 8;
+			for (n = len; n <= len+1; n++) {
+				ctx->dataStr[0] = '^';
+				memset(ctx->dataStr+1, 'A', (size_t)n);
+				ctx->dataStr[n+1] = '\0';
+				memset(bits_v, 0, sizeof(bits_v));
+				createCodewords(ctx, (uint8_t*)ctx->dataStr, cws_v, bits_v);
+
+				TEST_ASSERT(gs1_encoder_setQrVersion(ctx, 0));
+				sel = selectVersion(ctx, bits_v);
+				TEST_ASSERT(gs1_QRcapacity(ctx, &cap));
+				TEST_CHECK(cap.fits == (sel != NULL));
+				TEST_CHECK(!sel || (cap.rows == sel->size && cap.used == bits_v[sel->vergrp]));
+				TEST_MSG("V%d-%d length %d", v, ec, n);
+
+				TEST_ASSERT(gs1_encoder_setQrVersion(ctx, v));
+				TEST_ASSERT(gs1_QRcapacity(ctx, &cap));
+				okay = n == len;
+				TEST_CHECK(cap.fits == okay);
+				TEST_CHECK(cap.rows == m->size);
+				TEST_CHECK(cap.used == bits_v[m->vergrp] || bits_v[m->vergrp] == UINT16_MAX);
+				TEST_MSG("V%d-%d length %d", v, ec, n);
+			}
+		}
+	}
+
+	// The rMQR query selects the symbol that is encoded
+	TEST_ASSERT(gs1_encoder_setFormat(ctx, gs1_encoder_dRAW));
+	TEST_ASSERT(gs1_encoder_setSym(ctx, gs1_encoder_sRMQR));
+	TEST_ASSERT(gs1_encoder_setQrEClevel(ctx, gs1_encoder_qrEClevelM));
+	for (n = 1; n <= 140; n += 7) {
+		sprintf(ctx->dataStr, "^99%0*d", n, 0);
+		TEST_ASSERT(gs1_RMQRcapacity(ctx, &cap));
+		for (v = 0; rmetrics[v].height != cap.rows || rmetrics[v].width != cap.columns; v++);
+		TEST_CHECK(cap.used == 3 + 3 + rmetrics[v].cclen + 8*(n+2));
+		TEST_CHECK(cap.fits == gs1_encoder_encode(ctx));
+		if (cap.fits) {
+			TEST_CHECK(gs1_encoder_getBufferWidth(ctx) == cap.columns + 2*RMQR_QZ);
+			TEST_CHECK(gs1_encoder_getBufferHeight(ctx) == cap.rows + 2*RMQR_QZ);
+		}
+		TEST_MSG("length %d", n);
+	}
+
+	gs1_encoder_free(ctx);
+
+}
+
+
 #endif  /* UNIT_TESTS */
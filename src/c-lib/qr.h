@@ -32,11 +32,20 @@
 #define MAX_QR_DAT_CWS_PER_BLK	128
 #define MAX_QR_ECC_CWS_PER_BLK	128
 
+#define RMQR_QZ		2
+#define MAX_RMQR_W	(139 + 2*RMQR_QZ)
+#define MAX_RMQR_H	(17 + 2*RMQR_QZ)
+#define MAX_RMQR_BYTES	(((MAX_RMQR_W-1)/8+1) * MAX_RMQR_H)
+#define MAX_RMQR_CWS	233	// Maximum overall codewords (R17x139), plus remainder
+
 
 #include "gs1encoders.h"
 
 
 void gs1_QR(gs1_encoder *ctx);
+void gs1_RMQR(gs1_encoder *ctx);
+bool gs1_QRcapacity(gs1_encoder *ctx, gs1_encoder_capacity *cap);
+bool gs1_RMQRcapacity(gs1_encoder *ctx, gs1_encoder_capacity *cap);
 
 
 #ifdef UNIT_TESTS
@@ -44,6 +53,9 @@ void gs1_QR(gs1_encoder *ctx);
 void test_qr_QR_fixtures(void);
 void test_qr_QR_versions(void);
 void test_qr_QR_encode(void);
+void test_qr_RMQR_fixtures(void);
+void test_qr_RMQR_encode(void);
+void test_qr_QRcapacity(void);
 
 #endif
 
@@ -0,0 +1,922 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#define QUEUE_EVENTFD
+#endif
+
+#include "enc-private.h"
+#include "queue.h"
+
+
+/*
+ *  Cheap estimate of the time to encode a request, in roughly microseconds,
+ *  from the symbology, data length, format and X dimension alone. Matrix
+ *  symbols are sized from the data, since the QR Code mask evaluation
+ *  dominates once the symbol is large, and composite components are priced
+ *  per character
+ *
+ */
+int gs1_queueCost(const gs1_encoder_request *req) {
+
+	static const int area[gs1_encoder_sNUMSYMS] = {		// Fixed-size modules, including quiet zones
+		[gs1_encoder_sDataBarOmni]		= 96 * 33,
+		[gs1_encoder_sDataBarTruncated]		= 96 * 13,
+		[gs1_encoder_sDataBarStacked]		= 50 * 13,
+		[gs1_encoder_sDataBarStackedOmni]	= 50 * 69,
+		[gs1_encoder_sDataBarLimited]		= 79 * 10,
+		[gs1_encoder_sUPCA]			= 113 * 74,
+		[gs1_encoder_sUPCE]			= 65 * 74,
+		[gs1_encoder_sEAN13]			= 113 * 74,
+		[gs1_encoder_sEAN8]			= 81 * 60,
+		[gs1_encoder_sITF14]			= 155 * 42,
+	};
+	const char *cc;
+	int64_t len, ccLen = 0, mods, pixMult, cost;
+
+	len = req->dataStr ? (int64_t)strlen(req->dataStr) : 0;
+	if (req->dataStr && (cc = strchr(req->dataStr, '|')) != NULL) {
+		ccLen = len - (cc - req->dataStr) - 1;
+		len -= ccLen + 1;
+	}
+	pixMult = req->pixMult > 0 ? req->pixMult : 1;
+
+	switch (req->sym) {
+	case gs1_encoder_sQR:
+		mods = 441 + 15 * len;
+		cost = mods / 2;
+		break;
+	case gs1_encoder_sDM:
+		mods = 100 + 16 * len;
+		cost = len + 10;
+		break;
+	case gs1_encoder_sRMQR:
+		mods = 300 + 12 * len;
+		cost = len + 10;
+		break;
+	case gs1_encoder_sDataBarExpanded:
+		mods = 150 * len;
+		cost = 4 + len / 8;
+		break;
+	case gs1_encoder_sGS1_128_CCA:
+	case gs1_encoder_sGS1_128_CCC:
+		mods = (7 * len + 70) * (req->gs1_128LinearHeight > 0 ? req->gs1_128LinearHeight : 25);
+		cost = 4 + len / 8;
+		break;
+	default:
+		mods = req->sym >= 0 && req->sym < gs1_encoder_sNUMSYMS ? area[req->sym] : 0;
+		cost = 4;
+		break;
+	}
+
+	if (ccLen) {
+		mods += 60 * ccLen;
+		cost += 5 + ccLen / 2;
+	}
+
+	switch (req->format) {
+	case gs1_encoder_dGRAY:
+		cost += mods / 128;
+		break;
+	case gs1_encoder_dRGBA:
+		cost += mods / 64;
+		break;
+	case gs1_encoder_dPATH:
+		cost += mods / 100;
+		break;
+	default:
+		cost += mods * pixMult * pixMult / 10000;
+		break;
+	}
+
+	return cost < INT32_MAX ? (int)cost : INT32_MAX;
+
+}
+
+
+#if !defined(NOMALLOC) && !defined(_WIN32)
+
+/*
+ *  Asynchronous encoding for event loops: each request is copied into one of
+ *  a fixed set of jobs and handed to a worker thread, which owns an instance
+ *  of its own, over a single-producer single-consumer ring so that submitting
+ *  never takes a lock. Workers push finished jobs onto rings of their own and
+ *  signal a pollable descriptor, then the caller harvests them in batches
+ *
+ *  So that quick requests are not held up behind slow ones, each worker takes
+ *  from its bulk lane only when its express lane is empty, and with more than
+ *  one worker the first never receives bulk requests. Requests otherwise go to
+ *  the worker with the least estimated work outstanding
+ *
+ */
+
+// Descriptor that counts signals: an eventfd on Linux, otherwise a pipe
+struct notifier {
+	int rfd;
+	int wfd;
+};
+
+struct ring {
+	unsigned head;			// Advanced by the consumer
+	unsigned tail;			// Advanced by the producer
+	unsigned mask;
+	int *jobs;
+};
+
+struct queueJob {
+	gs1_encoder_request req;
+	uint64_t tag;
+	char dataStr[2*MAX_DATA+1];	// Bracketed AI syntax is longer than the data it encodes
+	char outFile[MAX_FNAME+1];
+	gs1_encoder_result res;
+	uint8_t *out;			// Copy of the output buffer followed by the HRI strings
+	size_t outCap;
+	int hriOffsets[MAX_AIS];
+	uint8_t digest[MAX_DIGEST_LEN];
+	char errMsg[sizeof(((gs1_encoder*)0)->errMsg)];
+	int cost;
+};
+
+struct queueWorker {
+	struct queueState *q;
+	gs1_encoder *ctx;
+	pthread_t thread;
+	bool started;
+	struct notifier wake;		// One signal per job submitted, and one to stop
+	struct ring in;			// Express lane
+	struct ring bulk;
+	struct ring out;
+	uint64_t submittedCost;		// Estimated cost of all jobs given to the worker
+	uint64_t doneCost;		// ... and of those it has completed
+};
+
+struct queueState {
+	int numThreads;
+	int depth;
+	struct queueWorker *workers;
+	struct queueJob *jobs;
+	int *free;			// Jobs available to the submitter
+	int numFree;
+	int *lent;			// Jobs whose results were last harvested
+	int numLent;
+	int next;			// Worker to favour when tied
+	struct notifier done;
+	pthread_mutex_t guardMutex;	// Serialises the workers' use of the owner's serial guard
+	bool guardMutexInit;
+};
+
+
+static bool notifierOpen(struct notifier *n, const bool semaphore) {
+
+#ifdef QUEUE_EVENTFD
+	n->rfd = n->wfd = eventfd(0, EFD_CLOEXEC | (semaphore ? EFD_SEMAPHORE : EFD_NONBLOCK));
+	return n->rfd >= 0;
+#else
+	int fds[2];
+
+	if (pipe(fds) != 0)
+		return false;
+	n->rfd = fds[0];
+	n->wfd = fds[1];
+	(void)fcntl(n->rfd, F_SETFD, FD_CLOEXEC);
+	(void)fcntl(n->wfd, F_SETFD, FD_CLOEXEC);
+	(void)fcntl(n->wfd, F_SETFL, O_NONBLOCK);
+	if (!semaphore)
+		(void)fcntl(n->rfd, F_SETFL, O_NONBLOCK);
+	return true;
+#endif
+
+}
+
+
+static void notifierClose(struct notifier *n) {
+	if (n->wfd >= 0 && n->wfd != n->rfd)
+		close(n->wfd);
+	if (n->rfd >= 0)
+		close(n->rfd);
+	n->rfd = n->wfd = -1;
+}
+
+
+static void notifierSignal(const struct notifier *n) {
+
+#ifdef QUEUE_EVENTFD
+	const uint64_t one = 1;
+	while (write(n->wfd, &one, sizeof(one)) < 0 && errno == EINTR);
+#else
+	const uint8_t one = 1;
+	while (write(n->wfd, &one, sizeof(one)) < 0 && errno == EINTR);	// A full pipe is readable already
+#endif
+
+}
+
+
+// Block until a signal arrives, then consume it
+static bool notifierWait(const struct notifier *n) {
+
+#ifdef QUEUE_EVENTFD
+	uint64_t val;
+#else
+	uint8_t val;
+#endif
+	ssize_t r;
+
+	while ((r = read(n->rfd, &val, sizeof(val))) < 0 && errno == EINTR);
+	return r == (ssize_t)sizeof(val);
+
+}
+
+
+// Consume all pending signals without blocking
+static void notifierDrain(const struct notifier *n) {
+
+	uint8_t buf[64];
+
+#ifdef QUEUE_EVENTFD
+	while (read(n->rfd, buf, sizeof(uint64_t)) < 0 && errno == EINTR);
+#else
+	ssize_t r;
+
+	while ((r = read(n->rfd, buf, sizeof(buf))) > 0 || (r < 0 && errno == EINTR));
+#endif
+
+}
+
+
+static bool ringInit(struct ring *r, const int depth) {
+
+	unsigned size = 1;
+
+	while (size < (unsigned)depth)
+		size <<= 1;
+	r->head = r->tail = 0;
+	r->mask = size - 1;
+	return (r->jobs = malloc(size * sizeof(int))) != NULL;
+
+}
+
+
+// Never overflows, since there are no more jobs than entries in a ring
+static void ringPush(struct ring *r, const int job) {
+
+	const unsigned tail = r->tail;
+
+	r->jobs[tail & r->mask] = job;
+	__atomic_store_n(&r->tail, tail + 1, __ATOMIC_RELEASE);
+
+}
+
+
+static bool ringPop(struct ring *r, int *job) {
+
+	const unsigned head = r->head;
+
+	if (head == __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE))
+		return false;
+	*job = r->jobs[head & r->mask];
+	__atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+	return true;
+
+}
+
+
+static bool ringEmpty(struct ring *r) {
+	return r->head == __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+}
+
+
+// Encode using the worker's instance and take a copy of the outcome, which the
+// instance overwrites with its next symbol
+static void runJob(gs1_encoder *ctx, struct queueJob *job) {
+
+	gs1_encoder_result res;
+	size_t hriLen = 0, need;
+	uint8_t *out;
+
+	gs1_encoder_encodeRequest(ctx, &job->req, &res);
+
+	if (res.status && res.numHRI > 0)
+		hriLen = (size_t)res.hriOffsets[res.numHRI - 1] + strlen(res.hri + res.hriOffsets[res.numHRI - 1]) + 1;
+	need = res.bufferSize + hriLen + 1;
+
+	if (res.status && need > job->outCap) {
+		if ((out = realloc(job->out, need)) == NULL) {
+			res.status = 0;
+			strcpy(ctx->errMsg, "Out of memory copying the encoder output");
+			res.errMsg = ctx->errMsg;
+		} else {
+			job->out = out;
+			job->outCap = need;
+		}
+	}
+
+	strcpy(job->errMsg, res.errMsg);
+	res.errMsg = job->errMsg;
+
+	if (!res.status) {
+		res.buffer = NULL;
+		res.bufferSize = 0;
+		res.numHRI = 0;
+		res.hri = NULL;
+		res.hriOffsets = NULL;
+		res.digest = NULL;
+		res.digestSize = 0;
+		job->res = res;
+		return;
+	}
+
+	if (res.buffer) {
+		memcpy(job->out, res.buffer, res.bufferSize);
+		res.buffer = job->out;
+	}
+	memcpy(job->out + res.bufferSize, res.hri, hriLen);
+	job->out[res.bufferSize + hriLen] = '\0';
+	res.hri = (const char*)job->out + res.bufferSize;
+	memcpy(job->hriOffsets, res.hriOffsets, (size_t)res.numHRI * sizeof(int));
+	res.hriOffsets = job->hriOffsets;
+	if (res.digest) {
+		memcpy(job->digest, res.digest, res.digestSize);
+		res.digest = job->digest;
+	}
+	job->res = res;
+
+}
+
+
+static void* worker(void *arg) {
+
+	struct queueWorker *w = arg;
+	int job;
+
+	// Jobs are signalled before the request to stop, so all are completed
+	while (notifierWait(&w->wake) && (ringPop(&w->in, &job) || ringPop(&w->bulk, &job))) {
+		runJob(w->ctx, &w->q->jobs[job]);
+		__atomic_store_n(&w->doneCost, w->doneCost + (uint64_t)w->q->jobs[job].cost, __ATOMIC_RELEASE);
+		ringPush(&w->out, job);
+		notifierSignal(&w->q->done);
+	}
+
+	return NULL;
+
+}
+
+
+// Stop the workers once their queued jobs are complete and release everything
+static void teardown(struct queueState *q) {
+
+	struct queueWorker *w;
+	int i;
+
+	for (i = 0; i < q->numThreads; i++) {
+		w = &q->workers[i];
+		if (w->started) {
+			notifierSignal(&w->wake);
+			pthread_join(w->thread, NULL);
+		}
+		if (w->ctx)
+			gs1_encoder_free(w->ctx);
+		notifierClose(&w->wake);
+		free(w->in.jobs);
+		free(w->bulk.jobs);
+		free(w->out.jobs);
+	}
+
+	if (q->jobs)
+		for (i = 0; i < q->depth; i++)
+			free(q->jobs[i].out);
+
+	notifierClose(&q->done);
+	if (q->guardMutexInit)
+		pthread_mutex_destroy(&q->guardMutex);
+	free(q->workers);
+	free(q->jobs);
+	free(q->free);
+	free(q->lent);
+	free(q);
+
+}
+
+
+bool gs1_queueOpen(gs1_encoder *ctx, const int threads, const int depth) {
+
+	struct queueState *q;
+	struct queueWorker *w;
+	int i;
+
+	if (ctx->queue) {
+		strcpy(ctx->errMsg, "Encode queue is already open");
+		ctx->errFlag = true;
+		return false;
+	}
+
+	if (threads < 1 || threads > QUEUE_MAX_THREADS) {
+		sprintf(ctx->errMsg, "Valid encode queue threads is 1 to %d", QUEUE_MAX_THREADS);
+		ctx->errFlag = true;
+		return false;
+	}
+
+	if (depth < 1 || depth > QUEUE_MAX_DEPTH) {
+		sprintf(ctx->errMsg, "Valid encode queue depth is 1 to %d", QUEUE_MAX_DEPTH);
+		ctx->errFlag = true;
+		return false;
+	}
+
+	if ((q = calloc(1, sizeof(struct queueState))) == NULL)
+		goto oom;
+
+	q->done.rfd = q->done.wfd = -1;
+	q->depth = depth;
+	if ((q->jobs = calloc((size_t)depth, sizeof(struct queueJob))) == NULL ||
+	    (q->free = malloc((size_t)depth * sizeof(int))) == NULL ||
+	    (q->lent = malloc((size_t)depth * sizeof(int))) == NULL ||
+	    (q->workers = calloc((size_t)threads, sizeof(struct queueWorker))) == NULL)
+		goto oom;
+
+	for (i = 0; i < depth; i++)
+		q->free[i] = depth - 1 - i;
+	q->numFree = depth;
+
+	q->numThreads = threads;
+	for (i = 0; i < threads; i++) {
+		w = &q->workers[i];
+		w->q = q;
+		w->wake.rfd = w->wake.wfd = -1;
+	}
+
+	if (pthread_mutex_init(&q->guardMutex, NULL) != 0)
+		goto fail;
+	q->guardMutexInit = true;
+
+	// Workers record serials against the guard of this instance
+	for (i = 0; i < threads; i++) {
+		w = &q->workers[i];
+		if ((w->ctx = gs1_encoder_init(NULL)) == NULL ||
+		    !ringInit(&w->in, depth) || !ringInit(&w->bulk, depth) || !ringInit(&w->out, depth))
+			goto oom;
+		w->ctx->guard.shared = &ctx->guard;
+		if (!notifierOpen(&w->wake, true))
+			goto fail;
+	}
+
+	if (!notifierOpen(&q->done, false))
+		goto fail;
+
+	for (i = 0; i < threads; i++) {
+		w = &q->workers[i];
+		if (pthread_create(&w->thread, NULL, worker, w) != 0)
+			goto fail;
+		w->started = true;
+	}
+
+	ctx->guard.mutex = &q->guardMutex;
+	ctx->queue = q;
+	return true;
+
+oom:
+
+	if (q)
+		teardown(q);
+	strcpy(ctx->errMsg, "Out of memory allocating the encode queue");
+	ctx->errFlag = true;
+	return false;
+
+fail:
+
+	teardown(q);
+	strcpy(ctx->errMsg, "Failed to start the encode queue");
+	ctx->errFlag = true;
+	return false;
+
+}
+
+
+// Wait for submitted requests to finish, discarding any unharvested results
+bool gs1_queueClose(gs1_encoder *ctx) {
+
+	if (!ctx->queue) {
+		strcpy(ctx->errMsg, "No encode queue is open");
+		ctx->errFlag = true;
+		return false;
+	}
+
+	teardown(ctx->queue);
+	ctx->queue = NULL;
+	ctx->guard.mutex = NULL;
+	return true;
+
+}
+
+
+int gs1_queueFd(const gs1_encoder *ctx) {
+	return ctx->queue ? ctx->queue->done.rfd : -1;
+}
+
+
+bool gs1_queueSubmit(gs1_encoder *ctx, const gs1_encoder_request *req, const uint64_t tag) {
+
+	struct queueState *q = ctx->queue;
+	struct queueWorker *w = NULL;
+	struct queueJob *job;
+	const size_t maxData = req->aiSyntax ? 2*MAX_DATA : MAX_DATA;
+	uint64_t load, least = 0;
+	bool bulk;
+	int i, j, k;
+
+	if (!q) {
+		strcpy(ctx->errMsg, "No encode queue is open");
+		ctx->errFlag = true;
+		return false;
+	}
+
+	if (q->numFree == 0) {
+		strcpy(ctx->errMsg, "Encode queue is full");
+		ctx->errFlag = true;
+		return false;
+	}
+
+	if (req->dataStr && strlen(req->dataStr) > maxData) {
+		sprintf(ctx->errMsg, "Maximum data length is %d characters", (int)maxData);
+		ctx->errFlag = true;
+		return false;
+	}
+
+	if (req->outFile && strlen(req->outFile) > MAX_FNAME) {
+		sprintf(ctx->errMsg, "Maximum output file is %d characters", MAX_FNAME);
+		ctx->errFlag = true;
+		return false;
+	}
+
+	j = q->free[--q->numFree];
+	job = &q->jobs[j];
+	if (!gs1_requestCopy(ctx, &job->req, req)) {
+		q->numFree++;
+		return false;
+	}
+	job->tag = tag;
+	if (req->dataStr)
+		job->req.dataStr = strcpy(job->dataStr, req->dataStr);
+	if (req->outFile)
+		job->req.outFile = strcpy(job->outFile, req->outFile);
+
+	job->cost = gs1_queueCost(req);
+	bulk = job->cost >= QUEUE_BULK_COST;
+
+	// Least loaded worker, starting from each in turn to share out ties
+	for (i = 0; i < q->numThreads; i++) {
+		k = (q->next + i) % q->numThreads;
+		if (bulk && k == 0 && q->numThreads > 1)
+			continue;
+		load = q->workers[k].submittedCost - __atomic_load_n(&q->workers[k].doneCost, __ATOMIC_ACQUIRE);
+		if (!w || load < least) {
+			w = &q->workers[k];
+			least = load;
+		}
+	}
+	q->next = (q->next + 1) % q->numThreads;
+
+	w->submittedCost += (uint64_t)job->cost;
+	ringPush(bulk ? &w->bulk : &w->in, j);
+	notifierSignal(&w->wake);
+
+	return true;
+
+}
+
+
+int gs1_queueHarvest(gs1_encoder *ctx, gs1_encoder_completion *out, const int max) {
+
+	struct queueState *q = ctx->queue;
+	struct queueWorker *w;
+	int i, j, n = 0;
+
+	if (!q) {
+		strcpy(ctx->errMsg, "No encode queue is open");
+		ctx->errFlag = true;
+		return 0;
+	}
+
+	// Results from the previous harvest are no longer referenced
+	while (q->numLent > 0)
+		q->free[q->numFree++] = q->lent[--q->numLent];
+
+	notifierDrain(&q->done);
+
+	for (i = 0; i < q->numThreads && n < max; i++) {
+		w = &q->workers[i];
+		while (n < max && ringPop(&w->out, &j)) {
+			out[n].tag = q->jobs[j].tag;
+			out[n].result = q->jobs[j].res;
+			q->lent[q->numLent++] = j;
+			n++;
+		}
+	}
+
+	// Remain readable while completions are left for another harvest
+	for (i = 0; i < q->numThreads; i++)
+		if (!ringEmpty(&q->workers[i].out)) {
+			notifierSignal(&q->done);
+			break;
+		}
+
+	return n;
+
+}
+
+
+#else
+
+/*
+ *  Worker instances are allocated on the heap and there is no pollable
+ *  descriptor on Windows, so the encode queue is unavailable in such builds
+ *
+ */
+
+#ifdef NOMALLOC
+#define QUEUE_UNAVAILABLE "Encode queue is not available in NOMALLOC builds"
+#else
+#define QUEUE_UNAVAILABLE "Encode queue is not available on this platform"
+#endif
+
+bool gs1_queueOpen(gs1_encoder *ctx, const int threads, const int depth) {
+	(void)threads;
+	(void)depth;
+	strcpy(ctx->errMsg, QUEUE_UNAVAILABLE);
+	ctx->errFlag = true;
+	return false;
+}
+
+bool gs1_queueClose(gs1_encoder *ctx) {
+	strcpy(ctx->errMsg, "No encode queue is open");
+	ctx->errFlag = true;
+	return false;
+}
+
+int gs1_queueFd(const gs1_encoder *ctx) {
+	(void)ctx;
+	return -1;
+}
+
+bool gs1_queueSubmit(gs1_encoder *ctx, const gs1_encoder_request *req, const uint64_t tag) {
+	(void)req;
+	(void)tag;
+	strcpy(ctx->errMsg, "No encode queue is open");
+	ctx->errFlag = true;
+	return false;
+}
+
+int gs1_queueHarvest(gs1_encoder *ctx, gs1_encoder_completion *out, const int max) {
+	(void)out;
+	(void)max;
+	strcpy(ctx->errMsg, "No encode queue is open");
+	ctx->errFlag = true;
+	return 0;
+}
+
+#endif  /* !NOMALLOC && !_WIN32 */
+
+
+#ifdef UNIT_TESTS
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
+
+void test_queue_cost(void) {
+
+	gs1_encoder_request req = { 0 };
+	char data[1024];
+	int ean, ccc, qr, cost;
+
+	req.size = sizeof(req);
+	req.format = gs1_encoder_dBMP;
+
+	req.sym = gs1_encoder_sEAN13;
+	req.dataStr = "2112345678900";
+	ean = gs1_queueCost(&req);
+	TEST_CHECK(ean > 0 && ean < 20);
+
+	// Larger X dimension costs more to rasterise, but not to preview
+	req.pixMult = 10;
+	TEST_CHECK((cost = gs1_queueCost(&req)) > ean);
+	req.format = gs1_encoder_dGRAY;
+	TEST_CHECK(gs1_queueCost(&req) < cost);
+	req.format = gs1_encoder_dBMP;
+	req.pixMult = 1;
+
+	req.sym = gs1_encoder_sGS1_128_CCC;
+	strcpy(data, "^0112345678901231^10ABC123|^91");
+	memset(data + strlen(data), 'A', 90);
+	strcpy(data + strlen(data), "^92");
+	memset(data + strlen(data), 'B', 90);
+	req.dataStr = data;
+	ccc = gs1_queueCost(&req);
+	TEST_CHECK(ccc > 10 * ean);
+	TEST_CHECK(ccc < QUEUE_BULK_COST);
+
+	req.sym = gs1_encoder_sQR;
+	memset(data, 'A', 800);
+	data[800] = '\0';
+	req.dataStr = data;
+	qr = gs1_queueCost(&req);
+	TEST_CHECK(qr > 10 * ccc);
+	TEST_CHECK(qr >= QUEUE_BULK_COST);
+
+	req.dataStr = NULL;
+	TEST_CHECK(gs1_queueCost(&req) > 0);
+
+}
+
+
+void test_queue_encode(void) {
+
+#if !defined(NOMALLOC) && !defined(_WIN32)
+
+	static const char *data[] = {
+		"(01)12345678901231",
+		"(01)12345678901231(10)ABC123",
+		"(01)12345678901231(10)ABC123(21)XYZ",
+		"(01)12345678901231(10)ABC123(21)XYZ(99)0123456789ABCDEFGHIJ",
+	};
+	gs1_encoder *ctx, *ref;
+	gs1_encoder_request req = { 0 };
+	gs1_encoder_result res;
+	gs1_encoder_completion done[SIZEOF_ARRAY(data)];
+	struct pollfd pfd;
+	int seen = 0, n, i;
+	uint64_t tag;
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+	TEST_ASSERT((ref = gs1_encoder_init(NULL)) != NULL);
+
+	req.size = sizeof(req);
+	req.sym = gs1_encoder_sQR;
+	req.format = gs1_encoder_dBMP;
+	req.pixMult = 2;
+	req.aiSyntax = 1;
+
+	TEST_ASSERT(gs1_queueOpen(ctx, 2, (int)SIZEOF_ARRAY(data)));
+	TEST_CHECK((pfd.fd = gs1_queueFd(ctx)) >= 0);
+	pfd.events = POLLIN;
+
+	for (i = 0; i < (int)SIZEOF_ARRAY(data); i++) {
+		req.dataStr = data[i];
+		TEST_CHECK(gs1_queueSubmit(ctx, &req, (uint64_t)i));
+	}
+	TEST_CHECK(!gs1_queueSubmit(ctx, &req, 0));
+	TEST_CHECK(strcmp(ctx->errMsg, "Encode queue is full") == 0);
+
+	// One at a time, so the descriptor must remain readable for the rest
+	while (seen != (1 << SIZEOF_ARRAY(data)) - 1) {
+		TEST_ASSERT(poll(&pfd, 1, 10000) == 1);
+		n = gs1_queueHarvest(ctx, done, 1);
+		TEST_ASSERT(n <= 1);
+		if (n == 0)
+			continue;
+		tag = done[0].tag;
+		TEST_ASSERT(tag < SIZEOF_ARRAY(data));
+		TEST_CHECK((seen & (1 << tag)) == 0);
+		seen |= 1 << tag;
+
+		req.dataStr = data[tag];
+		TEST_ASSERT(gs1_encoder_encodeRequest(ref, &req, &res));
+		TEST_CHECK(done[0].result.status);
+		TEST_CHECK(done[0].result.width == res.width && done[0].result.height == res.height);
+		TEST_CHECK(done[0].result.bufferSize == res.bufferSize &&
+			   memcmp(done[0].result.buffer, res.buffer, res.bufferSize) == 0);
+		TEST_CHECK(done[0].result.numHRI == res.numHRI);
+		TEST_CHECK(strcmp(done[0].result.hri + done[0].result.hriOffsets[res.numHRI - 1],
+				  res.hri + res.hriOffsets[res.numHRI - 1]) == 0);
+		TEST_MSG("Request %d", (int)tag);
+	}
+
+	// Failures are reported through the result
+	req.dataStr = "(01)12345678901234";
+	TEST_CHECK(gs1_queueSubmit(ctx, &req, 99));
+	do {
+		TEST_ASSERT(poll(&pfd, 1, 10000) == 1);
+	} while ((n = gs1_queueHarvest(ctx, done, (int)SIZEOF_ARRAY(data))) == 0);
+	TEST_ASSERT(n == 1);
+	TEST_CHECK(done[0].tag == 99);
+	TEST_CHECK(!done[0].result.status);
+	TEST_CHECK(done[0].result.buffer == NULL);
+	TEST_CHECK(strcmp(done[0].result.errMsg, "AI (01): Incorrect check digit") == 0);
+	TEST_MSG("Got: %s", done[0].result.errMsg);
+
+	// Nothing further is pending
+	TEST_CHECK(poll(&pfd, 1, 0) == 0);
+	TEST_CHECK(gs1_queueHarvest(ctx, done, (int)SIZEOF_ARRAY(data)) == 0);
+
+	// Unharvested requests are completed and discarded on close
+	for (i = 0; i < (int)SIZEOF_ARRAY(data); i++) {
+		req.dataStr = data[i];
+		TEST_CHECK(gs1_queueSubmit(ctx, &req, (uint64_t)i));
+	}
+	TEST_CHECK(gs1_queueClose(ctx));
+
+	gs1_encoder_free(ref);
+	gs1_encoder_free(ctx);
+
+#endif
+
+}
+
+
+void test_queue_lanes(void) {
+
+#if !defined(NOMALLOC) && !defined(_WIN32)
+
+	gs1_encoder *ctx;
+	gs1_encoder_request big = { 0 }, small = { 0 };
+	gs1_encoder_completion done[4];
+	char data[1024];
+	int got = 0, n, i, order[4];
+
+	TEST_ASSERT((ctx = gs1_encoder_init(NULL)) != NULL);
+
+	big.size = sizeof(big);
+	big.sym = gs1_encoder_sQR;
+	big.format = gs1_encoder_dRAW;
+	strcpy(data, "^0112345678901231^91");
+	memset(data + strlen(data), 'A', 90);
+	for (i = 2; i <= 9; i++) {
+		sprintf(data + strlen(data), "^9%d", i);
+		memset(data + strlen(data), 'A' + i, 90);
+	}
+	big.dataStr = data;
+	TEST_ASSERT(gs1_queueCost(&big) >= QUEUE_BULK_COST);
+
+	small.size = sizeof(small);
+	small.sym = gs1_encoder_sEAN13;
+	small.format = gs1_encoder_dRAW;
+	small.dataStr = "2112345678900";
+	TEST_ASSERT(gs1_queueCost(&small) < QUEUE_BULK_COST);
+
+	// With several workers, bulk requests leave the first to express requests
+	TEST_ASSERT(gs1_queueOpen(ctx, 3, 4));
+	TEST_CHECK(gs1_queueSubmit(ctx, &big, 0));
+	TEST_CHECK(gs1_queueSubmit(ctx, &big, 1));
+	TEST_CHECK(gs1_queueSubmit(ctx, &big, 2));
+	TEST_CHECK(ctx->queue->workers[0].submittedCost == 0);
+	TEST_CHECK(gs1_queueSubmit(ctx, &small, 3));
+	TEST_CHECK(ctx->queue->workers[0].submittedCost == (uint64_t)gs1_queueCost(&small));
+	TEST_CHECK(gs1_queueClose(ctx));
+
+	// With one worker, express requests overtake queued bulk requests
+	TEST_ASSERT(gs1_queueOpen(ctx, 1, 4));
+	TEST_CHECK(gs1_queueSubmit(ctx, &big, 0));
+	TEST_CHECK(gs1_queueSubmit(ctx, &big, 1));
+	TEST_CHECK(gs1_queueSubmit(ctx, &big, 2));
+	TEST_CHECK(gs1_queueSubmit(ctx, &small, 3));
+	while (got < 4) {
+		n = gs1_queueHarvest(ctx, done, 4);
+		for (i = 0; i < n; i++)
+			order[got++] = (int)done[i].tag;
+	}
+	TEST_CHECK(order[0] == 3 || order[1] == 3);
+	TEST_MSG("Completed: %d %d %d %d", order[0], order[1], order[2], order[3]);
+	TEST_CHECK(gs1_queueClose(ctx));
+
+	gs1_encoder_free(ctx);
+
+#endif
+
+}
+
+
+#endif  /* UNIT_TESTS */
@@ -0,0 +1,53 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "gs1encoders.h"
+
+
+#define QUEUE_MAX_THREADS	64		// Worker instances
+#define QUEUE_MAX_DEPTH		1024		// Requests in flight
+#define QUEUE_BULK_COST		1000		// Estimated cost from which a request is scheduled as bulk
+
+struct queueState;
+
+bool gs1_queueOpen(gs1_encoder *ctx, int threads, int depth);
+bool gs1_queueClose(gs1_encoder *ctx);
+int gs1_queueCost(const gs1_encoder_request *req);
+int gs1_queueFd(const gs1_encoder *ctx);
+bool gs1_queueSubmit(gs1_encoder *ctx, const gs1_encoder_request *req, uint64_t tag);
+int gs1_queueHarvest(gs1_encoder *ctx, gs1_encoder_completion *out, int max);
+
+
+#ifdef UNIT_TESTS
+
+void test_queue_cost(void);
+void test_queue_encode(void);
+void test_queue_lanes(void);
+
+#endif
+
+
+#endif  /* QUEUE_H */
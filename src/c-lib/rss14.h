@@ -32,6 +32,8 @@
 #define RSS14_ROWS2_H	7
 #define RSS14_L_PADR	5	// RSS-14 left offset
 #define RSS14_R_PADR	7	// RSS-14s right offset
+#define RSS14_MAX_SYM_W	CCB4_WIDTH				// Largest symbol in modules,
+#define RSS14_MAX_SYM_H	(CCB4_MAX_SYM_H + RSS14_SYM_H*2 + 4*2)	// with CC and separators
 
 
 #include "enc-private.h"
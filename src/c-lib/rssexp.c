@@ -25,6 +25,7 @@
 
 #include "assert.h"
 #include "enc-private.h"
+#include "bitbuf.h"
 #include "cc.h"
 #include "debug.h"
 #include "driver.h"
@@ -33,20 +34,7 @@
 
 // gets the next 12 bit sym char from bit string
 static int getVal12(const uint8_t bitString[], const int symNdx) {
-	int val, ndx;
-
-	ndx = symNdx*3/2; // index into bitString
-	if (symNdx & 1) {
-		// odd sym char count, so val = 4+8 bits
-		val = (int)bitString[ndx] & 0xF;
-		val = (val << 8) + (int)bitString[ndx+1];
-	}
-	else {
-		// even sym char count, so val = 8+4 bits
-		val = (int)bitString[ndx];
-		val = (val << 4) + ((int)bitString[ndx+1] >> 4);
-	}
-	return(val);
+	return((int)gs1_bitGet(bitString, (size_t)symNdx*12, 12));
 }
 
 
@@ -459,6 +447,66 @@ out:
 
 
 
+/*
+ * Report the size of the linear symbol, or of its composite component when
+ * there is one, without encoding it.
+ *
+ */
+bool gs1_RSSExpCapacity(gs1_encoder *ctx, gs1_encoder_capacity *cap) {
+
+	const uint8_t *dataStr = (const uint8_t *)ctx->dataStr;
+	uint8_t primaryStr[MAX_DATA + 1];
+	const char *ccStr;
+	size_t len;
+	int i, size, padded, segs, rowWidth;
+
+	if (*dataStr != '^') {
+		strcpy(ctx->errMsg, "primary data must be AI syntax (FNC1 in first position)");
+		ctx->errFlag = true;
+		return false;
+	}
+	dataStr++;
+
+	ccStr = strchr((const char*)dataStr, '|');
+	len = ccStr ? (size_t)((const uint8_t*)ccStr - dataStr) : strlen((const char*)dataStr);
+	memcpy(primaryStr, dataStr, len);
+	primaryStr[len] = '\0';
+
+	if (((i=gs1_check2DData(primaryStr)) != 0) || ((i=isSymbolSepatator(primaryStr)) != 0)) {
+		sprintf(ctx->errMsg, "illegal character in RSS Expanded data = '%c'", primaryStr[i]);
+		ctx->errFlag = true;
+		return false;
+	}
+
+	ctx->linFlag = true;
+	ctx->rssexp_rowWidth = rowWidth = ctx->dataBarExpandedSegmentsWidth;
+	if ((cap->used = gs1_packedBits(ctx, primaryStr, &size, &padded)) < 0)
+		return false;
+
+	if (ccStr) {	// Size the composite component, provided the linear fits
+		if (!gs1_CCcapacity(ctx, (const uint8_t*)ccStr+1, 4, cap))
+			return false;
+		cap->fits = cap->fits && size >= 0;
+		return true;
+	}
+
+	cap->fits = size >= 0;
+	if (size < 0) {
+		size = 21;		// 252 bits, the most that a symbol holds
+		padded = size*12;
+	}
+	segs = size+1;
+
+	cap->units = gs1_encoder_capBITS;
+	cap->capacity = padded;
+	cap->rows = (segs + rowWidth-1) / rowWidth;
+	cap->columns = segs < rowWidth ? segs : rowWidth;
+
+	return true;
+
+}
+
+
 #ifdef UNIT_TESTS
 
 #define TEST_NO_MAIN
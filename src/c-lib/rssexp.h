@@ -27,12 +27,15 @@
 #define RSSEXP_SYM_H		34	// height
 #define RSSEXP_MAX_DBL_SEGS	12	// max double segments
 #define RSSEXP_L_PAD		1	// CC left offset
+#define RSSEXP_MAX_SYM_W	(2 + RSSEXP_MAX_DBL_SEGS*RSSEXP_SYM_W + 2)			// Largest symbol in modules,
+#define RSSEXP_MAX_SYM_H	(RSSEXP_MAX_DBL_SEGS*(RSSEXP_SYM_H+3*2) + CCB4_MAX_SYM_H+2)	// with CC and separators
 
 
 #include "gs1encoders.h"
 
 
 void gs1_RSSExp(gs1_encoder *ctx);
+bool gs1_RSSExpCapacity(gs1_encoder *ctx, gs1_encoder_capacity *cap);
 
 
 #ifdef UNIT_TESTS
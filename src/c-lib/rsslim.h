@@ -27,6 +27,8 @@
 #define RSSLIM_SYM_W	74	// symbol width in modules including any quiet zones
 #define RSSLIM_SYM_H	10	// total pixel ht of RSS14L
 #define RSSLIM_L_PADB	10	// RSS Limited left pad for ccb
+#define RSSLIM_MAX_SYM_W	(RSSLIM_L_PADB + RSSLIM_SYM_W)		// Largest symbol in modules,
+#define RSSLIM_MAX_SYM_H	(CCB4_MAX_SYM_H + RSSLIM_SYM_H + 2)	// with CC and separator
 
 
 #include "enc-private.h"
@@ -54,6 +54,7 @@ static const struct symIdEntry symIdTable[] = {
 	SYM( "]C1", AI,     gs1_encoder_sGS1_128_CCA ),
 	SYM( "]E0", NON_AI, gs1_encoder_sEAN13 ),
 	SYM( "]E4", NON_AI, gs1_encoder_sEAN8 ),
+	SYM( "]I1", NON_AI, gs1_encoder_sITF14 ),
 	SYM( "]e0", AI,     gs1_encoder_sDataBarExpanded ),	// Shared with GS1-128 CC
 	SYM( "]d1", NON_AI, gs1_encoder_sDM ),
 	SYM( "]d2", AI,     gs1_encoder_sDM ),
@@ -107,8 +108,12 @@ char* gs1_generateScanData(gs1_encoder* ctx) {
 	char* cc = NULL;
 	int i;
 	bool lastAIfnc1;
+#ifndef EXCLUDE_EANUPC
 	char *prefix;
+#endif
+#if !defined(EXCLUDE_DATABAR) || !defined(EXCLUDE_EANUPC) || !defined(EXCLUDE_ITF14)
 	char primaryStr[15];
+#endif
 	char* ret;
 
 	assert(ctx);
@@ -121,15 +126,16 @@ char* gs1_generateScanData(gs1_encoder* ctx) {
 	switch (ctx->sym) {
 
 	case gs1_encoder_sQR:
+	case gs1_encoder_sRMQR:
 	case gs1_encoder_sDM:
 
-		// QR: "]Q1" for plain data; "]Q3" for GS1 data
+		// QR and rMQR: "]Q1" for plain data; "]Q3" for GS1 data
 		// DM: "]d1" for plain data; "]d2" for GS1 data
 
 		if (*ctx->dataStr == '^') {
-			strcat(ctx->outStr, ctx->sym == gs1_encoder_sQR ? "]Q3" : "]d2");
+			strcat(ctx->outStr, ctx->sym != gs1_encoder_sDM ? "]Q3" : "]d2");
 		} else {
-			strcat(ctx->outStr, ctx->sym == gs1_encoder_sQR ? "]Q1" : "]d1");
+			strcat(ctx->outStr, ctx->sym != gs1_encoder_sDM ? "]Q1" : "]d1");
 			if (cc)
 				*(cc - 1) = '|';	// Plain data so put original character back
 		}
@@ -172,6 +178,8 @@ char* gs1_generateScanData(gs1_encoder* ctx) {
 
 		break;
 
+#ifndef EXCLUDE_DATABAR
+
 	case gs1_encoder_sDataBarOmni:
 	case gs1_encoder_sDataBarTruncated:
 	case gs1_encoder_sDataBarStacked:
@@ -199,6 +207,10 @@ char* gs1_generateScanData(gs1_encoder* ctx) {
 
 		break;
 
+#endif
+
+#ifndef EXCLUDE_EANUPC
+
 	case gs1_encoder_sUPCA:
 	case gs1_encoder_sUPCE:
 	case gs1_encoder_sEAN13:
@@ -233,20 +245,47 @@ char* gs1_generateScanData(gs1_encoder* ctx) {
 		}
 		break;
 
+#endif
+
+#ifndef EXCLUDE_ITF14
+
+	case gs1_encoder_sITF14:
+
+		// "]I1" then 14 digits; there is no CC
+		if (cc) {
+			strcpy(ctx->errMsg, "Composite component is not supported for ITF-14");
+			ctx->errFlag = true;
+			goto fail;
+		}
+
+		gs1_normaliseITF14(ctx, ctx->dataStr, primaryStr);
+		if (*primaryStr == '\0')
+			goto fail;
+
+		strcat(ctx->outStr, "]I1");
+		scancat(ctx->outStr, primaryStr);
+		break;
+
+#endif
+
 	}
 
 	ret = ctx->outStr;
 
+#if !defined(EXCLUDE_DATABAR) || !defined(EXCLUDE_EANUPC) || !defined(EXCLUDE_ITF14)
 out:
+#endif
 
 	if (cc)
 		*(cc - 1) = '|';			// Put original separator back
 	return ret;
 
+#if !defined(EXCLUDE_DATABAR) || !defined(EXCLUDE_EANUPC) || !defined(EXCLUDE_ITF14)
 fail:
 
 	ret = NULL;
 	goto out;
+#endif
 
 }
 
@@ -291,6 +330,11 @@ bool gs1_processScanData(gs1_encoder* ctx, const char* scanData) {
 		goto fail;
 	}
 
+	if (!gs1_symAvailable(sym)) {
+		strcpy(ctx->errMsg, "Support for this symbology is not included in this build");
+		goto fail;
+	}
+
 	scanData += 3;
 	ctx->sym = sym;
 	p = ctx->dataStr;
@@ -336,6 +380,29 @@ bool gs1_processScanData(gs1_encoder* ctx, const char* scanData) {
 
 	}
 
+	if (sym == gs1_encoder_sITF14) {
+
+		if (strlen(scanData) != 14) {
+			strcpy(ctx->errMsg, "ITF-14 scan data must be 14 digits");
+			goto fail;
+		}
+
+		strcpy(p, scanData);
+
+		if (!gs1_allDigits((uint8_t*)p, 0)) {
+			strcpy(ctx->errMsg, "Primary message number only contain digits");
+			goto fail;
+		}
+
+		if (!gs1_validateParity((uint8_t*)p)) {
+			strcpy(ctx->errMsg, "Primary message check digit is incorrect");
+			goto fail;
+		}
+
+		return true;
+
+	}
+
 	if (aiMode) {
 
 		q = p;
@@ -371,8 +438,7 @@ bool gs1_processScanData(gs1_encoder* ctx, const char* scanData) {
 	strcpy(p, scanData);
 
 	// If a Digital Link URI is given then process it immediately
-	if ((strlen(ctx->dataStr) >= 8 && strncmp(ctx->dataStr, "https://", 8) == 0) || // Digital Link URI
-	    (strlen(ctx->dataStr) >= 7 && strncmp(ctx->dataStr, "http://",  7) == 0)) {
+	if (gs1_DLschemeLen(ctx->dataStr) > 0) {			// Digital Link URI
 		// We extract AIs with the element string stored in dlAIbuffer
 		if (!gs1_parseDLuri(ctx, ctx->dataStr, ctx->dlAIbuffer))
 			goto fail;
@@ -497,6 +563,10 @@ void test_scandata_generateScanData(void) {
 	test_testGenerateScanData(EAN8, "02345673|^99COMPOSITE^98XYZ",
 		"]E402345673|]e099COMPOSITE" "\x1D" "98XYZ");
 
+	/* ITF-14 */
+	test_testGenerateScanData(ITF14, "^0115012345678907", "]I115012345678907");
+	test_testGenerateScanData(ITF14, "15012345678907", "]I115012345678907");
+
 	gs1_encoder_free(ctx);
 
 }
@@ -603,6 +673,15 @@ void test_scandata_processScanData(void) {
 	test_testProcessScanData(true, "]E402345673|]e099COMPOSITE" "\x1D" "98XYZ",
 		EAN8, "02345673|^99COMPOSITE^98XYZ");
 
+	/* ITF-14 */
+	test_testProcessScanData(false, "]I1", NONE, "");
+	test_testProcessScanData(false, "]I11501234567890", NONE, "");	// Short
+	test_testProcessScanData(false, "]I1150123456789070", NONE, "");	// Long
+	test_testProcessScanData(false, "]I115012ABC78907", NONE, "");	// Non-numeric
+	test_testProcessScanData(false, "]I115012345678908", NONE, "");	// Bad check digit
+	test_testProcessScanData(true, "]I115012345678907",
+		ITF14, "15012345678907");
+
 	gs1_encoder_free(ctx);
 
 }
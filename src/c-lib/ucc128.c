@@ -253,6 +253,61 @@ static void cdc128(const uint8_t data[], int *di, int symchr[], int *si, int *co
 }
 
 
+/* determine start character A, B or C */
+static int start128(const uint8_t data[])
+{
+	int di, i;
+
+	di = 0;
+	if (data[0] == 0201) di++;  /* skip over leading FNC1 */
+	i = di;
+	while (ISNUM(data[i])) { i++; } /* look for leading numerics */
+	if ((i - di) >= 4) return 2;  /* 4 or more, code C */
+	if (((i - di) == 2) && data[i] == '\0') return 2; // NN: code C
+	/* decide between A and B */
+	for (i = di;  /* search for next cntl or lower case */
+		((data[i] >= 040) &&
+	 		((data[i] <= 0137) || (data[i] >= 0201)));
+				i++);
+
+	if ((data[i] < 040) || (data[i] == 0200))
+		return 0;  /* control char or end of data, change to code A */
+	return 1;  /* lower case alpha, change to code B */
+}
+
+
+/*
+ * count128 returns the number of symbol characters that enc128 would
+ * produce for the data, without the limit on the length of the symbol.
+ *
+ */
+static int count128(const uint8_t data[], const int link)
+{
+	int symchr[1];
+	int si, di, n, code;
+
+	code = start128(data);
+
+	si = 1;
+	for (di = 0; data[di] != 0; si += n) {
+		n = 0;  /* each step produces at most one symbol character */
+		switch (code) {
+			case 0:   /* code A */
+				cda128(data, &di, symchr, &n, &code);
+				break;
+			case 1:   /* code B */
+				cdb128(data, &di, symchr, &n, &code);
+				break;
+			case 2:  /* code C */
+				cdc128(data, &di, symchr, &n, &code);
+				break;
+		}
+	}
+
+	return si + (link > 0 ? 1:0) + 2;  /* link, check char and stop */
+}
+
+
 /*
  * enc128 converts the data string into a Code 128 symbol
  * represented in an array of bar and space widths.
@@ -289,26 +344,7 @@ static int enc128(uint8_t data[], uint8_t bars[], const int link)
 		}
 	}
 
-	/* determine start character A, B or C */
-
-	di = 0;
-	if (data[0] == 0201) di++;  /* skip over leading FNC1 */
-	i = di;
-	while (ISNUM(data[i])) { i++; } /* look for leading numerics */
-	if ((i - di) >= 4) code = 2;  /* 4 or more, code C */
-	else if (((i - di) == 2) && data[i] == '\0') code = 2; // NN: code C
-	else {   /* decide between A and B */
-		for (i = di;  /* search for next cntl or lower case */
-			((data[i] >= 040) &&
-		 		((data[i] <= 0137) || (data[i] >= 0201)));
-					i++);
-
-		if ((data[i] < 040) || (data[i] == 0200))
-				/* control char or end of data, change to code A */
-				code = 0;
-		else  /* lower case alpha, change to code B */
-				code = 1;
-	}
+	code = start128(data);
 
 	symchr[0] = 103 + code;      /*start char A, B or C*/
 
@@ -597,6 +633,69 @@ out:
 }
 
 
+/*
+ * Report the size of the linear symbol, or of its composite component when
+ * there is one, without encoding it.
+ *
+ */
+bool gs1_U128capacity(gs1_encoder *ctx, gs1_encoder_capacity *cap) {
+
+	uint8_t primaryStr[MAX_DATA + 1];
+	const char *ccStr;
+	size_t len, i;
+	int symChars;
+	bool fits;
+
+	if (*ctx->dataStr != '^') {
+		strcpy(ctx->errMsg, "primary data must be AI syntax (FNC1 in first position)");
+		ctx->errFlag = true;
+		return false;
+	}
+
+	ccStr = strchr(ctx->dataStr, '|');
+	len = ccStr ? (size_t)(ccStr - ctx->dataStr) : strlen(ctx->dataStr);
+
+	for (i = 0; i < len; i++)	// FNC1 as for enc128
+		primaryStr[i] = ctx->dataStr[i] == '^' ? 0201 : (uint8_t)ctx->dataStr[i];
+	primaryStr[len] = '\0';
+
+	symChars = count128(primaryStr,
+		ccStr ? (ctx->sym == gs1_encoder_sGS1_128_CCA ? 1 : 2) : 0);
+
+	fits = len <= 48 && symChars <= UCC128_SYMMAX;
+
+	if (!ccStr) {
+		cap->units = gs1_encoder_capSYMCHARS;
+		cap->used = symChars;
+		cap->capacity = UCC128_SYMMAX;
+		cap->rows = 1;
+		cap->columns = symChars*11+22;
+		cap->fits = fits;
+		return true;
+	}
+
+	// Size the composite component, provided the linear fits
+	if (ctx->sym == gs1_encoder_sGS1_128_CCA) {
+		if (!gs1_CCcapacity(ctx, (const uint8_t*)ccStr+1, 4, cap))
+			return false;
+	}
+	else {
+		ctx->colCnt = ((symChars*11 + 22 - UCC128_L_PAD - 5)/17) -4;
+		if (ctx->colCnt < 1) {
+			strcpy(ctx->errMsg, "UCC-128 too small");
+			ctx->errFlag = true;
+			return false;
+		}
+		if (!gs1_CCcapacity(ctx, (const uint8_t*)ccStr+1, 0, cap))
+			return false;
+	}
+	cap->fits = cap->fits && fits;
+
+	return true;
+
+}
+
+
 #ifdef UNIT_TESTS
 
 #define TEST_NO_MAIN
@@ -26,6 +26,8 @@
 #define UCC128_SYMMAX		53	// UCC/EAN-128 48 symbol chars + strt,FNC1,link,chk & stop max
 #define UCC128_MAX_PAT		10574	// 928*8 + 90*(4*8 + 3) for max codewords and 90 rows
 #define UCC128_L_PAD		(10-9)	// CCC starts -9X from 1st start bar
+#define UCC128_MAX_SYM_W	(UCC128_SYMMAX*11+22)			// Largest symbol in modules,
+#define UCC128_MAX_SYM_H	(CCC_MAX_SYM_H+2 + UCC128_MAX_LINHT)	// with CC-C and separator
 
 
 #include "enc-private.h"
@@ -34,6 +36,7 @@
 
 void gs1_U128A(gs1_encoder *ctx);
 void gs1_U128C(gs1_encoder *ctx);
+bool gs1_U128capacity(gs1_encoder *ctx, gs1_encoder_capacity *cap);
 
 
 #ifdef UNIT_TESTS
@@ -0,0 +1,130 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Compares the cost of generating symbols and reading back the buffer and HRI
+ * through the C API against doing the same through the C++ wrapper.
+ *
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "gs1encoders.hpp"
+
+
+struct Job {
+	const char *name;
+	gs1::Symbology sym;
+	const char *data;
+};
+
+static const Job jobs[] = {
+	{ "EAN-13", gs1::Symbology::EAN13, "(01)09506000134352" },
+	{ "GS1-128", gs1::Symbology::GS1_128_CCA, "(01)09506000134352(10)ABC123(17)211231" },
+	{ "DataBar Expanded", gs1::Symbology::DataBarExpanded, "(01)09506000134352(10)ABC123(17)211231" },
+	{ "Data Matrix", gs1::Symbology::DM, "(01)09506000134352(10)ABC123(17)211231(21)12345678" },
+	{ "QR Code", gs1::Symbology::QR, "(01)09506000134352(10)ABC123(17)211231(21)12345678" },
+};
+
+
+static volatile unsigned long sink;
+
+
+static double benchC(const Job &job, int iters) {
+
+	gs1_encoder *ctx = gs1_encoder_init(NULL);
+	gs1_encoder_setFormat(ctx, gs1_encoder_dRAW);
+	gs1_encoder_setOutFile(ctx, "");
+	gs1_encoder_setSym(ctx, static_cast<int>(job.sym));
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iters; i++) {
+		void *buf;
+		char **hri;
+		size_t size;
+		int num, j;
+		unsigned long acc = 0;
+
+		if (!gs1_encoder_setAIdataStr(ctx, job.data) || !gs1_encoder_encode(ctx)) {
+			fprintf(stderr, "%s: %s\n", job.name, gs1_encoder_getErrMsg(ctx));
+			exit(1);
+		}
+		size = gs1_encoder_getBuffer(ctx, &buf);
+		acc += size + static_cast<const unsigned char *>(buf)[size / 2];
+		num = gs1_encoder_getHRI(ctx, &hri);
+		for (j = 0; j < num; j++)
+			acc += strlen(hri[j]);
+		sink = sink + acc;
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	gs1_encoder_free(ctx);
+	return std::chrono::duration<double, std::nano>(end - start).count() / iters;
+
+}
+
+
+static double benchCpp(const Job &job, int iters) {
+
+	gs1::Encoder enc;
+	enc.setFormat(gs1::Format::RAW);
+	enc.setOutFile("");
+	enc.setSym(job.sym);
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iters; i++) {
+		unsigned long acc = 0;
+
+		if (!enc.setAIdataStr(job.data) || !enc.encode()) {
+			fprintf(stderr, "%s: %.*s\n", job.name, static_cast<int>(enc.errMsg().size()), enc.errMsg().data());
+			exit(1);
+		}
+		auto buf = enc.buffer();
+		acc += buf.size() + static_cast<unsigned char>(buf[buf.size() / 2]);
+		for (std::string_view hri : enc.hri())
+			acc += hri.size();
+		sink = sink + acc;
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double, std::nano>(end - start).count() / iters;
+
+}
+
+
+int main(int argc, char *argv[]) {
+
+	int iters = argc > 1 ? atoi(argv[1]) : 20000;
+
+	printf("%-20s %14s %14s %9s\n", "Symbology", "C (ns/op)", "C++ (ns/op)", "Ratio");
+	for (const Job &job : jobs) {
+		double c, cpp;
+		benchC(job, iters / 10);		// Warm up
+		c = benchC(job, iters);
+		cpp = benchCpp(job, iters);
+		printf("%-20s %14.0f %14.0f %9.3f\n", job.name, c, cpp, cpp / c);
+	}
+
+	return 0;
+
+}
@@ -0,0 +1,439 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @file gs1encoders.hpp
+ * @author GS1 AISBL
+ *
+ * \copyright Copyright (c) 2021 GS1 AISBL.
+ *
+ * @licenseblock{License}
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @endlicenseblock
+ *
+ *
+ * Header-only C++17 wrapper around the native C library.
+ *
+ * The wrapper is a very thin shim: every method is an inline call to the
+ * corresponding public API function declared in gs1encoders.h. No output is
+ * copied. The image buffer is exposed as a read-only byte view (std::span
+ * when compiled as C++20) and the HRI as a range of std::string_view, both of
+ * which reference storage owned by the library instance.
+ *
+ * As with the C API, views are invalidated by any subsequent call that
+ * modifies the input data or regenerates the output.
+ *
+ * \code
+ * #include "gs1encoders.hpp"
+ *
+ * gs1::Encoder enc;
+ * enc.setSym(gs1::Symbology::DM);
+ * enc.setOutFile("");
+ * if (auto r = enc.setAIdataStr("(01)12345678901231(10)ABC123"); !r)
+ *     std::cerr << r.error() << std::endl;
+ * if (auto r = enc.encode(); r) {
+ *     auto buf = enc.buffer();          // No copy
+ *     for (std::string_view hri : enc.hri())
+ *         std::cout << hri << std::endl;
+ * }
+ * \endcode
+ *
+ */
+
+#ifndef GS1_ENCODERS_HPP
+#define GS1_ENCODERS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#if __cplusplus >= 202002L && __has_include(<span>)
+#include <span>
+#define GS1_ENCODERS_HAVE_SPAN 1
+#endif
+
+#include "gs1encoders.h"
+
+
+namespace gs1 {
+
+
+/// Symbology types, mirroring ::gs1_encoder_symbologies
+enum class Symbology : int {
+	NONE = gs1_encoder_sNONE,
+	DataBarOmni = gs1_encoder_sDataBarOmni,
+	DataBarTruncated = gs1_encoder_sDataBarTruncated,
+	DataBarStacked = gs1_encoder_sDataBarStacked,
+	DataBarStackedOmni = gs1_encoder_sDataBarStackedOmni,
+	DataBarLimited = gs1_encoder_sDataBarLimited,
+	DataBarExpanded = gs1_encoder_sDataBarExpanded,
+	UPCA = gs1_encoder_sUPCA,
+	UPCE = gs1_encoder_sUPCE,
+	EAN13 = gs1_encoder_sEAN13,
+	EAN8 = gs1_encoder_sEAN8,
+	GS1_128_CCA = gs1_encoder_sGS1_128_CCA,
+	GS1_128_CCC = gs1_encoder_sGS1_128_CCC,
+	QR = gs1_encoder_sQR,
+	DM = gs1_encoder_sDM,
+	RMQR = gs1_encoder_sRMQR,
+	ITF14 = gs1_encoder_sITF14,
+};
+
+
+/// Output formats, mirroring ::gs1_encoder_formats
+enum class Format : int {
+	BMP = gs1_encoder_dBMP,
+	TIF = gs1_encoder_dTIF,
+	RAW = gs1_encoder_dRAW,
+	Path = gs1_encoder_dPATH,
+	Gray = gs1_encoder_dGRAY,
+	RGBA = gs1_encoder_dRGBA,
+};
+
+
+/// Marking path modes, mirroring ::gs1_encoder_pathModes
+enum class PathMode : int {
+	Dots = gs1_encoder_pathDOTS,
+	Strokes = gs1_encoder_pathSTROKES,
+};
+
+
+/// Output digest algorithms, mirroring ::gs1_encoder_digests
+enum class Digest : int {
+	None = gs1_encoder_digestNONE,
+	XXH64 = gs1_encoder_digestXXH64,
+	SHA256 = gs1_encoder_digestSHA256,
+};
+
+
+/**
+ * @brief Compile-time properties of each symbology.
+ *
+ * maxModules is the width of the largest symbol for 2D symbologies, and
+ * maxRows is its height; both are 0 for linear symbologies. maxDigits is the
+ * greatest number of numeric characters that the primary message can carry,
+ * excluding any composite component, and maxBytes is the greatest number of
+ * bytes that a 2D symbol can carry.
+ */
+struct SymbologyTraits {
+	bool is2D;
+	bool composite;
+	int maxModules;
+	int maxDigits;
+	int maxRows;
+	int maxBytes;
+};
+
+constexpr SymbologyTraits traits(Symbology sym) noexcept {
+	switch (sym) {
+		case Symbology::DataBarOmni:
+		case Symbology::DataBarTruncated:
+		case Symbology::DataBarStacked:
+		case Symbology::DataBarStackedOmni:
+		case Symbology::DataBarLimited:		return { false, true,    0,   14,   0,    0 };
+		case Symbology::DataBarExpanded:	return { false, true,    0,   74,   0,    0 };
+		case Symbology::UPCA:			return { false, true,    0,   12,   0,    0 };
+		case Symbology::UPCE:			return { false, true,    0,   12,   0,    0 };
+		case Symbology::EAN13:			return { false, true,    0,   13,   0,    0 };
+		case Symbology::EAN8:			return { false, true,    0,    8,   0,    0 };
+		case Symbology::ITF14:			return { false, false,   0,   14,   0,    0 };
+		case Symbology::GS1_128_CCA:
+		case Symbology::GS1_128_CCC:		return { false, true,    0,   48,   0,    0 };
+		case Symbology::QR:			return { true,  false, 177, 7089, 177, 2953 };
+		case Symbology::DM:			return { true,  false, 144, 3116, 144, 1556 };
+		case Symbology::RMQR:			return { true,  false, 139,  361,  17,  150 };	// R17x139-M
+		default:				return { false, false,   0,    0,   0,    0 };
+	}
+}
+
+
+/// Read-only view of bytes held by the library
+#ifdef GS1_ENCODERS_HAVE_SPAN
+using ByteView = std::span<const std::byte>;
+#else
+class ByteView {
+public:
+	constexpr ByteView() noexcept = default;
+	constexpr ByteView(const std::byte *data, std::size_t size) noexcept : data_(data), size_(size) {}
+	constexpr const std::byte *data() const noexcept { return data_; }
+	constexpr std::size_t size() const noexcept { return size_; }
+	constexpr bool empty() const noexcept { return size_ == 0; }
+	constexpr const std::byte *begin() const noexcept { return data_; }
+	constexpr const std::byte *end() const noexcept { return data_ + size_; }
+	constexpr const std::byte &operator[](std::size_t i) const noexcept { return data_[i]; }
+private:
+	const std::byte *data_ = nullptr;
+	std::size_t size_ = 0;
+};
+#endif
+
+
+/**
+ * @brief Outcome of an operation: either a value or an error message.
+ *
+ * Modelled on std::expected. The error message is copied out of the library
+ * instance only when an error has occurred.
+ */
+template <typename T>
+class Result {
+public:
+	Result(T value) : value_(std::move(value)), ok_(true) {}
+	static Result failure(const char *msg) { Result r; r.err_ = msg; return r; }
+	bool has_value() const noexcept { return ok_; }
+	explicit operator bool() const noexcept { return ok_; }
+	const T &value() const & noexcept { return value_; }
+	T &&value() && noexcept { return std::move(value_); }
+	const T &operator*() const & noexcept { return value_; }
+	const std::string &error() const noexcept { return err_; }
+	T value_or(T def) const { return ok_ ? value_ : def; }
+private:
+	Result() = default;
+	T value_{};
+	std::string err_;
+	bool ok_ = false;
+};
+
+template <>
+class Result<void> {
+public:
+	Result() noexcept : ok_(true) {}
+	static Result failure(const char *msg) { Result r; r.ok_ = false; r.err_ = msg; return r; }
+	bool has_value() const noexcept { return ok_; }
+	explicit operator bool() const noexcept { return ok_; }
+	const std::string &error() const noexcept { return err_; }
+private:
+	std::string err_;
+	bool ok_;
+};
+
+
+/**
+ * @brief Range over the HRI strings of an instance.
+ *
+ * Iteration yields a std::string_view into the library-managed HRI storage
+ * without allocation.
+ */
+class HRIRange {
+public:
+	class iterator {
+	public:
+		using value_type = std::string_view;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = std::string_view;
+		using iterator_category = std::forward_iterator_tag;
+
+		iterator() noexcept = default;
+		explicit iterator(char **p) noexcept : p_(p) {}
+		std::string_view operator*() const noexcept { return std::string_view(*p_); }
+		iterator &operator++() noexcept { ++p_; return *this; }
+		iterator operator++(int) noexcept { iterator t = *this; ++p_; return t; }
+		bool operator==(const iterator &o) const noexcept { return p_ == o.p_; }
+		bool operator!=(const iterator &o) const noexcept { return p_ != o.p_; }
+	private:
+		char **p_ = nullptr;
+	};
+
+	HRIRange(char **hri, int num) noexcept : hri_(hri), num_(num > 0 ? num : 0) {}
+	iterator begin() const noexcept { return iterator(hri_); }
+	iterator end() const noexcept { return iterator(hri_ + num_); }
+	std::size_t size() const noexcept { return static_cast<std::size_t>(num_); }
+	bool empty() const noexcept { return num_ == 0; }
+	std::string_view operator[](std::size_t i) const noexcept { return std::string_view(hri_[i]); }
+private:
+	char **hri_;
+	int num_;
+};
+
+
+/**
+ * @brief Move-only owner of a ::gs1_encoder instance.
+ *
+ * Setters return Result<void>; getters return values directly since they
+ * cannot fail.
+ */
+class Encoder {
+public:
+
+	Encoder() noexcept : ctx_(gs1_encoder_init(nullptr)) {}
+
+	/// Use caller-provided storage of at least instanceSize() bytes
+	explicit Encoder(void *mem) noexcept : ctx_(gs1_encoder_init(mem)) {}
+
+	~Encoder() { if (ctx_) gs1_encoder_free(ctx_); }
+
+	Encoder(const Encoder &) = delete;
+	Encoder &operator=(const Encoder &) = delete;
+
+	Encoder(Encoder &&o) noexcept : ctx_(std::exchange(o.ctx_, nullptr)) {}
+	Encoder &operator=(Encoder &&o) noexcept {
+		if (this != &o) {
+			if (ctx_) gs1_encoder_free(ctx_);
+			ctx_ = std::exchange(o.ctx_, nullptr);
+		}
+		return *this;
+	}
+
+	static std::size_t instanceSize() noexcept { return gs1_encoder_instanceSize(); }
+	static std::string_view version() noexcept { return gs1_encoder_getVersion(); }
+
+	/// False if the library failed to initialise (or the instance was moved from)
+	bool valid() const noexcept { return ctx_ != nullptr; }
+	explicit operator bool() const noexcept { return valid(); }
+
+	/// Access to the underlying context for calling the C API directly
+	gs1_encoder *native() const noexcept { return ctx_; }
+
+	std::string_view errMsg() const noexcept { return gs1_encoder_getErrMsg(ctx_); }
+
+	Symbology sym() const noexcept { return static_cast<Symbology>(gs1_encoder_getSym(ctx_)); }
+	Result<void> setSym(Symbology sym) { return check(gs1_encoder_setSym(ctx_, static_cast<int>(sym))); }
+
+	Format format() const noexcept { return static_cast<Format>(gs1_encoder_getFormat(ctx_)); }
+	Result<void> setFormat(Format format) { return check(gs1_encoder_setFormat(ctx_, static_cast<int>(format))); }
+
+	int pixMult() const noexcept { return gs1_encoder_getPixMult(ctx_); }
+	Result<void> setPixMult(int pixMult) { return check(gs1_encoder_setPixMult(ctx_, pixMult)); }
+
+	double deviceResolution() const noexcept { return gs1_encoder_getDeviceResolution(ctx_); }
+	Result<void> setDeviceResolution(double res) { return check(gs1_encoder_setDeviceResolution(ctx_, res)); }
+
+	Result<void> setXdimension(double min, double target, double max) { return check(gs1_encoder_setXdimension(ctx_, min, target, max)); }
+	double actualXdimension() const noexcept { return gs1_encoder_getActualXdimension(ctx_); }
+
+	int Xundercut() const noexcept { return gs1_encoder_getXundercut(ctx_); }
+	Result<void> setXundercut(int v) { return check(gs1_encoder_setXundercut(ctx_, v)); }
+
+	int Yundercut() const noexcept { return gs1_encoder_getYundercut(ctx_); }
+	Result<void> setYundercut(int v) { return check(gs1_encoder_setYundercut(ctx_, v)); }
+
+	int sepHt() const noexcept { return gs1_encoder_getSepHt(ctx_); }
+	Result<void> setSepHt(int v) { return check(gs1_encoder_setSepHt(ctx_, v)); }
+
+	int dataBarExpandedSegmentsWidth() const noexcept { return gs1_encoder_getDataBarExpandedSegmentsWidth(ctx_); }
+	Result<void> setDataBarExpandedSegmentsWidth(int v) { return check(gs1_encoder_setDataBarExpandedSegmentsWidth(ctx_, v)); }
+
+	int GS1_128LinearHeight() const noexcept { return gs1_encoder_getGS1_128LinearHeight(ctx_); }
+	Result<void> setGS1_128LinearHeight(int v) { return check(gs1_encoder_setGS1_128LinearHeight(ctx_, v)); }
+
+	int dmRows() const noexcept { return gs1_encoder_getDmRows(ctx_); }
+	Result<void> setDmRows(int v) { return check(gs1_encoder_setDmRows(ctx_, v)); }
+
+	int dmColumns() const noexcept { return gs1_encoder_getDmColumns(ctx_); }
+	Result<void> setDmColumns(int v) { return check(gs1_encoder_setDmColumns(ctx_, v)); }
+
+	int qrVersion() const noexcept { return gs1_encoder_getQrVersion(ctx_); }
+	Result<void> setQrVersion(int v) { return check(gs1_encoder_setQrVersion(ctx_, v)); }
+
+	int qrEClevel() const noexcept { return gs1_encoder_getQrEClevel(ctx_); }
+	Result<void> setQrEClevel(int v) { return check(gs1_encoder_setQrEClevel(ctx_, v)); }
+
+	bool addCheckDigit() const noexcept { return gs1_encoder_getAddCheckDigit(ctx_); }
+	Result<void> setAddCheckDigit(bool v) { return check(gs1_encoder_setAddCheckDigit(ctx_, v)); }
+
+	bool permitUnknownAIs() const noexcept { return gs1_encoder_getPermitUnknownAIs(ctx_); }
+	Result<void> setPermitUnknownAIs(bool v) { return check(gs1_encoder_setPermitUnknownAIs(ctx_, v)); }
+
+	std::string_view outFile() const noexcept { return gs1_encoder_getOutFile(ctx_); }
+	Result<void> setOutFile(const char *outFile) { return check(gs1_encoder_setOutFile(ctx_, outFile)); }
+
+	std::string_view dataStr() const noexcept { return gs1_encoder_getDataStr(ctx_); }
+	Result<void> setDataStr(const char *dataStr) { return check(gs1_encoder_setDataStr(ctx_, dataStr)); }
+
+	/// Null view for non-AI data
+	std::string_view AIdataStr() const noexcept { const char *s = gs1_encoder_getAIdataStr(ctx_); return s ? std::string_view(s) : std::string_view(); }
+	Result<void> setAIdataStr(const char *aiData) { return check(gs1_encoder_setAIdataStr(ctx_, aiData)); }
+
+	/// Null view for non-AI data
+	std::string_view AIdataJSON() const noexcept { const char *s = gs1_encoder_getAIdataJSON(ctx_); return s ? std::string_view(s) : std::string_view(); }
+	int AIrecord(gs1_encoder_aiRecord &record) const noexcept { return gs1_encoder_getAIrecord(ctx_, &record); }
+
+	std::string_view scanData() const noexcept { return gs1_encoder_getScanData(ctx_); }
+	Result<void> setScanData(const char *scanData) { return check(gs1_encoder_setScanData(ctx_, scanData)); }
+
+	HRIRange hri() const noexcept {
+		char **hri = nullptr;
+		int num = gs1_encoder_getHRI(ctx_, &hri);
+		return HRIRange(hri, num);
+	}
+
+	Result<void> encode() { return check(gs1_encoder_encode(ctx_)); }
+
+	/// Space used by the data against the capacity of the symbol, without encoding
+	Result<gs1_encoder_capacity> capacity() {
+		gs1_encoder_capacity cap;
+		if (!gs1_encoder_getCapacity(ctx_, &cap))
+			return Result<gs1_encoder_capacity>::failure(gs1_encoder_getErrMsg(ctx_));
+		return cap;
+	}
+
+	/// View of the output buffer, without copying
+	ByteView buffer() const noexcept {
+		void *buf = nullptr;
+		std::size_t size = gs1_encoder_getBuffer(ctx_, &buf);
+		return ByteView(static_cast<const std::byte *>(buf), size);
+	}
+
+	PathMode pathMode() const noexcept { return static_cast<PathMode>(gs1_encoder_getPathMode(ctx_)); }
+	Result<void> setPathMode(PathMode mode) { return check(gs1_encoder_setPathMode(ctx_, static_cast<int>(mode))); }
+
+	bool pathOptimise() const noexcept { return gs1_encoder_getPathOptimise(ctx_); }
+	Result<void> setPathOptimise(bool v) { return check(gs1_encoder_setPathOptimise(ctx_, v)); }
+
+	bool renderHRI() const noexcept { return gs1_encoder_getRenderHRI(ctx_); }
+	Result<void> setRenderHRI(bool v) { return check(gs1_encoder_setRenderHRI(ctx_, v)); }
+
+	int rasterThreads() const noexcept { return gs1_encoder_getRasterThreads(ctx_); }
+	Result<void> setRasterThreads(int threads) { return check(gs1_encoder_setRasterThreads(ctx_, threads)); }
+
+	double previewScale() const noexcept { return gs1_encoder_getPreviewScale(ctx_); }
+	Result<void> setPreviewScale(double scale) { return check(gs1_encoder_setPreviewScale(ctx_, scale)); }
+
+	/// Preview colours, as 0xRRGGBBAA
+	std::uint32_t previewDarkColour() const noexcept { return gs1_encoder_getPreviewDarkColour(ctx_); }
+	Result<void> setPreviewDarkColour(std::uint32_t rgba) { return check(gs1_encoder_setPreviewDarkColour(ctx_, rgba)); }
+
+	std::uint32_t previewLightColour() const noexcept { return gs1_encoder_getPreviewLightColour(ctx_); }
+	Result<void> setPreviewLightColour(std::uint32_t rgba) { return check(gs1_encoder_setPreviewLightColour(ctx_, rgba)); }
+
+	Digest outputDigestAlg() const noexcept { return static_cast<Digest>(gs1_encoder_getOutputDigestAlg(ctx_)); }
+	Result<void> setOutputDigestAlg(Digest alg) { return check(gs1_encoder_setOutputDigestAlg(ctx_, static_cast<int>(alg))); }
+
+	/// Digest of the output, computed as it was written
+	ByteView outputDigest() const noexcept {
+		void *digest = nullptr;
+		std::size_t size = gs1_encoder_getOutputDigest(ctx_, &digest);
+		return ByteView(static_cast<const std::byte *>(digest), size);
+	}
+
+	int bufferWidth() const noexcept { return gs1_encoder_getBufferWidth(ctx_); }
+	int bufferHeight() const noexcept { return gs1_encoder_getBufferHeight(ctx_); }
+
+private:
+	Result<void> check(bool ok) const {
+		return ok ? Result<void>() : Result<void>::failure(gs1_encoder_getErrMsg(ctx_));
+	}
+
+	gs1_encoder *ctx_;
+};
+
+
+}  // namespace gs1
+
+
+#endif  /* GS1_ENCODERS_HPP */
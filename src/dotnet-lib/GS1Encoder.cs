@@ -81,6 +81,10 @@ namespace GS1.Encoders
             QR,
             /// <summary>(GS1) Data Matrix</summary>
             DM,
+            /// <summary>(GS1) Rectangular Micro QR Code (rMQR)</summary>
+            RMQR,
+            /// <summary>ITF-14</summary>
+            ITF14,
             /// <summary>Value is the number of symbologies</summary>
             NUMSYMS,
         };
@@ -102,6 +106,69 @@ namespace GS1.Encoders
             TIF = 1,
             /// <summary>Headerless TIFF</summary>
             RAW = 2,
+            /// <summary>Marking path for Data Matrix and QR Code</summary>
+            PATH = 3,
+            /// <summary>Headerless 8-bit grey preview</summary>
+            GRAY = 4,
+            /// <summary>Headerless 32-bit RGBA preview</summary>
+            RGBA = 5,
+        };
+
+        /// <summary>
+        /// List of marking path modes, mirroring the corresponding list in
+        /// the C library.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - enum gs1_encoder_pathModes
+        ///
+        /// </summary>
+        public enum PathModes
+        {
+            /// <summary>A dot per dark module</summary>
+            DOTS = 0,
+            /// <summary>Strokes covering runs of dark modules</summary>
+            STROKES = 1,
+        };
+
+        /// <summary>
+        /// List of output digest algorithms, mirroring the corresponding list
+        /// in the C library.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - enum gs1_encoder_digests
+        ///
+        /// </summary>
+        public enum Digests
+        {
+            /// <summary>No digest</summary>
+            NONE = 0,
+            /// <summary>XXH64</summary>
+            XXH64 = 1,
+            /// <summary>SHA-256</summary>
+            SHA256 = 2,
+        };
+
+        /// <summary>
+        /// List of mechanisms for asynchronous file output, mirroring the
+        /// corresponding list in the C library.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - enum gs1_encoder_asyncBackends
+        ///
+        /// </summary>
+        public enum AsyncBackends
+        {
+            /// <summary>None</summary>
+            NONE = 0,
+            /// <summary>Linux io_uring</summary>
+            IOURING = 1,
+            /// <summary>Writer threads</summary>
+            THREADS = 2,
+            /// <summary>Synchronous</summary>
+            SYNC = 3,
         };
 
         /// <summary>
@@ -348,6 +415,159 @@ namespace GS1.Encoders
             Version40,
         };
 
+        /// <summary>
+        /// Settings and input data for a single call to Encode(EncodeRequest),
+        /// mirroring the corresponding struct in the C library.
+        ///
+        /// A zero value selects the library default for those settings that
+        /// do not otherwise accept zero.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - struct gs1_encoder_request
+        ///
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential)]
+        public struct EncodeRequest
+        {
+            /// <summary>Size of the struct, which Encode(EncodeRequest) sets</summary>
+            public UIntPtr Size;
+            /// <summary>Symbology</summary>
+            public Symbology Sym;
+            /// <summary>Output format</summary>
+            public Formats Format;
+            /// <summary>Device dots per module, or 0 for 1</summary>
+            public int PixMult;
+            /// <summary>X undercut in pixels</summary>
+            public int Xundercut;
+            /// <summary>Y undercut in pixels</summary>
+            public int Yundercut;
+            /// <summary>Separator height, or 0 to match PixMult</summary>
+            public int SepHt;
+            /// <summary>Segments per row, or 0 for 22</summary>
+            public int DataBarExpandedSegmentsWidth;
+            /// <summary>GS1-128 height in modules, or 0 for 25</summary>
+            public int GS1_128LinearHeight;
+            /// <summary>Data Matrix rows, or 0 for automatic</summary>
+            public DMrows DmRows;
+            /// <summary>Data Matrix columns, or 0 for automatic</summary>
+            public DMcolumns DmColumns;
+            /// <summary>QR Code version, or 0 for automatic</summary>
+            public QRversion QrVersion;
+            /// <summary>QR Code error correction level, or 0 for M</summary>
+            public QReclevel QrEClevel;
+            /// <summary>Calculate rather than validate check digits</summary>
+            [MarshalAs(UnmanagedType.Bool)]
+            public bool AddCheckDigit;
+            /// <summary>Accept AIs that are not in the AI table</summary>
+            [MarshalAs(UnmanagedType.Bool)]
+            public bool PermitUnknownAIs;
+            /// <summary>DataStr is bracketed AI syntax rather than raw data</summary>
+            [MarshalAs(UnmanagedType.Bool)]
+            public bool AIsyntax;
+            /// <summary>Barcode input data</summary>
+            [MarshalAs(UnmanagedType.LPStr)]
+            public string DataStr;
+            /// <summary>Output filename, or null for buffer output</summary>
+            [MarshalAs(UnmanagedType.LPStr)]
+            public string OutFile;
+            /// <summary>Render the HRI text beneath the symbol</summary>
+            [MarshalAs(UnmanagedType.Bool)]
+            public bool RenderHRI;
+            /// <summary>Marking path mode</summary>
+            public PathModes PathMode;
+            /// <summary>Reorder the marking path to reduce travel</summary>
+            [MarshalAs(UnmanagedType.Bool)]
+            public bool PathOptimise;
+            /// <summary>Preview pixels per device dot, or 0 for 1</summary>
+            public double PreviewScale;
+            /// <summary>Preview dark colour as 0xRRGGBBAA, or 0 for opaque black</summary>
+            public uint PreviewDarkColour;
+            /// <summary>Preview light colour as 0xRRGGBBAA, or 0 for opaque white</summary>
+            public uint PreviewLightColour;
+            /// <summary>Digest of the output</summary>
+            public Digests OutputDigestAlg;
+            /// <summary>Threads rasterising a large image, or 0 for 1</summary>
+            public int RasterThreads;
+        };
+
+        /// <summary>
+        /// Output of Encode(EncodeRequest).
+        /// </summary>
+        public class EncodeResult
+        {
+            /// <summary>Output buffer, empty when writing to a file</summary>
+            public byte[] Buffer { get; internal set; }
+            /// <summary>Width of the buffer image in pixels</summary>
+            public int Width { get; internal set; }
+            /// <summary>Height of the buffer image in pixels</summary>
+            public int Height { get; internal set; }
+            /// <summary>HRI strings for the AI data</summary>
+            public string[] HRI { get; internal set; }
+            /// <summary>Digest of the output, empty when none was requested</summary>
+            public byte[] Digest { get; internal set; }
+        };
+
+        /// <summary>
+        /// Units in which a Capacity is reported.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - enum gs1_encoder_capacityUnits
+        ///
+        /// </summary>
+        public enum CapacityUnits
+        {
+            /// <summary>Bits of data</summary>
+            Bits = 0,
+            /// <summary>Symbol characters</summary>
+            SymbolCharacters = 1,
+        };
+
+        /// <summary>
+        /// Output of GetCapacity(), mirroring the corresponding struct in the
+        /// C library.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_capacity
+        ///
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential)]
+        public struct Capacity
+        {
+            /// <summary>Units of Used and Available</summary>
+            public CapacityUnits Units;
+            /// <summary>Space taken by the data</summary>
+            public int Used;
+            /// <summary>Space available in the selected symbol size</summary>
+            public int Available;
+            /// <summary>Rows of the selected symbol size</summary>
+            public int Rows;
+            /// <summary>Columns of the selected symbol size</summary>
+            public int Columns;
+            /// <summary>Whether the data fits</summary>
+            [MarshalAs(UnmanagedType.Bool)]
+            public bool Fits;
+        };
+
+        // Layout of struct gs1_encoder_result
+        [StructLayout(LayoutKind.Sequential)]
+        private struct NativeResult
+        {
+            public int status;
+            public int width;
+            public int height;
+            public int numHRI;
+            public IntPtr buffer;
+            public UIntPtr bufferSize;
+            public IntPtr hri;
+            public IntPtr hriOffsets;
+            public IntPtr errMsg;
+            public IntPtr digest;
+            public UIntPtr digestSize;
+        };
+
         /// <summary>
         /// The expected name of the GS1 Barcode Engine dynamic-link library
         /// </summary>
@@ -516,6 +736,13 @@ namespace GS1.Encoders
         [DllImport(gs1_dll, EntryPoint = "gs1_encoder_getAIdataStr", CallingConvention = CallingConvention.Cdecl)]
         private static extern IntPtr gs1_encoder_getAIdataStr(IntPtr ctx);
 
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_normaliseDLuri", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool gs1_encoder_normaliseDLuri(IntPtr ctx, string uri, ref IntPtr elementString, ref IntPtr canonicalURI);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_getAIdataJSON", CallingConvention = CallingConvention.Cdecl)]
+        private static extern IntPtr gs1_encoder_getAIdataJSON(IntPtr ctx);
+
         [DllImport(gs1_dll, EntryPoint = "gs1_encoder_getScanData", CallingConvention = CallingConvention.Cdecl)]
         private static extern IntPtr gs1_encoder_getScanData(IntPtr ctx);
 
@@ -547,6 +774,64 @@ namespace GS1.Encoders
         [return: MarshalAs(UnmanagedType.U1)]
         private static extern bool gs1_encoder_setFormat(IntPtr ctx, int format);
 
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_getPathMode", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int gs1_encoder_getPathMode(IntPtr ctx);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_setPathMode", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool gs1_encoder_setPathMode(IntPtr ctx, int mode);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_getPathOptimise", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool gs1_encoder_getPathOptimise(IntPtr ctx);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_setPathOptimise", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool gs1_encoder_setPathOptimise(IntPtr ctx, [MarshalAs(UnmanagedType.U1)] bool optimise);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_getRenderHRI", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool gs1_encoder_getRenderHRI(IntPtr ctx);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_setRenderHRI", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool gs1_encoder_setRenderHRI(IntPtr ctx, [MarshalAs(UnmanagedType.U1)] bool renderHRI);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_getRasterThreads", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int gs1_encoder_getRasterThreads(IntPtr ctx);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_setRasterThreads", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool gs1_encoder_setRasterThreads(IntPtr ctx, int threads);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_getPreviewScale", CallingConvention = CallingConvention.Cdecl)]
+        private static extern double gs1_encoder_getPreviewScale(IntPtr ctx);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_setPreviewScale", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool gs1_encoder_setPreviewScale(IntPtr ctx, double scale);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_getPreviewDarkColour", CallingConvention = CallingConvention.Cdecl)]
+        private static extern uint gs1_encoder_getPreviewDarkColour(IntPtr ctx);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_setPreviewDarkColour", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool gs1_encoder_setPreviewDarkColour(IntPtr ctx, uint rgba);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_getPreviewLightColour", CallingConvention = CallingConvention.Cdecl)]
+        private static extern uint gs1_encoder_getPreviewLightColour(IntPtr ctx);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_setPreviewLightColour", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool gs1_encoder_setPreviewLightColour(IntPtr ctx, uint rgba);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_getOutputDigestAlg", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int gs1_encoder_getOutputDigestAlg(IntPtr ctx);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_setOutputDigestAlg", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool gs1_encoder_setOutputDigestAlg(IntPtr ctx, int alg);
+
         [DllImport(gs1_dll, EntryPoint = "gs1_encoder_encode", CallingConvention = CallingConvention.Cdecl)]
         [return: MarshalAs(UnmanagedType.U1)]
         private static extern bool gs1_encoder_encode(IntPtr ctx);
@@ -554,6 +839,46 @@ namespace GS1.Encoders
         [DllImport(gs1_dll, EntryPoint = "gs1_encoder_getBuffer", CallingConvention = CallingConvention.Cdecl)]
         private static extern int gs1_encoder_getBuffer(IntPtr ctx, ref IntPtr buf);
 
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_getOutputDigest", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int gs1_encoder_getOutputDigest(IntPtr ctx, ref IntPtr digest);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_openBatchFile", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool gs1_encoder_openBatchFile(IntPtr ctx, string batchFile);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_closeBatchFile", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool gs1_encoder_closeBatchFile(IntPtr ctx);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_getBatchPageCount", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int gs1_encoder_getBatchPageCount(IntPtr ctx);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_getBatchPageOffset", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int gs1_encoder_getBatchPageOffset(IntPtr ctx, int page);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_openCache", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool gs1_encoder_openCache(IntPtr ctx, string cacheFile, UIntPtr size);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_closeCache", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool gs1_encoder_closeCache(IntPtr ctx);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_getCacheHit", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool gs1_encoder_getCacheHit(IntPtr ctx);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_openAsyncOutput", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool gs1_encoder_openAsyncOutput(IntPtr ctx, int depth);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_closeAsyncOutput", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool gs1_encoder_closeAsyncOutput(IntPtr ctx);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_getAsyncBackend", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int gs1_encoder_getAsyncBackend(IntPtr ctx);
+
         [DllImport(gs1_dll, EntryPoint = "gs1_encoder_getBufferWidth", CallingConvention = CallingConvention.Cdecl)]
         private static extern int gs1_encoder_getBufferWidth(IntPtr ctx);
 
@@ -563,6 +888,14 @@ namespace GS1.Encoders
         [DllImport(gs1_dll, EntryPoint = "gs1_encoder_getBufferStrings", CallingConvention = CallingConvention.Cdecl)]
         private static extern int gs1_encoder_getBufferStrings(IntPtr ctx, ref IntPtr strings);
 
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_encodeRequest", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool gs1_encoder_encodeRequest(IntPtr ctx, ref EncodeRequest request, out NativeResult result);
+
+        [DllImport(gs1_dll, EntryPoint = "gs1_encoder_getCapacity", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool gs1_encoder_getCapacity(IntPtr ctx, out Capacity capacity);
+
         [DllImport(gs1_dll, EntryPoint = "gs1_encoder_free", CallingConvention = CallingConvention.Cdecl)]
         private static extern void gs1_encoder_free(IntPtr ctx);
 
@@ -1062,6 +1395,40 @@ namespace GS1.Encoders
             }
         }
 
+        /// <summary>
+        /// Set the input data to a GS1 Digital Link URI and return its
+        /// canonical element string and canonical URI.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_normaliseDLuri()
+        ///
+        /// </summary>
+        public void NormaliseDLuri(string uri, out string elementString, out string canonicalURI)
+        {
+            IntPtr es = IntPtr.Zero, cu = IntPtr.Zero;
+            if (!gs1_encoder_normaliseDLuri(ctx, uri, ref es, ref cu))
+                throw new GS1EncoderParameterException(ErrMsg);
+            elementString = System.Runtime.InteropServices.Marshal.PtrToStringAnsi(es);
+            canonicalURI = System.Runtime.InteropServices.Marshal.PtrToStringAnsi(cu);
+        }
+
+        /// <summary>
+        /// Get the AI data of the input as a compact JSON object, or null
+        /// for non-AI data.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_getAIdataJSON()
+        ///
+        /// </summary>
+        public string AIdataJSON
+        {
+            get {
+                return System.Runtime.InteropServices.Marshal.PtrToStringAnsi(gs1_encoder_getAIdataJSON(ctx));
+            }
+        }
+
         /// <summary>
         /// Get/set the barcode data input buffer using barcode scan data format.
         ///
@@ -1152,6 +1519,178 @@ namespace GS1.Encoders
             }
         }
 
+        /// <summary>
+        /// Get/set whether marking path output consists of dots or strokes.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_getPathMode()
+        ///   - gs1_encoder_setPathMode()
+        ///
+        /// </summary>
+        public int PathMode
+        {
+            get {
+                return gs1_encoder_getPathMode(ctx);
+            }
+            set
+            {
+                if (!gs1_encoder_setPathMode(ctx, value))
+                    throw new GS1EncoderParameterException(ErrMsg);
+            }
+        }
+
+        /// <summary>
+        /// Get/set whether a 2-opt pass is applied to reduce marking path travel.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_getPathOptimise()
+        ///   - gs1_encoder_setPathOptimise()
+        ///
+        /// </summary>
+        public bool PathOptimise
+        {
+            get {
+                return gs1_encoder_getPathOptimise(ctx);
+            }
+            set
+            {
+                if (!gs1_encoder_setPathOptimise(ctx, value))
+                    throw new GS1EncoderParameterException(ErrMsg);
+            }
+        }
+
+        /// <summary>
+        /// Get/set whether the HRI text is rendered beneath the symbol.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_getRenderHRI()
+        ///   - gs1_encoder_setRenderHRI()
+        ///
+        /// </summary>
+        public bool RenderHRI
+        {
+            get {
+                return gs1_encoder_getRenderHRI(ctx);
+            }
+            set
+            {
+                if (!gs1_encoder_setRenderHRI(ctx, value))
+                    throw new GS1EncoderParameterException(ErrMsg);
+            }
+        }
+
+        /// <summary>
+        /// Get/set the number of threads that rasterise bands of a large
+        /// image in parallel.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_getRasterThreads()
+        ///   - gs1_encoder_setRasterThreads()
+        ///
+        /// </summary>
+        public int RasterThreads
+        {
+            get {
+                return gs1_encoder_getRasterThreads(ctx);
+            }
+            set
+            {
+                if (!gs1_encoder_setRasterThreads(ctx, value))
+                    throw new GS1EncoderParameterException(ErrMsg);
+            }
+        }
+
+        /// <summary>
+        /// Get/set the pixels per X-dimension of the GRAY and RGBA preview
+        /// formats.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_getPreviewScale()
+        ///   - gs1_encoder_setPreviewScale()
+        ///
+        /// </summary>
+        public double PreviewScale
+        {
+            get {
+                return gs1_encoder_getPreviewScale(ctx);
+            }
+            set
+            {
+                if (!gs1_encoder_setPreviewScale(ctx, value))
+                    throw new GS1EncoderParameterException(ErrMsg);
+            }
+        }
+
+        /// <summary>
+        /// Get/set the preview colour of dark modules, as 0xRRGGBBAA.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_getPreviewDarkColour()
+        ///   - gs1_encoder_setPreviewDarkColour()
+        ///
+        /// </summary>
+        public uint PreviewDarkColour
+        {
+            get {
+                return gs1_encoder_getPreviewDarkColour(ctx);
+            }
+            set
+            {
+                if (!gs1_encoder_setPreviewDarkColour(ctx, value))
+                    throw new GS1EncoderParameterException(ErrMsg);
+            }
+        }
+
+        /// <summary>
+        /// Get/set the preview colour of light modules and the quiet zone, as
+        /// 0xRRGGBBAA.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_getPreviewLightColour()
+        ///   - gs1_encoder_setPreviewLightColour()
+        ///
+        /// </summary>
+        public uint PreviewLightColour
+        {
+            get {
+                return gs1_encoder_getPreviewLightColour(ctx);
+            }
+            set
+            {
+                if (!gs1_encoder_setPreviewLightColour(ctx, value))
+                    throw new GS1EncoderParameterException(ErrMsg);
+            }
+        }
+
+        /// <summary>
+        /// Get/set the algorithm used to compute a digest of the output as it
+        /// is written.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_getOutputDigestAlg()
+        ///   - gs1_encoder_setOutputDigestAlg()
+        ///
+        /// </summary>
+        public int OutputDigestAlg
+        {
+            get {
+                return gs1_encoder_getOutputDigestAlg(ctx);
+            }
+            set
+            {
+                if (!gs1_encoder_setOutputDigestAlg(ctx, value))
+                    throw new GS1EncoderParameterException(ErrMsg);
+            }
+        }
+
         /// <summary>
         /// Get/set the current output filename.
         ///
@@ -1188,6 +1727,62 @@ namespace GS1.Encoders
                 throw new GS1EncoderEncodeException(ErrMsg);
         }
 
+        /// <summary>
+        /// Apply all of the settings in a request, encode the data and
+        /// collect the output in a single transition into the native library.
+        ///
+        /// This avoids the per-property P/Invoke overhead of configuring the
+        /// instance through individual properties when generating many
+        /// symbols. The settings applied remain in effect afterwards.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_encodeRequest()
+        ///
+        /// </summary>
+        public EncodeResult Encode(EncodeRequest request)
+        {
+            NativeResult res;
+            request.Size = (UIntPtr)Marshal.SizeOf(typeof(EncodeRequest));
+            if (!gs1_encoder_encodeRequest(ctx, ref request, out res))
+                throw new GS1EncoderEncodeException(Marshal.PtrToStringAnsi(res.errMsg));
+
+            int size = (int)res.bufferSize;
+            byte[] data = new byte[size];
+            if (size > 0)
+                Marshal.Copy(res.buffer, data, 0, size);
+
+            int[] offsets = new int[res.numHRI];
+            if (res.numHRI > 0)
+                Marshal.Copy(res.hriOffsets, offsets, 0, res.numHRI);
+            string[] hri = new string[res.numHRI];
+            for (int i = 0; i < res.numHRI; i++)
+                hri[i] = Marshal.PtrToStringAnsi(IntPtr.Add(res.hri, offsets[i]));
+
+            byte[] digest = new byte[(int)res.digestSize];
+            if (digest.Length > 0)
+                Marshal.Copy(res.digest, digest, 0, digest.Length);
+
+            return new EncodeResult { Buffer = data, Width = res.width, Height = res.height, HRI = hri, Digest = digest };
+        }
+
+        /// <summary>
+        /// Get the space that the input data takes against the capacity of
+        /// the symbol that would be selected, without encoding.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_getCapacity()
+        ///
+        /// </summary>
+        public Capacity GetCapacity()
+        {
+            Capacity capacity;
+            if (!gs1_encoder_getCapacity(ctx, out capacity))
+                throw new GS1EncoderEncodeException(ErrMsg);
+            return capacity;
+        }
+
         /// <summary>
         /// Get the output buffer.
         ///
@@ -1209,6 +1804,168 @@ namespace GS1.Encoders
             return data;
         }
 
+        /// <summary>
+        /// Get the digest of the output, or an empty array if none was computed.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_getOutputDigest()
+        ///
+        /// </summary>
+        public byte[] GetOutputDigest()
+        {
+            IntPtr digest = new IntPtr();
+            int size = gs1_encoder_getOutputDigest(ctx, ref digest);
+
+            if (size == 0)
+                return new byte[0];
+
+            byte[] data = new byte[size];
+            Marshal.Copy(digest, data, 0, size);
+            return data;
+        }
+
+        /// <summary>
+        /// Open a multi-page TIFF file that receives each subsequently encoded
+        /// symbol as a new page.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_openBatchFile()
+        ///
+        /// </summary>
+        public void OpenBatchFile(string batchFile)
+        {
+            if (!gs1_encoder_openBatchFile(ctx, batchFile))
+                throw new GS1EncoderParameterException(ErrMsg);
+        }
+
+        /// <summary>
+        /// Flush and close the batch file.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_closeBatchFile()
+        ///
+        /// </summary>
+        public void CloseBatchFile()
+        {
+            if (!gs1_encoder_closeBatchFile(ctx))
+                throw new GS1EncoderEncodeException(ErrMsg);
+        }
+
+        /// <summary>
+        /// Get the file offset of each page in the current or last batch file.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_getBatchPageCount()
+        ///   - gs1_encoder_getBatchPageOffset()
+        ///
+        /// </summary>
+        public long[] BatchPageOffsets
+        {
+            get
+            {
+                int pages = gs1_encoder_getBatchPageCount(ctx);
+                long[] offsets = new long[pages];
+                for (int i = 0; i < pages; i++)
+                    offsets[i] = (uint)gs1_encoder_getBatchPageOffset(ctx, i);
+                return offsets;
+            }
+        }
+
+        /// <summary>
+        /// Open a persistent cache of rendered symbols that is shared with
+        /// other processes using the same file.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_openCache()
+        ///
+        /// </summary>
+        public void OpenCache(string cacheFile, ulong size)
+        {
+            if (!gs1_encoder_openCache(ctx, cacheFile, new UIntPtr(size)))
+                throw new GS1EncoderParameterException(ErrMsg);
+        }
+
+        /// <summary>
+        /// Close the symbol cache.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_closeCache()
+        ///
+        /// </summary>
+        public void CloseCache()
+        {
+            if (!gs1_encoder_closeCache(ctx))
+                throw new GS1EncoderParameterException(ErrMsg);
+        }
+
+        /// <summary>
+        /// Determine whether the last symbol was served from the cache.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_getCacheHit()
+        ///
+        /// </summary>
+        public bool CacheHit
+        {
+            get
+            {
+                return gs1_encoder_getCacheHit(ctx);
+            }
+        }
+
+        /// <summary>
+        /// Write each subsequently encoded symbol to its output file
+        /// asynchronously, with up to the given number of files in flight.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_openAsyncOutput()
+        ///
+        /// </summary>
+        public void OpenAsyncOutput(int depth)
+        {
+            if (!gs1_encoder_openAsyncOutput(ctx, depth))
+                throw new GS1EncoderParameterException(ErrMsg);
+        }
+
+        /// <summary>
+        /// Wait for all queued files to be written and close the
+        /// asynchronous output.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_closeAsyncOutput()
+        ///
+        /// </summary>
+        public void CloseAsyncOutput()
+        {
+            if (!gs1_encoder_closeAsyncOutput(ctx))
+                throw new GS1EncoderGeneralException(ErrMsg);
+        }
+
+        /// <summary>
+        /// Get the mechanism used for asynchronous file output.
+        ///
+        /// See the native library documentation for details:
+        ///
+        ///   - gs1_encoder_getAsyncBackend()
+        ///
+        /// </summary>
+        public AsyncBackends AsyncBackend
+        {
+            get
+            {
+                return (AsyncBackends)gs1_encoder_getAsyncBackend(ctx);
+            }
+        }
+
         /// <summary>
         /// Get the number of columns in the output buffer image.
         ///
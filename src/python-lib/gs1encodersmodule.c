@@ -0,0 +1,1009 @@
+/**
+ * GS1 Barcode Engine
+ *
+ * @author Copyright (c) 2021 GS1 AISBL.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * CPython extension module providing native access to the GS1 Barcode Engine.
+ *
+ * The output of an Encoder is exposed through the buffer protocol so that
+ * memoryview(enc) references the image held by the library without copying.
+ * The GIL is released while a symbol is generated.
+ *
+ * encode_batch() generates many symbols across a pool of native threads,
+ * each with its own library instance, returning Symbol objects that also
+ * export their image through the buffer protocol.
+ *
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "gs1encoders.h"
+
+#define MAX_BATCH_THREADS 64
+
+
+static PyObject *GS1EncoderError;
+
+
+/*
+ *  Encoder: wraps an instance of the library
+ *
+ */
+typedef struct {
+	PyObject_HEAD
+	gs1_encoder *ctx;
+	Py_ssize_t exports;		// Number of live buffer views of the output
+	bool busy;			// Encoding with the GIL released
+} EncoderObject;
+
+
+static PyObject* raise_error(gs1_encoder *ctx) {
+	PyErr_SetString(GS1EncoderError, gs1_encoder_getErrMsg(ctx));
+	return NULL;
+}
+
+
+static bool check_idle(EncoderObject *self) {
+	if (self->busy) {
+		PyErr_SetString(PyExc_RuntimeError, "Encoder is busy in another thread");
+		return false;
+	}
+	return true;
+}
+
+
+static int Encoder_init(EncoderObject *self, PyObject *args, PyObject *kwds) {
+
+	static char *kwlist[] = { NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "", kwlist))
+		return -1;
+
+	// A repeated __init__() must not free an instance that is still in use
+	if (!check_idle(self))
+		return -1;
+
+	if (self->exports > 0) {
+		PyErr_SetString(PyExc_BufferError, "Existing exports of the output buffer: cannot re-initialise");
+		return -1;
+	}
+
+	if (self->ctx)
+		gs1_encoder_free(self->ctx);
+	if ((self->ctx = gs1_encoder_init(NULL)) == NULL) {
+		PyErr_SetString(GS1EncoderError, "Failed to initialise GS1 Barcode Engine");
+		return -1;
+	}
+	return 0;
+
+}
+
+
+static void Encoder_dealloc(EncoderObject *self) {
+	if (self->ctx)
+		gs1_encoder_free(self->ctx);
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+
+static PyObject* Encoder_encode(EncoderObject *self, PyObject *Py_UNUSED(ignored)) {
+
+	bool ret;
+
+	if (!check_idle(self))
+		return NULL;
+
+	if (self->exports > 0) {
+		PyErr_SetString(PyExc_BufferError, "Existing exports of the output buffer: cannot re-encode");
+		return NULL;
+	}
+
+	self->busy = true;
+	Py_BEGIN_ALLOW_THREADS
+	ret = gs1_encoder_encode(self->ctx);
+	Py_END_ALLOW_THREADS
+	self->busy = false;
+
+	if (!ret)
+		return raise_error(self->ctx);
+
+	Py_RETURN_NONE;
+
+}
+
+
+static PyObject* Encoder_getBufferStrings(EncoderObject *self, PyObject *Py_UNUSED(ignored)) {
+
+	char **strings;
+	size_t rows, i;
+	PyObject *list;
+
+	if (!check_idle(self))
+		return NULL;
+
+	rows = gs1_encoder_getBufferStrings(self->ctx, &strings);
+	if ((list = PyList_New((Py_ssize_t)rows)) == NULL)
+		return NULL;
+	for (i = 0; i < rows; i++) {
+		PyObject *s = PyUnicode_FromString(strings[i]);
+		if (!s) {
+			Py_DECREF(list);
+			return NULL;
+		}
+		PyList_SET_ITEM(list, (Py_ssize_t)i, s);
+	}
+	return list;
+
+}
+
+
+/*
+ *  Validate a column held in Arrow string layout: data is the value arena and
+ *  offsets is any buffer of count+1 32-bit offsets, such as buffers()[1] of a
+ *  pyarrow string array
+ *
+ */
+static PyObject* Encoder_validateAIcolumn(EncoderObject *self, PyObject *args) {
+
+	const char *ai;
+	Py_buffer data, offsets;
+	PyObject *validity = NULL, *faults = NULL, *result = NULL;
+	size_t count;
+	long ret;
+
+	if (!check_idle(self))
+		return NULL;
+
+	if (!PyArg_ParseTuple(args, "sy*y*", &ai, &data, &offsets))
+		return NULL;
+
+	if (offsets.len < (Py_ssize_t)sizeof(int32_t) || offsets.len % (Py_ssize_t)sizeof(int32_t) != 0) {
+		PyErr_SetString(PyExc_ValueError, "offsets must hold count+1 32-bit integers");
+		goto out;
+	}
+	count = (size_t)offsets.len / sizeof(int32_t) - 1;
+
+	if ((validity = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)((count + 7) / 8))) == NULL ||
+	    (faults = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)count)) == NULL)
+		goto out;
+
+	// The arena must hold every value
+	if (count > 0 && (((const int32_t *)offsets.buf)[count] > data.len)) {
+		PyErr_SetString(PyExc_ValueError, "offsets extend beyond the data");
+		goto out;
+	}
+
+	self->busy = true;
+	Py_BEGIN_ALLOW_THREADS
+	ret = gs1_encoder_validateAIcolumn(self->ctx, ai, data.buf, offsets.buf, count,
+					   (uint8_t *)PyBytes_AS_STRING(validity), (uint8_t *)PyBytes_AS_STRING(faults));
+	Py_END_ALLOW_THREADS
+	self->busy = false;
+
+	if (ret < 0) {
+		raise_error(self->ctx);
+		goto out;
+	}
+
+	result = PyTuple_Pack(2, validity, faults);
+
+out:
+
+	Py_XDECREF(validity);
+	Py_XDECREF(faults);
+	PyBuffer_Release(&data);
+	PyBuffer_Release(&offsets);
+	return result;
+
+}
+
+
+static PyObject* Encoder_normaliseDLuri(EncoderObject *self, PyObject *args) {
+
+	const char *uri;
+	char *es, *canonical;
+
+	if (!check_idle(self))
+		return NULL;
+
+	if (!PyArg_ParseTuple(args, "s", &uri))
+		return NULL;
+
+	if (!gs1_encoder_normaliseDLuri(self->ctx, uri, &es, &canonical))
+		return raise_error(self->ctx);
+
+	return Py_BuildValue("(ss)", es, canonical);
+
+}
+
+
+static PyObject* Encoder_getCapacity(EncoderObject *self, PyObject *Py_UNUSED(ignored)) {
+
+	gs1_encoder_capacity cap;
+
+	if (!check_idle(self))
+		return NULL;
+
+	if (!gs1_encoder_getCapacity(self->ctx, &cap))
+		return raise_error(self->ctx);
+
+	return Py_BuildValue("{sisisisisisO}",
+			     "units", cap.units, "used", cap.used, "capacity", cap.capacity,
+			     "rows", cap.rows, "columns", cap.columns, "fits", cap.fits ? Py_True : Py_False);
+
+}
+
+
+static PyMethodDef Encoder_methods[] = {
+	{ "encode", (PyCFunction)Encoder_encode, METH_NOARGS,
+	  "Generate the symbol. The GIL is released while encoding." },
+	{ "getBufferStrings", (PyCFunction)Encoder_getBufferStrings, METH_NOARGS,
+	  "Return the output image as a list of strings." },
+	{ "normaliseDLuri", (PyCFunction)Encoder_normaliseDLuri, METH_VARARGS,
+	  "normaliseDLuri(uri)\n\n"
+	  "Set the input data to a Digital Link URI, returning its canonical element string and URI." },
+	{ "validateAIcolumn", (PyCFunction)Encoder_validateAIcolumn, METH_VARARGS,
+	  "validateAIcolumn(ai, data, offsets)\n\n"
+	  "Validate a column of values for an AI held in Arrow string layout, returning a\n"
+	  "validity bitmap and a fault code per value. The GIL is released while validating." },
+	{ "getCapacity", (PyCFunction)Encoder_getCapacity, METH_NOARGS,
+	  "Return the space used by the input data against the capacity of the symbol, without encoding." },
+	{ NULL, NULL, 0, NULL }
+};
+
+
+/*
+ *  Property accessors, mapped onto the get/set functions of the C API
+ *
+ */
+struct intProp {
+	int (*get)(gs1_encoder *);
+	bool (*set)(gs1_encoder *, int);
+};
+
+struct boolProp {
+	bool (*get)(gs1_encoder *);
+	bool (*set)(gs1_encoder *, bool);
+};
+
+struct strProp {
+	char* (*get)(gs1_encoder *);
+	bool (*set)(gs1_encoder *, const char *);
+};
+
+struct floatProp {
+	double (*get)(gs1_encoder *);
+	bool (*set)(gs1_encoder *, double);
+};
+
+struct colourProp {
+	uint32_t (*get)(gs1_encoder *);
+	bool (*set)(gs1_encoder *, uint32_t);
+};
+
+
+static PyObject* getInt(EncoderObject *self, void *closure) {
+	const struct intProp *p = closure;
+	if (!check_idle(self))
+		return NULL;
+	return PyLong_FromLong(p->get(self->ctx));
+}
+
+static int setInt(EncoderObject *self, PyObject *value, void *closure) {
+	const struct intProp *p = closure;
+	long v;
+	if (!check_idle(self))
+		return -1;
+	if (value == NULL) {
+		PyErr_SetString(PyExc_TypeError, "Cannot delete attribute");
+		return -1;
+	}
+	v = PyLong_AsLong(value);
+	if (v == -1 && PyErr_Occurred())
+		return -1;
+	if (v < INT32_MIN || v > INT32_MAX || !p->set(self->ctx, (int)v)) {
+		raise_error(self->ctx);
+		return -1;
+	}
+	return 0;
+}
+
+static PyObject* getBool(EncoderObject *self, void *closure) {
+	const struct boolProp *p = closure;
+	if (!check_idle(self))
+		return NULL;
+	return PyBool_FromLong(p->get(self->ctx));
+}
+
+static int setBool(EncoderObject *self, PyObject *value, void *closure) {
+	const struct boolProp *p = closure;
+	int v;
+	if (!check_idle(self))
+		return -1;
+	if (value == NULL) {
+		PyErr_SetString(PyExc_TypeError, "Cannot delete attribute");
+		return -1;
+	}
+	if ((v = PyObject_IsTrue(value)) < 0)
+		return -1;
+	if (!p->set(self->ctx, v != 0)) {
+		raise_error(self->ctx);
+		return -1;
+	}
+	return 0;
+}
+
+static PyObject* getFloat(EncoderObject *self, void *closure) {
+	const struct floatProp *p = closure;
+	if (!check_idle(self))
+		return NULL;
+	return PyFloat_FromDouble(p->get(self->ctx));
+}
+
+static int setFloat(EncoderObject *self, PyObject *value, void *closure) {
+	const struct floatProp *p = closure;
+	double v;
+	if (!check_idle(self))
+		return -1;
+	if (value == NULL) {
+		PyErr_SetString(PyExc_TypeError, "Cannot delete attribute");
+		return -1;
+	}
+	v = PyFloat_AsDouble(value);
+	if (v == -1.0 && PyErr_Occurred())
+		return -1;
+	if (!p->set(self->ctx, v)) {
+		raise_error(self->ctx);
+		return -1;
+	}
+	return 0;
+}
+
+static PyObject* getColour(EncoderObject *self, void *closure) {
+	const struct colourProp *p = closure;
+	if (!check_idle(self))
+		return NULL;
+	return PyLong_FromUnsignedLong(p->get(self->ctx));
+}
+
+static int setColour(EncoderObject *self, PyObject *value, void *closure) {
+	const struct colourProp *p = closure;
+	unsigned long v;
+	if (!check_idle(self))
+		return -1;
+	if (value == NULL) {
+		PyErr_SetString(PyExc_TypeError, "Cannot delete attribute");
+		return -1;
+	}
+	v = PyLong_AsUnsignedLong(value);
+	if (v == (unsigned long)-1 && PyErr_Occurred())
+		return -1;
+	if (v > UINT32_MAX) {
+		PyErr_SetString(PyExc_OverflowError, "Colour must be 0xRRGGBBAA");
+		return -1;
+	}
+	if (!p->set(self->ctx, (uint32_t)v)) {
+		raise_error(self->ctx);
+		return -1;
+	}
+	return 0;
+}
+
+static PyObject* getStr(EncoderObject *self, void *closure) {
+	const struct strProp *p = closure;
+	char *s;
+	if (!check_idle(self))
+		return NULL;
+	if ((s = p->get(self->ctx)) == NULL)
+		Py_RETURN_NONE;
+	return PyUnicode_FromString(s);
+}
+
+static int setStr(EncoderObject *self, PyObject *value, void *closure) {
+	const struct strProp *p = closure;
+	const char *s;
+	if (!check_idle(self))
+		return -1;
+	if (value == NULL) {
+		PyErr_SetString(PyExc_TypeError, "Cannot delete attribute");
+		return -1;
+	}
+	if ((s = PyUnicode_AsUTF8(value)) == NULL)
+		return -1;
+	if (!p->set(self->ctx, s)) {
+		raise_error(self->ctx);
+		return -1;
+	}
+	return 0;
+}
+
+static PyObject* getHRI(EncoderObject *self, void *Py_UNUSED(closure)) {
+	char **hri;
+	int num, i;
+	PyObject *t;
+	if (!check_idle(self))
+		return NULL;
+	num = gs1_encoder_getHRI(self->ctx, &hri);
+	if ((t = PyTuple_New(num)) == NULL)
+		return NULL;
+	for (i = 0; i < num; i++) {
+		PyObject *s = PyUnicode_FromString(hri[i]);
+		if (!s) {
+			Py_DECREF(t);
+			return NULL;
+		}
+		PyTuple_SET_ITEM(t, i, s);
+	}
+	return t;
+}
+
+static PyObject* getAIdataJSON(EncoderObject *self, void *Py_UNUSED(closure)) {
+	char *s;
+	if (!check_idle(self))
+		return NULL;
+	if ((s = gs1_encoder_getAIdataJSON(self->ctx)) == NULL) {
+		if (*gs1_encoder_getErrMsg(self->ctx))
+			return raise_error(self->ctx);
+		Py_RETURN_NONE;
+	}
+	return PyUnicode_FromString(s);
+}
+
+
+static PyObject* getOutputDigest(EncoderObject *self, void *Py_UNUSED(closure)) {
+	void *digest;
+	size_t len;
+	if (!check_idle(self))
+		return NULL;
+	if ((len = gs1_encoder_getOutputDigest(self->ctx, &digest)) == 0)
+		Py_RETURN_NONE;
+	return PyBytes_FromStringAndSize(digest, (Py_ssize_t)len);
+}
+
+static PyObject* getWidth(EncoderObject *self, void *Py_UNUSED(closure)) {
+	if (!check_idle(self))
+		return NULL;
+	return PyLong_FromLong(gs1_encoder_getBufferWidth(self->ctx));
+}
+
+static PyObject* getHeight(EncoderObject *self, void *Py_UNUSED(closure)) {
+	if (!check_idle(self))
+		return NULL;
+	return PyLong_FromLong(gs1_encoder_getBufferHeight(self->ctx));
+}
+
+
+static const struct intProp propSym = { gs1_encoder_getSym, gs1_encoder_setSym };
+static const struct intProp propFormat = { gs1_encoder_getFormat, gs1_encoder_setFormat };
+static const struct intProp propPixMult = { gs1_encoder_getPixMult, gs1_encoder_setPixMult };
+static const struct intProp propXundercut = { gs1_encoder_getXundercut, gs1_encoder_setXundercut };
+static const struct intProp propYundercut = { gs1_encoder_getYundercut, gs1_encoder_setYundercut };
+static const struct intProp propSepHt = { gs1_encoder_getSepHt, gs1_encoder_setSepHt };
+static const struct intProp propSegWidth = { gs1_encoder_getDataBarExpandedSegmentsWidth, gs1_encoder_setDataBarExpandedSegmentsWidth };
+static const struct intProp propLinHeight = { gs1_encoder_getGS1_128LinearHeight, gs1_encoder_setGS1_128LinearHeight };
+static const struct intProp propDmRows = { gs1_encoder_getDmRows, gs1_encoder_setDmRows };
+static const struct intProp propDmColumns = { gs1_encoder_getDmColumns, gs1_encoder_setDmColumns };
+static const struct intProp propQrVersion = { gs1_encoder_getQrVersion, gs1_encoder_setQrVersion };
+static const struct intProp propQrEClevel = { gs1_encoder_getQrEClevel, gs1_encoder_setQrEClevel };
+static const struct intProp propPathMode = { gs1_encoder_getPathMode, gs1_encoder_setPathMode };
+static const struct intProp propRasterThreads = { gs1_encoder_getRasterThreads, gs1_encoder_setRasterThreads };
+static const struct boolProp propPathOptimise = { gs1_encoder_getPathOptimise, gs1_encoder_setPathOptimise };
+static const struct boolProp propRenderHRI = { gs1_encoder_getRenderHRI, gs1_encoder_setRenderHRI };
+static const struct floatProp propPreviewScale = { gs1_encoder_getPreviewScale, gs1_encoder_setPreviewScale };
+static const struct colourProp propPreviewDarkColour = { gs1_encoder_getPreviewDarkColour, gs1_encoder_setPreviewDarkColour };
+static const struct colourProp propPreviewLightColour = { gs1_encoder_getPreviewLightColour, gs1_encoder_setPreviewLightColour };
+static const struct intProp propOutputDigestAlg = { gs1_encoder_getOutputDigestAlg, gs1_encoder_setOutputDigestAlg };
+static const struct boolProp propAddCheckDigit = { gs1_encoder_getAddCheckDigit, gs1_encoder_setAddCheckDigit };
+static const struct boolProp propPermitUnknownAIs = { gs1_encoder_getPermitUnknownAIs, gs1_encoder_setPermitUnknownAIs };
+static const struct strProp propOutFile = { gs1_encoder_getOutFile, gs1_encoder_setOutFile };
+static const struct strProp propDataStr = { gs1_encoder_getDataStr, gs1_encoder_setDataStr };
+static const struct strProp propAIdataStr = { gs1_encoder_getAIdataStr, gs1_encoder_setAIdataStr };
+static const struct strProp propScanData = { gs1_encoder_getScanData, gs1_encoder_setScanData };
+
+#define INT_PROP(name, p) { name, (getter)getInt, (setter)setInt, NULL, (void *)&p }
+#define BOOL_PROP(name, p) { name, (getter)getBool, (setter)setBool, NULL, (void *)&p }
+#define STR_PROP(name, p) { name, (getter)getStr, (setter)setStr, NULL, (void *)&p }
+#define FLOAT_PROP(name, p) { name, (getter)getFloat, (setter)setFloat, NULL, (void *)&p }
+#define COLOUR_PROP(name, p) { name, (getter)getColour, (setter)setColour, NULL, (void *)&p }
+
+static PyGetSetDef Encoder_getset[] = {
+	INT_PROP("sym", propSym),
+	INT_PROP("format", propFormat),
+	INT_PROP("pixMult", propPixMult),
+	INT_PROP("Xundercut", propXundercut),
+	INT_PROP("Yundercut", propYundercut),
+	INT_PROP("sepHt", propSepHt),
+	INT_PROP("dataBarExpandedSegmentsWidth", propSegWidth),
+	INT_PROP("gs1_128LinearHeight", propLinHeight),
+	INT_PROP("dmRows", propDmRows),
+	INT_PROP("dmColumns", propDmColumns),
+	INT_PROP("qrVersion", propQrVersion),
+	INT_PROP("qrEClevel", propQrEClevel),
+	INT_PROP("pathMode", propPathMode),
+	INT_PROP("rasterThreads", propRasterThreads),
+	BOOL_PROP("pathOptimise", propPathOptimise),
+	BOOL_PROP("renderHRI", propRenderHRI),
+	FLOAT_PROP("previewScale", propPreviewScale),
+	COLOUR_PROP("previewDarkColour", propPreviewDarkColour),
+	COLOUR_PROP("previewLightColour", propPreviewLightColour),
+	INT_PROP("outputDigestAlg", propOutputDigestAlg),
+	BOOL_PROP("addCheckDigit", propAddCheckDigit),
+	BOOL_PROP("permitUnknownAIs", propPermitUnknownAIs),
+	STR_PROP("outFile", propOutFile),
+	STR_PROP("dataStr", propDataStr),
+	STR_PROP("aiDataStr", propAIdataStr),
+	STR_PROP("scanData", propScanData),
+	{ "hri", (getter)getHRI, NULL, "Tuple of HRI strings", NULL },
+	{ "aiDataJSON", (getter)getAIdataJSON, NULL, "AI data as a JSON object, or None for non-AI data", NULL },
+	{ "width", (getter)getWidth, NULL, "Width of the output image", NULL },
+	{ "height", (getter)getHeight, NULL, "Height of the output image", NULL },
+	{ "outputDigest", (getter)getOutputDigest, NULL, "Digest of the last output, or None", NULL },
+	{ NULL, NULL, NULL, NULL, NULL }
+};
+
+
+/*
+ *  Buffer protocol: read-only view of the library-managed output buffer
+ *
+ */
+static int Encoder_getbuffer(EncoderObject *self, Py_buffer *view, int flags) {
+
+	void *buf = NULL;
+	size_t size;
+
+	if (!check_idle(self)) {
+		view->obj = NULL;
+		return -1;
+	}
+
+	size = gs1_encoder_getBuffer(self->ctx, &buf);
+	if (PyBuffer_FillInfo(view, (PyObject *)self, buf, (Py_ssize_t)size, 1, flags) < 0)
+		return -1;
+	self->exports++;
+	return 0;
+
+}
+
+static void Encoder_releasebuffer(EncoderObject *self, Py_buffer *Py_UNUSED(view)) {
+	self->exports--;
+}
+
+static PyBufferProcs Encoder_as_buffer = {
+	(getbufferproc)Encoder_getbuffer,
+	(releasebufferproc)Encoder_releasebuffer,
+};
+
+
+static PyTypeObject EncoderType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "gs1encoders.Encoder",
+	.tp_doc = "An instance of the GS1 Barcode Engine",
+	.tp_basicsize = sizeof(EncoderObject),
+	.tp_itemsize = 0,
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_new = PyType_GenericNew,
+	.tp_init = (initproc)Encoder_init,
+	.tp_dealloc = (destructor)Encoder_dealloc,
+	.tp_methods = Encoder_methods,
+	.tp_getset = Encoder_getset,
+	.tp_as_buffer = &Encoder_as_buffer,
+};
+
+
+/*
+ *  Symbol: result of a batch encode that owns its image
+ *
+ */
+typedef struct {
+	PyObject_HEAD
+	uint8_t *buf;
+	size_t size;
+	int width;
+	int height;
+	PyObject *error;		// None on success, else the error message
+} SymbolObject;
+
+
+static void Symbol_dealloc(SymbolObject *self) {
+	free(self->buf);
+	Py_XDECREF(self->error);
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int Symbol_getbuffer(SymbolObject *self, Py_buffer *view, int flags) {
+	return PyBuffer_FillInfo(view, (PyObject *)self, self->buf, (Py_ssize_t)self->size, 1, flags);
+}
+
+static PyBufferProcs Symbol_as_buffer = {
+	(getbufferproc)Symbol_getbuffer,
+	NULL,
+};
+
+static PyObject* Symbol_getError(SymbolObject *self, void *Py_UNUSED(closure)) {
+	Py_INCREF(self->error);
+	return self->error;
+}
+
+static PyObject* Symbol_getWidth(SymbolObject *self, void *Py_UNUSED(closure)) {
+	return PyLong_FromLong(self->width);
+}
+
+static PyObject* Symbol_getHeight(SymbolObject *self, void *Py_UNUSED(closure)) {
+	return PyLong_FromLong(self->height);
+}
+
+static PyGetSetDef Symbol_getset[] = {
+	{ "error", (getter)Symbol_getError, NULL, "None on success, otherwise the error message", NULL },
+	{ "width", (getter)Symbol_getWidth, NULL, "Width of the image", NULL },
+	{ "height", (getter)Symbol_getHeight, NULL, "Height of the image", NULL },
+	{ NULL, NULL, NULL, NULL, NULL }
+};
+
+static PyTypeObject SymbolType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "gs1encoders.Symbol",
+	.tp_doc = "A symbol generated by encode_batch()",
+	.tp_basicsize = sizeof(SymbolObject),
+	.tp_itemsize = 0,
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_dealloc = (destructor)Symbol_dealloc,
+	.tp_getset = Symbol_getset,
+	.tp_as_buffer = &Symbol_as_buffer,
+};
+
+
+/*
+ *  Batch encoding across native threads
+ *
+ */
+struct batchItem {
+	const char *data;		// UTF-8 owned by the input list
+	uint8_t *buf;
+	size_t size;
+	int width;
+	int height;
+	char errMsg[512];
+};
+
+struct batchJob {
+	struct batchItem *items;
+	Py_ssize_t num;
+	Py_ssize_t next;		// Next item to be claimed
+	int sym;
+	int format;
+	int pixMult;
+	bool aiSyntax;
+#ifndef _WIN32
+	pthread_mutex_t lock;
+#endif
+};
+
+
+static void encodeItem(gs1_encoder *ctx, struct batchJob *job, struct batchItem *item) {
+
+	void *buf;
+	bool ok;
+
+	ok = job->aiSyntax ? gs1_encoder_setAIdataStr(ctx, item->data) : gs1_encoder_setDataStr(ctx, item->data);
+	if (ok)
+		ok = gs1_encoder_encode(ctx);
+	if (!ok) {
+		strncpy(item->errMsg, gs1_encoder_getErrMsg(ctx), sizeof(item->errMsg) - 1);
+		return;
+	}
+
+	item->size = gs1_encoder_getBuffer(ctx, &buf);
+	item->width = gs1_encoder_getBufferWidth(ctx);
+	item->height = gs1_encoder_getBufferHeight(ctx);
+	if ((item->buf = malloc(item->size ? item->size : 1)) == NULL) {
+		strcpy(item->errMsg, "Out of memory");
+		item->size = 0;
+		return;
+	}
+	memcpy(item->buf, buf, item->size);
+
+}
+
+
+static void* batchWorker(void *arg) {
+
+	struct batchJob *job = arg;
+	gs1_encoder *ctx;
+	Py_ssize_t i;
+
+	if ((ctx = gs1_encoder_init(NULL)) == NULL)
+		return NULL;		// Items left unclaimed are reported by the caller
+
+	gs1_encoder_setOutFile(ctx, "");
+	gs1_encoder_setFormat(ctx, job->format);
+	gs1_encoder_setSym(ctx, job->sym);
+	gs1_encoder_setPixMult(ctx, job->pixMult);
+
+	for (;;) {
+#ifndef _WIN32
+		pthread_mutex_lock(&job->lock);
+		i = job->next++;
+		pthread_mutex_unlock(&job->lock);
+#else
+		i = job->next++;
+#endif
+		if (i >= job->num)
+			break;
+		encodeItem(ctx, job, &job->items[i]);
+	}
+
+	gs1_encoder_free(ctx);
+	return NULL;
+
+}
+
+
+static int defaultThreads(void) {
+#ifndef _WIN32
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (int)n : 1;
+#else
+	return 1;
+#endif
+}
+
+
+static PyObject* gs1encoders_encode_batch(PyObject *Py_UNUSED(module), PyObject *args, PyObject *kwds) {
+
+	static char *kwlist[] = { "sym", "data", "format", "pixMult", "aiSyntax", "threads", NULL };
+
+	int sym, format = gs1_encoder_dRAW, pixMult = 1, aiSyntax = 1, threads = 0, t, started = 0;
+	PyObject *data, *seq = NULL, *result = NULL;
+	struct batchJob job;
+	Py_ssize_t i;
+#ifndef _WIN32
+	pthread_t tids[MAX_BATCH_THREADS];
+#endif
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "iO|iipi", kwlist,
+					 &sym, &data, &format, &pixMult, &aiSyntax, &threads))
+		return NULL;
+
+	if (sym <= gs1_encoder_sNONE || sym >= gs1_encoder_sNUMSYMS) {
+		PyErr_SetString(GS1EncoderError, "Unknown symbology");
+		return NULL;
+	}
+	if (pixMult < 1 || pixMult > gs1_encoder_getMaxPixMult()) {
+		PyErr_Format(GS1EncoderError, "Valid X-dimension range is 1 to %d", gs1_encoder_getMaxPixMult());
+		return NULL;
+	}
+	if (format < gs1_encoder_dBMP || format > gs1_encoder_dRGBA) {
+		PyErr_SetString(GS1EncoderError, "Unknown output format");
+		return NULL;
+	}
+
+	if ((seq = PySequence_Fast(data, "data must be a sequence of strings")) == NULL)
+		return NULL;
+
+	memset(&job, 0, sizeof(job));
+	job.num = PySequence_Fast_GET_SIZE(seq);
+	job.sym = sym;
+	job.format = format;
+	job.pixMult = pixMult;
+	job.aiSyntax = aiSyntax != 0;
+
+	if ((job.items = calloc((size_t)(job.num ? job.num : 1), sizeof(struct batchItem))) == NULL) {
+		PyErr_NoMemory();
+		goto out;
+	}
+	for (i = 0; i < job.num; i++) {
+		if ((job.items[i].data = PyUnicode_AsUTF8(PySequence_Fast_GET_ITEM(seq, i))) == NULL)
+			goto out;
+	}
+
+	if (threads <= 0)
+		threads = defaultThreads();
+	if (threads > MAX_BATCH_THREADS)
+		threads = MAX_BATCH_THREADS;
+	if (threads > job.num)
+		threads = (int)job.num;
+
+	Py_BEGIN_ALLOW_THREADS
+#ifndef _WIN32
+	pthread_mutex_init(&job.lock, NULL);
+	for (t = 0; t < threads; t++) {
+		if (pthread_create(&tids[t], NULL, batchWorker, &job) != 0)
+			break;
+		started++;
+	}
+	if (started == 0)
+		batchWorker(&job);
+	for (t = 0; t < started; t++)
+		pthread_join(tids[t], NULL);
+	pthread_mutex_destroy(&job.lock);
+#else
+	(void)t;
+	(void)started;
+	batchWorker(&job);
+#endif
+	Py_END_ALLOW_THREADS
+
+	if ((result = PyList_New(job.num)) == NULL)
+		goto out;
+
+	for (i = 0; i < job.num; i++) {
+		struct batchItem *item = &job.items[i];
+		SymbolObject *symbol = PyObject_New(SymbolObject, &SymbolType);
+		if (!symbol) {
+			Py_CLEAR(result);
+			goto out;
+		}
+		symbol->buf = item->buf;		// Ownership passes to the Symbol
+		symbol->size = item->size;
+		symbol->width = item->width;
+		symbol->height = item->height;
+		item->buf = NULL;
+		if (*item->errMsg)
+			symbol->error = PyUnicode_FromString(item->errMsg);
+		else if (!symbol->buf)
+			symbol->error = PyUnicode_FromString("Failed to initialise GS1 Barcode Engine");
+		else {
+			symbol->error = Py_None;
+			Py_INCREF(Py_None);
+		}
+		PyList_SET_ITEM(result, i, (PyObject *)symbol);
+		if (!symbol->error) {
+			Py_CLEAR(result);
+			goto out;
+		}
+	}
+
+out:
+	if (job.items) {
+		for (i = 0; i < job.num; i++)
+			free(job.items[i].buf);
+		free(job.items);
+	}
+	Py_DECREF(seq);
+	return result;
+
+}
+
+
+static PyObject* gs1encoders_version(PyObject *Py_UNUSED(module), PyObject *Py_UNUSED(ignored)) {
+	return PyUnicode_FromString(gs1_encoder_getVersion());
+}
+
+
+static PyMethodDef gs1encoders_methods[] = {
+	{ "encode_batch", (PyCFunction)(void(*)(void))gs1encoders_encode_batch, METH_VARARGS | METH_KEYWORDS,
+	  "encode_batch(sym, data, format=RAW, pixMult=1, aiSyntax=True, threads=0)\n\n"
+	  "Encode each string in data across native threads, returning a list of Symbol objects." },
+	{ "version", gs1encoders_version, METH_NOARGS, "Version of the native library." },
+	{ NULL, NULL, 0, NULL }
+};
+
+
+static struct PyModuleDef gs1encodersmodule = {
+	PyModuleDef_HEAD_INIT,
+	.m_name = "gs1encoders",
+	.m_doc = "Native interface to the GS1 Barcode Engine",
+	.m_size = -1,
+	.m_methods = gs1encoders_methods,
+};
+
+
+struct constant {
+	const char *name;
+	int value;
+};
+
+static const struct constant constants[] = {
+	{ "sNONE", gs1_encoder_sNONE },
+	{ "sDataBarOmni", gs1_encoder_sDataBarOmni },
+	{ "sDataBarTruncated", gs1_encoder_sDataBarTruncated },
+	{ "sDataBarStacked", gs1_encoder_sDataBarStacked },
+	{ "sDataBarStackedOmni", gs1_encoder_sDataBarStackedOmni },
+	{ "sDataBarLimited", gs1_encoder_sDataBarLimited },
+	{ "sDataBarExpanded", gs1_encoder_sDataBarExpanded },
+	{ "sUPCA", gs1_encoder_sUPCA },
+	{ "sUPCE", gs1_encoder_sUPCE },
+	{ "sEAN13", gs1_encoder_sEAN13 },
+	{ "sEAN8", gs1_encoder_sEAN8 },
+	{ "sGS1_128_CCA", gs1_encoder_sGS1_128_CCA },
+	{ "sGS1_128_CCC", gs1_encoder_sGS1_128_CCC },
+	{ "sQR", gs1_encoder_sQR },
+	{ "sDM", gs1_encoder_sDM },
+	{ "sRMQR", gs1_encoder_sRMQR },
+	{ "sITF14", gs1_encoder_sITF14 },
+	{ "dBMP", gs1_encoder_dBMP },
+	{ "dTIF", gs1_encoder_dTIF },
+	{ "dRAW", gs1_encoder_dRAW },
+	{ "dPATH", gs1_encoder_dPATH },
+	{ "dGRAY", gs1_encoder_dGRAY },
+	{ "dRGBA", gs1_encoder_dRGBA },
+	{ "pathDOTS", gs1_encoder_pathDOTS },
+	{ "pathSTROKES", gs1_encoder_pathSTROKES },
+	{ "qrEClevelL", gs1_encoder_qrEClevelL },
+	{ "qrEClevelM", gs1_encoder_qrEClevelM },
+	{ "qrEClevelQ", gs1_encoder_qrEClevelQ },
+	{ "qrEClevelH", gs1_encoder_qrEClevelH },
+	{ "digestNONE", gs1_encoder_digestNONE },
+	{ "digestXXH64", gs1_encoder_digestXXH64 },
+	{ "digestSHA256", gs1_encoder_digestSHA256 },
+	{ "colOK", gs1_encoder_colOK },
+	{ "colEMPTY", gs1_encoder_colEMPTY },
+	{ "colLENGTH", gs1_encoder_colLENGTH },
+	{ "colCHARSET", gs1_encoder_colCHARSET },
+	{ "colCHECKDIGIT", gs1_encoder_colCHECKDIGIT },
+	{ "colCONTENT", gs1_encoder_colCONTENT },
+	{ "capBITS", gs1_encoder_capBITS },
+	{ "capSYMCHARS", gs1_encoder_capSYMCHARS },
+	{ NULL, 0 }
+};
+
+
+PyMODINIT_FUNC PyInit_gs1encoders(void) {
+
+	PyObject *m;
+	const struct constant *c;
+
+	if (PyType_Ready(&EncoderType) < 0 || PyType_Ready(&SymbolType) < 0)
+		return NULL;
+
+	if ((m = PyModule_Create(&gs1encodersmodule)) == NULL)
+		return NULL;
+
+	GS1EncoderError = PyErr_NewException("gs1encoders.GS1EncoderError", PyExc_ValueError, NULL);
+	Py_XINCREF(GS1EncoderError);
+	if (PyModule_AddObject(m, "GS1EncoderError", GS1EncoderError) < 0)
+		goto fail;
+
+	Py_INCREF(&EncoderType);
+	if (PyModule_AddObject(m, "Encoder", (PyObject *)&EncoderType) < 0) {
+		Py_DECREF(&EncoderType);
+		goto fail;
+	}
+
+	Py_INCREF(&SymbolType);
+	if (PyModule_AddObject(m, "Symbol", (PyObject *)&SymbolType) < 0) {
+		Py_DECREF(&SymbolType);
+		goto fail;
+	}
+
+	for (c = constants; c->name; c++) {
+		if (PyModule_AddIntConstant(m, c->name, c->value) < 0)
+			goto fail;
+	}
+
+	return m;
+
+fail:
+	Py_XDECREF(GS1EncoderError);
+	Py_CLEAR(GS1EncoderError);
+	Py_DECREF(m);
+	return NULL;
+
+}
@@ -0,0 +1,60 @@
+#
+# GS1 Barcode Engine
+#
+# @author Copyright (c) 2021 GS1 AISBL.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+#
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+#
+#  Builds the native extension together with the C library sources:
+#
+#      python3 setup.py build_ext --inplace
+#      python3 -m unittest -v
+#
+
+import os
+import re
+import sys
+from glob import glob
+
+from setuptools import Extension, setup
+
+CLIB = os.path.join('..', 'c-lib')
+
+# Library sources only; not the console application, unit tests or fuzzers
+LIB_SRCS = sorted(f for f in glob(os.path.join(CLIB, '*.c'))
+                  if not re.search(r'gs1encoders-(app|test|nomalloc-test|fuzzer)', os.path.basename(f)))
+
+extra_compile_args = []
+extra_link_args = []
+if sys.platform != 'win32':
+    extra_compile_args = ['-O2', '-pthread']
+    extra_link_args = ['-pthread']
+
+setup(
+    name='gs1encoders',
+    version='1.0',
+    description='Native interface to the GS1 Barcode Engine',
+    license='Apache-2.0',
+    ext_modules=[
+        Extension(
+            'gs1encoders',
+            sources=['gs1encodersmodule.c'] + LIB_SRCS,
+            include_dirs=[CLIB],
+            extra_compile_args=extra_compile_args,
+            extra_link_args=extra_link_args,
+        ),
+    ],
+)
@@ -0,0 +1,201 @@
+#
+# GS1 Barcode Engine
+#
+# @author Copyright (c) 2021 GS1 AISBL.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+#
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+import hashlib
+import json
+import threading
+import unittest
+
+import gs1encoders
+
+
+def new_encoder(sym):
+    enc = gs1encoders.Encoder()
+    enc.outFile = ''
+    enc.format = gs1encoders.dRAW
+    enc.sym = sym
+    return enc
+
+
+class TestEncoder(unittest.TestCase):
+
+    def test_properties(self):
+        enc = gs1encoders.Encoder()
+        self.assertEqual(enc.sym, gs1encoders.sNONE)
+        self.assertEqual(enc.pixMult, 1)
+        enc.pixMult = 3
+        self.assertEqual(enc.pixMult, 3)
+        with self.assertRaises(gs1encoders.GS1EncoderError):
+            enc.pixMult = 0
+        enc.addCheckDigit = True
+        self.assertTrue(enc.addCheckDigit)
+
+    def test_ai_data(self):
+        enc = new_encoder(gs1encoders.sDM)
+        enc.aiDataStr = '(01)12345678901231(10)ABC123'
+        self.assertEqual(enc.dataStr, '^011234567890123110ABC123')
+        self.assertEqual(enc.hri, ('(01) 12345678901231', '(10) ABC123'))
+        self.assertEqual(json.loads(enc.aiDataJSON), {'01': '12345678901231', '10': 'ABC123'})
+        with self.assertRaises(gs1encoders.GS1EncoderError) as cm:
+            enc.aiDataStr = '(01)12345678901234'
+        self.assertIn('check digit', str(cm.exception))
+
+    def test_normalise_dl_uri(self):
+        enc = gs1encoders.Encoder()
+        es, uri = enc.normaliseDLuri('http://example.com/01/9520123456788?99=A%2a&10=L1')
+        self.assertEqual(es, '^010952012345678810L1^99A*')
+        self.assertEqual(uri, 'https://id.gs1.org/01/09520123456788/10/L1?99=A%2A')
+        with self.assertRaises(gs1encoders.GS1EncoderError):
+            enc.normaliseDLuri('https://example.com/01/09520123456789')
+
+    def test_validate_ai_column(self):
+        import array
+        enc = gs1encoders.Encoder()
+        values = ['12312312312333', '12312312312334', '', '1231231231233']
+        offsets = array.array('i', [0])
+        for v in values:
+            offsets.append(offsets[-1] + len(v))
+        validity, faults = enc.validateAIcolumn('01', ''.join(values).encode(), offsets)
+        self.assertEqual(validity, b'\x01')
+        self.assertEqual(list(faults), [gs1encoders.colOK, gs1encoders.colCHECKDIGIT,
+                                        gs1encoders.colEMPTY, gs1encoders.colLENGTH])
+        with self.assertRaises(gs1encoders.GS1EncoderError):
+            enc.validateAIcolumn('0', b'', array.array('i', [0]))
+        with self.assertRaises(ValueError):
+            enc.validateAIcolumn('01', b'123', offsets)
+
+    def test_buffer_is_not_copied(self):
+        enc = new_encoder(gs1encoders.sEAN13)
+        enc.dataStr = '2112345678900'
+        enc.encode()
+        mv = memoryview(enc)
+        self.assertTrue(mv.readonly)
+        self.assertEqual(mv.nbytes, ((enc.width + 7) // 8) * enc.height)
+        self.assertIs(mv.obj, enc)
+        rows = enc.getBufferStrings()
+        self.assertEqual(len(rows), enc.height)
+        self.assertEqual(len(rows[0]), enc.width)
+
+        # The output cannot be regenerated while it is exported
+        with self.assertRaises(BufferError):
+            enc.encode()
+        with self.assertRaises(BufferError):
+            enc.__init__()
+        self.assertEqual(mv.tobytes(), bytes(memoryview(enc)))
+        mv.release()
+        enc.encode()
+        enc.__init__()
+        self.assertEqual(enc.sym, gs1encoders.sNONE)
+
+    def test_output_digest(self):
+        enc = new_encoder(gs1encoders.sQR)
+        enc.dataStr = 'https://id.gs1.org/01/12312312312333'
+        enc.encode()
+        self.assertIsNone(enc.outputDigest)
+        enc.outputDigestAlg = gs1encoders.digestSHA256
+        enc.encode()
+        self.assertEqual(enc.outputDigest, hashlib.sha256(enc).digest())
+        with self.assertRaises(gs1encoders.GS1EncoderError):
+            enc.outputDigestAlg = 99
+
+    def test_capacity(self):
+        enc = new_encoder(gs1encoders.sDM)
+        enc.dataStr = '^011231231231233310ABC123'
+        cap = enc.getCapacity()
+        self.assertEqual(cap['units'], gs1encoders.capBITS)
+        self.assertEqual((cap['used'], cap['capacity']), (120, 144))
+        self.assertEqual((cap['rows'], cap['columns']), (18, 18))
+        self.assertTrue(cap['fits'])
+        enc.sym = gs1encoders.sITF14
+        with self.assertRaises(gs1encoders.GS1EncoderError):
+            enc.getCapacity()
+
+    def test_preview(self):
+        enc = new_encoder(gs1encoders.sDM)
+        enc.dataStr = '^011231231231233310ABC123'
+        enc.encode()
+        w, h = enc.width, enc.height
+        enc.format = gs1encoders.dRGBA
+        enc.previewScale = 2.5
+        enc.previewDarkColour = 0x102030FF
+        self.assertEqual(enc.previewDarkColour, 0x102030FF)
+        self.assertEqual(enc.previewLightColour, 0xFFFFFFFF)
+        enc.encode()
+        self.assertEqual((enc.width, enc.height), ((w * 5 + 1) // 2, (h * 5 + 1) // 2))
+        self.assertEqual(len(memoryview(enc)), 4 * enc.width * enc.height)
+        with self.assertRaises(gs1encoders.GS1EncoderError):
+            enc.previewScale = 0
+        with self.assertRaises(OverflowError):
+            enc.previewLightColour = 1 << 32
+
+    def test_encode_error(self):
+        enc = new_encoder(gs1encoders.sEAN13)
+        enc.dataStr = '211234567890'
+        with self.assertRaises(gs1encoders.GS1EncoderError):
+            enc.encode()
+
+    def test_encode_releases_gil(self):
+        encs = [new_encoder(gs1encoders.sQR) for _ in range(4)]
+        for enc in encs:
+            enc.aiDataStr = '(01)12345678901231(99)' + 'A' * 80
+        threads = [threading.Thread(target=enc.encode) for enc in encs]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        self.assertEqual(len({bytes(memoryview(enc)) for enc in encs}), 1)
+
+
+class TestBatch(unittest.TestCase):
+
+    def test_batch(self):
+        data = ['(01)%013d%d' % (i, d) for i in range(200) for d in range(10)]
+        symbols = gs1encoders.encode_batch(gs1encoders.sDM, data, threads=4)
+        self.assertEqual(len(symbols), len(data))
+
+        enc = new_encoder(gs1encoders.sDM)
+        for d, sym in zip(data, symbols):
+            try:
+                enc.aiDataStr = d
+            except gs1encoders.GS1EncoderError as e:
+                self.assertIsNotNone(sym.error)
+                self.assertEqual(str(e), sym.error)
+                continue
+            enc.encode()
+            self.assertIsNone(sym.error)
+            self.assertEqual((sym.width, sym.height), (enc.width, enc.height))
+            self.assertEqual(memoryview(sym).tobytes(), memoryview(enc).tobytes())
+
+    def test_batch_plain_data(self):
+        symbols = gs1encoders.encode_batch(gs1encoders.sEAN13, ['2112345678900', 'bad'],
+                                           aiSyntax=False, pixMult=2)
+        self.assertIsNone(symbols[0].error)
+        self.assertGreater(len(memoryview(symbols[0])), 0)
+        self.assertIsNotNone(symbols[1].error)
+        self.assertEqual(len(memoryview(symbols[1])), 0)
+
+    def test_batch_bad_args(self):
+        with self.assertRaises(gs1encoders.GS1EncoderError):
+            gs1encoders.encode_batch(gs1encoders.sNUMSYMS if hasattr(gs1encoders, 'sNUMSYMS') else 99, [])
+        with self.assertRaises(TypeError):
+            gs1encoders.encode_batch(gs1encoders.sDM, [1, 2])
+
+
+if __name__ == '__main__':
+    unittest.main()